@@ -518,6 +518,9 @@ void	DBinit_autoincrement_options(void);
 
 int	DBconnect(int flag);
 void	DBclose(void);
+int	DBparallel_open(int num);
+int	DBparallel_wait(void);
+void	DBparallel_close(void);
 
 int	zbx_db_validate_config_features(void);
 #if defined(HAVE_MYSQL) || defined(HAVE_POSTGRESQL)
@@ -531,6 +534,7 @@ int		DBexecute(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 int		DBexecute_once(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselect_once(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselect(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
+DB_RESULT	DBselect_parallel(const char *fmt, ...) __zbx_attr_format_printf(1, 2);
 DB_RESULT	DBselectN(const char *query, int n);
 DB_ROW		DBfetch(DB_RESULT result);
 int		DBis_null(const char *field);
@@ -142,6 +142,7 @@ typedef struct
 	zbx_uint64_t		itemid;
 	zbx_uint64_t		lastlogsize;
 	zbx_uint64_t		valuemapid;
+	zbx_uint64_t		macro_revision;	/* configuration cache macro revision at retrieval time */
 	unsigned char		type;
 	unsigned char		snmp_version;
 	unsigned char		value_type;
@@ -163,6 +164,7 @@ typedef struct
 	unsigned char		verify_peer;
 	unsigned char		verify_host;
 	unsigned char		allow_traps;
+	unsigned char		macros_resolved;	/* key and SNMP OID were resolved by configuration cache */
 	char			key_orig[ITEM_KEY_LEN * ZBX_MAX_BYTES_IN_UTF8_CHAR + 1], *key;
 	char			*units;
 	char			*delay;
@@ -200,6 +202,31 @@ typedef struct
 }
 DC_ITEM;
 
+/* item data required by history syncers - unlike DC_ITEM it does not contain */
+/* item type specific poll information and is cheap to copy in large batches  */
+typedef struct
+{
+	DC_HOST			host;
+	zbx_uint64_t		itemid;
+	zbx_uint64_t		lastlogsize;
+	zbx_uint64_t		valuemapid;
+	unsigned char		type;
+	unsigned char		value_type;
+	unsigned char		state;
+	unsigned char		flags;
+	unsigned char		inventory_link;
+	unsigned char		status;
+	unsigned char		history;
+	unsigned char		trends;
+	char			*key_orig;
+	char			*units;
+	char			*error;
+	int			history_sec;
+	int			trends_sec;
+	int			mtime;
+}
+zbx_history_sync_item_t;
+
 typedef struct
 {
 	zbx_uint64_t	functionid;
@@ -472,6 +499,16 @@ typedef struct
 }
 zbx_correlation_rules_t;
 
+/* problem event, used to cache open problems for recovery attempts and correlation */
+typedef struct
+{
+	zbx_uint64_t		eventid;
+	zbx_uint64_t		triggerid;
+
+	zbx_vector_ptr_t	tags;
+}
+zbx_event_problem_t;
+
 /* value_avg_t structure is used for item average value trend calculations. */
 /*                                                                          */
 /* For double values the average value is calculated on the fly with the    */
@@ -688,6 +725,9 @@ void	DCconfig_get_items_by_keys(DC_ITEM *items, zbx_host_key_t *keys, int *errco
 void	DCconfig_get_items_by_itemids(DC_ITEM *items, const zbx_uint64_t *itemids, int *errcodes, size_t num);
 void	DCconfig_get_items_by_itemids_partial(DC_ITEM *items, const zbx_uint64_t *itemids, int *errcodes, size_t num,
 		unsigned int mode);
+void	DCconfig_history_sync_get_items_by_itemids(zbx_history_sync_item_t *items, const zbx_uint64_t *itemids,
+		int *errcodes, size_t num, unsigned int mode);
+void	DCconfig_clean_history_sync_items(zbx_history_sync_item_t *items, int *errcodes, size_t num);
 void	DCconfig_get_preprocessable_items(zbx_hashset_t *items, int *timestamp);
 void	DCconfig_get_functions_by_functionids(DC_FUNCTION *functions,
 		zbx_uint64_t *functionids, int *errcodes, size_t num);
@@ -707,6 +747,7 @@ int	DCconfig_get_interface_by_type(DC_INTERFACE *interface, zbx_uint64_t hostid,
 int	DCconfig_get_interface(DC_INTERFACE *interface, zbx_uint64_t hostid, zbx_uint64_t itemid);
 int	DCconfig_get_poller_nextcheck(unsigned char poller_type);
 int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items);
+void	DCconfig_set_resolved_items(const DC_ITEM *items, const int *errcodes, int num);
 int	DCconfig_get_ipmi_poller_items(int now, DC_ITEM *items, int items_num, int *nextcheck);
 int	DCconfig_get_snmp_interfaceids_by_addr(const char *addr, zbx_uint64_t **interfaceids);
 size_t	DCconfig_get_snmp_items_by_interfaceid(zbx_uint64_t interfaceid, DC_ITEM **items);
@@ -841,6 +882,11 @@ void	zbx_dc_correlation_rules_clean(zbx_correlation_rules_t *rules);
 void	zbx_dc_correlation_rules_free(zbx_correlation_rules_t *rules);
 void	zbx_dc_correlation_rules_get(zbx_correlation_rules_t *rules);
 
+int	zbx_dc_get_open_problems(const zbx_vector_str_t *tags, zbx_vector_ptr_t *problems);
+void	zbx_dc_update_open_problems(const zbx_vector_ptr_t *problem_events,
+		const zbx_vector_uint64_t *closed_eventids);
+int	zbx_dc_check_hostgroup_hosts(zbx_uint64_t groupid, const zbx_vector_uint64_t *hostids);
+
 void	zbx_dc_get_nested_hostgroupids(zbx_uint64_t *groupids, int groupids_num, zbx_vector_uint64_t *nested_groupids);
 void	zbx_dc_get_hostids_by_group_name(const char *name, zbx_vector_uint64_t *hostids);
 
@@ -24,10 +24,24 @@
 #define ZBX_FLAG_EXPTYPE_HISTORY	2
 #define ZBX_FLAG_EXPTYPE_TRENDS		4
 
+typedef struct
+{
+	zbx_uint64_t	total_size;
+	zbx_uint64_t	free_size;
+	zbx_uint64_t	written_num;
+	zbx_uint64_t	dropped_num;
+}
+zbx_export_cache_stats_t;
+
 int	zbx_validate_export_type(char *export_type, uint32_t *export_mask);
 int	zbx_is_export_enabled(uint32_t flags);
 int	zbx_export_init(char **error);
 
+int	zbx_is_export_cache_enabled(void);
+int	zbx_export_cache_write(void);
+void	zbx_export_cache_flush(void);
+int	zbx_export_cache_get_stats(zbx_export_cache_stats_t *stats);
+
 void	zbx_problems_export_init(const char *process_name, int process_num);
 void	zbx_problems_export_write(const char *buf, size_t count);
 void	zbx_problems_export_flush(void);
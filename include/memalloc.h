@@ -29,25 +29,41 @@
 #define MEM_MAX_BUCKET_SIZE	256 /* starting from this size all free chunks are put into the same bucket */
 #define MEM_BUCKET_COUNT	((MEM_MAX_BUCKET_SIZE - MEM_MIN_BUCKET_SIZE) / 8 + 1)
 
+/* small allocations are served from slabs of fixed size objects, one size class per 8 bytes */
+#define MEM_SLAB_CLASS_COUNT	16
+#define MEM_SLAB_MAX_ALLOC	(MEM_SLAB_CLASS_COUNT * 8)
+
 typedef struct
 {
-	void		*base;
-	void		**buckets;
-	void		*lo_bound;
-	void		*hi_bound;
-	zbx_uint64_t	free_size;
-	zbx_uint64_t	used_size;
-	zbx_uint64_t	orig_size;
-	zbx_uint64_t	total_size;
-	int		shm_id;
+	void		*slabs;		/* slabs having free objects */
+	zbx_uint64_t	slabs_num;
+	zbx_uint64_t	objects_num;
+	zbx_uint64_t	used_num;
+}
+zbx_mem_slab_class_t;
+
+typedef struct
+{
+	void			*base;
+	void			**buckets;
+	zbx_mem_slab_class_t	*slab_classes;	/* NULL if slabs are not used */
+	void			*lo_bound;
+	void			*hi_bound;
+	zbx_uint64_t		free_size;
+	zbx_uint64_t		slab_free_size;	/* free slab objects, not included in free_size */
+	zbx_uint64_t		used_size;
+	zbx_uint64_t		orig_size;
+	zbx_uint64_t		total_size;
+	zbx_uint64_t		page_size;	/* size of memory pages backing the segment */
+	int			shm_id;
 
 	/* Continue execution in out of memory situation.                         */
 	/* Normally allocator forces exit when it runs out of allocatable memory. */
 	/* Set this flag to 1 to allow execution in out of memory situations.     */
-	char		allow_oom;
+	char			allow_oom;
 
-	const char	*mem_descr;
-	const char	*mem_param;
+	const char		*mem_descr;
+	const char		*mem_param;
 }
 zbx_mem_info_t;
 
@@ -61,12 +77,23 @@ typedef struct
 	unsigned int	chunks_num[MEM_BUCKET_COUNT];
 	unsigned int	free_chunks;
 	unsigned int	used_chunks;
+	zbx_uint64_t	page_size;
+
+	/* percentage of free chunk memory outside the largest free chunk */
+	double		fragmentation;
+
+	/* free memory in slab objects, usable only by allocations of the same size class */
+	zbx_uint64_t	slab_free_size;
+	unsigned int	slabs_num[MEM_SLAB_CLASS_COUNT];
+	unsigned int	slab_objects_num[MEM_SLAB_CLASS_COUNT];
+	unsigned int	slab_used_num[MEM_SLAB_CLASS_COUNT];
 }
 zbx_mem_stats_t;
 
 int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr, const char *param, int allow_oom,
 		char **error);
 void	zbx_mem_destroy(zbx_mem_info_t *info);
+void	zbx_mem_set_huge_pages(int huge_pages);
 
 #define	zbx_mem_malloc(info, old, size) __zbx_mem_malloc(__FILE__, __LINE__, info, old, size)
 #define	zbx_mem_realloc(info, old, size) __zbx_mem_realloc(__FILE__, __LINE__, info, old, size)
@@ -21,6 +21,7 @@
 #define ZABBIX_COMPRESS_H
 
 int	zbx_compress(const char *in, size_t size_in, char **out, size_t *size_out);
+int	zbx_compress_gzip(const char *in, size_t size_in, char **out, size_t *size_out);
 int	zbx_uncompress(const char *in, size_t size_in, char *out, size_t *size_out);
 const char	*zbx_compress_strerror(void);
 
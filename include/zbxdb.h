@@ -101,6 +101,14 @@ zbx_err_codes_t	zbx_db_last_errcode(void);
 #ifdef HAVE_POSTGRESQL
 int	zbx_tsdb_get_version(void);
 #define ZBX_DB_TSDB_V1	(20000 > zbx_tsdb_get_version())
+
+int	zbx_db_parallel_open(int num, char *host, char *user, char *password, char *dbname, char *dbschema,
+		char *dbsocket, int port, char *tls_connect, char *cert, char *key, char *ca, char *cipher,
+		char *cipher_13);
+int	zbx_db_parallel_num(void);
+DB_RESULT	zbx_db_parallel_select(const char *sql);
+int	zbx_db_parallel_wait(void);
+void	zbx_db_parallel_close(void);
 #endif
 
 #ifdef HAVE_ORACLE
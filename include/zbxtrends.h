@@ -34,6 +34,16 @@ typedef enum
 }
 zbx_trend_state_t;
 
+/* the range of trend hours, including start and end */
+typedef struct
+{
+	int	start;
+	int	end;
+}
+zbx_trend_range_t;
+
+ZBX_VECTOR_DECL(trend_range, zbx_trend_range_t)
+
 int	zbx_trends_parse_base(const char *params, zbx_time_unit_t *base, char **error);
 int	zbx_parse_timeshift(time_t from, const char *timeshift, struct tm *tm, char **error);
 
@@ -60,11 +70,21 @@ int	zbx_tfc_init(char **error);
 void	zbx_tfc_destroy(void);
 int	zbx_tfc_get_stats(zbx_tfc_stats_t *stats, char **error);
 void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num);
+void	zbx_tfc_update_trends(const ZBX_DC_TREND *trends, int trends_num, int committed);
 
 int	zbx_baseline_get_data(zbx_uint64_t itemid, unsigned char value_type, time_t now, const char *period,
 		int season_num, zbx_time_unit_t season_unit, int skip, zbx_vector_dbl_t *values,
 		zbx_vector_uint64_t *index, char **error);
+int	zbx_baseline_get_ranges(time_t now, const char *period, int season_num, zbx_time_unit_t season_unit,
+		int skip, zbx_vector_trend_range_t *ranges, char **error);
 
 zbx_trend_state_t	zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value);
+void	zbx_trends_get_avgs(const char *table, zbx_uint64_t itemid, const zbx_vector_trend_range_t *ranges,
+		double *values, zbx_trend_state_t *states);
+
+void	zbx_trends_prefetch_add(zbx_uint64_t itemid, unsigned char value_type,
+		const zbx_vector_trend_range_t *ranges);
+void	zbx_trends_prefetch(void);
+void	zbx_trends_prefetch_clear(void);
 const char	*zbx_trends_error(zbx_trend_state_t state);
 #endif
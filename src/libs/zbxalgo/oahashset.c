@@ -0,0 +1,521 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+
+#include "zbxalgo.h"
+
+/*
+ * Open addressing hashset.
+ *
+ * The slot array is split into groups of ZBX_OAHASHSET_GROUP_WIDTH slots. Every slot has a control byte
+ * which is either CTRL_EMPTY, CTRL_DELETED or the lowest 7 bits of the entry hash (the tag). The remaining
+ * hash bits select the first group to probe, further groups are visited in triangular sequence, which
+ * covers all groups when their number is a power of two.
+ *
+ * Group control bytes are stored before the group slots and are loaded as a single 64-bit word to be
+ * matched against the tag. The last control byte is a sentinel that never matches. On 64-bit platforms
+ * a group fills exactly one cache line, so a lookup usually touches one cache line before dereferencing
+ * the entry. Probing stops at the first group that has an empty slot.
+ *
+ * Entries are allocated separately and only pointers are stored in slots, so the returned data pointers
+ * stay valid across slot array resizing. Entries do not carry any header - the hash is recalculated
+ * when the slot array is resized.
+ */
+
+#define ZBX_OAHASHSET_MIN_GROUPS	2
+#define ZBX_OAHASHSET_CACHE_LINE	64
+
+#define CTRL_EMPTY	0x80
+#define CTRL_DELETED	0xfe
+#define CTRL_SENTINEL	CTRL_DELETED
+#define CTRL_TAG_MASK	0x7f
+
+#define CTRL_IS_FULL(ctrl)	(0 == ((ctrl) & 0x80))
+
+#define GROUP_LSBS	__UINT64_C(0x0101010101010101)
+#define GROUP_MSBS	__UINT64_C(0x8080808080808080)
+
+/* slots can be occupied by entries or tombstones up to 3/4 of the slot array, keeping probe sequences short */
+#define OAHASHSET_MAX_LOAD(num_slots)	((num_slots) - (num_slots) / 4)
+
+#define OAHASHSET_CTRL(hs, slot)	((hs)->groups[(slot) / ZBX_OAHASHSET_GROUP_WIDTH].ctrl[(slot) % \
+		ZBX_OAHASHSET_GROUP_WIDTH])
+#define OAHASHSET_SLOT(hs, slot)	((hs)->groups[(slot) / ZBX_OAHASHSET_GROUP_WIDTH].slots[(slot) % \
+		ZBX_OAHASHSET_GROUP_WIDTH])
+
+/* private open addressing hashset functions */
+
+static zbx_uint64_t	oahashset_group_load(const zbx_oahashset_group_t *group)
+{
+	zbx_uint64_t	ctrl;
+
+	memcpy(&ctrl, group->ctrl, sizeof(ctrl));
+
+	return ctrl;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if group has control bytes matching the tag                 *
+ *                                                                            *
+ * Return value: non-zero if group might have a matching byte, 0 otherwise    *
+ *                                                                            *
+ * Comments: The result can have false positives next to a matching byte,     *
+ *           so the control bytes must be checked individually afterwards.    *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	oahashset_group_match(zbx_uint64_t ctrl, unsigned char tag)
+{
+	zbx_uint64_t	x = ctrl ^ (GROUP_LSBS * tag);
+
+	return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+static zbx_uint64_t	oahashset_group_match_empty(zbx_uint64_t ctrl)
+{
+	/* only CTRL_EMPTY has the highest bit set and the second lowest bit cleared */
+	return ctrl & ~(ctrl << 6) & GROUP_MSBS;
+}
+
+static void	oahashset_free_entry(zbx_oahashset_t *hs, void *entry)
+{
+	if (NULL != hs->clean_func)
+		hs->clean_func(entry);
+
+	hs->mem_free_func(entry);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get position of the first matching control byte in group and     *
+ *          clear it from the match mask                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	oahashset_match_next(zbx_uint64_t *match)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	int	pos = __builtin_ctzll(*match) / 8;
+
+	*match &= *match - 1;
+
+	return pos;
+#else
+	int	pos;
+
+	for (pos = 0; 0 == (((const unsigned char *)match)[pos] & 0x80); pos++)
+		;
+
+	((unsigned char *)match)[pos] = 0;
+
+	return pos;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find slot of the specified entry                                  *
+ *                                                                            *
+ * Parameters: hs     - [IN] the hashset                                      *
+ *             data   - [IN] the entry to find                                *
+ *             hash   - [IN] the entry hash                                   *
+ *             direct - [IN] 1 - data is a pointer to an entry stored in the  *
+ *                               hashset, compare pointers                    *
+ *                           0 - compare entries with compare function        *
+ *             pos    - [OUT] the slot position in group                      *
+ *                                                                            *
+ * Return value: the group containing entry or NULL if the entry was not      *
+ *               found                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_oahashset_group_t	*oahashset_find_slot(const zbx_oahashset_t *hs, const void *data, zbx_hash_t hash,
+		int direct, int *pos)
+{
+	int			index, step, num_groups, i;
+	unsigned char		tag = hash & CTRL_TAG_MASK;
+	zbx_uint64_t		ctrl, match;
+	zbx_oahashset_group_t	*group;
+
+	num_groups = hs->num_slots / ZBX_OAHASHSET_GROUP_WIDTH;
+	index = (int)((hash >> 7) & (zbx_hash_t)(num_groups - 1));
+
+	for (step = 0; step < num_groups; step++)
+	{
+		group = &hs->groups[index];
+		ctrl = oahashset_group_load(group);
+
+		for (match = oahashset_group_match(ctrl, tag); 0 != match;)
+		{
+			i = oahashset_match_next(&match);
+
+			if (group->ctrl[i] != tag)
+				continue;
+
+			if ((0 != direct && group->slots[i] == data) ||
+					(0 == direct && 0 == hs->compare_func(group->slots[i], data)))
+			{
+				*pos = i;
+				return group;
+			}
+		}
+
+		if (0 != oahashset_group_match_empty(ctrl))
+			break;
+
+		index = (index + step + 1) & (num_groups - 1);
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find the first empty or deleted slot in the entry probe sequence  *
+ *                                                                            *
+ ******************************************************************************/
+static int	oahashset_find_free_slot(const zbx_oahashset_group_t *groups, int num_slots, zbx_hash_t hash)
+{
+	int	index, step, num_groups, i;
+
+	num_groups = num_slots / ZBX_OAHASHSET_GROUP_WIDTH;
+	index = (int)((hash >> 7) & (zbx_hash_t)(num_groups - 1));
+
+	for (step = 0; step < num_groups; step++)
+	{
+		for (i = 0; i < ZBX_OAHASHSET_GROUP_WIDTH; i++)
+		{
+			if (!CTRL_IS_FULL(groups[index].ctrl[i]))
+				return index * ZBX_OAHASHSET_GROUP_WIDTH + i;
+		}
+
+		index = (index + step + 1) & (num_groups - 1);
+	}
+
+	/* unreachable - the load factor guarantees free slots */
+	THIS_SHOULD_NEVER_HAPPEN;
+	exit(EXIT_FAILURE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: move entries to a new slot array, dropping tombstones             *
+ *                                                                            *
+ ******************************************************************************/
+static int	oahashset_rehash(zbx_oahashset_t *hs, int num_slots)
+{
+	zbx_oahashset_group_t	*groups;
+	void			*groups_mem;
+	int			i, slot, num_groups = num_slots / ZBX_OAHASHSET_GROUP_WIDTH;
+
+	/* align groups to cache lines so that probing a group touches a single cache line */
+	if (NULL == (groups_mem = hs->mem_malloc_func(NULL,
+			(size_t)num_groups * sizeof(zbx_oahashset_group_t) + ZBX_OAHASHSET_CACHE_LINE - 1)))
+	{
+		return FAIL;
+	}
+
+	groups = (zbx_oahashset_group_t *)(((uintptr_t)groups_mem + ZBX_OAHASHSET_CACHE_LINE - 1) &
+			~(uintptr_t)(ZBX_OAHASHSET_CACHE_LINE - 1));
+
+	for (i = 0; i < num_groups; i++)
+	{
+		memset(groups[i].ctrl, CTRL_EMPTY, ZBX_OAHASHSET_GROUP_WIDTH);
+		groups[i].ctrl[ZBX_OAHASHSET_GROUP_WIDTH] = CTRL_SENTINEL;
+	}
+
+	for (i = 0; i < hs->num_slots; i++)
+	{
+		zbx_hash_t	hash;
+		void		*entry;
+
+		if (!CTRL_IS_FULL(OAHASHSET_CTRL(hs, i)))
+			continue;
+
+		entry = OAHASHSET_SLOT(hs, i);
+		hash = hs->hash_func(entry);
+		slot = oahashset_find_free_slot(groups, num_slots, hash);
+		groups[slot / ZBX_OAHASHSET_GROUP_WIDTH].ctrl[slot % ZBX_OAHASHSET_GROUP_WIDTH] = hash & CTRL_TAG_MASK;
+		groups[slot / ZBX_OAHASHSET_GROUP_WIDTH].slots[slot % ZBX_OAHASHSET_GROUP_WIDTH] = entry;
+	}
+
+	if (NULL != hs->groups_mem)
+		hs->mem_free_func(hs->groups_mem);
+
+	hs->groups = groups;
+	hs->groups_mem = groups_mem;
+	hs->num_slots = num_slots;
+	hs->num_deleted = 0;
+
+	return SUCCEED;
+}
+
+static void	oahashset_erase_slot(zbx_oahashset_t *hs, zbx_oahashset_group_t *group, int pos)
+{
+	oahashset_free_entry(hs, group->slots[pos]);
+	group->slots[pos] = NULL;
+	hs->num_data--;
+
+	/* If the group has an empty slot, then it was never full since the last rehash and */
+	/* no probe sequence could have passed through it - the slot can be marked empty.   */
+	if (0 != oahashset_group_match_empty(oahashset_group_load(group)))
+	{
+		group->ctrl[pos] = CTRL_EMPTY;
+	}
+	else
+	{
+		group->ctrl[pos] = CTRL_DELETED;
+		hs->num_deleted++;
+	}
+}
+
+/* public open addressing hashset interface */
+
+void	zbx_oahashset_create(zbx_oahashset_t *hs, size_t init_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func)
+{
+	zbx_oahashset_create_ext(hs, init_size, hash_func, compare_func, NULL,
+					ZBX_DEFAULT_MEM_MALLOC_FUNC,
+					ZBX_DEFAULT_MEM_REALLOC_FUNC,
+					ZBX_DEFAULT_MEM_FREE_FUNC);
+}
+
+void	zbx_oahashset_create_ext(zbx_oahashset_t *hs, size_t init_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func,
+				zbx_clean_func_t clean_func,
+				zbx_mem_malloc_func_t mem_malloc_func,
+				zbx_mem_realloc_func_t mem_realloc_func,
+				zbx_mem_free_func_t mem_free_func)
+{
+	hs->hash_func = hash_func;
+	hs->compare_func = compare_func;
+	hs->clean_func = clean_func;
+	hs->mem_malloc_func = mem_malloc_func;
+	hs->mem_realloc_func = mem_realloc_func;
+	hs->mem_free_func = mem_free_func;
+
+	hs->groups = NULL;
+	hs->groups_mem = NULL;
+	hs->num_slots = 0;
+	hs->num_data = 0;
+	hs->num_deleted = 0;
+
+	if (0 < init_size)
+		zbx_oahashset_reserve(hs, (int)init_size);
+}
+
+void	zbx_oahashset_destroy(zbx_oahashset_t *hs)
+{
+	zbx_oahashset_clear(hs);
+
+	hs->num_slots = 0;
+
+	if (NULL != hs->groups_mem)
+	{
+		hs->mem_free_func(hs->groups_mem);
+		hs->groups = NULL;
+		hs->groups_mem = NULL;
+	}
+
+	hs->hash_func = NULL;
+	hs->compare_func = NULL;
+	hs->mem_malloc_func = NULL;
+	hs->mem_realloc_func = NULL;
+	hs->mem_free_func = NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: make sure the hashset can store the required number of entries   *
+ *          without resizing                                                  *
+ *                                                                            *
+ * Parameters: hs            - [IN] the destination hashset                   *
+ *             num_slots_req - [IN] the number of entries to store            *
+ *                                                                            *
+ * Return value: SUCCEED - the hashset has enough slots                       *
+ *               FAIL    - failed to allocate slots                           *
+ *                                                                            *
+ * Comments: If the slot array is full only because of tombstones, it is      *
+ *           rehashed without growing.                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_oahashset_reserve(zbx_oahashset_t *hs, int num_slots_req)
+{
+	int	num_groups;
+
+	if (0 != hs->num_slots && num_slots_req + hs->num_deleted <= OAHASHSET_MAX_LOAD(hs->num_slots))
+		return SUCCEED;
+
+	num_groups = MAX(ZBX_OAHASHSET_MIN_GROUPS, hs->num_slots / ZBX_OAHASHSET_GROUP_WIDTH);
+
+	while (num_slots_req > OAHASHSET_MAX_LOAD(num_groups * ZBX_OAHASHSET_GROUP_WIDTH))
+		num_groups *= 2;
+
+	/* grow instead of rehashing in place when the slots are mostly used by live entries */
+	if (num_groups * ZBX_OAHASHSET_GROUP_WIDTH == hs->num_slots && num_slots_req > hs->num_slots / 2)
+		num_groups *= 2;
+
+	return oahashset_rehash(hs, num_groups * ZBX_OAHASHSET_GROUP_WIDTH);
+}
+
+void	*zbx_oahashset_insert(zbx_oahashset_t *hs, const void *data, size_t size)
+{
+	return zbx_oahashset_insert_ext(hs, data, size, 0);
+}
+
+void	*zbx_oahashset_insert_ext(zbx_oahashset_t *hs, const void *data, size_t size, size_t offset)
+{
+	int			slot, pos;
+	zbx_hash_t		hash;
+	void			*entry;
+	zbx_oahashset_group_t	*group;
+
+	hash = hs->hash_func(data);
+
+	if (0 != hs->num_slots && NULL != (group = oahashset_find_slot(hs, data, hash, 0, &pos)))
+		return group->slots[pos];
+
+	if (SUCCEED != zbx_oahashset_reserve(hs, hs->num_data + 1))
+		return NULL;
+
+	if (NULL == (entry = hs->mem_malloc_func(NULL, size)))
+		return NULL;
+
+	memcpy((char *)entry + offset, (const char *)data + offset, size - offset);
+
+	slot = oahashset_find_free_slot(hs->groups, hs->num_slots, hash);
+
+	if (CTRL_DELETED == OAHASHSET_CTRL(hs, slot))
+		hs->num_deleted--;
+
+	OAHASHSET_CTRL(hs, slot) = hash & CTRL_TAG_MASK;
+	OAHASHSET_SLOT(hs, slot) = entry;
+	hs->num_data++;
+
+	return entry;
+}
+
+void	*zbx_oahashset_search(zbx_oahashset_t *hs, const void *data)
+{
+	int			pos;
+	zbx_oahashset_group_t	*group;
+
+	if (0 == hs->num_data)
+		return NULL;
+
+	if (NULL == (group = oahashset_find_slot(hs, data, hs->hash_func(data), 0, &pos)))
+		return NULL;
+
+	return group->slots[pos];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: remove a hashset entry using comparison with the given data       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_oahashset_remove(zbx_oahashset_t *hs, const void *data)
+{
+	int			pos;
+	zbx_oahashset_group_t	*group;
+
+	if (0 == hs->num_data)
+		return;
+
+	if (NULL != (group = oahashset_find_slot(hs, data, hs->hash_func(data), 0, &pos)))
+		oahashset_erase_slot(hs, group, pos);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: remove a hashset entry using a data pointer returned to the user  *
+ *          by zbx_oahashset_insert[_ext]() and zbx_oahashset_search()        *
+ *          functions                                                         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_oahashset_remove_direct(zbx_oahashset_t *hs, const void *data)
+{
+	int			pos;
+	zbx_oahashset_group_t	*group;
+
+	if (0 == hs->num_data)
+		return;
+
+	if (NULL != (group = oahashset_find_slot(hs, data, hs->hash_func(data), 1, &pos)))
+		oahashset_erase_slot(hs, group, pos);
+}
+
+void	zbx_oahashset_clear(zbx_oahashset_t *hs)
+{
+	int	slot;
+
+	for (slot = 0; slot < hs->num_slots; slot++)
+	{
+		if (CTRL_IS_FULL(OAHASHSET_CTRL(hs, slot)))
+		{
+			oahashset_free_entry(hs, OAHASHSET_SLOT(hs, slot));
+			OAHASHSET_SLOT(hs, slot) = NULL;
+		}
+
+		OAHASHSET_CTRL(hs, slot) = CTRL_EMPTY;
+	}
+
+	hs->num_data = 0;
+	hs->num_deleted = 0;
+}
+
+#define	ITER_START	(-1)
+
+void	zbx_oahashset_iter_reset(zbx_oahashset_t *hs, zbx_oahashset_iter_t *iter)
+{
+	iter->hashset = hs;
+	iter->slot = ITER_START;
+}
+
+void	*zbx_oahashset_iter_next(zbx_oahashset_iter_t *iter)
+{
+	const zbx_oahashset_t	*hs = iter->hashset;
+
+	while (iter->slot < hs->num_slots)
+	{
+		if (++iter->slot == hs->num_slots)
+			break;
+
+		if (CTRL_IS_FULL(OAHASHSET_CTRL(hs, iter->slot)))
+			return OAHASHSET_SLOT(hs, iter->slot);
+	}
+
+	return NULL;
+}
+
+void	zbx_oahashset_iter_remove(zbx_oahashset_iter_t *iter)
+{
+	zbx_oahashset_t	*hs = iter->hashset;
+
+	if (ITER_START == iter->slot || iter->slot >= hs->num_slots || !CTRL_IS_FULL(OAHASHSET_CTRL(hs, iter->slot)))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "removing a hashset entry through a bad iterator");
+		exit(EXIT_FAILURE);
+	}
+
+	oahashset_erase_slot(hs, &hs->groups[iter->slot / ZBX_OAHASHSET_GROUP_WIDTH],
+			iter->slot % ZBX_OAHASHSET_GROUP_WIDTH);
+}
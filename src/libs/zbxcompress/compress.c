@@ -96,6 +96,72 @@ int	zbx_compress(const char *in, size_t size_in, char **out, size_t *size_out)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compress data in gzip format                                      *
+ *                                                                            *
+ * Parameters: in       - [IN] the data to compress                           *
+ *             size_in  - [IN] the input data size                            *
+ *             out      - [OUT] the compressed data                           *
+ *             size_out - [OUT] the compressed data size                      *
+ *                                                                            *
+ * Return value: SUCCEED - the data was compressed successfully               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The fastest compression level is used as the gzip format is      *
+ *           intended for HTTP request bodies.                                *
+ *           In the case of success the output buffer must be freed by the    *
+ *           caller.                                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_compress_gzip(const char *in, size_t size_in, char **out, size_t *size_out)
+{
+	z_stream	strm;
+	Bytef		*buf;
+	uLong		buf_size;
+
+	if (UINT_MAX < size_in)
+	{
+		zbx_zlib_errno = Z_BUF_ERROR;
+		return FAIL;
+	}
+
+	memset(&strm, 0, sizeof(strm));
+
+	/* window bits 15 with 16 added selects gzip header and trailer */
+	if (Z_OK != (zbx_zlib_errno = deflateInit2(&strm, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+			Z_DEFAULT_STRATEGY)))
+	{
+		return FAIL;
+	}
+
+	buf_size = deflateBound(&strm, (uLong)size_in);
+	buf = (Bytef *)zbx_malloc(NULL, buf_size);
+
+	strm.next_in = (Bytef *)in;
+	strm.avail_in = (uInt)size_in;
+	strm.next_out = buf;
+	strm.avail_out = (uInt)buf_size;
+
+	if (Z_STREAM_END != (zbx_zlib_errno = deflate(&strm, Z_FINISH)))
+	{
+		deflateEnd(&strm);
+		zbx_free(buf);
+
+		if (Z_OK == zbx_zlib_errno)
+			zbx_zlib_errno = Z_BUF_ERROR;
+
+		return FAIL;
+	}
+
+	*out = (char *)buf;
+	*size_out = strm.total_out;
+
+	deflateEnd(&strm);
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: uncompress data                                                   *
@@ -132,6 +198,15 @@ int zbx_compress(const char *in, size_t size_in, char **out, size_t *size_out)
 	return FAIL;
 }
 
+int zbx_compress_gzip(const char *in, size_t size_in, char **out, size_t *size_out)
+{
+	ZBX_UNUSED(in);
+	ZBX_UNUSED(size_in);
+	ZBX_UNUSED(out);
+	ZBX_UNUSED(size_out);
+	return FAIL;
+}
+
 int zbx_uncompress(const char *in, size_t size_in, char *out, size_t *size_out)
 {
 	ZBX_UNUSED(in);
@@ -55,6 +55,11 @@ struct zbx_db_result
 	int		fld_num;
 	int		cursor;
 	DB_ROW		values;
+
+	/* parallel select data, pending_conn is NULL when the result is complete */
+	PGconn		*pending_conn;
+	char		*sql;
+	double		sec;
 #elif defined(HAVE_SQLITE3)
 	int		curow;
 	char		**data;
@@ -106,6 +111,18 @@ static unsigned int		ZBX_PG_BYTEAOID = 0;
 static int			ZBX_TSDB_VERSION = -1;
 static zbx_uint32_t		ZBX_PG_SVERSION = ZBX_DBVERSION_UNDEFINED;
 char				ZBX_PG_ESCAPE_BACKSLASH = 1;
+
+typedef struct
+{
+	PGconn		*conn;
+	DB_RESULT	result;		/* the result of query being executed, NULL if connection is idle */
+}
+zbx_db_parallel_conn_t;
+
+static zbx_db_parallel_conn_t	*parallel_conns = NULL;
+static int			parallel_conns_num = 0;
+static int			parallel_conns_next = 0;
+static int			parallel_error = ZBX_DB_OK;
 #elif defined(HAVE_SQLITE3)
 static sqlite3			*conn = NULL;
 static zbx_mutex_t		sqlite_access = ZBX_MUTEX_NULL;
@@ -1004,6 +1021,315 @@ void	zbx_db_close(void)
 #endif
 }
 
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: start read only transaction sharing the same snapshot on          *
+ *          parallel connection                                               *
+ *                                                                            *
+ * Parameters: pg_conn  - [IN] the parallel connection                        *
+ *             snapshot - [IN/OUT] the snapshot identifier, exported by the   *
+ *                                 first connection                           *
+ *                                                                            *
+ * Return value: SUCCEED - the transaction was started                        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	db_parallel_begin(PGconn *pg_conn, char **snapshot)
+{
+	PGresult	*pg_result;
+	char		*sql = NULL, *error = NULL;
+	int		ret = FAIL;
+
+	pg_result = PQexec(pg_conn, "begin transaction isolation level repeatable read read only");
+
+	if (PGRES_COMMAND_OK != PQresultStatus(pg_result))
+		goto out;
+
+	PQclear(pg_result);
+
+	if (NULL == *snapshot)
+	{
+		pg_result = PQexec(pg_conn, "select pg_export_snapshot()");
+
+		if (PGRES_TUPLES_OK != PQresultStatus(pg_result) || 1 != PQntuples(pg_result))
+			goto out;
+
+		*snapshot = zbx_strdup(NULL, PQgetvalue(pg_result, 0, 0));
+	}
+	else
+	{
+		sql = zbx_dsprintf(sql, "set transaction snapshot '%s'", *snapshot);
+		pg_result = PQexec(pg_conn, sql);
+		zbx_free(sql);
+
+		if (PGRES_COMMAND_OK != PQresultStatus(pg_result))
+			goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED != ret)
+	{
+		zbx_postgresql_error(&error, pg_result);
+		zabbix_log(LOG_LEVEL_WARNING, "cannot start transaction on parallel database connection: %s", error);
+		zbx_free(error);
+	}
+
+	PQclear(pg_result);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open additional database connections for parallel selects        *
+ *                                                                            *
+ * Parameters: num - [IN] the number of connections to open                   *
+ *             ... - [IN] the connection parameters, see zbx_db_connect()     *
+ *                                                                            *
+ * Return value: the number of opened connections                             *
+ *                                                                            *
+ * Comments: All parallel connections read from the same database snapshot.   *
+ *           Selects are sent over them explicitly with                       *
+ *           zbx_db_parallel_select() and must be completed with              *
+ *           zbx_db_parallel_wait() before fetching the results.              *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_parallel_open(int num, char *host, char *user, char *password, char *dbname, char *dbschema,
+		char *dbsocket, int port, char *tls_connect, char *cert, char *key, char *ca, char *cipher,
+		char *cipher_13)
+{
+	PGconn			*main_conn = conn;
+	char			*snapshot = NULL;
+	zbx_db_parallel_conn_t	*pconns;
+	int			pconns_num = 0;
+
+	if (0 != parallel_conns_num || 0 >= num)
+		return parallel_conns_num;
+
+	pconns = (zbx_db_parallel_conn_t *)zbx_malloc(NULL, sizeof(zbx_db_parallel_conn_t) * num);
+
+	/* zbx_db_connect() sets up the current connection, so it is temporarily swapped */
+	while (pconns_num < num)
+	{
+		conn = NULL;
+
+		if (ZBX_DB_OK != zbx_db_connect(host, user, password, dbname, dbschema, dbsocket, port, tls_connect,
+				cert, key, ca, cipher, cipher_13))
+		{
+			break;
+		}
+
+		if (SUCCEED != db_parallel_begin(conn, &snapshot))
+		{
+			zbx_db_close();
+			break;
+		}
+
+		pconns[pconns_num].conn = conn;
+		pconns[pconns_num++].result = NULL;
+	}
+
+	conn = main_conn;
+
+	zbx_free(snapshot);
+
+	if (0 == pconns_num)
+	{
+		zbx_free(pconns);
+		return 0;
+	}
+
+	parallel_conns = pconns;
+	parallel_conns_num = pconns_num;
+
+	return parallel_conns_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the number of open parallel connections                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_parallel_num(void)
+{
+	return parallel_conns_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: receive result of parallel select                                 *
+ *                                                                            *
+ * Parameters: result - [IN/OUT] the pending result                           *
+ *                                                                            *
+ * Comments: If the query fails the result is left empty and the error is     *
+ *           remembered to be returned by zbx_db_parallel_wait(). The query   *
+ *           is not repeated over the main connection as it does not share    *
+ *           the snapshot of parallel connections.                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_parallel_complete(DB_RESULT result)
+{
+	PGresult	*pg_result;
+	char		*error = NULL;
+	int		i;
+
+	while (NULL != (pg_result = PQgetResult(result->pending_conn)))
+	{
+		if (NULL == result->pg_result)
+			result->pg_result = pg_result;
+		else
+			PQclear(pg_result);
+	}
+
+	if (PGRES_TUPLES_OK != PQresultStatus(result->pg_result))
+	{
+		zbx_postgresql_error(&error, result->pg_result);
+		zbx_db_errlog(ERR_Z3005, 0, error, result->sql);
+		zbx_free(error);
+
+		if (SUCCEED == is_recoverable_postgresql_error(result->pending_conn, result->pg_result))
+			parallel_error = ZBX_DB_DOWN;
+		else if (ZBX_DB_OK == parallel_error)
+			parallel_error = ZBX_DB_FAIL;
+
+		PQclear(result->pg_result);
+		result->pg_result = NULL;
+		result->row_num = 0;
+	}
+	else
+		result->row_num = PQntuples(result->pg_result);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "parallel query completed in " ZBX_FS_DBL " sec, %d rows [%s]",
+			zbx_time() - result->sec, result->row_num, result->sql);
+
+	for (i = 0; i < parallel_conns_num; i++)
+	{
+		if (parallel_conns[i].result == result)
+		{
+			parallel_conns[i].result = NULL;
+			break;
+		}
+	}
+
+	result->pending_conn = NULL;
+	zbx_free(result->sql);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: send select statement over parallel connection                    *
+ *                                                                            *
+ * Parameters: sql - [IN] the select statement                                *
+ *                                                                            *
+ * Return value: the pending result                                           *
+ *               NULL - the statement could not be sent                       *
+ *               ZBX_DB_DOWN - the parallel connection is down                *
+ *                                                                            *
+ * Comments: The result rows must not be fetched before zbx_db_parallel_wait()*
+ *           has confirmed that all pending selects succeeded.                *
+ *                                                                            *
+ *           An idle connection is preferred. If all connections are busy,    *
+ *           the next connection in turn is waited for.                       *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	zbx_db_parallel_select(const char *sql)
+{
+	zbx_db_parallel_conn_t	*pconn = NULL;
+	DB_RESULT		result;
+	int			i;
+
+	for (i = 0; i < parallel_conns_num; i++)
+	{
+		if (NULL == parallel_conns[i].result)
+		{
+			pconn = &parallel_conns[i];
+			break;
+		}
+	}
+
+	if (NULL == pconn)
+	{
+		pconn = &parallel_conns[parallel_conns_next];
+		parallel_conns_next = (parallel_conns_next + 1) % parallel_conns_num;
+		db_parallel_complete(pconn->result);
+	}
+
+	if (1 != PQsendQuery(pconn->conn, sql))
+	{
+		zbx_db_errlog(ERR_Z3005, 0, PQerrorMessage(pconn->conn), sql);
+
+		return CONNECTION_OK != PQstatus(pconn->conn) ? (DB_RESULT)ZBX_DB_DOWN : NULL;
+	}
+
+	result = (DB_RESULT)zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	result->pg_result = NULL;
+	result->values = NULL;
+	result->cursor = 0;
+	result->row_num = 0;
+	result->pending_conn = pconn->conn;
+	result->sql = zbx_strdup(NULL, sql);
+	result->sec = zbx_time();
+
+	pconn->result = result;
+
+	return result;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wait for all pending parallel selects                             *
+ *                                                                            *
+ * Return value: ZBX_DB_OK - all selects sent since the last call succeeded   *
+ *               ZBX_DB_FAIL - a select failed                                *
+ *               ZBX_DB_DOWN - a parallel connection is down                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_parallel_wait(void)
+{
+	int	i, ret;
+
+	for (i = 0; i < parallel_conns_num; i++)
+	{
+		if (NULL != parallel_conns[i].result)
+			db_parallel_complete(parallel_conns[i].result);
+	}
+
+	ret = parallel_error;
+	parallel_error = ZBX_DB_OK;
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: close parallel database connections                               *
+ *                                                                            *
+ * Comments: Pending results are received before closing the connections and  *
+ *           stay valid.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_db_parallel_close(void)
+{
+	int	i;
+
+	for (i = 0; i < parallel_conns_num; i++)
+	{
+		if (NULL != parallel_conns[i].result)
+			db_parallel_complete(parallel_conns[i].result);
+
+		PQclear(PQexec(parallel_conns[i].conn, "commit"));
+		PQfinish(parallel_conns[i].conn);
+	}
+
+	zbx_free(parallel_conns);
+	parallel_conns_num = 0;
+	parallel_conns_next = 0;
+	parallel_error = ZBX_DB_OK;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: start transaction                                                 *
@@ -1798,6 +2124,8 @@ error:
 	result->values = NULL;
 	result->cursor = 0;
 	result->row_num = 0;
+	result->pending_conn = NULL;
+	result->sql = NULL;
 
 	if (NULL == result->pg_result)
 		zbx_db_errlog(ERR_Z3005, 0, "result is NULL", sql);
@@ -2041,6 +2369,9 @@ DB_ROW	zbx_db_fetch(DB_RESULT result)
 
 	return result->values;
 #elif defined(HAVE_POSTGRESQL)
+	if (NULL != result->pending_conn)
+		db_parallel_complete(result);
+
 	/* free old data */
 	if (NULL != result->values)
 		zbx_free(result->values);
@@ -2166,6 +2497,9 @@ void	DBfree_result(DB_RESULT result)
 	if (NULL == result)
 		return;
 
+	if (NULL != result->pending_conn)
+		db_parallel_complete(result);
+
 	if (NULL != result->values)
 	{
 		result->fld_num = 0;
@@ -2860,3 +3194,7 @@ void zbx_db_set_character_set(const char *char_set)
 		zabbix_log(LOG_LEVEL_WARNING, "cannot set MySQL character set to \"%s\"", char_set);
 }
 #endif
+
+#if defined(HAVE_TESTS) && defined(HAVE_POSTGRESQL)
+#	include "../../../tests/libs/zbxdb/zbx_db_parallel_test.c"
+#endif
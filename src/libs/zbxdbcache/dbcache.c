@@ -70,6 +70,14 @@ extern char		*CONFIG_EXPORT_DIR;
 
 #define ZBX_TRENDS_CLEANUP_TIME	((SEC_PER_HOUR * 55) / 60)
 
+/* Trends of the previous hour are flushed evenly during the first minutes of the hour instead of */
+/* all at once. The period must end before trend functions of the hour base are evaluated (:10). */
+#define ZBX_TRENDS_FLUSH_PERIOD	(SEC_PER_MIN * 5)
+
+/* Trends of the previous hour are flushed at once when less than 1/4 of trend cache is free, */
+/* so the trends waiting for flush cannot exhaust the cache.                                  */
+#define ZBX_TRENDS_PENDING_FREE_DIV	4
+
 /* the maximum time spent synchronizing history */
 #define ZBX_HC_SYNC_TIME_MAX	10
 
@@ -118,6 +126,11 @@ zbx_hc_proxyqueue_t;
 typedef struct
 {
 	zbx_hashset_t		trends;
+
+	/* trends of the finished hour waiting to be flushed and the last time they were flushed */
+	zbx_hashset_t		trends_pending;
+	double			trends_pending_flush;
+
 	ZBX_DC_STATS		stats;
 
 	zbx_hashset_t		history_items;
@@ -381,6 +394,14 @@ static void	DCupdate_trends(zbx_vector_uint64_pair_t *trends_diff)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+typedef struct
+{
+	int	inserted;
+	int	updated;
+	int	checked;	/* trends checked for existing rows in database */
+}
+zbx_trends_flush_stats_t;
+
 /******************************************************************************
  *                                                                            *
  * Purpose: helper function for DCflush trends                                *
@@ -650,7 +671,8 @@ static void	dc_trends_fetch_and_update(ZBX_DC_TREND *trends, int trends_num, zbx
  * Purpose: flush trend to the database                                       *
  *                                                                            *
  ******************************************************************************/
-static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uint64_pair_t *trends_diff)
+static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uint64_pair_t *trends_diff,
+		zbx_trends_flush_stats_t *stats)
 {
 	int		num, i, clock, inserts_num = 0, itemids_alloc, itemids_num = 0, trends_to = *trends_num;
 	unsigned char	value_type;
@@ -701,6 +723,7 @@ static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uin
 
 	if (0 != itemids_num)
 	{
+		stats->checked += itemids_num;
 		dc_remove_updated_trends(trends, trends_to, table_name, value_type, itemids,
 				&itemids_num, clock);
 	}
@@ -720,8 +743,10 @@ static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uin
 
 	if (0 != itemids_num)
 	{
+		num = inserts_num;
 		dc_trends_fetch_and_update(trends, trends_to, itemids, itemids_num,
 				&inserts_num, value_type, table_name, clock);
+		stats->updated += num - inserts_num;
 	}
 
 	zbx_free(itemids);
@@ -750,7 +775,10 @@ static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uin
 	}
 
 	if (0 != inserts_num)
+	{
+		stats->inserted += inserts_num;
 		dc_insert_trends_in_db(trends, trends_to, value_type, table_name, clock);
+	}
 
 	/* clean trends */
 	for (i = 0, num = 0; i < *trends_num; i++)
@@ -765,6 +793,20 @@ static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uin
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: clear trend data, keeping the item and database state            *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_trend_reset(ZBX_DC_TREND *trend)
+{
+	trend->clock = 0;
+	trend->num = 0;
+	memset(&trend->value_min, 0, sizeof(history_value_t));
+	memset(&trend->value_avg, 0, sizeof(value_avg_t));
+	memset(&trend->value_max, 0, sizeof(history_value_t));
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: move trend to the array of trends for flushing to DB              *
@@ -781,36 +823,62 @@ static void	DCflush_trend(ZBX_DC_TREND *trend, ZBX_DC_TREND **trends, int *trend
 	memcpy(&(*trends)[*trends_num], trend, sizeof(ZBX_DC_TREND));
 	(*trends_num)++;
 
-	trend->clock = 0;
-	trend->num = 0;
-	memset(&trend->value_min, 0, sizeof(history_value_t));
-	memset(&trend->value_avg, 0, sizeof(value_avg_t));
-	memset(&trend->value_max, 0, sizeof(history_value_t));
+	dc_trend_reset(trend);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: add new value to the trends                                       *
+ * Purpose: check if trend cache is too full to keep trends waiting for flush *
+ *                                                                            *
+ * Return value: SUCCEED - the trends must be flushed without waiting         *
+ *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static void	DCadd_trend(const ZBX_DC_HISTORY *history, ZBX_DC_TREND **trends, int *trends_alloc, int *trends_num)
+static int	dc_trends_memory_low(void)
 {
-	ZBX_DC_TREND	*trend = NULL;
-	int		hour;
+	if (trend_mem->free_size < trend_mem->orig_size / ZBX_TRENDS_PENDING_FREE_DIV)
+		return SUCCEED;
 
-	hour = history->ts.sec - history->ts.sec % SEC_PER_HOUR;
+	return FAIL;
+}
 
-	trend = DCget_trend(history->itemid);
+/******************************************************************************
+ *                                                                            *
+ * Purpose: move trend of the finished hour to the trends waiting for flush   *
+ *                                                                            *
+ * Comments: If a trend of an older hour is still waiting, it is moved to the *
+ *           array of trends for flushing to DB. When trend cache is low on   *
+ *           memory the trend is moved there directly.                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_trend_defer(ZBX_DC_TREND *trend, ZBX_DC_TREND **trends, int *trends_alloc, int *trends_num)
+{
+	ZBX_DC_TREND	*pending;
 
-	if (trend->num > 0 && (trend->clock != hour || trend->value_type != history->value_type) &&
-			SUCCEED == zbx_history_requires_trends(trend->value_type))
+	if (SUCCEED == dc_trends_memory_low())
 	{
 		DCflush_trend(trend, trends, trends_alloc, trends_num);
+		return;
 	}
 
-	trend->value_type = history->value_type;
-	trend->clock = hour;
+	if (NULL != (pending = (ZBX_DC_TREND *)zbx_hashset_search(&cache->trends_pending, &trend->itemid)))
+	{
+		DCflush_trend(pending, trends, trends_alloc, trends_num);
+		memcpy(pending, trend, sizeof(ZBX_DC_TREND));
+	}
+	else
+		zbx_hashset_insert(&cache->trends_pending, trend, sizeof(ZBX_DC_TREND));
+
+	dc_trend_reset(trend);
+}
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add value to the trend                                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_trend_add_value(ZBX_DC_TREND *trend, const ZBX_DC_HISTORY *history)
+{
 	switch (trend->value_type)
 	{
 		case ITEM_VALUE_TYPE_FLOAT:
@@ -832,6 +900,104 @@ static void	DCadd_trend(const ZBX_DC_HISTORY *history, ZBX_DC_TREND **trends, in
 	trend->num++;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add new value to the trends                                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCadd_trend(const ZBX_DC_HISTORY *history, ZBX_DC_TREND **trends, int *trends_alloc, int *trends_num)
+{
+	ZBX_DC_TREND	*trend = NULL, *pending;
+	int		hour;
+
+	hour = history->ts.sec - history->ts.sec % SEC_PER_HOUR;
+
+	trend = DCget_trend(history->itemid);
+
+	if (trend->num > 0 && (trend->clock != hour || trend->value_type != history->value_type) &&
+			SUCCEED == zbx_history_requires_trends(trend->value_type))
+	{
+		if (trend->value_type != history->value_type)
+		{
+			DCflush_trend(trend, trends, trends_alloc, trends_num);
+		}
+		else if (trend->clock < hour)
+		{
+			dc_trend_defer(trend, trends, trends_alloc, trends_num);
+		}
+		else if (NULL != (pending = (ZBX_DC_TREND *)zbx_hashset_search(&cache->trends_pending,
+				&history->itemid)) && pending->clock == hour &&
+				pending->value_type == history->value_type)
+		{
+			/* late value of the hour waiting for flush */
+			dc_trend_add_value(pending, history);
+			return;
+		}
+		else
+			DCflush_trend(trend, trends, trends_alloc, trends_num);
+	}
+
+	trend->value_type = history->value_type;
+	trend->clock = hour;
+
+	dc_trend_add_value(trend, history);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: move part of the trends waiting for flush to the array of trends  *
+ *          for flushing to DB                                                *
+ *                                                                            *
+ * Parameters: ts              - [IN] the current time                        *
+ *             compression_age - [IN] history compression age                 *
+ *             trends          - [OUT] list of trends to flush into database  *
+ *             trends_alloc    - [IN/OUT] trends array size                   *
+ *             trends_num      - [IN/OUT] number of trends                    *
+ *                                                                            *
+ * Comments: The number of flushed trends is proportional to the time passed  *
+ *           since the last flush, so that all trends are flushed by the end  *
+ *           of the flush period. All trends are flushed when trend cache is  *
+ *           low on memory.                                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_flush_pending_trends(const zbx_timespec_t *ts, int compression_age, ZBX_DC_TREND **trends,
+		int *trends_alloc, int *trends_num)
+{
+	zbx_hashset_iter_t	iter;
+	ZBX_DC_TREND		*trend;
+	double			now, last, deadline;
+	int			quota, pending_num = cache->trends_pending.num_data;
+
+	if (0 == pending_num)
+		return;
+
+	now = ts->sec + ts->ns / 1e9;
+	last = ts->sec - ts->sec % SEC_PER_HOUR;
+	deadline = last + ZBX_TRENDS_FLUSH_PERIOD;
+
+	if (cache->trends_pending_flush > last)
+		last = cache->trends_pending_flush;
+
+	if (now >= deadline || last >= now || SUCCEED == dc_trends_memory_low())
+		quota = pending_num;
+	else
+		quota = (int)ceil(pending_num * (now - last) / (deadline - last));
+
+	cache->trends_pending_flush = now;
+
+	zbx_hashset_iter_reset(&cache->trends_pending, &iter);
+
+	while (0 < quota-- && NULL != (trend = (ZBX_DC_TREND *)zbx_hashset_iter_next(&iter)))
+	{
+		if (0 == compression_age || trend->clock >= compression_age)
+			DCflush_trend(trend, trends, trends_alloc, trends_num);
+
+		zbx_hashset_iter_remove(&iter);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() pending:%d left:%d", __func__, pending_num, cache->trends_pending.num_data);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: update trends cache and get list of trends to flush into database *
@@ -868,6 +1034,8 @@ static void	DCmass_update_trends(const ZBX_DC_HISTORY *history, int history_num,
 		DCadd_trend(h, trends, &trends_alloc, trends_num);
 	}
 
+	dc_flush_pending_trends(&ts, compression_age, trends, &trends_alloc, trends_num);
+
 	if (cache->trends_last_cleanup_hour < hour && ZBX_TRENDS_CLEANUP_TIME < seconds)
 	{
 		zbx_hashset_iter_t	iter;
@@ -904,6 +1072,33 @@ static void	DCmass_update_trends(const ZBX_DC_HISTORY *history, int history_num,
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get list of trends waiting for flush to flush into database       *
+ *                                                                            *
+ * Parameters: trends          - [OUT] list of trends to flush into database  *
+ *             trends_num      - [OUT] number of trends                       *
+ *             compression_age - [IN]  history compression age                *
+ *                                                                            *
+ * Comments: Used when there are no new values to sync, so the trends of the  *
+ *           finished hour are flushed within the flush period regardless of  *
+ *           incoming values.                                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCmass_flush_pending_trends(ZBX_DC_TREND **trends, int *trends_num, int compression_age)
+{
+	zbx_timespec_t	ts;
+	int		trends_alloc = 0;
+
+	zbx_timespec(&ts);
+
+	LOCK_TRENDS;
+
+	dc_flush_pending_trends(&ts, compression_age, trends, &trends_alloc, trends_num);
+
+	UNLOCK_TRENDS;
+}
+
 static int	zbx_trend_compare(const void *d1, const void *d2)
 {
 	const ZBX_DC_TREND	*p1 = (const ZBX_DC_TREND *)d1;
@@ -927,18 +1122,24 @@ static int	zbx_trend_compare(const void *d1, const void *d2)
 static void	DBmass_update_trends(const ZBX_DC_TREND *trends, int trends_num,
 		zbx_vector_uint64_pair_t *trends_diff)
 {
-	ZBX_DC_TREND	*trends_tmp;
+	ZBX_DC_TREND			*trends_tmp;
+	zbx_trends_flush_stats_t	stats = {0, 0, 0};
+	double				sec;
 
 	if (0 != trends_num)
 	{
+		sec = zbx_time();
 		trends_tmp = (ZBX_DC_TREND *)zbx_malloc(NULL, trends_num * sizeof(ZBX_DC_TREND));
 		memcpy(trends_tmp, trends, trends_num * sizeof(ZBX_DC_TREND));
 		qsort(trends_tmp, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
 
 		while (0 < trends_num)
-			DBflush_trends(trends_tmp, &trends_num, trends_diff);
+			DBflush_trends(trends_tmp, &trends_num, trends_diff, &stats);
 
 		zbx_free(trends_tmp);
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() inserted:%d updated:%d checked:%d in " ZBX_FS_DBL " sec",
+				__func__, stats.inserted, stats.updated, stats.checked, zbx_time() - sec);
 	}
 }
 
@@ -1017,7 +1218,7 @@ typedef struct
 {
 	zbx_uint64_t		itemid;
 	char			*name;
-	DC_ITEM			*item;
+	zbx_history_sync_item_t	*item;
 	zbx_vector_item_tag_t	item_tags;
 }
 zbx_item_info_t;
@@ -1127,13 +1328,13 @@ static void	zbx_item_info_clean(zbx_item_info_t *item_info)
 static void	DCexport_trends(const ZBX_DC_TREND *trends, int trends_num, zbx_hashset_t *hosts_info,
 		zbx_hashset_t *items_info)
 {
-	struct zbx_json		json;
-	const ZBX_DC_TREND	*trend = NULL;
-	int			i, j;
-	const DC_ITEM		*item;
-	zbx_host_info_t		*host_info;
-	zbx_item_info_t		*item_info;
-	zbx_uint128_t		avg;	/* calculate the trend average value */
+	struct zbx_json			json;
+	const ZBX_DC_TREND		*trend = NULL;
+	int				i, j;
+	const zbx_history_sync_item_t	*item;
+	zbx_host_info_t			*host_info;
+	zbx_item_info_t			*item_info;
+	zbx_uint128_t			avg;	/* calculate the trend average value */
 
 	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
 
@@ -1225,12 +1426,12 @@ static void	DCexport_trends(const ZBX_DC_TREND *trends, int trends_num, zbx_hash
 static void	DCexport_history(const ZBX_DC_HISTORY *history, int history_num, zbx_hashset_t *hosts_info,
 		zbx_hashset_t *items_info)
 {
-	const ZBX_DC_HISTORY	*h;
-	const DC_ITEM		*item;
-	int			i, j;
-	zbx_host_info_t		*host_info;
-	zbx_item_info_t		*item_info;
-	struct zbx_json		json;
+	const ZBX_DC_HISTORY		*h;
+	const zbx_history_sync_item_t	*item;
+	int				i, j;
+	zbx_host_info_t			*host_info;
+	zbx_item_info_t			*item_info;
+	struct zbx_json			json;
 
 	zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
 
@@ -1340,13 +1541,13 @@ static void	DCexport_history(const ZBX_DC_HISTORY *history, int history_num, zbx
  *                                                                            *
  ******************************************************************************/
 static void	DCexport_history_and_trends(const ZBX_DC_HISTORY *history, int history_num,
-		const zbx_vector_uint64_t *itemids, DC_ITEM *items, const int *errcodes, const ZBX_DC_TREND *trends,
-		int trends_num)
+		const zbx_vector_uint64_t *itemids, zbx_history_sync_item_t *items, const int *errcodes,
+		const ZBX_DC_TREND *trends, int trends_num)
 {
 	int			i, index;
 	zbx_vector_uint64_t	hostids, item_info_ids;
 	zbx_hashset_t		hosts_info, items_info;
-	DC_ITEM			*item;
+	zbx_history_sync_item_t	*item;
 	zbx_item_info_t		item_info;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d trends_num:%d", __func__, history_num, trends_num);
@@ -1454,17 +1655,15 @@ clean:
  ******************************************************************************/
 static void	DCexport_all_trends(const ZBX_DC_TREND *trends, int trends_num)
 {
-	DC_ITEM			*items;
+	zbx_history_sync_item_t	*items;
 	zbx_vector_uint64_t	itemids;
 	int			*errcodes, i, num;
 
-	zabbix_log(LOG_LEVEL_WARNING, "exporting trend data...");
-
 	while (0 < trends_num)
 	{
 		num = MIN(ZBX_HC_SYNC_MAX, trends_num);
 
-		items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)num);
+		items = (zbx_history_sync_item_t *)zbx_malloc(NULL, sizeof(zbx_history_sync_item_t) * (size_t)num);
 		errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
 
 		zbx_vector_uint64_create(&itemids);
@@ -1475,11 +1674,12 @@ static void	DCexport_all_trends(const ZBX_DC_TREND *trends, int trends_num)
 
 		zbx_vector_uint64_sort(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
-		DCconfig_get_items_by_itemids(items, itemids.values, errcodes, num);
+		DCconfig_history_sync_get_items_by_itemids(items, itemids.values, errcodes, num,
+				ZBX_ITEM_GET_SYNC_EXPORT);
 
 		DCexport_history_and_trends(NULL, 0, &itemids, items, errcodes, trends, num);
 
-		DCconfig_clean_items(items, errcodes, num);
+		DCconfig_clean_history_sync_items(items, errcodes, num);
 		zbx_vector_uint64_destroy(&itemids);
 		zbx_free(items);
 		zbx_free(errcodes);
@@ -1487,8 +1687,6 @@ static void	DCexport_all_trends(const ZBX_DC_TREND *trends, int trends_num)
 		trends += num;
 		trends_num -= num;
 	}
-
-	zabbix_log(LOG_LEVEL_WARNING, "exporting trend data done");
 }
 
 /******************************************************************************
@@ -1499,8 +1697,9 @@ static void	DCexport_all_trends(const ZBX_DC_TREND *trends, int trends_num)
 static void	DCsync_trends(void)
 {
 	zbx_hashset_iter_t	iter;
-	ZBX_DC_TREND		*trends = NULL, *trend;
-	int			trends_alloc = 0, trends_num = 0, compression_age;
+	ZBX_DC_TREND			*trends = NULL, *trend;
+	int				trends_alloc = 0, trends_num = 0, compression_age;
+	zbx_trends_flush_stats_t	stats = {0, 0, 0};
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() trends_num:%d", __func__, cache->trends_num);
 
@@ -1518,10 +1717,24 @@ static void	DCsync_trends(void)
 			DCflush_trend(trend, &trends, &trends_alloc, &trends_num);
 	}
 
+	zbx_hashset_iter_reset(&cache->trends_pending, &iter);
+
+	while (NULL != (trend = (ZBX_DC_TREND *)zbx_hashset_iter_next(&iter)))
+	{
+		if (trend->clock >= compression_age)
+			DCflush_trend(trend, &trends, &trends_alloc, &trends_num);
+
+		zbx_hashset_iter_remove(&iter);
+	}
+
 	UNLOCK_TRENDS;
 
 	if (SUCCEED == zbx_is_export_enabled(ZBX_FLAG_EXPTYPE_TRENDS) && 0 != trends_num)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "exporting trend data...");
 		DCexport_all_trends(trends, trends_num);
+		zabbix_log(LOG_LEVEL_WARNING, "exporting trend data done");
+	}
 
 	if (0 < trends_num)
 		qsort(trends, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
@@ -1529,7 +1742,7 @@ static void	DCsync_trends(void)
 	DBbegin();
 
 	while (trends_num > 0)
-		DBflush_trends(trends, &trends_num, NULL);
+		DBflush_trends(trends, &trends_num, NULL, &stats);
 
 	DBcommit();
 
@@ -1537,7 +1750,8 @@ static void	DCsync_trends(void)
 
 	zabbix_log(LOG_LEVEL_WARNING, "syncing trend data done");
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() inserted:%d updated:%d checked:%d", __func__, stats.inserted,
+			stats.updated, stats.checked);
 }
 
 /******************************************************************************
@@ -1555,8 +1769,8 @@ static void	DCsync_trends(void)
  *                                                                            *
  ******************************************************************************/
 static void	recalculate_triggers(const ZBX_DC_HISTORY *history, int history_num,
-		const zbx_vector_uint64_t *history_itemids, const DC_ITEM *history_items, const int *history_errcodes,
-		const zbx_vector_ptr_t *timers, zbx_vector_ptr_t *trigger_diff)
+		const zbx_vector_uint64_t *history_itemids, const zbx_history_sync_item_t *history_items,
+		const int *history_errcodes, const zbx_vector_ptr_t *timers, zbx_vector_ptr_t *trigger_diff)
 {
 	int			i, item_num = 0, timers_num = 0;
 	zbx_uint64_t		*itemids = NULL;
@@ -1641,7 +1855,8 @@ out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
-static void	DCinventory_value_add(zbx_vector_ptr_t *inventory_values, const DC_ITEM *item, ZBX_DC_HISTORY *h)
+static void	DCinventory_value_add(zbx_vector_ptr_t *inventory_values, const zbx_history_sync_item_t *item,
+		ZBX_DC_HISTORY *h)
 {
 	char			value[MAX_BUFFER_LEN];
 	const char		*inventory_field;
@@ -1845,7 +2060,7 @@ static void	dc_history_set_value(ZBX_DC_HISTORY *hdata, unsigned char value_type
  *             hdata         - [IN/OUT] the historical data to process        *
  *                                                                            *
  ******************************************************************************/
-static void	normalize_item_value(const DC_ITEM *item, ZBX_DC_HISTORY *hdata)
+static void	normalize_item_value(const zbx_history_sync_item_t *item, ZBX_DC_HISTORY *hdata)
 {
 	char		*logvalue;
 	zbx_variant_t	value_var;
@@ -1923,7 +2138,7 @@ static void	normalize_item_value(const DC_ITEM *item, ZBX_DC_HISTORY *hdata)
  * Comments: Will generate internal events when item state switches.          *
  *                                                                            *
  ******************************************************************************/
-static zbx_item_diff_t	*calculate_item_update(DC_ITEM *item, const ZBX_DC_HISTORY *h)
+static zbx_item_diff_t	*calculate_item_update(zbx_history_sync_item_t *item, const ZBX_DC_HISTORY *h)
 {
 	zbx_uint64_t	flags = 0;
 	const char	*item_error = NULL;
@@ -2626,7 +2841,7 @@ static void	DBmass_proxy_add_history(ZBX_DC_HISTORY *history, int history_num)
  *                                                                            *
  ******************************************************************************/
 static void	DCmass_prepare_history(ZBX_DC_HISTORY *history, const zbx_vector_uint64_t *itemids,
-		DC_ITEM *items, const int *errcodes, int history_num, zbx_vector_ptr_t *item_diff,
+		zbx_history_sync_item_t *items, const int *errcodes, int history_num, zbx_vector_ptr_t *item_diff,
 		zbx_vector_ptr_t *inventory_values, int compression_age, zbx_vector_uint64_pair_t *proxy_subscribtions)
 {
 	static time_t	last_history_discard = 0;
@@ -2639,10 +2854,10 @@ static void	DCmass_prepare_history(ZBX_DC_HISTORY *history, const zbx_vector_uin
 
 	for (i = 0; i < history_num; i++)
 	{
-		ZBX_DC_HISTORY	*h = &history[i];
-		DC_ITEM		*item;
-		zbx_item_diff_t	*diff;
-		int		index;
+		ZBX_DC_HISTORY		*h = &history[i];
+		zbx_history_sync_item_t	*item;
+		zbx_item_diff_t		*diff;
+		int			index;
 
 		/* discard history items that are older than compression age */
 		if (0 != compression_age && h->ts.sec < compression_age)
@@ -2926,7 +3141,7 @@ static void	DCmodule_sync_history(int history_float_num, int history_integer_num
 static void	proxy_prepare_history(ZBX_DC_HISTORY *history, int history_num)
 {
 	int			i, *errcodes;
-	DC_ITEM			*items;
+	zbx_history_sync_item_t	*items;
 	zbx_vector_uint64_t	itemids;
 
 	zbx_vector_uint64_create(&itemids);
@@ -2935,10 +3150,11 @@ static void	proxy_prepare_history(ZBX_DC_HISTORY *history, int history_num)
 	for (i = 0; i < history_num; i++)
 		zbx_vector_uint64_append(&itemids, history[i].itemid);
 
-	items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)history_num);
+	items = (zbx_history_sync_item_t *)zbx_malloc(NULL, sizeof(zbx_history_sync_item_t) *
+			(size_t)history_num);
 	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)history_num);
 
-	DCconfig_get_items_by_itemids(items, itemids.values, errcodes, itemids.values_num);
+	DCconfig_history_sync_get_items_by_itemids(items, itemids.values, errcodes, itemids.values_num, 0);
 
 	for (i = 0; i < history_num; i++)
 	{
@@ -2971,7 +3187,7 @@ static void	proxy_prepare_history(ZBX_DC_HISTORY *history, int history_num)
 		history[i].flags |= ZBX_DC_FLAG_NOVALUE;
 	}
 
-	DCconfig_clean_items(items, errcodes, history_num);
+	DCconfig_clean_history_sync_items(items, errcodes, history_num);
 	zbx_free(items);
 	zbx_free(errcodes);
 	zbx_vector_uint64_destroy(&itemids);
@@ -3058,6 +3274,60 @@ static void	sync_proxy_history(int *total_num, int *more)
 	zbx_vector_ptr_destroy(&history_items);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: flushes trends to database and updates trend caches               *
+ *                                                                            *
+ * Parameters: trends           - [IN] the trends to flush                    *
+ *             trends_num       - [IN] the number of trends                   *
+ *             item_diff        - [IN] the item changes to save in the same   *
+ *                                     transaction, optional                  *
+ *             inventory_values - [IN] the inventory values to save with item *
+ *                                     changes                                *
+ *                                                                            *
+ * Comments: When item changes are given, the internal events generated       *
+ *           while preparing history are processed in the same transaction.   *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCflush_trends(ZBX_DC_TREND *trends, int trends_num, const zbx_vector_ptr_t *item_diff,
+		const zbx_vector_ptr_t *inventory_values)
+{
+	zbx_vector_uint64_pair_t	trends_diff;
+	int				txn_error;
+
+	zbx_vector_uint64_pair_create(&trends_diff);
+
+	if (0 != trends_num)
+		zbx_tfc_invalidate_trends(trends, trends_num);
+
+	do
+	{
+		DBbegin();
+
+		if (NULL != item_diff)
+			DBmass_update_items(item_diff, inventory_values);
+
+		DBmass_update_trends(trends, trends_num, &trends_diff);
+
+		/* process internal events generated by DCmass_prepare_history() */
+		if (NULL != item_diff)
+			zbx_process_events(NULL, NULL);
+
+		if (ZBX_DB_OK == (txn_error = DBcommit()))
+			DCupdate_trends(&trends_diff);
+		else if (NULL != item_diff)
+			zbx_reset_event_recovery();
+
+		zbx_vector_uint64_pair_clear(&trends_diff);
+	}
+	while (ZBX_DB_DOWN == txn_error);
+
+	if (0 != trends_num)
+		zbx_tfc_update_trends(trends, trends_num, ZBX_DB_OK == txn_error ? SUCCEED : FAIL);
+
+	zbx_vector_uint64_pair_destroy(&trends_diff);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: flush history cache to database, process triggers of flushed      *
@@ -3093,7 +3363,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 	time_t				sync_start;
 	zbx_vector_uint64_t		triggerids ;
 	zbx_vector_ptr_t		history_items, trigger_diff, item_diff, inventory_values, trigger_timers;
-	zbx_vector_uint64_pair_t	trends_diff, proxy_subscribtions;
+	zbx_vector_uint64_pair_t	proxy_subscribtions;
 	ZBX_DC_HISTORY			history[ZBX_HC_SYNC_MAX];
 
 	item_retrieve_mode = NULL == CONFIG_EXPORT_DIR ? ZBX_ITEM_GET_SYNC : ZBX_ITEM_GET_SYNC_EXPORT;
@@ -3133,7 +3403,6 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 	zbx_vector_ptr_create(&inventory_values);
 	zbx_vector_ptr_create(&item_diff);
 	zbx_vector_ptr_create(&trigger_diff);
-	zbx_vector_uint64_pair_create(&trends_diff);
 	zbx_vector_uint64_pair_create(&proxy_subscribtions);
 
 	zbx_vector_uint64_create(&triggerids);
@@ -3149,7 +3418,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 	do
 	{
-		DC_ITEM			*items;
+		zbx_history_sync_item_t	*items;
 		int			*errcodes, trends_num = 0, timers_num = 0, ret = SUCCEED;
 		zbx_vector_uint64_t	itemids;
 		ZBX_DC_TREND		*trends = NULL;
@@ -3179,7 +3448,8 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 		{
 			hc_get_item_values(history, &history_items);	/* copy item data from history cache */
 
-			items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)history_num);
+			items = (zbx_history_sync_item_t *)zbx_malloc(NULL, sizeof(zbx_history_sync_item_t) *
+					(size_t)history_num);
 			errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)history_num);
 
 			zbx_vector_uint64_reserve(&itemids, history_num);
@@ -3189,7 +3459,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 			zbx_vector_uint64_sort(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
-			DCconfig_get_items_by_itemids_partial(items, itemids.values, errcodes, history_num,
+			DCconfig_history_sync_get_items_by_itemids(items, itemids.values, errcodes, history_num,
 					item_retrieve_mode);
 
 			DCmass_prepare_history(history, &itemids, items, errcodes, history_num, &item_diff,
@@ -3199,28 +3469,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 			{
 				DCconfig_items_apply_changes(&item_diff);
 				DCmass_update_trends(history, history_num, &trends, &trends_num, compression_age);
-
-				if (0 != trends_num)
-					zbx_tfc_invalidate_trends(trends, trends_num);
-
-				do
-				{
-					DBbegin();
-
-					DBmass_update_items(&item_diff, &inventory_values);
-					DBmass_update_trends(trends, trends_num, &trends_diff);
-
-					/* process internal events generated by DCmass_prepare_history() */
-					zbx_process_events(NULL, NULL);
-
-					if (ZBX_DB_OK == (txn_error = DBcommit()))
-						DCupdate_trends(&trends_diff);
-					else
-						zbx_reset_event_recovery();
-
-					zbx_vector_uint64_pair_clear(&trends_diff);
-				}
-				while (ZBX_DB_DOWN == txn_error);
+				DCflush_trends(trends, trends_num, &item_diff, &inventory_values);
 			}
 
 			zbx_clean_events();
@@ -3275,7 +3524,10 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 				while (ZBX_DB_DOWN == txn_error);
 
 				if (ZBX_DB_OK == txn_error)
+				{
+					zbx_events_update_open_problems();
 					zbx_events_update_itservices();
+				}
 			}
 		}
 
@@ -3367,13 +3619,28 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 		if (0 != history_num)
 		{
 			zbx_free(trends);
-			DCconfig_clean_items(items, errcodes, history_num);
+			DCconfig_clean_history_sync_items(items, errcodes, history_num);
 			zbx_free(errcodes);
 			zbx_free(items);
 
 			zbx_vector_ptr_clear(&history_items);
 			hc_free_item_values(history, history_num);
 		}
+		else
+		{
+			/* flush trends of the finished hour when there are no values to sync */
+			DCmass_flush_pending_trends(&trends, &trends_num, compression_age);
+
+			if (0 != trends_num)
+			{
+				DCflush_trends(trends, trends_num, NULL, NULL);
+
+				if (SUCCEED == zbx_is_export_enabled(ZBX_FLAG_EXPTYPE_TRENDS))
+					DCexport_all_trends(trends, trends_num);
+
+				zbx_free(trends);
+			}
+		}
 
 		zbx_vector_uint64_destroy(&itemids);
 
@@ -3386,7 +3653,6 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 	zbx_vector_ptr_destroy(&inventory_values);
 	zbx_vector_ptr_destroy(&item_diff);
 	zbx_vector_ptr_destroy(&trigger_diff);
-	zbx_vector_uint64_pair_destroy(&trends_diff);
 	zbx_vector_uint64_pair_destroy(&proxy_subscribtions);
 
 	zbx_vector_ptr_destroy(&trigger_timers);
@@ -4518,6 +4784,11 @@ static int	init_trend_cache(char **error)
 			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
 			__trend_mem_malloc_func, __trend_mem_realloc_func, __trend_mem_free_func);
 
+	zbx_hashset_create_ext(&cache->trends_pending, INIT_HASHSET_SIZE,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+			__trend_mem_malloc_func, __trend_mem_realloc_func, __trend_mem_free_func);
+	cache->trends_pending_flush = 0;
+
 #undef INIT_HASHSET_SIZE
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -104,6 +104,8 @@ static void	dc_maintenance_precache_nested_groups(void);
 static unsigned char	macro_env = ZBX_MACRO_ENV_NONSECURE;
 extern char		*CONFIG_VAULTDBPATH;
 extern char		*CONFIG_VAULTTOKEN;
+extern int		CONFIG_CONF_CACHE_LOAD_CONNECTIONS;
+extern int		CONFIG_HOUSEKEEPING_PARTITION_PERIOD;
 /******************************************************************************
  *                                                                            *
  * Purpose: copies string into configuration cache shared memory              *
@@ -471,7 +473,7 @@ static ZBX_DC_ITEM	*DCfind_item(zbx_uint64_t hostid, const char *key)
 	item_hk_local.hostid = hostid;
 	item_hk_local.key = key;
 
-	if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_search(&config->items_hk, &item_hk_local)))
+	if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_oahashset_search(&config->items_hk, &item_hk_local)))
 		return NULL;
 	else
 		return item_hk->item_ptr;
@@ -1034,10 +1036,11 @@ static int	DCsync_config(zbx_dbsync_t *sync, int *flags)
 		config->config->hk.history = 1;	/* just enough to make 0 == items[i].history condition fail */
 	}
 
-#ifdef HAVE_POSTGRESQL
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
 	if (ZBX_HK_MODE_DISABLED != config->config->hk.history_mode &&
 			ZBX_HK_OPTION_ENABLED == config->config->hk.history_global &&
-			0 == zbx_strcmp_null(config->config->db.extension, ZBX_CONFIG_DB_EXTENSION_TIMESCALE))
+			(0 != CONFIG_HOUSEKEEPING_PARTITION_PERIOD ||
+			0 == zbx_strcmp_null(config->config->db.extension, ZBX_CONFIG_DB_EXTENSION_TIMESCALE)))
 	{
 		config->config->hk.history_mode = ZBX_HK_MODE_PARTITION;
 	}
@@ -1053,10 +1056,11 @@ static int	DCsync_config(zbx_dbsync_t *sync, int *flags)
 		config->config->hk.trends = 1;	/* just enough to make 0 == items[i].trends condition fail */
 	}
 
-#ifdef HAVE_POSTGRESQL
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
 	if (ZBX_HK_MODE_DISABLED != config->config->hk.trends_mode &&
 			ZBX_HK_OPTION_ENABLED == config->config->hk.trends_global &&
-			0 == zbx_strcmp_null(config->config->db.extension, ZBX_CONFIG_DB_EXTENSION_TIMESCALE))
+			(0 != CONFIG_HOUSEKEEPING_PARTITION_PERIOD ||
+			0 == zbx_strcmp_null(config->config->db.extension, ZBX_CONFIG_DB_EXTENSION_TIMESCALE)))
 	{
 		config->config->hk.trends_mode = ZBX_HK_MODE_PARTITION;
 	}
@@ -1130,7 +1134,7 @@ static void	DCsync_hosts(zbx_dbsync_t *sync)
 	int		found;
 	int		update_index_h, update_index_p, ret;
 	zbx_uint64_t	hostid, proxy_hostid;
-	unsigned char	status;
+	unsigned char	status, update_macros;
 	time_t		now;
 	signed char	ipmi_authtype;
 	unsigned char	ipmi_privilege;
@@ -1212,8 +1216,11 @@ static void	DCsync_hosts(zbx_dbsync_t *sync)
 
 		/* store new information in host structure */
 
-		DCstrpool_replace(found, &host->host, row[2]);
-		DCstrpool_replace(found, &host->name, row[11]);
+		update_macros = (SUCCEED == DCstrpool_replace(found, &host->host, row[2]));
+		update_macros |= (SUCCEED == DCstrpool_replace(found, &host->name, row[11]));
+
+		if (0 != update_macros)
+			host->macro_revision = ++config->macro_revision;
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 		DCstrpool_replace(found, &host->tls_issuer, row[15]);
 		DCstrpool_replace(found, &host->tls_subject, row[16]);
@@ -2191,6 +2198,9 @@ void	DCsync_kvs_paths(const struct zbx_json_parse *jp_kvs_paths)
 				dc_kv->value = NULL;
 			}
 
+			/* secret macro values changed */
+			config->macro_global_revision = ++config->macro_revision;
+
 			FINISH_SYNC;
 		}
 
@@ -2357,12 +2367,12 @@ static void	DCsync_interfaces(zbx_dbsync_t *sync)
 	ZBX_DC_INTERFACE	*interface;
 	ZBX_DC_INTERFACE_HT	*interface_ht, interface_ht_local;
 	ZBX_DC_INTERFACE_ADDR	*interface_snmpaddr, interface_snmpaddr_local;
-	ZBX_DC_HOST		*host;
+	ZBX_DC_HOST		*host, *old_host;
 
 	int			found, update_index, ret, i;
 	zbx_uint64_t		interfaceid, hostid;
 	unsigned char		type, main_, useip;
-	unsigned char		reset_snmp_stats;
+	unsigned char		reset_snmp_stats, update_macros;
 	zbx_vector_ptr_t	interfaces;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
@@ -2429,16 +2439,29 @@ static void	DCsync_interfaces(zbx_dbsync_t *sync)
 
 		reset_snmp_stats = (0 == found || interface->hostid != hostid || interface->type != type ||
 				interface->useip != useip);
+		update_macros = (0 != reset_snmp_stats || interface->main != main_);
+
+		/* interface moved to another host, old host address macros must be resolved again */
+		if (0 != found && interface->hostid != hostid &&
+				NULL != (old_host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &interface->hostid)))
+		{
+			old_host->macro_revision = ++config->macro_revision;
+		}
 
 		interface->hostid = hostid;
 		interface->type = type;
 		interface->main = main_;
 		interface->useip = useip;
-		reset_snmp_stats |= (SUCCEED == DCstrpool_replace(found, &interface->ip, row[5]));
-		reset_snmp_stats |= (SUCCEED == DCstrpool_replace(found, &interface->dns, row[6]));
-		reset_snmp_stats |= (SUCCEED == DCstrpool_replace(found, &interface->port, row[7]));
+		update_macros |= (SUCCEED == DCstrpool_replace(found, &interface->ip, row[5]));
+		update_macros |= (SUCCEED == DCstrpool_replace(found, &interface->dns, row[6]));
+		update_macros |= (SUCCEED == DCstrpool_replace(found, &interface->port, row[7]));
+		reset_snmp_stats |= update_macros;
 		reset_snmp_stats |= (SUCCEED == DCstrpool_replace(found, &interface->error, row[10]));
 
+		/* availability changes are frequent, only address changes affect resolved item keys */
+		if (0 != update_macros)
+			host->macro_revision = ++config->macro_revision;
+
 		if (0 == found)
 		{
 			interface->errors_from = atoi(row[11]);
@@ -2551,6 +2574,8 @@ static void	DCsync_interfaces(zbx_dbsync_t *sync)
 
 		if (NULL != (host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &interface->hostid)))
 		{
+			host->macro_revision = ++config->macro_revision;
+
 			for (i = 0; i < host->interfaces_v.values_num; i++)
 			{
 				if (interface == host->interfaces_v.values[i])
@@ -2624,6 +2649,28 @@ static void	dc_interface_snmpitems_remove(ZBX_DC_ITEM *item)
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: remove macro-resolved item fields from configuration cache        *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_resolved_item_remove(zbx_uint64_t itemid)
+{
+	zbx_dc_resolved_item_t	*resolved;
+
+	if (NULL == (resolved = (zbx_dc_resolved_item_t *)zbx_hashset_search(&config->resolved_items, &itemid)))
+		return;
+
+	zbx_strpool_release(resolved->key);
+
+	if (NULL != resolved->snmp_oid)
+		zbx_strpool_release(resolved->snmp_oid);
+
+	zbx_hashset_remove_direct(&config->resolved_items, resolved);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: remove itemid from master item dependent itemid vector            *
@@ -2765,6 +2812,10 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 
 		item = (ZBX_DC_ITEM *)DCfind_id(&config->items, itemid, sizeof(ZBX_DC_ITEM), &found);
 
+		/* item key or parameters might have changed, fields must be resolved again */
+		if (0 != found)
+			dc_resolved_item_remove(itemid);
+
 		/* template item */
 		ZBX_DBROW2UINT64(item->templateid, row[48]);
 
@@ -2785,7 +2836,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 				item_hk_local.hostid = item->hostid;
 				item_hk_local.key = item->key;
 
-				if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_search(&config->items_hk,
+				if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_oahashset_search(&config->items_hk,
 						&item_hk_local)))
 				{
 					/* item keys should be unique for items within a host, otherwise items with  */
@@ -2795,13 +2846,13 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 				else if (item == item_hk->item_ptr)
 				{
 					zbx_strpool_release(item_hk->key);
-					zbx_hashset_remove_direct(&config->items_hk, item_hk);
+					zbx_oahashset_remove_direct(&config->items_hk, item_hk);
 				}
 			}
 
 			item_hk_local.hostid = hostid;
 			item_hk_local.key = row[5];
-			item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_search(&config->items_hk, &item_hk_local);
+			item_hk = (ZBX_DC_ITEM_HK *)zbx_oahashset_search(&config->items_hk, &item_hk_local);
 
 			if (NULL != item_hk)
 				item_hk->item_ptr = item;
@@ -2888,7 +2939,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 			item_hk_local.hostid = item->hostid;
 			item_hk_local.key = zbx_strpool_acquire(item->key);
 			item_hk_local.item_ptr = item;
-			zbx_hashset_insert(&config->items_hk, &item_hk_local, sizeof(ZBX_DC_ITEM_HK));
+			zbx_oahashset_insert(&config->items_hk, &item_hk_local, sizeof(ZBX_DC_ITEM_HK));
 		}
 
 		/* process item intervals and update item nextcheck */
@@ -3328,6 +3379,8 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 		if (ITEM_TYPE_SNMPTRAP == item->type)
 			dc_interface_snmpitems_remove(item);
 
+		dc_resolved_item_remove(itemid);
+
 		/* numeric items */
 
 		if (ITEM_VALUE_TYPE_FLOAT == item->value_type || ITEM_VALUE_TYPE_UINT64 == item->value_type)
@@ -3502,7 +3555,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 		item_hk_local.hostid = item->hostid;
 		item_hk_local.key = item->key;
 
-		if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_hashset_search(&config->items_hk, &item_hk_local)))
+		if (NULL == (item_hk = (ZBX_DC_ITEM_HK *)zbx_oahashset_search(&config->items_hk, &item_hk_local)))
 		{
 			/* item keys should be unique for items within a host, otherwise items with  */
 			/* same key share index and removal of last added item already cleared index */
@@ -3511,7 +3564,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags)
 		else if (item == item_hk->item_ptr)
 		{
 			zbx_strpool_release(item_hk->key);
-			zbx_hashset_remove_direct(&config->items_hk, item_hk);
+			zbx_oahashset_remove_direct(&config->items_hk, item_hk);
 		}
 
 		if (ZBX_LOC_QUEUE == item->location)
@@ -5814,6 +5867,236 @@ static void	dc_load_trigger_queue(zbx_hashset_t *trend_functions)
 	DBfree_result(result);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds open problem to the problem tag index                        *
+ *                                                                            *
+ * Parameters: tag     - [IN] the tag name (string pool reference)            *
+ *             eventid - [IN] the problem event identifier                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_problem_tag_index_add(const char *tag, zbx_uint64_t eventid)
+{
+	zbx_dc_problem_tag_index_t	*index, index_local;
+
+	index_local.tag = tag;
+
+	if (NULL == (index = (zbx_dc_problem_tag_index_t *)zbx_hashset_search(&config->problem_tags, &index_local)))
+	{
+		index = (zbx_dc_problem_tag_index_t *)zbx_hashset_insert(&config->problem_tags, &index_local,
+				sizeof(index_local));
+		index->tag = zbx_strpool_acquire(tag);
+		zbx_hashset_create_ext(&index->eventids, 0, ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL, __config_mem_malloc_func,
+				__config_mem_realloc_func, __config_mem_free_func);
+	}
+
+	zbx_hashset_insert(&index->eventids, &eventid, sizeof(eventid));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes open problem from the problem tag index                   *
+ *                                                                            *
+ * Parameters: tag     - [IN] the tag name                                    *
+ *             eventid - [IN] the problem event identifier                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_problem_tag_index_remove(const char *tag, zbx_uint64_t eventid)
+{
+	zbx_dc_problem_tag_index_t	*index, index_local;
+
+	index_local.tag = tag;
+
+	if (NULL == (index = (zbx_dc_problem_tag_index_t *)zbx_hashset_search(&config->problem_tags, &index_local)))
+		return;
+
+	zbx_hashset_remove(&index->eventids, &eventid);
+
+	if (0 == index->eventids.num_data)
+	{
+		zbx_hashset_destroy(&index->eventids);
+		zbx_strpool_release(index->tag);
+		zbx_hashset_remove_direct(&config->problem_tags, index);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds tag to the open problem and problem tag index                *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_problem_add_tag(zbx_dc_problem_t *problem, const char *tag, const char *value)
+{
+	zbx_dc_problem_tag_t	*problem_tag;
+
+	problem_tag = (zbx_dc_problem_tag_t *)__config_mem_malloc_func(NULL, sizeof(zbx_dc_problem_tag_t));
+	problem_tag->tag = zbx_strpool_intern(tag);
+	problem_tag->value = zbx_strpool_intern(value);
+	zbx_vector_ptr_append(&problem->tags, problem_tag);
+
+	dc_problem_tag_index_add(problem_tag->tag, problem->eventid);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds open problem to configuration cache                          *
+ *                                                                            *
+ * Return value: the added problem or NULL if the problem was already cached  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_dc_problem_t	*dc_problem_add(zbx_uint64_t eventid, zbx_uint64_t triggerid)
+{
+	zbx_dc_problem_t	*problem;
+	int			found;
+
+	problem = (zbx_dc_problem_t *)DCfind_id(&config->problems, eventid, sizeof(zbx_dc_problem_t), &found);
+
+	if (0 != found)
+		return NULL;
+
+	problem->triggerid = triggerid;
+	zbx_vector_ptr_create_ext(&problem->tags, __config_mem_malloc_func, __config_mem_realloc_func,
+			__config_mem_free_func);
+
+	return problem;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: releases open problem tags and removes them from problem tag      *
+ *          index                                                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_problem_clean(zbx_dc_problem_t *problem)
+{
+	int			i;
+	zbx_dc_problem_tag_t	*problem_tag;
+
+	for (i = 0; i < problem->tags.values_num; i++)
+	{
+		problem_tag = (zbx_dc_problem_tag_t *)problem->tags.values[i];
+
+		dc_problem_tag_index_remove(problem_tag->tag, problem->eventid);
+		zbx_strpool_release(problem_tag->tag);
+		zbx_strpool_release(problem_tag->value);
+		__config_mem_free_func(problem_tag);
+	}
+
+	zbx_vector_ptr_destroy(&problem->tags);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads open trigger problems into configuration cache              *
+ *                                                                            *
+ * Comments: Open problems are loaded when the first global correlation rule  *
+ *           is configured, afterwards the event processing keeps them up to  *
+ *           date with zbx_dc_update_open_problems().                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_load_open_problems(void)
+{
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_uint64_t		eventid, triggerid;
+	zbx_dc_problem_t	*problem;
+
+	result = DBselect("select eventid,objectid from problem"
+			" where source=%d"
+				" and object=%d"
+				" and r_eventid is null",
+			EVENT_SOURCE_TRIGGERS, EVENT_OBJECT_TRIGGER);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(eventid, row[0]);
+		ZBX_STR2UINT64(triggerid, row[1]);
+
+		if (NULL != zbx_hashset_search(&config->triggers, &triggerid))
+			dc_problem_add(eventid, triggerid);
+	}
+	DBfree_result(result);
+
+	result = DBselect("select pt.eventid,pt.tag,pt.value from problem_tag pt,problem p"
+			" where pt.eventid=p.eventid"
+				" and p.source=%d"
+				" and p.object=%d"
+				" and p.r_eventid is null",
+			EVENT_SOURCE_TRIGGERS, EVENT_OBJECT_TRIGGER);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(eventid, row[0]);
+
+		/* the problem might have been closed after the problems were selected */
+		if (NULL == (problem = (zbx_dc_problem_t *)zbx_hashset_search(&config->problems, &eventid)))
+			continue;
+
+		dc_problem_add_tag(problem, row[1], row[2]);
+	}
+	DBfree_result(result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes open problems of the removed triggers                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_remove_orphaned_problems(void)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_dc_problem_t	*problem;
+
+	zbx_hashset_iter_reset(&config->problems, &iter);
+	while (NULL != (problem = (zbx_dc_problem_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (NULL != zbx_hashset_search(&config->triggers, &problem->triggerid))
+			continue;
+
+		dc_problem_clean(problem);
+		zbx_hashset_iter_remove(&iter);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads or removes open problems depending on whether global        *
+ *          correlation rules are configured                                  *
+ *                                                                            *
+ * Comments: Open problems are used only by global event correlation, so they *
+ *           are not cached and maintained without correlation rules.         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_sync_open_problems(void)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_dc_problem_t	*problem;
+
+	if (0 != config->correlations.num_data)
+	{
+		if (0 == config->problems_loaded)
+		{
+			dc_load_open_problems();
+			config->problems_loaded = 1;
+		}
+
+		return;
+	}
+
+	if (0 == config->problems_loaded)
+		return;
+
+	zbx_hashset_iter_reset(&config->problems, &iter);
+	while (NULL != (problem = (zbx_dc_problem_t *)zbx_hashset_iter_next(&iter)))
+	{
+		dc_problem_clean(problem);
+		zbx_hashset_iter_remove(&iter);
+	}
+
+	config->problems_loaded = 0;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Synchronize configuration data from database                      *
@@ -5821,7 +6104,7 @@ static void	dc_load_trigger_queue(zbx_hashset_t *trend_functions)
  ******************************************************************************/
 void	DCsync_configuration(unsigned char mode)
 {
-	int		i, flags;
+	int		i, flags, parallel_num = 0;
 	double		sec, csec, hsec, hisec, htsec, gmsec, hmsec, ifsec, isec, tsec, dsec, fsec, expr_sec, csec2,
 			hsec2, hisec2, htsec2, gmsec2, hmsec2, ifsec2, isec2, tsec2, dsec2, fsec2, expr_sec2,
 			action_sec, action_sec2, action_op_sec, action_op_sec2, action_condition_sec,
@@ -5854,6 +6137,15 @@ void	DCsync_configuration(unsigned char mode)
 	{
 		zbx_hashset_create(&trend_queue, 1000, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 		dc_load_trigger_queue(&trend_queue);
+
+		/* tables of the initial load are selected concurrently within each synchronization stage, */
+		/* the selects of a stage must be received with DBparallel_wait() before syncing them      */
+		if (0 != CONFIG_CONF_CACHE_LOAD_CONNECTIONS &&
+				0 != (parallel_num = DBparallel_open(CONFIG_CONF_CACHE_LOAD_CONNECTIONS)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "%s() loading configuration over %d parallel database connections",
+					__func__, parallel_num);
+		}
 	}
 
 	/* global configuration must be synchronized directly with database */
@@ -5940,6 +6232,9 @@ void	DCsync_configuration(unsigned char mode)
 		goto out;
 	host_tag_sec = zbx_time() - sec;
 
+	if (0 != parallel_num && SUCCEED != DBparallel_wait())
+		goto out;
+
 	START_SYNC;
 	sec = zbx_time();
 	DCsync_htmpls(&htmpl_sync);
@@ -5957,6 +6252,13 @@ void	DCsync_configuration(unsigned char mode)
 	DCsync_host_tags(&host_tag_sync);
 	host_tag_sec2 = zbx_time() - sec;
 
+	if (0 != htmpl_sync.add_num + htmpl_sync.update_num + htmpl_sync.remove_num +
+			gmacro_sync.add_num + gmacro_sync.update_num + gmacro_sync.remove_num +
+			hmacro_sync.add_num + hmacro_sync.update_num + hmacro_sync.remove_num)
+	{
+		config->macro_global_revision = ++config->macro_revision;
+	}
+
 	/* postpone configuration sync until macro secrets are received from Zabbix server */
 	if (0 == (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 != config->kvs_paths.values_num &&
 			ZBX_DBSYNC_INIT == mode)
@@ -5998,6 +6300,9 @@ void	DCsync_configuration(unsigned char mode)
 		goto out;
 	maintenance_sec = zbx_time() - sec;
 
+	if (0 != parallel_num && SUCCEED != DBparallel_wait())
+		goto out;
+
 	START_SYNC;
 	sec = zbx_time();
 	DCsync_hosts(&hosts_sync);
@@ -6064,6 +6369,9 @@ void	DCsync_configuration(unsigned char mode)
 		goto out;
 	itemscrp_sec = zbx_time() - sec;
 
+	if (0 != parallel_num && SUCCEED != DBparallel_wait())
+		goto out;
+
 	START_SYNC;
 
 	/* resolves macros for interface_snmpaddrs, must be after DCsync_hmacros() */
@@ -6106,6 +6414,9 @@ void	DCsync_configuration(unsigned char mode)
 		goto out;
 	fsec = zbx_time() - sec;
 
+	if (0 != parallel_num && SUCCEED != DBparallel_wait())
+		goto out;
+
 	START_SYNC;
 	sec = zbx_time();
 	DCsync_functions(&func_sync);
@@ -6164,12 +6475,25 @@ void	DCsync_configuration(unsigned char mode)
 		goto out;
 	corr_operation_sec = zbx_time() - sec;
 
+	/* all selects are received, the results stay valid after parallel connections are closed */
+	if (0 != parallel_num)
+	{
+		if (SUCCEED != DBparallel_wait())
+			goto out;
+
+		DBparallel_close();
+	}
+
 	START_SYNC;
 
 	sec = zbx_time();
 	DCsync_triggers(&triggers_sync);
 	tsec2 = zbx_time() - sec;
 
+	/* relies on triggers, must be after DCsync_triggers() */
+	if (0 != config->problems_loaded && 0 != triggers_sync.remove_num)
+		dc_remove_orphaned_problems();
+
 	sec = zbx_time();
 	DCsync_trigdeps(&tdep_sync);
 	dsec2 = zbx_time() - sec;
@@ -6213,6 +6537,10 @@ void	DCsync_configuration(unsigned char mode)
 	DCsync_corr_operations(&corr_operation_sync);
 	corr_operation_sec2 = zbx_time() - sec;
 
+	/* relies on triggers and correlation rules, must be after DCsync_correlations() */
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+		dc_sync_open_problems();
+
 	sec = zbx_time();
 
 	if (0 != hosts_sync.add_num + hosts_sync.update_num + hosts_sync.remove_num)
@@ -6415,6 +6743,8 @@ void	DCsync_configuration(unsigned char mode)
 				config->interface_snmpitems.num_data, config->interface_snmpitems.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() if_snmpaddr: %d (%d slots)", __func__,
 				config->interface_snmpaddrs.num_data, config->interface_snmpaddrs.num_slots);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() resolved   : %d (%d slots)", __func__,
+				config->resolved_items.num_data, config->resolved_items.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() items      : %d (%d slots)", __func__,
 				config->items.num_data, config->items.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() items_hk   : %d (%d slots)", __func__,
@@ -6473,6 +6803,10 @@ void	DCsync_configuration(unsigned char mode)
 				config->corr_conditions.num_data, config->corr_conditions.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() corr. ops  : %d (%d slots)", __func__,
 				config->corr_operations.num_data, config->corr_operations.num_slots);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() problems   : %d (%d slots)", __func__,
+				config->problems.num_data, config->problems.num_slots);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() prob. tags : %d (%d slots)", __func__,
+				config->problem_tags.num_data, config->problem_tags.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() hgroups    : %d (%d slots)", __func__,
 				config->hostgroups.num_data, config->hostgroups.num_slots);
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() item procs : %d (%d slots)", __func__,
@@ -6518,6 +6852,9 @@ out:
 
 	FINISH_SYNC;
 
+	if (0 != parallel_num)
+		DBparallel_close();
+
 	zbx_dbsync_clear(&config_sync);
 	zbx_dbsync_clear(&autoreg_config_sync);
 	zbx_dbsync_clear(&hosts_sync);
@@ -6817,6 +7154,23 @@ static int	__config_regexp_compare(const void *d1, const void *d2)
 	return r1->name == r2->name ? 0 : strcmp(r1->name, r2->name);
 }
 
+/* hash and compare functions for problem tag index hashset */
+
+static zbx_hash_t	__config_problem_tag_hash(const void *data)
+{
+	const zbx_dc_problem_tag_index_t	*index = (const zbx_dc_problem_tag_index_t *)data;
+
+	return ZBX_DEFAULT_STRING_HASH_FUNC(index->tag);
+}
+
+static int	__config_problem_tag_compare(const void *d1, const void *d2)
+{
+	const zbx_dc_problem_tag_index_t	*i1 = (const zbx_dc_problem_tag_index_t *)d1;
+	const zbx_dc_problem_tag_index_t	*i2 = (const zbx_dc_problem_tag_index_t *)d2;
+
+	return i1->tag == i2->tag ? 0 : strcmp(i1->tag, i2->tag);
+}
+
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 static zbx_hash_t	__config_psk_hash(const void *data)
 {
@@ -6907,6 +7261,11 @@ int	init_configuration_cache(char **error)
 	zbx_hashset_create_ext(&hashset, hashset_size, hash_func, compare_func, NULL,				\
 			__config_mem_malloc_func, __config_mem_realloc_func, __config_mem_free_func)
 
+#define CREATE_OAHASHSET_EXT(hashset, hashset_size, hash_func, compare_func)					\
+														\
+	zbx_oahashset_create_ext(&hashset, hashset_size, hash_func, compare_func, NULL,				\
+			__config_mem_malloc_func, __config_mem_realloc_func, __config_mem_free_func)
+
 	CREATE_HASHSET(config->items, 100);
 	CREATE_HASHSET(config->numitems, 0);
 	CREATE_HASHSET(config->snmpitems, 0);
@@ -6941,6 +7300,7 @@ int	init_configuration_cache(char **error)
 	CREATE_HASHSET(config->interfaces, 10);
 	CREATE_HASHSET(config->interfaces_snmp, 0);
 	CREATE_HASHSET(config->interface_snmpitems, 0);
+	CREATE_HASHSET(config->resolved_items, 0);
 	CREATE_HASHSET(config->expressions, 0);
 	CREATE_HASHSET(config->actions, 0);
 	CREATE_HASHSET(config->action_conditions, 0);
@@ -6951,6 +7311,7 @@ int	init_configuration_cache(char **error)
 	CREATE_HASHSET(config->correlations, 0);
 	CREATE_HASHSET(config->corr_conditions, 0);
 	CREATE_HASHSET(config->corr_operations, 0);
+	CREATE_HASHSET(config->problems, 0);
 	CREATE_HASHSET(config->hostgroups, 0);
 	zbx_vector_ptr_create_ext(&config->hostgroups_name, __config_mem_malloc_func, __config_mem_realloc_func,
 			__config_mem_free_func);
@@ -6963,7 +7324,7 @@ int	init_configuration_cache(char **error)
 	CREATE_HASHSET(config->maintenance_periods, 0);
 	CREATE_HASHSET(config->maintenance_tags, 0);
 
-	CREATE_HASHSET_EXT(config->items_hk, 100, __config_item_hk_hash, __config_item_hk_compare);
+	CREATE_OAHASHSET_EXT(config->items_hk, 100, __config_item_hk_hash, __config_item_hk_compare);
 	CREATE_HASHSET_EXT(config->hosts_h, 10, __config_host_h_hash, __config_host_h_compare);
 	CREATE_HASHSET_EXT(config->hosts_p, 0, __config_host_h_hash, __config_host_h_compare);
 	CREATE_HASHSET_EXT(config->gmacros_m, 0, __config_gmacro_m_hash, __config_gmacro_m_compare);
@@ -6971,6 +7332,7 @@ int	init_configuration_cache(char **error)
 	CREATE_HASHSET_EXT(config->interfaces_ht, 10, __config_interface_ht_hash, __config_interface_ht_compare);
 	CREATE_HASHSET_EXT(config->interface_snmpaddrs, 0, __config_interface_addr_hash, __config_interface_addr_compare);
 	CREATE_HASHSET_EXT(config->regexps, 0, __config_regexp_hash, __config_regexp_compare);
+	CREATE_HASHSET_EXT(config->problem_tags, 0, __config_problem_tag_hash, __config_problem_tag_compare);
 
 	CREATE_HASHSET_EXT(config->strpool, 100, __config_strpool_hash, __config_strpool_compare);
 
@@ -7034,8 +7396,11 @@ int	init_configuration_cache(char **error)
 	config->sync_ts = 0;
 	config->item_sync_ts = 0;
 	config->sync_start_ts = 0;
+	config->macro_revision = 0;
+	config->macro_global_revision = 0;
 
 	config->internal_actions = 0;
+	config->problems_loaded = 0;
 
 	/* maintenance data are used only when timers are defined (server) */
 	if (0 != CONFIG_TIMER_FORKS)
@@ -7062,6 +7427,7 @@ int	init_configuration_cache(char **error)
 
 #undef CREATE_HASHSET
 #undef CREATE_HASHSET_EXT
+#undef CREATE_OAHASHSET_EXT
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 
@@ -7816,6 +8182,59 @@ static void	DCget_item(DC_ITEM *dst_item, const ZBX_DC_ITEM *src_item, unsigned
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies item data required by history syncers                      *
+ *                                                                            *
+ * Parameters: dst_item - [OUT] the item data                                 *
+ *             src_item - [IN] the configuration cache item                   *
+ *             mode     - [IN] the item data to retrieve, see                 *
+ *                             ZBX_ITEM_GET_* defines                         *
+ *                                                                            *
+ * Comments: Only ZBX_ITEM_GET_NUM, ZBX_ITEM_GET_EMPTY_UNITS and              *
+ *           ZBX_ITEM_GET_EMPTY_ERROR flags affect item data, other fields    *
+ *           are always copied.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCget_history_sync_item(zbx_history_sync_item_t *dst_item, const ZBX_DC_ITEM *src_item,
+		unsigned int mode)
+{
+	const ZBX_DC_NUMITEM	*numitem;
+
+	dst_item->itemid = src_item->itemid;
+	dst_item->type = src_item->type;
+	dst_item->value_type = src_item->value_type;
+	dst_item->flags = src_item->flags;
+
+	dst_item->state = src_item->state;
+	dst_item->lastlogsize = src_item->lastlogsize;
+	dst_item->mtime = src_item->mtime;
+
+	dst_item->history = src_item->history;
+	dst_item->history_sec = src_item->history_sec;
+
+	dst_item->inventory_link = src_item->inventory_link;
+	dst_item->valuemapid = src_item->valuemapid;
+	dst_item->status = src_item->status;
+
+	dst_item->key_orig = zbx_strdup(NULL, src_item->key);
+
+	if ((ZBX_ITEM_GET_EMPTY_ERROR & mode) || '\0' != *src_item->error)
+		dst_item->error = zbx_strdup(NULL, src_item->error);
+
+	if (0 != (ZBX_ITEM_GET_NUM & mode) && (ITEM_VALUE_TYPE_FLOAT == src_item->value_type ||
+			ITEM_VALUE_TYPE_UINT64 == src_item->value_type))
+	{
+		numitem = (ZBX_DC_NUMITEM *)zbx_hashset_search(&config->numitems, &src_item->itemid);
+
+		dst_item->trends = numitem->trends;
+		dst_item->trends_sec = numitem->trends_sec;
+
+		if (0 != (ZBX_ITEM_GET_EMPTY_UNITS & mode) || '\0' != *numitem->units)
+			dst_item->units = zbx_strdup(NULL, numitem->units);
+	}
+}
+
 void	DCconfig_clean_items(DC_ITEM *items, int *errcodes, size_t num)
 {
 	size_t	i;
@@ -7855,6 +8274,21 @@ void	DCconfig_clean_items(DC_ITEM *items, int *errcodes, size_t num)
 	}
 }
 
+void	DCconfig_clean_history_sync_items(zbx_history_sync_item_t *items, int *errcodes, size_t num)
+{
+	size_t	i;
+
+	for (i = 0; i < num; i++)
+	{
+		if (NULL != errcodes && SUCCEED != errcodes[i])
+			continue;
+
+		zbx_free(items[i].key_orig);
+		zbx_free(items[i].units);
+		zbx_free(items[i].error);
+	}
+}
+
 static void	DCget_function(DC_FUNCTION *dst_function, const ZBX_DC_FUNCTION *src_function)
 {
 	size_t	sz_function, sz_parameter;
@@ -8109,34 +8543,105 @@ void	DCconfig_get_items_by_itemids_partial(DC_ITEM *items, const zbx_uint64_t *i
 
 /******************************************************************************
  *                                                                            *
- * Purpose: initialize new preprocessor item from configuration cache         *
+ * Purpose: get item data required by history syncers                         *
  *                                                                            *
- * Parameters: item   - [OUT] the item to initialize                          *
- *             itemid - [IN] the item identifier                              *
+ * Parameters: items    - [OUT] pointer to array of items                     *
+ *             itemids  - [IN] array of item identifiers                      *
+ *             errcodes - [OUT] SUCCEED if item found, otherwise FAIL         *
+ *             num      - [IN] number of elements                             *
+ *             mode     - [IN] the host and item data to retrieve, see        *
+ *                             ZBX_ITEM_GET_* defines                         *
  *                                                                            *
- * Return value: SUCCEED - the item was initialized successfully              *
- *               FAIL    - item with the specified itemid is not cached or    *
- *                         monitored                                          *
+ * Comments: Unlike DCconfig_get_items_by_itemids_partial() this function     *
+ *           copies only the item fields used when processing item values,    *
+ *           avoiding large per item copies for history sync batches.         *
+ *           Item error is always set and units are set for numeric items     *
+ *           when ZBX_ITEM_GET_NUM flag is specified.                         *
  *                                                                            *
  ******************************************************************************/
-static int	dc_preproc_item_init(zbx_preproc_item_t *item, zbx_uint64_t itemid)
+void	DCconfig_history_sync_get_items_by_itemids(zbx_history_sync_item_t *items, const zbx_uint64_t *itemids,
+		int *errcodes, size_t num, unsigned int mode)
 {
+	size_t			i;
 	const ZBX_DC_ITEM	*dc_item;
-	const ZBX_DC_HOST	*dc_host;
-
-	if (NULL == (dc_item = (const ZBX_DC_ITEM *)zbx_hashset_search(&config->items, &itemid)))
-		return FAIL;
-
-	if (ITEM_STATUS_ACTIVE != dc_item->status)
-		return FAIL;
+	const ZBX_DC_HOST	*dc_host = NULL;
 
-	if (NULL == (dc_host = (const ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &dc_item->hostid)))
-		return FAIL;
+	memset(items, 0, sizeof(zbx_history_sync_item_t) * (size_t)num);
+	memset(errcodes, 0, sizeof(int) * (size_t)num);
 
-	if (HOST_STATUS_MONITORED != dc_host->status)
-		return FAIL;
+	RDLOCK_CACHE;
 
-	item->itemid = itemid;
+	for (i = 0; i < num; i++)
+	{
+		if (NULL == (dc_item = (ZBX_DC_ITEM *)zbx_hashset_search(&config->items, &itemids[i])))
+		{
+			errcodes[i] = FAIL;
+			continue;
+		}
+
+		if (NULL == dc_host || dc_host->hostid != dc_item->hostid)
+		{
+			if (NULL == (dc_host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &dc_item->hostid)))
+			{
+				errcodes[i] = FAIL;
+				continue;
+			}
+		}
+
+		DCget_host(&items[i].host, dc_host, mode);
+		DCget_history_sync_item(&items[i], dc_item, mode);
+	}
+
+	UNLOCK_CACHE;
+
+	/* avoid unnecessary allocations inside lock if there are no error or units */
+	for (i = 0; i < num; i++)
+	{
+		if (FAIL == errcodes[i])
+			continue;
+
+		if (NULL == items[i].error)
+			items[i].error = zbx_strdup(NULL, "");
+
+		if (0 != (ZBX_ITEM_GET_NUM & mode) && (ITEM_VALUE_TYPE_FLOAT == items[i].value_type ||
+				ITEM_VALUE_TYPE_UINT64 == items[i].value_type))
+		{
+			if (NULL == items[i].units)
+				items[i].units = zbx_strdup(NULL, "");
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initialize new preprocessor item from configuration cache         *
+ *                                                                            *
+ * Parameters: item   - [OUT] the item to initialize                          *
+ *             itemid - [IN] the item identifier                              *
+ *                                                                            *
+ * Return value: SUCCEED - the item was initialized successfully              *
+ *               FAIL    - item with the specified itemid is not cached or    *
+ *                         monitored                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_preproc_item_init(zbx_preproc_item_t *item, zbx_uint64_t itemid)
+{
+	const ZBX_DC_ITEM	*dc_item;
+	const ZBX_DC_HOST	*dc_host;
+
+	if (NULL == (dc_item = (const ZBX_DC_ITEM *)zbx_hashset_search(&config->items, &itemid)))
+		return FAIL;
+
+	if (ITEM_STATUS_ACTIVE != dc_item->status)
+		return FAIL;
+
+	if (NULL == (dc_host = (const ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &dc_item->hostid)))
+		return FAIL;
+
+	if (HOST_STATUS_MONITORED != dc_host->status)
+		return FAIL;
+
+	item->itemid = itemid;
 	item->type = dc_item->type;
 	item->value_type = dc_item->value_type;
 
@@ -9247,6 +9752,60 @@ static void	dc_requeue_item_at(ZBX_DC_ITEM *dc_item, ZBX_DC_HOST *dc_host, int n
 	DCupdate_item_queue(dc_item, old_poller_type, old_nextcheck);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if fields resolved with the specified macro revision are    *
+ *          still valid for the host                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_macro_revision_valid(zbx_uint64_t revision, const ZBX_DC_HOST *dc_host)
+{
+	if (revision < config->macro_global_revision || revision < dc_host->macro_revision)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copy macro-resolved item fields from configuration cache          *
+ *                                                                            *
+ * Parameters: item    - [IN/OUT] the item retrieved by DCget_item()          *
+ *             dc_host - [IN] the item host                                   *
+ *                                                                            *
+ * Comments: If the fields are not cached or macros have changed since they   *
+ *           were resolved the item is left for poller to resolve and store   *
+ *           with DCconfig_set_resolved_items().                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_get_resolved_item(DC_ITEM *item, const ZBX_DC_HOST *dc_host)
+{
+	const zbx_dc_resolved_item_t	*resolved;
+
+	item->macro_revision = config->macro_revision;
+	item->macros_resolved = 0;
+
+	if (NULL == (resolved = (const zbx_dc_resolved_item_t *)zbx_hashset_search(&config->resolved_items,
+			&item->itemid)))
+	{
+		return;
+	}
+
+	if (SUCCEED != dc_macro_revision_valid(resolved->revision, dc_host))
+		return;
+
+	if (ITEM_TYPE_SNMP == item->type)
+	{
+		if (NULL == resolved->snmp_oid)
+			return;
+
+		item->snmp_oid = zbx_strdup(NULL, resolved->snmp_oid);
+	}
+
+	item->key = zbx_strdup(NULL, resolved->key);
+	item->macros_resolved = 1;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Get array of items for selected poller                            *
@@ -9267,6 +9826,12 @@ static void	dc_requeue_item_at(ZBX_DC_ITEM *dc_item, ZBX_DC_HOST *dc_host, int n
  *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
  *           function.                                                        *
  *                                                                            *
+ *           Pollers keep using DC_ITEM rather than zbx_history_sync_item_t - *
+ *           the *_orig buffers are filled with macro substituted values      *
+ *           during item preparation and only the set string lengths are      *
+ *           copied inside the lock, so a compact copy would not shorten the  *
+ *           lock hold time noticeably.                                       *
+ *                                                                            *
  ******************************************************************************/
 int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 {
@@ -9393,6 +9958,7 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 		dc_item->location = ZBX_LOC_POLLER;
 		DCget_host(&(*items)[num].host, dc_host, ZBX_ITEM_GET_ALL);
 		DCget_item(&(*items)[num], dc_item, ZBX_ITEM_GET_ALL);
+		dc_get_resolved_item(&(*items)[num], dc_host);
 		num++;
 	}
 
@@ -9403,6 +9969,94 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 	return num;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: store macro-resolved item fields in configuration cache           *
+ *                                                                            *
+ * Parameters: items    - [IN] the items returned by                          *
+ *                             DCconfig_get_poller_items() and prepared by    *
+ *                             poller                                         *
+ *             errcodes - [IN] the item preparation result codes              *
+ *             num      - [IN] the number of items                            *
+ *                                                                            *
+ * Comments: Fields are stored only if item configuration and the macros they *
+ *           depend on did not change since items were retrieved. Write lock  *
+ *           is taken only when there are items resolved by the poller.       *
+ *                                                                            *
+ ******************************************************************************/
+void	DCconfig_set_resolved_items(const DC_ITEM *items, const int *errcodes, int num)
+{
+	int				i;
+	const ZBX_DC_ITEM		*dc_item;
+	const ZBX_DC_HOST		*dc_host;
+	const ZBX_DC_SNMPITEM		*snmpitem;
+	zbx_dc_resolved_item_t		*resolved;
+
+	for (i = 0; i < num; i++)
+	{
+		if (SUCCEED == errcodes[i] && 0 == items[i].macros_resolved)
+			break;
+	}
+
+	if (i == num)
+		return;
+
+	WRLOCK_CACHE;
+
+	for (; i < num; i++)
+	{
+		int	found;
+
+		if (SUCCEED != errcodes[i] || 0 != items[i].macros_resolved)
+			continue;
+
+		if (NULL == (dc_host = (const ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &items[i].host.hostid)))
+			continue;
+
+		if (SUCCEED != dc_macro_revision_valid(items[i].macro_revision, dc_host))
+			continue;
+
+		if (NULL == (dc_item = (const ZBX_DC_ITEM *)zbx_hashset_search(&config->items, &items[i].itemid)))
+			continue;
+
+		/* item could have been updated after it was retrieved */
+		if (dc_item->type != items[i].type || 0 != strcmp(dc_item->key, items[i].key_orig))
+			continue;
+
+		if (ITEM_TYPE_SNMP == items[i].type)
+		{
+			if (NULL == items[i].snmp_oid || NULL == (snmpitem = (const ZBX_DC_SNMPITEM *)
+					zbx_hashset_search(&config->snmpitems, &items[i].itemid)) ||
+					0 != strcmp(snmpitem->snmp_oid, items[i].snmp_oid_orig))
+			{
+				continue;
+			}
+		}
+
+		resolved = (zbx_dc_resolved_item_t *)DCfind_id(&config->resolved_items, items[i].itemid,
+				sizeof(zbx_dc_resolved_item_t), &found);
+
+		DCstrpool_replace(found, &resolved->key, items[i].key);
+
+		if (ITEM_TYPE_SNMP == items[i].type)
+		{
+			DCstrpool_replace(0 != found && NULL != resolved->snmp_oid, &resolved->snmp_oid,
+					items[i].snmp_oid);
+		}
+		else
+		{
+			if (0 != found && NULL != resolved->snmp_oid)
+				zbx_strpool_release(resolved->snmp_oid);
+
+			resolved->snmp_oid = NULL;
+		}
+
+		resolved->revision = items[i].macro_revision;
+	}
+
+	UNLOCK_CACHE;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Get array of items for IPMI poller                                *
@@ -12512,6 +13166,200 @@ void	zbx_dc_correlation_rules_get(zbx_correlation_rules_t *rules)
 	zbx_vector_ptr_sort(&rules->correlations, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies open problem from configuration cache                      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_event_problem_t	*dc_problem_dup(const zbx_dc_problem_t *dc_problem)
+{
+	zbx_event_problem_t		*problem;
+	const zbx_dc_problem_tag_t	*dc_tag;
+	zbx_tag_t			*tag;
+	int				i;
+
+	problem = (zbx_event_problem_t *)zbx_malloc(NULL, sizeof(zbx_event_problem_t));
+	problem->eventid = dc_problem->eventid;
+	problem->triggerid = dc_problem->triggerid;
+	zbx_vector_ptr_create(&problem->tags);
+
+	if (0 != dc_problem->tags.values_num)
+	{
+		zbx_vector_ptr_reserve(&problem->tags, dc_problem->tags.values_num);
+
+		for (i = 0; i < dc_problem->tags.values_num; i++)
+		{
+			dc_tag = (const zbx_dc_problem_tag_t *)dc_problem->tags.values[i];
+
+			tag = (zbx_tag_t *)zbx_malloc(NULL, sizeof(zbx_tag_t));
+			tag->tag = zbx_strdup(NULL, dc_tag->tag);
+			tag->value = zbx_strdup(NULL, dc_tag->value);
+			zbx_vector_ptr_append(&problem->tags, tag);
+		}
+	}
+
+	return problem;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets open trigger problems from configuration cache               *
+ *                                                                            *
+ * Parameter: tags     - [IN] the tag names, problems having at least one of  *
+ *                           them are returned (optional, all problems are    *
+ *                           returned if NULL)                                *
+ *            problems - [OUT] the problems (zbx_event_problem_t), sorted by  *
+ *                             event identifier                               *
+ *                                                                            *
+ * Return value: The total number of open trigger problems.                   *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dc_get_open_problems(const zbx_vector_str_t *tags, zbx_vector_ptr_t *problems)
+{
+	int				i, problems_num;
+	zbx_hashset_iter_t		iter;
+	const zbx_dc_problem_t		*dc_problem;
+	zbx_dc_problem_tag_index_t	*index, index_local;
+	zbx_vector_uint64_t		eventids;
+	zbx_uint64_t			*peventid;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() tags:%d", __func__, NULL == tags ? -1 : tags->values_num);
+
+	zbx_vector_uint64_create(&eventids);
+
+	RDLOCK_CACHE;
+
+	if (NULL == tags)
+	{
+		zbx_vector_ptr_reserve(problems, config->problems.num_data);
+
+		zbx_hashset_iter_reset(&config->problems, &iter);
+		while (NULL != (dc_problem = (const zbx_dc_problem_t *)zbx_hashset_iter_next(&iter)))
+			zbx_vector_ptr_append(problems, dc_problem_dup(dc_problem));
+	}
+	else
+	{
+		for (i = 0; i < tags->values_num; i++)
+		{
+			index_local.tag = tags->values[i];
+
+			if (NULL == (index = (zbx_dc_problem_tag_index_t *)zbx_hashset_search(&config->problem_tags,
+					&index_local)))
+			{
+				continue;
+			}
+
+			zbx_hashset_iter_reset(&index->eventids, &iter);
+			while (NULL != (peventid = (zbx_uint64_t *)zbx_hashset_iter_next(&iter)))
+				zbx_vector_uint64_append(&eventids, *peventid);
+		}
+
+		zbx_vector_uint64_sort(&eventids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		zbx_vector_uint64_uniq(&eventids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+		for (i = 0; i < eventids.values_num; i++)
+		{
+			if (NULL != (dc_problem = (const zbx_dc_problem_t *)zbx_hashset_search(&config->problems,
+					&eventids.values[i])))
+			{
+				zbx_vector_ptr_append(problems, dc_problem_dup(dc_problem));
+			}
+		}
+	}
+
+	problems_num = config->problems.num_data;
+
+	UNLOCK_CACHE;
+
+	zbx_vector_uint64_destroy(&eventids);
+
+	zbx_vector_ptr_sort(problems, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() problems:%d/%d", __func__, problems->values_num, problems_num);
+
+	return problems_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates open trigger problems in configuration cache              *
+ *                                                                            *
+ * Parameter: problem_events  - [IN] the new trigger problem events           *
+ *                                   (DB_EVENT), optional                     *
+ *            closed_eventids - [IN] the closed problem event identifiers,    *
+ *                                   optional                                 *
+ *                                                                            *
+ * Comments: This function must be called after the problem changes have been *
+ *           committed to database.                                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dc_update_open_problems(const zbx_vector_ptr_t *problem_events,
+		const zbx_vector_uint64_t *closed_eventids)
+{
+	int			i, j;
+	unsigned char		problems_loaded;
+	const DB_EVENT		*event;
+	const zbx_tag_t		*tag;
+	zbx_dc_problem_t	*problem;
+
+	if ((NULL == problem_events || 0 == problem_events->values_num) &&
+			(NULL == closed_eventids || 0 == closed_eventids->values_num))
+	{
+		return;
+	}
+
+	/* Open problems are loaded with write lock, so if they are not loaded yet, the loading will */
+	/* select the committed problem changes from database.                                      */
+	RDLOCK_CACHE;
+	problems_loaded = config->problems_loaded;
+	UNLOCK_CACHE;
+
+	if (0 == problems_loaded)
+		return;
+
+	WRLOCK_CACHE;
+
+	if (0 == config->problems_loaded)
+	{
+		UNLOCK_CACHE;
+		return;
+	}
+
+	if (NULL != problem_events)
+	{
+		for (i = 0; i < problem_events->values_num; i++)
+		{
+			event = (const DB_EVENT *)problem_events->values[i];
+
+			if (NULL == (problem = dc_problem_add(event->eventid, event->objectid)))
+				continue;
+
+			for (j = 0; j < event->tags.values_num; j++)
+			{
+				tag = (const zbx_tag_t *)event->tags.values[j];
+				dc_problem_add_tag(problem, tag->tag, tag->value);
+			}
+		}
+	}
+
+	if (NULL != closed_eventids)
+	{
+		for (i = 0; i < closed_eventids->values_num; i++)
+		{
+			if (NULL == (problem = (zbx_dc_problem_t *)zbx_hashset_search(&config->problems,
+					&closed_eventids->values[i])))
+			{
+				continue;
+			}
+
+			dc_problem_clean(problem);
+			zbx_hashset_remove_direct(&config->problems, problem);
+		}
+	}
+
+	UNLOCK_CACHE;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: cache nested group identifiers                                    *
@@ -12644,6 +13492,59 @@ void	zbx_dc_get_nested_hostgroupids(zbx_uint64_t *groupids, int groupids_num, zb
 	zbx_vector_uint64_uniq(nested_groupids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if any of the hosts belongs to the group or its nested     *
+ *          groups                                                            *
+ *                                                                            *
+ * Parameter: groupid - [IN] the group identifier                             *
+ *            hostids - [IN] the host identifiers                             *
+ *                                                                            *
+ * Return value: SUCCEED - at least one host belongs to the group             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dc_check_hostgroup_hosts(zbx_uint64_t groupid, const zbx_vector_uint64_t *hostids)
+{
+	int			i, j, ret = FAIL;
+	zbx_vector_uint64_t	groupids;
+	zbx_dc_hostgroup_t	*group;
+
+	if (0 == hostids->values_num)
+		return FAIL;
+
+	zbx_vector_uint64_create(&groupids);
+
+	/* write lock is required to cache nested group identifiers */
+	WRLOCK_CACHE;
+
+	dc_get_nested_hostgroupids(groupid, &groupids);
+
+	for (i = 0; i < groupids.values_num && SUCCEED != ret; i++)
+	{
+		if (NULL == (group = (zbx_dc_hostgroup_t *)zbx_hashset_search(&config->hostgroups,
+				&groupids.values[i])))
+		{
+			continue;
+		}
+
+		for (j = 0; j < hostids->values_num; j++)
+		{
+			if (NULL != zbx_hashset_search(&group->hostids, &hostids->values[j]))
+			{
+				ret = SUCCEED;
+				break;
+			}
+		}
+	}
+
+	UNLOCK_CACHE;
+
+	zbx_vector_uint64_destroy(&groupids);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: gets hostids belonging to the group and its nested groups         *
@@ -318,6 +318,7 @@ typedef struct
 							/* by a particular proxy. */
 							/* NOTE: On disabled hosts all items are counted as disabled. */
 	zbx_uint64_t	maintenanceid;
+	zbx_uint64_t	macro_revision;		/* macro revision of the last host name or interface change */
 
 	const char	*host;
 	const char	*name;
@@ -697,6 +698,30 @@ typedef struct
 }
 zbx_dc_correlation_t;
 
+typedef struct
+{
+	const char	*tag;
+	const char	*value;
+}
+zbx_dc_problem_tag_t;
+
+/* open trigger problem, indexed for global event correlation */
+typedef struct
+{
+	zbx_uint64_t		eventid;
+	zbx_uint64_t		triggerid;
+	zbx_vector_ptr_t	tags;		/* zbx_dc_problem_tag_t */
+}
+zbx_dc_problem_t;
+
+/* open trigger problems having the tag name */
+typedef struct
+{
+	const char	*tag;
+	zbx_hashset_t	eventids;
+}
+zbx_dc_problem_tag_index_t;
+
 #define ZBX_DC_HOSTGROUP_FLAGS_NONE		0
 #define ZBX_DC_HOSTGROUP_FLAGS_NESTED_GROUPIDS	1
 
@@ -781,6 +806,15 @@ typedef struct
 }
 zbx_dc_timer_trigger_t;
 
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	zbx_uint64_t	revision;	/* macro revision the fields were resolved with */
+	const char	*key;
+	const char	*snmp_oid;
+}
+zbx_dc_resolved_item_t;
+
 typedef struct
 {
 	/* timestamp of the last host availability diff sent to sever, used only by proxies */
@@ -790,8 +824,17 @@ typedef struct
 	int			item_sync_ts;
 	int			sync_start_ts;
 
+	/* Macro revisions are used to validate macro-resolved item fields. The global revision is */
+	/* updated when template links, global or host macros change and the host revisions when  */
+	/* host names or interfaces change. Both are assigned from incremented macro_revision.     */
+	zbx_uint64_t		macro_revision;
+	zbx_uint64_t		macro_global_revision;
+
 	unsigned int		internal_actions;		/* number of enabled internal actions */
 
+	/* open trigger problems are cached only while global correlation rules are configured */
+	unsigned char		problems_loaded;
+
 	/* maintenance processing management */
 	unsigned char		maintenance_update;		/* flag to trigger maintenance update by timers  */
 	zbx_uint64_t		*maintenance_update_flags;	/* Array of flags to manage timer maintenance updates.*/
@@ -801,7 +844,7 @@ typedef struct
 	char			*session_token;
 
 	zbx_hashset_t		items;
-	zbx_hashset_t		items_hk;		/* hostid, key */
+	zbx_oahashset_t		items_hk;		/* hostid, key */
 	zbx_hashset_t		template_items;		/* template items selected from items table */
 	zbx_hashset_t		prototype_items;	/* item prototypes selected from items table */
 	zbx_hashset_t		numitems;
@@ -843,6 +886,7 @@ typedef struct
 	zbx_hashset_t		interfaces_ht;		/* hostid, type */
 	zbx_hashset_t		interface_snmpaddrs;	/* addr, interfaceids for SNMP interfaces */
 	zbx_hashset_t		interface_snmpitems;	/* interfaceid, itemids for SNMP trap items */
+	zbx_hashset_t		resolved_items;		/* macro-resolved item fields cached by pollers */
 	zbx_hashset_t		regexps;
 	zbx_hashset_t		expressions;
 	zbx_hashset_t		actions;
@@ -854,6 +898,8 @@ typedef struct
 	zbx_hashset_t		correlations;
 	zbx_hashset_t		corr_conditions;
 	zbx_hashset_t		corr_operations;
+	zbx_hashset_t		problems;		/* open trigger problems */
+	zbx_hashset_t		problem_tags;		/* open trigger problem index by tag name */
 	zbx_hashset_t		hostgroups;
 	zbx_vector_ptr_t	hostgroups_name;	/* host groups sorted by name */
 	zbx_vector_ptr_t	kvs_paths;
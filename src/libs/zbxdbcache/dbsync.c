@@ -730,7 +730,7 @@ int	zbx_dbsync_compare_hosts(zbx_dbsync_t *sync)
 
 	dbsync_prepare(sync, 22, NULL);
 #else
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
 				"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
 				"status,name,lastaccess,tls_connect,tls_accept,"
@@ -846,7 +846,7 @@ int	zbx_dbsync_compare_host_inventory(zbx_dbsync_t *sync)
 			"poc_2_cell,poc_2_screen,poc_2_notes"
 			" from host_inventory";
 
-	if (NULL == (result = DBselect("%s", sql)))
+	if (NULL == (result = DBselect_parallel("%s", sql)))
 		return FAIL;
 
 	dbsync_prepare(sync, 72, NULL);
@@ -915,7 +915,7 @@ int	zbx_dbsync_compare_host_templates(zbx_dbsync_t *sync)
 	char			hostid_s[MAX_ID_LEN + 1], templateid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {hostid_s, templateid_s};
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select hostid,templateid"
 			" from hosts_templates"
 			" order by hostid")))
@@ -1041,7 +1041,7 @@ int	zbx_dbsync_compare_global_macros(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_GMACRO		*macro;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select globalmacroid,macro,value,type"
 			" from globalmacro")))
 	{
@@ -1159,7 +1159,7 @@ int	zbx_dbsync_compare_host_macros(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_HMACRO		*macro;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select m.hostmacroid,m.hostid,m.macro,m.value,m.type"
 			" from hostmacro m"
 			" inner join hosts h on m.hostid=h.hostid"
@@ -1329,7 +1329,7 @@ int	zbx_dbsync_compare_interfaces(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_INTERFACE	*interface;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select i.interfaceid,i.hostid,i.type,i.main,i.useip,i.ip,i.dns,i.port,"
 			"i.available,i.disable_until,i.error,i.errors_from,"
 			"s.version,s.bulk,s.community,s.securityname,s.securitylevel,s.authpassphrase,s.privpassphrase,"
@@ -1863,7 +1863,7 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 	ZBX_DC_ITEM		*item;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select i.itemid,i.hostid,i.status,i.type,i.value_type,i.key_,i.snmp_oid,i.ipmi_sensor,i.delay,"
 				"i.trapper_hosts,i.logtimefmt,i.params,ir.state,i.authtype,i.username,i.password,"
 				"i.publickey,i.privatekey,i.flags,i.interfaceid,ir.lastlogsize,ir.mtime,"
@@ -1954,7 +1954,7 @@ int	zbx_dbsync_compare_template_items(zbx_dbsync_t *sync)
 	ZBX_DC_TEMPLATE_ITEM	*item;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select i.itemid,i.hostid,i.templateid from items i inner join hosts h on i.hostid=h.hostid"
 			" where h.status=%d", HOST_STATUS_TEMPLATE)))
 	{
@@ -2035,7 +2035,7 @@ int	zbx_dbsync_compare_prototype_items(zbx_dbsync_t *sync)
 	ZBX_DC_PROTOTYPE_ITEM	*item;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select i.itemid,i.hostid,i.templateid from items i where i.flags=%d",
 				ZBX_FLAG_DISCOVERY_PROTOTYPE)))
 	{
@@ -2271,7 +2271,7 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 	ZBX_DC_TRIGGER		*trigger;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select t.triggerid,t.description,t.expression,t.error,t.priority,t.type,t.value,"
 				"t.state,t.lastchange,t.status,t.recovery_mode,t.recovery_expression,"
 				"t.correlation_mode,t.correlation_tag,t.opdata,t.event_name,null,null,null"
@@ -2353,7 +2353,7 @@ int	zbx_dbsync_compare_trigger_dependency(zbx_dbsync_t *sync)
 	char			*del_row[2] = {down_s, up_s};
 	int			i;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select distinct d.triggerid_down,d.triggerid_up"
 			" from trigger_depends d,triggers t,hosts h,items i,functions f"
 			" where t.triggerid=d.triggerid_down"
@@ -2503,7 +2503,7 @@ int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 	ZBX_DC_FUNCTION		*function;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select i.itemid,f.functionid,f.name,f.parameter,t.triggerid,i.hostid"
 			" from hosts h,items i,functions f,triggers t"
 			" where h.hostid=i.hostid"
@@ -2610,7 +2610,7 @@ int	zbx_dbsync_compare_expressions(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_EXPRESSION	*expression;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select r.name,e.expressionid,e.expression,e.expression_type,e.exp_delimiter,e.case_sensitive"
 			" from regexps r,expressions e"
 			" where r.regexpid=e.regexpid")))
@@ -2706,7 +2706,7 @@ int	zbx_dbsync_compare_actions(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_action_t		*action;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select actionid,eventsource,evaltype,formula"
 			" from actions"
 			" where eventsource<>%d"
@@ -2900,7 +2900,7 @@ int	zbx_dbsync_compare_action_conditions(zbx_dbsync_t *sync)
 	zbx_uint64_t			rowid;
 	zbx_dc_action_condition_t	*condition;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select c.conditionid,c.actionid,c.conditiontype,c.operator,c.value,c.value2"
 			" from conditions c,actions a"
 			" where c.actionid=a.actionid"
@@ -2997,7 +2997,7 @@ int	zbx_dbsync_compare_trigger_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_trigger_tag_t	*trigger_tag;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select distinct tt.triggertagid,tt.triggerid,tt.tag,tt.value"
 			" from trigger_tag tt,triggers t,hosts h,items i,functions f"
 			" where t.triggerid=tt.triggerid"
@@ -3098,7 +3098,7 @@ int	zbx_dbsync_compare_item_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_item_tag_t	*item_tag;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select distinct it.itemtagid,it.itemid,it.tag,it.value"
 			" from item_tag it,items i,hosts h"
 			" where i.itemid=it.itemid"
@@ -3198,7 +3198,7 @@ int	zbx_dbsync_compare_host_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_host_tag_t	*host_tag;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select * from host_tag")))
 	{
 		printf("db query failed!\n");
@@ -3292,7 +3292,7 @@ int	zbx_dbsync_compare_correlations(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_correlation_t	*correlation;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select correlationid,name,evaltype,formula"
 			" from correlation"
 			" where status=%d",
@@ -3418,7 +3418,7 @@ int	zbx_dbsync_compare_corr_conditions(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_corr_condition_t	*corr_condition;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select cc.corr_conditionid,cc.correlationid,cc.type,cct.tag,cctv.tag,cctv.value,cctv.operator,"
 				" ccg.groupid,ccg.operator,cctp.oldtag,cctp.newtag"
 			" from correlation c,corr_condition cc"
@@ -3523,7 +3523,7 @@ int	zbx_dbsync_compare_corr_operations(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_corr_operation_t	*corr_operation;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select co.corr_operationid,co.correlationid,co.type"
 			" from correlation c,corr_operation co"
 			" where c.correlationid=co.correlationid"
@@ -3614,7 +3614,7 @@ int	zbx_dbsync_compare_host_groups(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_hostgroup_t	*group;
 
-	if (NULL == (result = DBselect("select groupid,name from hstgrp")))
+	if (NULL == (result = DBselect_parallel("select groupid,name from hstgrp")))
 		return FAIL;
 
 	dbsync_prepare(sync, 2, NULL);
@@ -3754,7 +3754,7 @@ int	zbx_dbsync_compare_item_preprocs(zbx_dbsync_t *sync)
 	zbx_dc_preproc_op_t	*preproc;
 	char			**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select pp.item_preprocid,pp.itemid,pp.type,pp.params,pp.step,i.hostid,pp.error_handler,"
 				"pp.error_handler_params,i.type,i.key_,h.proxy_hostid"
 			" from item_preproc pp,items i,hosts h"
@@ -3903,7 +3903,7 @@ int	zbx_dbsync_compare_item_script_param(zbx_dbsync_t *sync)
 	zbx_dc_scriptitem_param_t	*itemscript_params;
 	char				**row;
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select p.item_parameterid,p.itemid,p.name,p.value,i.hostid"
 			" from item_parameter p,items i,hosts h"
 			" where p.itemid=i.itemid"
@@ -3984,8 +3984,9 @@ int	zbx_dbsync_compare_maintenances(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_maintenance_t	*maintenance;
 
-	if (NULL == (result = DBselect("select maintenanceid,maintenance_type,active_since,active_till,tags_evaltype"
-						" from maintenances")))
+	if (NULL == (result = DBselect_parallel(
+			"select maintenanceid,maintenance_type,active_since,active_till,tags_evaltype"
+			" from maintenances")))
 	{
 		return FAIL;
 	}
@@ -4076,7 +4077,7 @@ int	zbx_dbsync_compare_maintenance_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t			rowid;
 	zbx_dc_maintenance_tag_t	*maintenance_tag;
 
-	if (NULL == (result = DBselect("select maintenancetagid,maintenanceid,operator,tag,value"
+	if (NULL == (result = DBselect_parallel("select maintenancetagid,maintenanceid,operator,tag,value"
 						" from maintenance_tag")))
 	{
 		return FAIL;
@@ -4185,10 +4186,11 @@ int	zbx_dbsync_compare_maintenance_periods(zbx_dbsync_t *sync)
 	zbx_uint64_t			rowid;
 	zbx_dc_maintenance_period_t	*period;
 
-	if (NULL == (result = DBselect("select t.timeperiodid,t.timeperiod_type,t.every,t.month,t.dayofweek,t.day,"
-						"t.start_time,t.period,t.start_date,m.maintenanceid"
-					" from maintenances_windows m,timeperiods t"
-					" where t.timeperiodid=m.timeperiodid")))
+	if (NULL == (result = DBselect_parallel(
+			"select t.timeperiodid,t.timeperiod_type,t.every,t.month,t.dayofweek,t.day,"
+				"t.start_time,t.period,t.start_date,m.maintenanceid"
+			" from maintenances_windows m,timeperiods t"
+			" where t.timeperiodid=m.timeperiodid")))
 	{
 		return FAIL;
 	}
@@ -4258,7 +4260,8 @@ int	zbx_dbsync_compare_maintenance_groups(zbx_dbsync_t *sync)
 	char			maintenanceid_s[MAX_ID_LEN + 1], groupid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {maintenanceid_s, groupid_s};
 
-	if (NULL == (result = DBselect("select maintenanceid,groupid from maintenances_groups order by maintenanceid")))
+	if (NULL == (result = DBselect_parallel(
+			"select maintenanceid,groupid from maintenances_groups order by maintenanceid")))
 		return FAIL;
 
 	dbsync_prepare(sync, 2, NULL);
@@ -4333,7 +4336,8 @@ int	zbx_dbsync_compare_maintenance_hosts(zbx_dbsync_t *sync)
 	char			maintenanceid_s[MAX_ID_LEN + 1], hostid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {maintenanceid_s, hostid_s};
 
-	if (NULL == (result = DBselect("select maintenanceid,hostid from maintenances_hosts order by maintenanceid")))
+	if (NULL == (result = DBselect_parallel(
+			"select maintenanceid,hostid from maintenances_hosts order by maintenanceid")))
 		return FAIL;
 
 	dbsync_prepare(sync, 2, NULL);
@@ -4408,7 +4412,7 @@ int	zbx_dbsync_compare_host_group_hosts(zbx_dbsync_t *sync)
 	char			groupid_s[MAX_ID_LEN + 1], hostid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {groupid_s, hostid_s};
 
-	if (NULL == (result = DBselect(
+	if (NULL == (result = DBselect_parallel(
 			"select hg.groupid,hg.hostid"
 			" from hosts_groups hg,hosts h"
 			" where hg.hostid=h.hostid"
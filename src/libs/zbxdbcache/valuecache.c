@@ -42,6 +42,15 @@
  * If an item is already being cached the new values are automatically added to the cache
  * after being written into database.
  *
+ * Each chunk of numeric item values keeps the count, minimum, maximum and sum of its values.
+ * The summaries are updated whenever chunk values change and allow aggregating time periods
+ * by scanning only the values in partially covered chunks at period boundaries.
+ *
+ * When value cache compression is enabled, full chunks of numeric items (except the head chunk)
+ * are compressed - timestamps are stored as delta-of-delta and values as XOR (floating point) or
+ * delta-of-delta (unsigned) bit sequences. Compressed chunks are decoded into process local memory
+ * when their values are read and expanded back if values must be inserted in the middle of them.
+ *
  * When cache runs out of memory to store new items it enters in low memory mode.
  * In low memory mode cache continues to function as before with few restrictions:
  *   1) items that weren't accessed during the last day are removed from cache.
@@ -74,6 +83,9 @@ static int	vc_state = ZBX_VC_DISABLED;
 /* the value cache size */
 extern zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE;
 
+/* the numeric value compression flag */
+extern int		CONFIG_VALUE_CACHE_COMPRESSION;
+
 ZBX_MEM_FUNC_IMPL(__vc, vc_mem)
 
 #define VC_STRPOOL_INIT_SIZE	(1000)
@@ -106,11 +118,41 @@ typedef struct zbx_vc_chunk
 	/* the number of item value slots in chunk */
 	int			slots_num;
 
+	/* the summary of numeric values in chunk */
+	zbx_vc_aggregate_t	summary;
+
+	/* The size of compressed value data in bytes, 0 for uncompressed chunks. */
+	/* Compressed chunks store the first and last values in the first two    */
+	/* slots followed by the compressed data of all slots_num values.        */
+	/* The first/last value indexes refer to the compressed value sequence.  */
+	int			compressed_size;
+
 	/* the item value data */
 	zbx_history_record_t	slots[1];
 }
 zbx_vc_chunk_t;
 
+/* the minimum number of values in chunk to compress */
+#define ZBX_VC_MIN_COMPRESS_RECORDS	8
+
+/* the maximum size of compressed value in bits: 36 bits for timestamp seconds, */
+/* 31 bits for nanoseconds and 77 bits for floating point value                 */
+#define ZBX_VC_MAX_COMPRESSED_VALUE_SIZE	18
+
+/* the size of compressed chunk with the specified compressed data size */
+#define ZBX_VC_COMPRESSED_CHUNK_SIZE(size)	\
+		(offsetof(zbx_vc_chunk_t, slots) + 2 * sizeof(zbx_history_record_t) + (size_t)(size))
+
+/* the bit stream used to compress chunk values */
+typedef struct
+{
+	unsigned char	*data;
+
+	/* the stream position in bits */
+	size_t		offset;
+}
+zbx_vc_bitstream_t;
+
 /* min/max number number of item history values to store in chunk */
 
 #define ZBX_VC_MIN_CHUNK_RECORDS	2
@@ -276,6 +318,39 @@ static void	vc_cache_item_update(zbx_uint64_t itemid, zbx_vc_item_update_type_t
 /* the value cache */
 static zbx_vc_cache_t	*vc_cache = NULL;
 
+/* the process local buffer for decompressed chunk values */
+static zbx_vc_chunk_t	*vc_chunk_buffer = NULL;
+static int		vc_chunk_buffer_slots = 0;
+
+/* the maximum number of values copied by one prefetch request */
+#define ZBX_VC_PREFETCH_MAX_VALUES	1000
+
+/* the process local copy of item values used to serve a batch of requests for the same item */
+typedef struct
+{
+	/* the prefetched item, 0 if nothing is prefetched */
+	zbx_uint64_t			itemid;
+	unsigned char			value_type;
+
+	/* the item status flags and active range at the prefetch time */
+	unsigned char			status;
+	int				active_range;
+
+	/* the prefetch end timestamp - requests ending later cannot be served */
+	zbx_timespec_t			ts;
+
+	/* all item values with timestamp greater than this and not greater than */
+	/* the prefetch end timestamp are prefetched, zero if there are no older */
+	/* values at all                                                         */
+	zbx_timespec_t			from;
+
+	/* the prefetched values in descending timestamp order */
+	zbx_vector_history_record_t	values;
+}
+zbx_vc_prefetch_t;
+
+static zbx_vc_prefetch_t	vc_prefetch;
+
 #define	RDLOCK_CACHE	zbx_rwlock_rdlock(vc_lock);
 #define	WRLOCK_CACHE	zbx_rwlock_wrlock(vc_lock);
 #define	UNLOCK_CACHE	zbx_rwlock_unlock(vc_lock);
@@ -928,7 +1003,7 @@ static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_history_
  *                                                                            *
  ******************************************************************************/
 static void	vc_history_record_vector_append(zbx_vector_history_record_t *vector, int value_type,
-		zbx_history_record_t *value)
+		const zbx_history_record_t *value)
 {
 	zbx_history_record_t	record;
 
@@ -1163,240 +1238,900 @@ static size_t	vc_item_free_values(zbx_vc_item_t *item, zbx_history_record_t *val
 
 /******************************************************************************
  *                                                                            *
- * Purpose: removes item from cache and frees resources allocated for it      *
+ * Purpose: adds numeric value to aggregate                                   *
  *                                                                            *
- * Parameters: item    - [IN] the item                                        *
+ * Parameters: aggregate  - [IN/OUT] the aggregate                            *
+ *             value_type - [IN] the value type (ITEM_VALUE_TYPE_FLOAT or     *
+ *                               ITEM_VALUE_TYPE_UINT64)                      *
+ *             value      - [IN] the value to add                             *
  *                                                                            *
  ******************************************************************************/
-static void	vc_remove_item(zbx_vc_item_t *item)
+static void	vc_aggregate_add_value(zbx_vc_aggregate_t *aggregate, int value_type, const history_value_t *value)
 {
-	vch_item_free_cache(item);
-	zbx_hashset_remove_direct(&vc_cache->items, item);
+	if (0 == aggregate->count++)
+	{
+		aggregate->min = *value;
+		aggregate->max = *value;
+		aggregate->sum = *value;
+		aggregate->sum_overflow = 0;
+		return;
+	}
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		if (value->dbl < aggregate->min.dbl)
+			aggregate->min.dbl = value->dbl;
+
+		if (value->dbl > aggregate->max.dbl)
+			aggregate->max.dbl = value->dbl;
+
+		aggregate->sum.dbl += value->dbl;
+	}
+	else
+	{
+		if (value->ui64 < aggregate->min.ui64)
+			aggregate->min.ui64 = value->ui64;
+
+		if (value->ui64 > aggregate->max.ui64)
+			aggregate->max.ui64 = value->ui64;
+
+		if (aggregate->sum.ui64 + value->ui64 < aggregate->sum.ui64)
+			aggregate->sum_overflow = 1;
+
+		aggregate->sum.ui64 += value->ui64;
+	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: removes item from cache and frees resources allocated for it      *
+ * Purpose: merges two aggregates of numeric values                           *
  *                                                                            *
- * Parameters: itemid - [IN] the item identifier                              *
+ * Parameters: aggregate  - [IN/OUT] the target aggregate                     *
+ *             value_type - [IN] the value type (ITEM_VALUE_TYPE_FLOAT or     *
+ *                               ITEM_VALUE_TYPE_UINT64)                      *
+ *             src        - [IN] the aggregate to merge                       *
  *                                                                            *
  ******************************************************************************/
-static void	vc_remove_item_by_id(zbx_uint64_t itemid)
+static void	vc_aggregate_merge(zbx_vc_aggregate_t *aggregate, int value_type, const zbx_vc_aggregate_t *src)
 {
-	zbx_vc_item_t	*item;
+	if (0 == src->count)
+		return;
 
-	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	if (0 == aggregate->count)
+	{
+		*aggregate = *src;
 		return;
+	}
 
-	vch_item_free_cache(item);
-	zbx_hashset_remove_direct(&vc_cache->items, item);
+	aggregate->count += src->count;
+	aggregate->sum_overflow |= src->sum_overflow;
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		if (src->min.dbl < aggregate->min.dbl)
+			aggregate->min.dbl = src->min.dbl;
+
+		if (src->max.dbl > aggregate->max.dbl)
+			aggregate->max.dbl = src->max.dbl;
+
+		aggregate->sum.dbl += src->sum.dbl;
+	}
+	else
+	{
+		if (src->min.ui64 < aggregate->min.ui64)
+			aggregate->min.ui64 = src->min.ui64;
+
+		if (src->max.ui64 > aggregate->max.ui64)
+			aggregate->max.ui64 = src->max.ui64;
+
+		if (aggregate->sum.ui64 + src->sum.ui64 < aggregate->sum.ui64)
+			aggregate->sum_overflow = 1;
+
+		aggregate->sum.ui64 += src->sum.ui64;
+	}
 }
+
 /******************************************************************************
  *                                                                            *
- * Purpose: updates the timestamp from which the item is being cached         *
+ * Purpose: writes bits to bit stream                                         *
  *                                                                            *
- * Parameters: item      - [IN] the item                                      *
- *             timestamp - [IN] the timestamp from which all item values are  *
- *                              guaranteed to be cached                       *
+ * Parameters: stream - [IN/OUT] the bit stream                               *
+ *             value  - [IN] the value to write                               *
+ *             bits   - [IN] the number of lower value bits to write (1-64)   *
+ *                                                                            *
+ * Comments: The stream data must be zero initialized.                        *
  *                                                                            *
  ******************************************************************************/
-static void	vc_item_update_db_cached_from(zbx_vc_item_t *item, int timestamp)
+static void	vc_bitstream_write(zbx_vc_bitstream_t *stream, zbx_uint64_t value, int bits)
 {
-	if (0 == item->db_cached_from || timestamp < item->db_cached_from)
-		item->db_cached_from = timestamp;
-}
+	while (0 < bits)
+	{
+		int	free_bits, n;
 
-/******************************************************************************************************************
- *                                                                                                                *
- * History storage API                                                                                            *
- *                                                                                                                *
- ******************************************************************************************************************/
-/*
- * The value cache caches all values from the largest request range to
- * the current time. The history data are stored in variable size chunks
- * as illustrated in the following diagram:
- *
- *  .----------------.
- *  | zbx_vc_cache_t |
- *  |----------------|      .---------------.
- *  | items          |----->| zbx_vc_item_t |-.
- *  '----------------'      |---------------| |-.
- *  .-----------------------| tail          | | |
- *  |                   .---| head          | | |
- *  |                   |   '---------------' | |
- *  |                   |     '---------------' |
- *  |                   |       '---------------'
- *  |                   |
- *  |                   '-------------------------------------------------.
- *  |                                                                     |
- *  |  .----------------.                                                 |
- *  '->| zbx_vc_chunk_t |<-.                                              |
- *     |----------------|  |  .----------------.                          |
- *     | next           |---->| zbx_vc_chunk_t |<-.                       |
- *     | prev           |  |  |----------------|  |  .----------------.   |
- *     '----------------'  |  | next           |---->| zbx_vc_chunk_t |<--'
- *                         '--| prev           |  |  |----------------|
- *                            '----------------'  |  | next           |
- *                                                '--| prev           |
- *                                                   '----------------'
- *
- * The history values are stored in a double linked list of data chunks, holding
- * variable number of records (depending on largest request size).
- *
- * After adding a new chunk, the older chunks (outside the largest request
- * range) are automatically removed from cache.
- */
+		free_bits = 8 - (int)(stream->offset & 7);
+		n = MIN(free_bits, bits);
+		bits -= n;
+
+		stream->data[stream->offset >> 3] |= (unsigned char)(((value >> bits) & ((1 << n) - 1)) <<
+				(free_bits - n));
+		stream->offset += n;
+	}
+}
 
 /******************************************************************************
  *                                                                            *
- * Purpose: updates item range with current request range                     *
+ * Purpose: reads bits from bit stream                                        *
  *                                                                            *
- * Parameters: item   - [IN] the item                                         *
- *             range  - [IN] the request range                                *
- *             now    - [IN] the current timestamp                            *
+ * Parameters: stream - [IN/OUT] the bit stream                               *
+ *             bits   - [IN] the number of bits to read (1-64)                *
+ *                                                                            *
+ * Return value: the value read                                               *
  *                                                                            *
  ******************************************************************************/
-static void	vch_item_update_range(zbx_vc_item_t *item, int range, int now)
+static zbx_uint64_t	vc_bitstream_read(zbx_vc_bitstream_t *stream, int bits)
 {
-	int	hour, diff;
+	zbx_uint64_t	value = 0;
 
-	if (VC_MIN_RANGE > range)
-		range = VC_MIN_RANGE;
+	/* single bit flags are the most frequently read */
+	if (1 == bits)
+	{
+		value = (stream->data[stream->offset >> 3] >> (7 - (stream->offset & 7))) & 1;
+		stream->offset++;
 
-	if (item->daily_range < range)
-		item->daily_range = range;
+		return value;
+	}
 
-	hour = (now / SEC_PER_HOUR) & 0xff;
+	while (0 < bits)
+	{
+		int	avail_bits, n;
 
-	if (0 > (diff = hour - item->range_sync_hour))
-		diff += 0xff;
+		avail_bits = 8 - (int)(stream->offset & 7);
+		n = MIN(avail_bits, bits);
+		bits -= n;
 
-	if (item->active_range < item->daily_range || ZBX_VC_RANGE_SYNC_PERIOD < diff)
-	{
-		item->active_range = item->daily_range;
-		item->daily_range = range;
-		item->range_sync_hour = hour;
+		value = (value << n) | ((stream->data[stream->offset >> 3] >> (avail_bits - n)) & ((1 << n) - 1));
+		stream->offset += n;
 	}
+
+	return value;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: calculates optimal number of slots for an item data chunk         *
+ * Purpose: writes delta-of-delta value to bit stream                         *
  *                                                                            *
- * Parameters:  item        - [IN] the item                                   *
- *              values_new  - [IN] the number of values to be added           *
+ * Parameters: stream - [IN/OUT] the bit stream                               *
+ *             dod    - [IN] the delta-of-delta value                         *
+ *             bits   - [IN] the number of bits used to store values out of   *
+ *                           the short encoding ranges                        *
  *                                                                            *
- * Return value: the number of slots for a new item data chunk                *
+ * Comments: The value is stored with prefix:                                 *
+ *             0    - zero                                                    *
+ *             10   - 7 bits for values [-63, 64]                             *
+ *             110  - 9 bits for values [-255, 256]                           *
+ *             1110 - 12 bits for values [-2047, 2048]                        *
+ *             1111 - the specified number of bits for other values           *
  *                                                                            *
- * Comments: From size perspective the optimal slot count per chunk is        *
- *           approximately square root of the number of cached values.        *
- *           Still creating too many chunks might affect timeshift request    *
- *           performance, so don't try creating more than 32 chunks unless    *
- *           the calculated slot count exceeds the maximum limit.             *
+ ******************************************************************************/
+static void	vc_bitstream_write_dod(zbx_vc_bitstream_t *stream, zbx_int64_t dod, int bits)
+{
+	if (0 == dod)
+	{
+		vc_bitstream_write(stream, 0, 1);
+	}
+	else if (-63 <= dod && 64 >= dod)
+	{
+		vc_bitstream_write(stream, 2, 2);
+		vc_bitstream_write(stream, (zbx_uint64_t)(dod + 63), 7);
+	}
+	else if (-255 <= dod && 256 >= dod)
+	{
+		vc_bitstream_write(stream, 6, 3);
+		vc_bitstream_write(stream, (zbx_uint64_t)(dod + 255), 9);
+	}
+	else if (-2047 <= dod && 2048 >= dod)
+	{
+		vc_bitstream_write(stream, 14, 4);
+		vc_bitstream_write(stream, (zbx_uint64_t)(dod + 2047), 12);
+	}
+	else
+	{
+		vc_bitstream_write(stream, 15, 4);
+		vc_bitstream_write(stream, (zbx_uint64_t)dod, bits);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads delta-of-delta value from bit stream                        *
+ *                                                                            *
+ * Parameters: stream - [IN/OUT] the bit stream                               *
+ *             bits   - [IN] the number of bits used to store values out of   *
+ *                           the short encoding ranges                        *
+ *                                                                            *
+ * Return value: the delta-of-delta value                                     *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_chunk_slot_count(zbx_vc_item_t *item, int values_new)
+static zbx_int64_t	vc_bitstream_read_dod(zbx_vc_bitstream_t *stream, int bits)
 {
-	int	nslots, values;
+	zbx_uint64_t	value;
 
-	values = item->values_total + values_new;
+	if (0 == vc_bitstream_read(stream, 1))
+		return 0;
 
-	nslots = zbx_isqrt32(values);
+	if (0 == vc_bitstream_read(stream, 1))
+		return (zbx_int64_t)vc_bitstream_read(stream, 7) - 63;
 
-	if ((values + nslots - 1) / nslots + 1 > 32)
-		nslots = values / 32;
+	if (0 == vc_bitstream_read(stream, 1))
+		return (zbx_int64_t)vc_bitstream_read(stream, 9) - 255;
 
-	if (nslots > (int)ZBX_VC_MAX_CHUNK_RECORDS)
-		nslots = ZBX_VC_MAX_CHUNK_RECORDS;
-	if (nslots < (int)ZBX_VC_MIN_CHUNK_RECORDS)
-		nslots = ZBX_VC_MIN_CHUNK_RECORDS;
+	if (0 == vc_bitstream_read(stream, 1))
+		return (zbx_int64_t)vc_bitstream_read(stream, 12) - 2047;
 
-	return nslots;
+	value = vc_bitstream_read(stream, bits);
+
+	/* extend the sign of values stored with less than 64 bits */
+	if (64 > bits && 0 != (value & (__UINT64_C(1) << (bits - 1))))
+		value |= ~__UINT64_C(0) << bits;
+
+	return (zbx_int64_t)value;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds a new data chunk at the end of item's history data list      *
+ * Purpose: writes XOR of two floating point values to bit stream             *
  *                                                                            *
- * Parameters: item          - [IN/OUT] the item to add chunk to              *
- *             nslots        - [IN] the number of slots in the new chunk      *
- *             insert_before - [IN] the target chunk before which the new     *
- *                             chunk must be inserted. If this value is NULL  *
- *                             then the new chunk is appended at the end of   *
- *                             chunk list (making it the newest chunk).       *
+ * Parameters: stream   - [IN/OUT] the bit stream                             *
+ *             xor      - [IN] the XOR of floating point value bits           *
+ *             leading  - [IN/OUT] the number of leading zero bits in the     *
+ *                                 last stored XOR, -1 if none is stored yet  *
+ *             trailing - [IN/OUT] the number of trailing zero bits in the    *
+ *                                 last stored XOR                            *
  *                                                                            *
- * Return value:  SUCCEED - the chunk was added successfully                  *
- *                FAIL - failed to create a new chunk (not enough memory)     *
+ * Comments: The value is stored with prefix:                                 *
+ *             0  - zero (the value has not changed)                          *
+ *             10 - meaningful bits within the last stored leading/trailing   *
+ *                  zero bit window                                           *
+ *             11 - 5 bits of leading zero count, 6 bits of meaningful bit    *
+ *                  count - 1 and the meaningful bits                         *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_add_chunk(zbx_vc_item_t *item, int nslots, zbx_vc_chunk_t *insert_before)
+static void	vc_bitstream_write_xor(zbx_vc_bitstream_t *stream, zbx_uint64_t xor, int *leading, int *trailing)
 {
-	zbx_vc_chunk_t	*chunk;
-	int		chunk_size;
-
-	chunk_size = sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) * (nslots - 1);
+	int		lz = 0, tz = 0;
+	zbx_uint64_t	value;
 
-	if (NULL == (chunk = (zbx_vc_chunk_t *)vc_item_malloc(item, chunk_size)))
-		return FAIL;
+	if (0 == xor)
+	{
+		vc_bitstream_write(stream, 0, 1);
+		return;
+	}
 
-	memset(chunk, 0, sizeof(zbx_vc_chunk_t));
-	chunk->slots_num = nslots;
+	for (value = xor; 0 == (value & (__UINT64_C(1) << 63)) && 31 > lz; value <<= 1)
+		lz++;
 
-	chunk->next = insert_before;
+	for (value = xor; 0 == (value & 1); value >>= 1)
+		tz++;
 
-	if (NULL == insert_before)
+	if (-1 != *leading && lz >= *leading && tz >= *trailing)
 	{
-		chunk->prev = item->head;
+		vc_bitstream_write(stream, 2, 2);
+		vc_bitstream_write(stream, xor >> *trailing, 64 - *leading - *trailing);
+		return;
+	}
 
-		if (NULL != item->head)
-			item->head->next = chunk;
-		else
-			item->tail = chunk;
+	vc_bitstream_write(stream, 3, 2);
+	vc_bitstream_write(stream, (zbx_uint64_t)lz, 5);
+	vc_bitstream_write(stream, (zbx_uint64_t)(64 - lz - tz - 1), 6);
+	vc_bitstream_write(stream, xor >> tz, 64 - lz - tz);
 
-		item->head = chunk;
-	}
-	else
-	{
-		chunk->prev = insert_before->prev;
-		insert_before->prev = chunk;
+	*leading = lz;
+	*trailing = tz;
+}
 
-		if (item->tail == insert_before)
-			item->tail = chunk;
-		else
-			chunk->prev->next = chunk;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads XOR of two floating point values from bit stream            *
+ *                                                                            *
+ * Parameters: stream   - [IN/OUT] the bit stream                             *
+ *             leading  - [IN/OUT] the number of leading zero bits in the     *
+ *                                 last read XOR                              *
+ *             trailing - [IN/OUT] the number of trailing zero bits in the    *
+ *                                 last read XOR                              *
+ *                                                                            *
+ * Return value: the XOR of floating point value bits                         *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	vc_bitstream_read_xor(zbx_vc_bitstream_t *stream, int *leading, int *trailing)
+{
+	if (0 == vc_bitstream_read(stream, 1))
+		return 0;
+
+	if (0 != vc_bitstream_read(stream, 1))
+	{
+		*leading = (int)vc_bitstream_read(stream, 5);
+		*trailing = 64 - *leading - (int)vc_bitstream_read(stream, 6) - 1;
 	}
 
-	return SUCCEED;
+	return vc_bitstream_read(stream, 64 - *leading - *trailing) << *trailing;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: find the index of the last value in chunk with timestamp less or  *
- *          equal to the specified timestamp.                                 *
+ * Purpose: compresses numeric values                                         *
  *                                                                            *
- * Parameters:  chunk - [IN] the chunk                                        *
- *              ts    - [IN] the target timestamp                             *
+ * Parameters: value_type - [IN] the value type (ITEM_VALUE_TYPE_FLOAT or     *
+ *                               ITEM_VALUE_TYPE_UINT64)                      *
+ *             values     - [IN] the values to compress                       *
+ *             values_num - [IN] the number of values to compress             *
+ *             data       - [OUT] the compressed data, must be zero           *
+ *                                initialized and have space for values_num * *
+ *                                ZBX_VC_MAX_COMPRESSED_VALUE_SIZE bytes      *
  *                                                                            *
- * Return value: The index of the last value in chunk with timestamp less or  *
- *               equal to the specified timestamp.                            *
- *               -1 is returned in the case of failure (meaning that all      *
- *               values have timestamps greater than the target timestamp).   *
+ * Return value: the size of compressed data in bytes                         *
+ *                                                                            *
+ * Comments: The first value is stored as is, the following timestamp seconds*
+ *           as delta-of-delta, nanoseconds only if changed and values as XOR *
+ *           with previous value (floating point) or delta-of-delta (unsigned)*
  *                                                                            *
  ******************************************************************************/
-static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+static size_t	vc_compress_values(int value_type, const zbx_history_record_t *values, int values_num,
+		unsigned char *data)
 {
-	int	start = chunk->first_value, end = chunk->last_value, middle;
-
-	/* check if the last value timestamp is already greater or equal to the specified timestamp */
-	if (0 >= zbx_timespec_compare(&chunk->slots[end].timestamp, ts))
-		return end;
+	zbx_vc_bitstream_t	stream = {data, 0};
+	zbx_int64_t		delta, delta_prev = 0;
+	zbx_uint64_t		value_delta, value_delta_prev = 0;
+	int			i, leading = -1, trailing = 0;
 
-	/* chunk contains only one value, which did not pass the above check, return failure */
-	if (start == end)
-		return -1;
+	vc_bitstream_write(&stream, (zbx_uint64_t)values[0].timestamp.sec, 32);
+	vc_bitstream_write(&stream, (zbx_uint64_t)values[0].timestamp.ns, 30);
+	vc_bitstream_write(&stream, values[0].value.ui64, 64);
 
-	/* perform value lookup using binary search */
-	while (start != end)
+	for (i = 1; i < values_num; i++)
+	{
+		const zbx_history_record_t	*value = &values[i], *prev = &values[i - 1];
+
+		delta = (zbx_int64_t)value->timestamp.sec - prev->timestamp.sec;
+		vc_bitstream_write_dod(&stream, delta - delta_prev, 32);
+		delta_prev = delta;
+
+		if (value->timestamp.ns == prev->timestamp.ns)
+		{
+			vc_bitstream_write(&stream, 0, 1);
+		}
+		else
+		{
+			vc_bitstream_write(&stream, 1, 1);
+			vc_bitstream_write(&stream, (zbx_uint64_t)value->timestamp.ns, 30);
+		}
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			/* floating point values are compared by their bit representation */
+			vc_bitstream_write_xor(&stream, value->value.ui64 ^ prev->value.ui64, &leading, &trailing);
+		}
+		else
+		{
+			value_delta = value->value.ui64 - prev->value.ui64;
+			vc_bitstream_write_dod(&stream, (zbx_int64_t)(value_delta - value_delta_prev), 64);
+			value_delta_prev = value_delta;
+		}
+	}
+
+	return (stream.offset + 7) / 8;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: decompresses numeric values                                       *
+ *                                                                            *
+ * Parameters: value_type - [IN] the value type (ITEM_VALUE_TYPE_FLOAT or     *
+ *                               ITEM_VALUE_TYPE_UINT64)                      *
+ *             data       - [IN] the compressed data                          *
+ *             values     - [OUT] the decompressed values                     *
+ *             values_num - [IN] the number of compressed values              *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_decompress_values(int value_type, const unsigned char *data, zbx_history_record_t *values,
+		int values_num)
+{
+	zbx_vc_bitstream_t	stream = {(unsigned char *)data, 0};
+	zbx_int64_t		delta = 0;
+	zbx_uint64_t		value_delta = 0;
+	int			i, leading = 0, trailing = 0;
+
+	values[0].timestamp.sec = (int)vc_bitstream_read(&stream, 32);
+	values[0].timestamp.ns = (int)vc_bitstream_read(&stream, 30);
+	values[0].value.ui64 = vc_bitstream_read(&stream, 64);
+
+	for (i = 1; i < values_num; i++)
+	{
+		zbx_history_record_t	*value = &values[i], *prev = &values[i - 1];
+
+		delta += vc_bitstream_read_dod(&stream, 32);
+		value->timestamp.sec = (int)(prev->timestamp.sec + delta);
+
+		if (0 == vc_bitstream_read(&stream, 1))
+			value->timestamp.ns = prev->timestamp.ns;
+		else
+			value->timestamp.ns = (int)vc_bitstream_read(&stream, 30);
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			value->value.ui64 = prev->value.ui64 ^ vc_bitstream_read_xor(&stream, &leading, &trailing);
+		}
+		else
+		{
+			value_delta += (zbx_uint64_t)vc_bitstream_read_dod(&stream, 64);
+			value->value.ui64 = prev->value.ui64 + value_delta;
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets chunk with uncompressed values                               *
+ *                                                                            *
+ * Parameters: item  - [IN] the chunk owner item                              *
+ *             chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: The chunk itself if it is not compressed or a copy of chunk  *
+ *               with decompressed values in process local memory.            *
+ *                                                                            *
+ * Comments: The returned copy is valid until the next call of this function. *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_vc_chunk_t	*vch_chunk_get_values(const zbx_vc_item_t *item, const zbx_vc_chunk_t *chunk)
+{
+	if (0 == chunk->compressed_size)
+		return chunk;
+
+	if (vc_chunk_buffer_slots < chunk->slots_num)
+	{
+		vc_chunk_buffer_slots = chunk->slots_num;
+		vc_chunk_buffer = (zbx_vc_chunk_t *)zbx_realloc(vc_chunk_buffer, sizeof(zbx_vc_chunk_t) +
+				(vc_chunk_buffer_slots - 1) * sizeof(zbx_history_record_t));
+	}
+
+	memcpy(vc_chunk_buffer, chunk, offsetof(zbx_vc_chunk_t, slots));
+	vc_chunk_buffer->compressed_size = 0;
+
+	vc_decompress_values(item->value_type, (const unsigned char *)(chunk->slots + 2), vc_chunk_buffer->slots,
+			chunk->slots_num);
+
+	return vc_chunk_buffer;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the first (oldest) value in chunk                            *
+ *                                                                            *
+ * Parameters: chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: the first value, only the timestamp of values in compressed  *
+ *               chunks must be used                                          *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_history_record_t	*vch_chunk_first_value(const zbx_vc_chunk_t *chunk)
+{
+	if (0 != chunk->compressed_size)
+		return chunk->slots;
+
+	return chunk->slots + chunk->first_value;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the last (newest) value in chunk                             *
+ *                                                                            *
+ * Parameters: chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: the last value                                               *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_history_record_t	*vch_chunk_last_value(const zbx_vc_chunk_t *chunk)
+{
+	if (0 != chunk->compressed_size)
+		return chunk->slots + 1;
+
+	return chunk->slots + chunk->last_value;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the size of memory allocated for chunk                       *
+ *                                                                            *
+ * Parameters: chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: the chunk size in bytes                                      *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	vch_chunk_size(const zbx_vc_chunk_t *chunk)
+{
+	if (0 != chunk->compressed_size)
+		return ZBX_VC_COMPRESSED_CHUNK_SIZE(chunk->compressed_size);
+
+	return sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: recalculates summary of numeric values in chunk                   *
+ *                                                                            *
+ * Parameters: item  - [IN] the chunk owner item                              *
+ *             chunk - [IN/OUT] the chunk                                     *
+ *                                                                            *
+ * Comments: Used when values are removed from chunk or moved between chunks. *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_chunk_update_summary(const zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+{
+	int			i;
+	const zbx_vc_chunk_t	*values;
+
+	if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
+		return;
+
+	memset(&chunk->summary, 0, sizeof(chunk->summary));
+	values = vch_chunk_get_values(item, chunk);
+
+	for (i = chunk->first_value; i <= chunk->last_value; i++)
+		vc_aggregate_add_value(&chunk->summary, item->value_type, &values->slots[i].value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item from cache and frees resources allocated for it      *
+ *                                                                            *
+ * Parameters: item    - [IN] the item                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_remove_item(zbx_vc_item_t *item)
+{
+	vch_item_free_cache(item);
+	zbx_hashset_remove_direct(&vc_cache->items, item);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item from cache and frees resources allocated for it      *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_remove_item_by_id(zbx_uint64_t itemid)
+{
+	zbx_vc_item_t	*item;
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+		return;
+
+	vch_item_free_cache(item);
+	zbx_hashset_remove_direct(&vc_cache->items, item);
+}
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates the timestamp from which the item is being cached         *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             timestamp - [IN] the timestamp from which all item values are  *
+ *                              guaranteed to be cached                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_item_update_db_cached_from(zbx_vc_item_t *item, int timestamp)
+{
+	if (0 == item->db_cached_from || timestamp < item->db_cached_from)
+		item->db_cached_from = timestamp;
+}
+
+/******************************************************************************************************************
+ *                                                                                                                *
+ * History storage API                                                                                            *
+ *                                                                                                                *
+ ******************************************************************************************************************/
+/*
+ * The value cache caches all values from the largest request range to
+ * the current time. The history data are stored in variable size chunks
+ * as illustrated in the following diagram:
+ *
+ *  .----------------.
+ *  | zbx_vc_cache_t |
+ *  |----------------|      .---------------.
+ *  | items          |----->| zbx_vc_item_t |-.
+ *  '----------------'      |---------------| |-.
+ *  .-----------------------| tail          | | |
+ *  |                   .---| head          | | |
+ *  |                   |   '---------------' | |
+ *  |                   |     '---------------' |
+ *  |                   |       '---------------'
+ *  |                   |
+ *  |                   '-------------------------------------------------.
+ *  |                                                                     |
+ *  |  .----------------.                                                 |
+ *  '->| zbx_vc_chunk_t |<-.                                              |
+ *     |----------------|  |  .----------------.                          |
+ *     | next           |---->| zbx_vc_chunk_t |<-.                       |
+ *     | prev           |  |  |----------------|  |  .----------------.   |
+ *     '----------------'  |  | next           |---->| zbx_vc_chunk_t |<--'
+ *                         '--| prev           |  |  |----------------|
+ *                            '----------------'  |  | next           |
+ *                                                '--| prev           |
+ *                                                   '----------------'
+ *
+ * The history values are stored in a double linked list of data chunks, holding
+ * variable number of records (depending on largest request size).
+ *
+ * After adding a new chunk, the older chunks (outside the largest request
+ * range) are automatically removed from cache.
+ */
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates item range with current request range                     *
+ *                                                                            *
+ * Parameters: item   - [IN] the item                                         *
+ *             range  - [IN] the request range                                *
+ *             now    - [IN] the current timestamp                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_update_range(zbx_vc_item_t *item, int range, int now)
+{
+	int	hour, diff;
+
+	if (VC_MIN_RANGE > range)
+		range = VC_MIN_RANGE;
+
+	if (item->daily_range < range)
+		item->daily_range = range;
+
+	hour = (now / SEC_PER_HOUR) & 0xff;
+
+	if (0 > (diff = hour - item->range_sync_hour))
+		diff += 0xff;
+
+	if (item->active_range < item->daily_range || ZBX_VC_RANGE_SYNC_PERIOD < diff)
+	{
+		item->active_range = item->daily_range;
+		item->daily_range = range;
+		item->range_sync_hour = hour;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculates optimal number of slots for an item data chunk         *
+ *                                                                            *
+ * Parameters:  item        - [IN] the item                                   *
+ *              values_new  - [IN] the number of values to be added           *
+ *                                                                            *
+ * Return value: the number of slots for a new item data chunk                *
+ *                                                                            *
+ * Comments: From size perspective the optimal slot count per chunk is        *
+ *           approximately square root of the number of cached values.        *
+ *           Still creating too many chunks might affect timeshift request    *
+ *           performance, so don't try creating more than 32 chunks unless    *
+ *           the calculated slot count exceeds the maximum limit.             *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_chunk_slot_count(zbx_vc_item_t *item, int values_new)
+{
+	int	nslots, values;
+
+	values = item->values_total + values_new;
+
+	nslots = zbx_isqrt32(values);
+
+	if ((values + nslots - 1) / nslots + 1 > 32)
+		nslots = values / 32;
+
+	if (nslots > (int)ZBX_VC_MAX_CHUNK_RECORDS)
+		nslots = ZBX_VC_MAX_CHUNK_RECORDS;
+	if (nslots < (int)ZBX_VC_MIN_CHUNK_RECORDS)
+		nslots = ZBX_VC_MIN_CHUNK_RECORDS;
+
+	return nslots;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds a new data chunk at the end of item's history data list      *
+ *                                                                            *
+ * Parameters: item          - [IN/OUT] the item to add chunk to              *
+ *             nslots        - [IN] the number of slots in the new chunk      *
+ *             insert_before - [IN] the target chunk before which the new     *
+ *                             chunk must be inserted. If this value is NULL  *
+ *                             then the new chunk is appended at the end of   *
+ *                             chunk list (making it the newest chunk).       *
+ *                                                                            *
+ * Return value:  SUCCEED - the chunk was added successfully                  *
+ *                FAIL - failed to create a new chunk (not enough memory)     *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_add_chunk(zbx_vc_item_t *item, int nslots, zbx_vc_chunk_t *insert_before)
+{
+	zbx_vc_chunk_t	*chunk;
+	int		chunk_size;
+
+	chunk_size = sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) * (nslots - 1);
+
+	if (NULL == (chunk = (zbx_vc_chunk_t *)vc_item_malloc(item, chunk_size)))
+		return FAIL;
+
+	memset(chunk, 0, sizeof(zbx_vc_chunk_t));
+	chunk->slots_num = nslots;
+
+	chunk->next = insert_before;
+
+	if (NULL == insert_before)
+	{
+		chunk->prev = item->head;
+
+		if (NULL != item->head)
+			item->head->next = chunk;
+		else
+			item->tail = chunk;
+
+		item->head = chunk;
+	}
+	else
+	{
+		chunk->prev = insert_before->prev;
+		insert_before->prev = chunk;
+
+		if (item->tail == insert_before)
+			item->tail = chunk;
+		else
+			chunk->prev->next = chunk;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: replaces item history data chunk                                  *
+ *                                                                            *
+ * Parameters: item      - [IN/OUT] the chunk owner item                      *
+ *             chunk     - [IN] the chunk to replace, freed afterwards        *
+ *             new_chunk - [IN] the new chunk                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_replace_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, zbx_vc_chunk_t *new_chunk)
+{
+	new_chunk->prev = chunk->prev;
+	new_chunk->next = chunk->next;
+
+	if (NULL != chunk->prev)
+		chunk->prev->next = new_chunk;
+	else
+		item->tail = new_chunk;
+
+	if (NULL != chunk->next)
+		chunk->next->prev = new_chunk;
+	else
+		item->head = new_chunk;
+
+	__vc_mem_free_func(chunk);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compresses numeric item history data chunk                        *
+ *                                                                            *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN] the chunk to compress                             *
+ *                                                                            *
+ * Comments: The chunk is replaced with compressed copy if compression is     *
+ *           enabled and reduces the chunk size. Otherwise, or if there is    *
+ *           not enough memory for the copy, the chunk is left as is.         *
+ *           The head chunk must not be compressed.                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_compress_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+{
+	static unsigned char	*data = NULL;
+	static size_t		data_alloc = 0;
+
+	size_t			data_size;
+	int			values_num;
+	zbx_vc_chunk_t		*compressed;
+
+	if (0 == CONFIG_VALUE_CACHE_COMPRESSION || 0 != chunk->compressed_size)
+		return;
+
+	if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
+		return;
+
+	if (ZBX_VC_MIN_COMPRESS_RECORDS > (values_num = chunk->last_value - chunk->first_value + 1))
+		return;
+
+	if (data_alloc < (data_size = (size_t)values_num * ZBX_VC_MAX_COMPRESSED_VALUE_SIZE))
+	{
+		data_alloc = data_size;
+		data = (unsigned char *)zbx_realloc(data, data_alloc);
+	}
+
+	memset(data, 0, data_size);
+	data_size = vc_compress_values(item->value_type, chunk->slots + chunk->first_value, values_num, data);
+
+	if (ZBX_VC_COMPRESSED_CHUNK_SIZE(data_size) >= vch_chunk_size(chunk))
+		return;
+
+	if (NULL == (compressed = (zbx_vc_chunk_t *)__vc_mem_malloc_func(NULL,
+			ZBX_VC_COMPRESSED_CHUNK_SIZE(data_size))))
+	{
+		return;
+	}
+
+	compressed->first_value = 0;
+	compressed->last_value = values_num - 1;
+	compressed->slots_num = values_num;
+	compressed->summary = chunk->summary;
+	compressed->compressed_size = (int)data_size;
+	compressed->slots[0] = *vch_chunk_first_value(chunk);
+	memcpy(compressed->slots + 1, vch_chunk_last_value(chunk), sizeof(zbx_history_record_t));
+	memcpy(compressed->slots + 2, data, data_size);
+
+	vch_item_replace_chunk(item, chunk, compressed);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: replaces compressed item history data chunk with uncompressed one *
+ *                                                                            *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN/OUT] the chunk to expand, on success replaced with *
+ *                              the uncompressed chunk                        *
+ *                                                                            *
+ * Return value: SUCCEED - the chunk was expanded successfully                *
+ *               FAIL    - not enough space in cache                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_expand_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t **chunk)
+{
+	zbx_vc_chunk_t	*expanded;
+	size_t		size;
+
+	size = sizeof(zbx_vc_chunk_t) + ((*chunk)->slots_num - 1) * sizeof(zbx_history_record_t);
+
+	if (NULL == (expanded = (zbx_vc_chunk_t *)vc_item_malloc(item, size)))
+		return FAIL;
+
+	memcpy(expanded, vch_chunk_get_values(item, *chunk), size);
+	vch_item_replace_chunk(item, *chunk, expanded);
+	*chunk = expanded;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find the index of the last value in chunk with timestamp less or  *
+ *          equal to the specified timestamp.                                 *
+ *                                                                            *
+ * Parameters:  chunk - [IN] the chunk                                        *
+ *              ts    - [IN] the target timestamp                             *
+ *                                                                            *
+ * Return value: The index of the last value in chunk with timestamp less or  *
+ *               equal to the specified timestamp.                            *
+ *               -1 is returned in the case of failure (meaning that all      *
+ *               values have timestamps greater than the target timestamp).   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+{
+	int	start = chunk->first_value, end = chunk->last_value, middle;
+
+	/* check if the last value timestamp is already greater or equal to the specified timestamp */
+	if (0 >= zbx_timespec_compare(&chunk->slots[end].timestamp, ts))
+		return end;
+
+	/* chunk contains only one value, which did not pass the above check, return failure */
+	if (start == end)
+		return -1;
+
+	/* perform value lookup using binary search */
+	while (start != end)
 	{
 		middle = start + (end - start) / 2;
 
@@ -1450,14 +2185,14 @@ static int	vch_item_get_last_value(const zbx_vc_item_t *item, const zbx_timespec
 
 	if (0 < zbx_timespec_compare(&chunk->slots[index].timestamp, ts))
 	{
-		while (0 < zbx_timespec_compare(&chunk->slots[chunk->first_value].timestamp, ts))
+		while (0 < zbx_timespec_compare(&vch_chunk_first_value(chunk)->timestamp, ts))
 		{
 			chunk = chunk->prev;
 			/* there are no values for requested range, return failure */
 			if (NULL == chunk)
 				return FAIL;
 		}
-		index = vch_chunk_find_last_value_before(chunk, ts);
+		index = vch_chunk_find_last_value_before(vch_chunk_get_values(item, chunk), ts);
 	}
 
 	*pchunk = chunk;
@@ -1570,6 +2305,7 @@ static int	vch_item_copy_values_at_tail(zbx_vc_item_t *item, const zbx_history_r
 	}
 out:
 	item->values_total += first_value - item->tail->first_value;
+	vch_chunk_update_summary(item, item->tail);
 
 	return ret;
 }
@@ -1588,7 +2324,7 @@ static size_t	vch_item_free_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
 {
 	size_t	freed;
 
-	freed = sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t);
+	freed = vch_chunk_size(chunk);
 	freed += vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->last_value);
 
 	__vc_mem_free_func(chunk);
@@ -1621,6 +2357,38 @@ static void	vch_item_remove_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
 	vch_item_free_chunk(item, chunk);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes the oldest chunk values with timestamp (seconds) less     *
+ *          than the specified timestamp                                      *
+ *                                                                            *
+ * Parameters: item      - [IN/OUT] the chunk owner item                      *
+ *             chunk     - [IN/OUT] the chunk                                 *
+ *             timestamp - [IN] the timestamp (number of seconds since the    *
+ *                              Epoch)                                        *
+ *                                                                            *
+ * Comments: The chunk must contain values with greater or equal timestamp.   *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_chunk_remove_values(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int timestamp)
+{
+	const zbx_vc_chunk_t	*values;
+	int			first_value = chunk->first_value;
+
+	values = vch_chunk_get_values(item, chunk);
+
+	while (values->slots[chunk->first_value].timestamp.sec < timestamp)
+		chunk->first_value++;
+
+	vc_item_free_values(item, chunk->slots, first_value, chunk->first_value - 1);
+
+	/* compressed chunks keep a copy of the first value */
+	if (0 != chunk->compressed_size)
+		chunk->slots[0] = values->slots[chunk->first_value];
+
+	vch_chunk_update_summary(item, chunk);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: removes item history data that are outside (older) the maximum    *
@@ -1642,8 +2410,8 @@ static void	vch_item_clean_cache(zbx_vc_item_t *item)
 		timestamp = time(NULL) - item->active_range;
 
 		/* try to remove chunks with all history values older than maximum request range */
-		while (NULL != chunk && chunk->slots[chunk->last_value].timestamp.sec < timestamp &&
-				chunk->slots[chunk->last_value].timestamp.sec !=
+		while (NULL != chunk && vch_chunk_last_value(chunk)->timestamp.sec < timestamp &&
+				vch_chunk_last_value(chunk)->timestamp.sec !=
 						item->head->slots[item->head->last_value].timestamp.sec)
 		{
 			/* don't remove the head chunk */
@@ -1658,18 +2426,15 @@ static void	vch_item_clean_cache(zbx_vc_item_t *item)
 			/* In this case increase the first value index of the next chunk until the first  */
 			/* value timestamp is greater.                                                    */
 
-			if (next->slots[next->first_value].timestamp.sec != next->slots[next->last_value].timestamp.sec)
+			if (vch_chunk_first_value(next)->timestamp.sec != vch_chunk_last_value(next)->timestamp.sec &&
+					vch_chunk_first_value(next)->timestamp.sec ==
+					vch_chunk_last_value(chunk)->timestamp.sec)
 			{
-				while (next->slots[next->first_value].timestamp.sec ==
-						chunk->slots[chunk->last_value].timestamp.sec)
-				{
-					vc_item_free_values(item, next->slots, next->first_value, next->first_value);
-					next->first_value++;
-				}
+				vch_chunk_remove_values(item, next, vch_chunk_last_value(chunk)->timestamp.sec + 1);
 			}
 
 			/* set the database cached from timestamp to the last (oldest) removed value timestamp + 1 */
-			item->db_cached_from = chunk->slots[chunk->last_value].timestamp.sec + 1;
+			item->db_cached_from = vch_chunk_last_value(chunk)->timestamp.sec + 1;
 
 			vch_item_remove_chunk(item, chunk);
 
@@ -1700,21 +2465,16 @@ static void	vch_item_remove_values(zbx_vc_item_t *item, int timestamp)
 		item->status = 0;
 
 	/* try to remove chunks with all history values older than the timestamp */
-	while (NULL != chunk && chunk->slots[chunk->first_value].timestamp.sec < timestamp)
+	while (NULL != chunk && vch_chunk_first_value(chunk)->timestamp.sec < timestamp)
 	{
 		zbx_vc_chunk_t	*next;
 
 		/* If chunk contains values with timestamp greater or equal - remove */
 		/* only the values with less timestamp. Otherwise remove the while   */
 		/* chunk and check next one.                                         */
-		if (chunk->slots[chunk->last_value].timestamp.sec >= timestamp)
+		if (vch_chunk_last_value(chunk)->timestamp.sec >= timestamp)
 		{
-			while (chunk->slots[chunk->first_value].timestamp.sec < timestamp)
-			{
-				vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->first_value);
-				chunk->first_value++;
-			}
-
+			vch_chunk_remove_values(item, chunk, timestamp);
 			break;
 		}
 
@@ -1741,13 +2501,13 @@ static void	vch_item_remove_values(zbx_vc_item_t *item, int timestamp)
  ******************************************************************************/
 static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_record_t *value)
 {
-	int		ret = FAIL, index, sindex, nslots = 0;
-	zbx_vc_chunk_t	*chunk, *schunk;
+	int		ret = FAIL, index, sindex, nslots = 0, shifted = 0;
+	zbx_vc_chunk_t	*chunk, *schunk, *head = item->head;
 
 	if (NULL != item->head &&
 			0 < zbx_history_record_compare_asc_func(&item->head->slots[item->head->last_value], value))
 	{
-		if (0 < zbx_history_record_compare_asc_func(&item->tail->slots[item->tail->first_value], value))
+		if (0 < zbx_history_record_compare_asc_func(vch_chunk_first_value(item->tail), value))
 		{
 			/* If the added value has the same or older timestamp as the first value in cache */
 			/* we can't add it to keep cache consistency. Additionally we must make sure no   */
@@ -1768,8 +2528,18 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 			goto out;
 		}
 
+		/* values newer than the added value are moved, expand the compressed chunks containing them */
+		for (chunk = item->head->prev; NULL != chunk &&
+				0 < zbx_timespec_compare(&vch_chunk_last_value(chunk)->timestamp, &value->timestamp);
+				chunk = chunk->prev)
+		{
+			if (0 != chunk->compressed_size && FAIL == vch_item_expand_chunk(item, &chunk))
+				goto out;
+		}
+
 		sindex = item->head->last_value;
 		schunk = item->head;
+		shifted = 1;
 
 		if (0 == item->head->slots_num - item->head->last_value - 1)
 		{
@@ -1801,6 +2571,14 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 					goto out;
 				}
 
+				/* chunks with values older than the added value were not expanded, */
+				/* check the boundary without accessing their slots                  */
+				if (0 >= zbx_timespec_compare(&vch_chunk_last_value(schunk)->timestamp,
+						&value->timestamp))
+				{
+					break;
+				}
+
 				sindex = schunk->last_value;
 			}
 		}
@@ -1829,6 +2607,33 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 	if (SUCCEED != vch_item_copy_value(item, chunk, index, value))
 		goto out;
 
+	if (ITEM_VALUE_TYPE_FLOAT == item->value_type || ITEM_VALUE_TYPE_UINT64 == item->value_type)
+	{
+		if (0 == shifted)
+		{
+			vc_aggregate_add_value(&chunk->summary, item->value_type, &value->value);
+		}
+		else
+		{
+			zbx_vc_chunk_t	*next;
+
+			/* values were moved towards head to insert the value in the middle, */
+			/* update summaries and compress back the expanded chunks            */
+			for (; NULL != chunk; chunk = next)
+			{
+				next = chunk->next;
+				vch_chunk_update_summary(item, chunk);
+
+				if (NULL != next)
+					vch_item_compress_chunk(item, chunk);
+			}
+		}
+	}
+
+	/* compress the previous head chunk when a new head chunk is started */
+	if (NULL != head && head != item->head)
+		vch_item_compress_chunk(item, item->head->prev);
+
 	ret = SUCCEED;
 out:
 	return ret;
@@ -1857,7 +2662,7 @@ static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_re
 	/* skip values already added to the item cache by another process */
 	if (NULL != item->tail)
 	{
-		int	sec = item->tail->slots[item->tail->first_value].timestamp.sec;
+		int	sec = vch_chunk_first_value(item->tail)->timestamp.sec;
 
 		while (--count >= 0 && values[count].timestamp.sec >= sec)
 			;
@@ -1868,17 +2673,24 @@ static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_re
 	{
 		int	copy_slots, nslots = 0;
 
-		/* find the number of free slots on the left side in first (tail) chunk */
-		if (NULL != item->tail)
+		/* find the number of free slots on the left side in first (tail) chunk, */
+		/* values can't be added to compressed chunks                            */
+		if (NULL != item->tail && 0 == item->tail->compressed_size)
 			nslots = item->tail->first_value;
 
 		if (0 == nslots)
 		{
+			zbx_vc_chunk_t	*tail = item->tail;
+
 			nslots = vch_item_chunk_slot_count(item, count);
 
 			if (FAIL == vch_item_add_chunk(item, nslots, item->tail))
 				goto out;
 
+			/* compress the previous tail chunk when a new tail chunk is started */
+			if (NULL != tail && tail != item->head)
+				vch_item_compress_chunk(item, tail);
+
 			item->tail->last_value = nslots - 1;
 			item->tail->first_value = nslots;
 		}
@@ -1928,7 +2740,7 @@ static int	vch_item_cache_values_by_time(zbx_vc_item_t **item, int range_start)
 	if (NULL != (*item)->tail)
 	{
 		/* we need to get item values before the first cached value, but not including it */
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
+		range_end = vch_chunk_first_value((*item)->tail)->timestamp.sec - 1;
 	}
 	else
 		range_end = ZBX_JAN_2038;
@@ -2033,7 +2845,7 @@ static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int ran
 
 	/* get the end timestamp to which (including) the values should be cached */
 	if (NULL != (*item)->head)
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
+		range_end = vch_chunk_first_value((*item)->tail)->timestamp.sec - 1;
 	else
 		range_end = ZBX_JAN_2038;
 
@@ -2086,41 +2898,94 @@ static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int ran
 		(*item)->status = ZBX_ITEM_STATUS_CACHED_ALL;
 	}
 
-	if ((count <= records.values_num || 0 == range_start) && 0 != records.values_num)
+	if ((count <= records.values_num || 0 == range_start) && 0 != records.values_num)
+	{
+		vc_item_update_db_cached_from(*item,
+				vch_chunk_first_value((*item)->tail)->timestamp.sec);
+	}
+	else if (0 != range_start)
+		vc_item_update_db_cached_from(*item, range_start);
+
+out:
+	zbx_history_record_vector_destroy(&records, value_type);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieves item history data from cache                            *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             values    - [OUT] the item history data stored time/value      *
+ *                         pairs in undefined order                           *
+ *             seconds   - [IN] the time period to retrieve data for          *
+ *             ts        - [IN] the requested period end timestamp            *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
+		const zbx_timespec_t *ts)
+{
+	int			index, now;
+	zbx_timespec_t		start = {ts->sec - seconds, ts->ns};
+	zbx_vc_chunk_t		*chunk;
+	const zbx_vc_chunk_t	*chunk_values;
+
+	/* Check if maximum request range is not set and all data are cached.  */
+	/* Because that indicates there was a count based request with unknown */
+	/* range which might be greater than the current request range.        */
+	if (0 != item->active_range || ZBX_ITEM_STATUS_CACHED_ALL != item->status)
+	{
+		now = time(NULL);
+		/* add another second to include nanosecond shifts */
+		vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+	}
+
+	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
 	{
-		vc_item_update_db_cached_from(*item,
-				(*item)->tail->slots[(*item)->tail->first_value].timestamp.sec);
+		/* Cache does not contain records for the specified timeshift & seconds range. */
+		/* Return empty vector with success.                                           */
+		return;
 	}
-	else if (0 != range_start)
-		vc_item_update_db_cached_from(*item, range_start);
 
-out:
-	zbx_history_record_vector_destroy(&records, value_type);
+	/* fill the values vector with item history values until the start timestamp is reached */
+	while (0 < zbx_timespec_compare(&vch_chunk_last_value(chunk)->timestamp, &start))
+	{
+		chunk_values = vch_chunk_get_values(item, chunk);
 
-	return ret;
+		while (index >= chunk->first_value &&
+				0 < zbx_timespec_compare(&chunk_values->slots[index].timestamp, &start))
+		{
+			vc_history_record_vector_append(values, item->value_type, &chunk_values->slots[index--]);
+		}
+
+		if (NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: retrieves item history data from cache                            *
+ * Purpose: aggregates cached item values for the specified time period       *
  *                                                                            *
  * Parameters: item      - [IN] the item                                      *
- *             values    - [OUT] the item history data stored time/value      *
- *                         pairs in undefined order                           *
- *             seconds   - [IN] the time period to retrieve data for          *
+ *             aggregate - [OUT] the aggregated values                        *
+ *             seconds   - [IN] the time period                               *
  *             ts        - [IN] the requested period end timestamp            *
  *                                                                            *
+ * Comments: Chunks completely within the period are aggregated by their      *
+ *           summaries, only the boundary chunks are scanned.                 *
+ *                                                                            *
  ******************************************************************************/
-static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_history_record_t *values, int seconds,
-		const zbx_timespec_t *ts)
+static void	vch_item_get_aggregate_by_time(const zbx_vc_item_t *item, zbx_vc_aggregate_t *aggregate,
+		int seconds, const zbx_timespec_t *ts)
 {
 	int		index, now;
 	zbx_timespec_t	start = {ts->sec - seconds, ts->ns};
 	zbx_vc_chunk_t	*chunk;
 
-	/* Check if maximum request range is not set and all data are cached.  */
-	/* Because that indicates there was a count based request with unknown */
-	/* range which might be greater than the current request range.        */
 	if (0 != item->active_range || ZBX_ITEM_STATUS_CACHED_ALL != item->status)
 	{
 		now = time(NULL);
@@ -2129,17 +2994,28 @@ static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_hi
 	}
 
 	if (FAIL == vch_item_get_last_value(item, ts, &chunk, &index))
-	{
-		/* Cache does not contain records for the specified timeshift & seconds range. */
-		/* Return empty vector with success.                                           */
 		return;
-	}
 
-	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
+	while (0 < zbx_timespec_compare(&vch_chunk_last_value(chunk)->timestamp, &start))
 	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+		if (index == chunk->last_value &&
+				0 < zbx_timespec_compare(&vch_chunk_first_value(chunk)->timestamp, &start))
+		{
+			vc_aggregate_merge(aggregate, item->value_type, &chunk->summary);
+		}
+		else
+		{
+			const zbx_vc_chunk_t	*chunk_values;
+
+			chunk_values = vch_chunk_get_values(item, chunk);
+
+			while (index >= chunk->first_value &&
+					0 < zbx_timespec_compare(&chunk_values->slots[index].timestamp, &start))
+			{
+				vc_aggregate_add_value(aggregate, item->value_type,
+						&chunk_values->slots[index--].value);
+			}
+		}
 
 		if (NULL == (chunk = chunk->prev))
 			break;
@@ -2166,9 +3042,10 @@ static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_hi
 static void	vch_item_get_values_by_time_and_count(zbx_vc_item_t *item, zbx_vector_history_record_t *values,
 		int seconds, int count, const zbx_timespec_t *ts)
 {
-	int		index, now, range_timestamp;
-	zbx_vc_chunk_t	*chunk;
-	zbx_timespec_t	start;
+	int			index, now, range_timestamp;
+	zbx_vc_chunk_t		*chunk;
+	const zbx_vc_chunk_t	*chunk_values;
+	zbx_timespec_t		start;
 
 	/* set start timestamp of the requested time period */
 	if (0 != seconds)
@@ -2191,11 +3068,14 @@ static void	vch_item_get_values_by_time_and_count(zbx_vc_item_t *item, zbx_vecto
 	/* fill the values vector with item history values until the <count> values are read    */
 	/* or no more values within specified time period                                       */
 	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
+	while (0 < zbx_timespec_compare(&vch_chunk_last_value(chunk)->timestamp, &start))
 	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
+		chunk_values = vch_chunk_get_values(item, chunk);
+
+		while (index >= chunk->first_value &&
+				0 < zbx_timespec_compare(&chunk_values->slots[index].timestamp, &start))
 		{
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+			vc_history_record_vector_append(values, item->value_type, &chunk_values->slots[index--]);
 
 			if (values->values_num == count)
 				goto out;
@@ -2328,6 +3208,95 @@ static size_t	vch_item_free_cache(zbx_vc_item_t *item)
 	return freed;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the prefetched values of the specified range                *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type                          *
+ *             seconds    - [IN] the time period to retrieve data for         *
+ *             count      - [IN] the number of history values to retrieve     *
+ *             ts         - [IN] the period end timestamp                     *
+ *             first      - [OUT] the index of the first (newest) value       *
+ *             last       - [OUT] the index following the last (oldest) value *
+ *                                                                            *
+ * Return value: SUCCEED - the range is covered by prefetched values          *
+ *               FAIL    - the range must be retrieved from value cache       *
+ *                                                                            *
+ * Comments: The range is defined in the same way as for zbx_vc_get_values(). *
+ *           Item range and statistics updates are queued in the same way as  *
+ *           if the values were retrieved from value cache.                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_prefetch_find_values(zbx_uint64_t itemid, int value_type, int seconds, int count,
+		const zbx_timespec_t *ts, int *first, int *last)
+{
+	const zbx_vector_history_record_t	*values = &vc_prefetch.values;
+	zbx_timespec_t				start;
+	int					i, j, now, range_timestamp;
+
+	if (itemid != vc_prefetch.itemid || value_type != vc_prefetch.value_type ||
+			0 < zbx_timespec_compare(ts, &vc_prefetch.ts))
+	{
+		return FAIL;
+	}
+
+	if (0 == seconds && 0 != count)
+	{
+		start.sec = 0;
+		start.ns = 0;
+	}
+	else
+	{
+		start.sec = ts->sec - seconds;
+		start.ns = ts->ns;
+	}
+
+	for (i = 0; i < values->values_num && 0 < zbx_timespec_compare(&values->values[i].timestamp, ts); i++)
+		;
+
+	for (j = i; j < values->values_num && (0 == count || j - i < count); j++)
+	{
+		if (0 >= zbx_timespec_compare(&values->values[j].timestamp, &start))
+			break;
+	}
+
+	/* all prefetched values were taken, older values might be needed */
+	if (j == values->values_num && (0 == count || j - i < count) &&
+			0 > zbx_timespec_compare(&start, &vc_prefetch.from))
+	{
+		return FAIL;
+	}
+
+	now = time(NULL);
+
+	if (0 == count)
+	{
+		if (0 != vc_prefetch.active_range || ZBX_ITEM_STATUS_CACHED_ALL != vc_prefetch.status)
+			vc_cache_item_update(itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+	}
+	else if (count > j - i)
+	{
+		if (0 != seconds)
+		{
+			range_timestamp = ts->sec - seconds;
+			vc_cache_item_update(itemid, ZBX_VC_UPDATE_RANGE, now - range_timestamp, now);
+		}
+	}
+	else
+	{
+		range_timestamp = values->values[j - 1].timestamp.sec - 1;
+		vc_cache_item_update(itemid, ZBX_VC_UPDATE_RANGE, now - range_timestamp, now);
+	}
+
+	vc_cache_item_update(itemid, ZBX_VC_UPDATE_STATS, j - i, 0);
+
+	*first = i;
+	*last = j;
+
+	return SUCCEED;
+}
+
 /******************************************************************************************************************
  *                                                                                                                *
  * Public API                                                                                                     *
@@ -2396,6 +3365,9 @@ int	zbx_vc_init(char **error)
 	zbx_vector_vc_itemupdate_create(&vc_itemupdates);
 	zbx_vector_vc_itemupdate_reserve(&vc_itemupdates, 256);
 
+	memset(&vc_prefetch, 0, sizeof(vc_prefetch));
+	zbx_vector_history_record_create(&vc_prefetch.values);
+
 	ret = SUCCEED;
 out:
 	zbx_vc_disable();
@@ -2418,6 +3390,9 @@ void	zbx_vc_destroy(void)
 	{
 		zbx_vector_vc_itemupdate_destroy(&vc_itemupdates);
 
+		zbx_vc_prefetch_clear();
+		zbx_vector_history_record_destroy(&vc_prefetch.values);
+
 		zbx_hashset_destroy(&vc_cache->items);
 		zbx_hashset_destroy(&vc_cache->strpool);
 
@@ -2429,6 +3404,9 @@ void	zbx_vc_destroy(void)
 		zbx_rwlock_destroy(&vc_lock);
 	}
 
+	zbx_free(vc_chunk_buffer);
+	vc_chunk_buffer_slots = 0;
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
@@ -2559,11 +3537,24 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 		int count, const zbx_timespec_t *ts)
 {
 	zbx_vc_item_t	*item, new_item;
-	int 		ret = FAIL, cache_used = 1;
+	int 		ret = FAIL, cache_used = 1, first, last;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " value_type:%d count:%d period:%d end_timestamp"
 			" '%s'", __func__, itemid, value_type, count, seconds, zbx_timespec_str(ts));
 
+	if (SUCCEED == vc_prefetch_find_values(itemid, value_type, seconds, count, ts, &first, &last))
+	{
+		zbx_vector_history_record_clear(values);
+
+		for (; first < last; first++)
+			vc_history_record_vector_append(values, value_type, &vc_prefetch.values.values[first]);
+
+		zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s count:%d prefetched:1", __func__,
+				zbx_result_string(SUCCEED), values->values_num);
+
+		return SUCCEED;
+	}
+
 	RDLOCK_CACHE;
 
 	if (ZBX_VC_DISABLED == vc_state)
@@ -2650,6 +3641,265 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: aggregate numeric item values for the specified time period       *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type (ITEM_VALUE_TYPE_FLOAT   *
+ *                               or ITEM_VALUE_TYPE_UINT64)                   *
+ *             seconds    - [IN] the time period                              *
+ *             ts         - [IN] the period end timestamp                     *
+ *             aggregate  - [OUT] the count, minimum, maximum and sum of      *
+ *                                values in the period                        *
+ *                                                                            *
+ * Return value:  SUCCEED - the values were aggregated successfully           *
+ *                FAIL    - the item history data was not retrieved           *
+ *                                                                            *
+ * Comments: The period is defined in the same way as for zbx_vc_get_values() *
+ *           time based requests. If the data is not in cache it's read from  *
+ *           DB and aggregated locally.                                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, const zbx_timespec_t *ts,
+		zbx_vc_aggregate_t *aggregate)
+{
+	zbx_vc_item_t	*item, new_item;
+	int		ret = FAIL, cache_used = 1, records_read, range_start, first, last;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " value_type:%d period:%d end_timestamp '%s'",
+			__func__, itemid, value_type, seconds, zbx_timespec_str(ts));
+
+	memset(aggregate, 0, sizeof(zbx_vc_aggregate_t));
+
+	if (ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type)
+		return FAIL;
+
+	if (SUCCEED == vc_prefetch_find_values(itemid, value_type, seconds, 0, ts, &first, &last))
+	{
+		for (; first < last; first++)
+			vc_aggregate_add_value(aggregate, value_type, &vc_prefetch.values.values[first].value);
+
+		zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s count:%d prefetched:1", __func__,
+				zbx_result_string(SUCCEED), aggregate->count);
+
+		return SUCCEED;
+	}
+
+	RDLOCK_CACHE;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		goto out;
+
+	if (ZBX_VC_MODE_LOWMEM == vc_cache->mode)
+		vc_warn_low_memory();
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	{
+		if (ZBX_VC_MODE_NORMAL != vc_cache->mode)
+			goto out;
+
+		memset(&new_item, 0, sizeof(new_item));
+		new_item.itemid = itemid;
+		new_item.value_type = value_type;
+		item = &new_item;
+	}
+	else if (item->value_type != value_type)
+		goto out;
+
+	if (0 > (range_start = ts->sec - seconds))
+		range_start = 0;
+
+	if (FAIL == (records_read = vch_item_cache_values_by_time(&item, range_start)))
+		goto out;
+
+	vch_item_get_aggregate_by_time(item, aggregate, seconds, ts);
+
+	if (records_read > aggregate->count)
+		records_read = aggregate->count;
+
+	vc_cache_item_update(item->itemid, ZBX_VC_UPDATE_STATS, aggregate->count - records_read, records_read);
+
+	ret = SUCCEED;
+out:
+	if (FAIL == ret)
+	{
+		zbx_vector_history_record_t	values;
+		int				i;
+
+		cache_used = 0;
+		zbx_history_record_vector_create(&values);
+
+		UNLOCK_CACHE;
+		ret = vc_db_get_values(itemid, value_type, &values, seconds, 0, ts);
+		WRLOCK_CACHE;
+
+		if (ZBX_VC_DISABLED != vc_state)
+			vc_remove_item_by_id(itemid);
+
+		if (SUCCEED == ret)
+		{
+			for (i = 0; i < values.values_num; i++)
+				vc_aggregate_add_value(aggregate, value_type, &values.values[i].value);
+
+			vc_update_statistics(NULL, 0, values.values_num, time(NULL));
+		}
+
+		zbx_history_record_vector_destroy(&values, value_type);
+	}
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s count:%d cached:%d",
+			__func__, zbx_result_string(ret), aggregate->count, cache_used);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies cached item values into process local memory, so the       *
+ *          following requests of the same item can be served without        *
+ *          locking and searching the value cache                             *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type, only numeric values     *
+ *                               can be prefetched                            *
+ *             seconds    - [IN] the time period of values to copy, 0 to copy *
+ *                               only the specified number of values          *
+ *             count      - [IN] the minimum number of values to copy         *
+ *             ts         - [IN] the latest end timestamp of the following    *
+ *                               requests                                     *
+ *                                                                            *
+ * Return value:  SUCCEED - the item values were prefetched                   *
+ *                FAIL    - the item is not cached or is not numeric          *
+ *                                                                            *
+ * Comments: The values not later than the specified timestamp are copied     *
+ *           until both the time period and the number of values are covered, *
+ *           but no more than ZBX_VC_PREFETCH_MAX_VALUES values. The          *
+ *           zbx_vc_get_values(), zbx_vc_get_value() and                      *
+ *           zbx_vc_get_aggregate() requests covered by the copied values are *
+ *           served from the copy, other requests are passed to value cache.  *
+ *           The previously prefetched values are discarded.                  *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_prefetch_values(zbx_uint64_t itemid, int value_type, int seconds, int count,
+		const zbx_timespec_t *ts)
+{
+	zbx_vc_item_t		*item;
+	zbx_vc_chunk_t		*chunk;
+	const zbx_vc_chunk_t	*chunk_values;
+	zbx_timespec_t		start;
+	int			index, ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " value_type:%d period:%d count:%d"
+			" end_timestamp '%s'", __func__, itemid, value_type, seconds, count, zbx_timespec_str(ts));
+
+	zbx_vc_prefetch_clear();
+
+	/* string values are not prefetched to avoid copying them */
+	if (ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type)
+		goto out;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		goto out;
+
+	start.sec = ts->sec - seconds;
+	start.ns = ts->ns;
+
+	RDLOCK_CACHE;
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)) ||
+			item->value_type != value_type)
+	{
+		goto unlock;
+	}
+
+	/* use the same cached range check as vch_item_cache_values_by_time() */
+	if (ZBX_ITEM_STATUS_CACHED_ALL == item->status)
+	{
+		vc_prefetch.from.sec = 0;
+	}
+	else if (NULL != item->tail)
+	{
+		vc_prefetch.from.sec = vch_chunk_first_value(item->tail)->timestamp.sec - 1;
+
+		if (0 != item->db_cached_from && item->db_cached_from < vc_prefetch.from.sec)
+			vc_prefetch.from.sec = item->db_cached_from;
+	}
+	else if (0 != item->db_cached_from)
+	{
+		vc_prefetch.from.sec = item->db_cached_from;
+	}
+	else
+		goto unlock;
+
+	vc_prefetch.from.ns = 0;
+
+	if (SUCCEED == vch_item_get_last_value(item, ts, &chunk, &index))
+	{
+		while (1)
+		{
+			chunk_values = vch_chunk_get_values(item, chunk);
+
+			for (; index >= chunk->first_value; index--)
+			{
+				const zbx_timespec_t	*timestamp = &chunk_values->slots[index].timestamp;
+
+				if (count <= vc_prefetch.values.values_num &&
+						(0 == seconds || 0 >= zbx_timespec_compare(timestamp, &start)))
+				{
+					/* all newer values are copied, the requested range is covered */
+					vc_prefetch.from = *timestamp;
+					goto copied;
+				}
+
+				if (ZBX_VC_PREFETCH_MAX_VALUES == vc_prefetch.values.values_num)
+				{
+					/* only the range of copied values is covered */
+					vc_prefetch.from = vc_prefetch.values.values[
+							vc_prefetch.values.values_num - 1].timestamp;
+					goto copied;
+				}
+
+				vc_history_record_vector_append(&vc_prefetch.values, value_type,
+						&chunk_values->slots[index]);
+			}
+
+			if (NULL == (chunk = chunk->prev))
+				break;
+
+			index = chunk->last_value;
+		}
+	}
+copied:
+	vc_prefetch.itemid = itemid;
+	vc_prefetch.value_type = (unsigned char)value_type;
+	vc_prefetch.status = item->status;
+	vc_prefetch.active_range = item->active_range;
+	vc_prefetch.ts = *ts;
+
+	ret = SUCCEED;
+unlock:
+	UNLOCK_CACHE;
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s count:%d", __func__, zbx_result_string(ret),
+			vc_prefetch.values.values_num);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: discards the prefetched item values                               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_vc_prefetch_clear(void)
+{
+	vc_history_record_vector_clean(&vc_prefetch.values, vc_prefetch.value_type);
+	vc_prefetch.itemid = 0;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: retrieves usage cache statistics                                  *
@@ -50,6 +50,15 @@
  *   either zbx_history_record_vector_destroy() function (free the zbx_vc_get_values()
  *   call output) or zbx_history_record_clear() function (free the zbx_vc_get_value() call output).
  *
+ *   The count, minimum, maximum and sum of numeric values in time period are returned by
+ *   zbx_vc_get_aggregate() function without copying the values.
+ *
+ *   Multiple requests of the same numeric item can be batched by copying the union of their
+ *   value ranges into process local memory with zbx_vc_prefetch_values() function. The
+ *   following requests covered by the copied values are served without locking the cache
+ *   until the values are discarded with zbx_vc_prefetch_clear() function or another item
+ *   is prefetched.
+ *
  * Locking
  *
  *   The cache ensures synchronization between processes by using automatic locks whenever
@@ -83,6 +92,21 @@ typedef struct
 }
 zbx_vc_stats_t;
 
+/* the aggregated numeric item values */
+typedef struct
+{
+	/* the number of aggregated values */
+	int		count;
+
+	/* set if the sum of unsigned values has overflowed */
+	unsigned char	sum_overflow;
+
+	history_value_t	min;
+	history_value_t	max;
+	history_value_t	sum;
+}
+zbx_vc_aggregate_t;
+
 /* item diagnostic statistics */
 typedef struct
 {
@@ -107,6 +131,13 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 
 int	zbx_vc_get_value(zbx_uint64_t itemid, int value_type, const zbx_timespec_t *ts, zbx_history_record_t *value);
 
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, const zbx_timespec_t *ts,
+		zbx_vc_aggregate_t *aggregate);
+
+int	zbx_vc_prefetch_values(zbx_uint64_t itemid, int value_type, int seconds, int count,
+		const zbx_timespec_t *ts);
+void	zbx_vc_prefetch_clear(void);
+
 int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush);
 
 int	zbx_vc_get_statistics(zbx_vc_stats_t *stats);
@@ -212,6 +212,71 @@ int	DBconnect(int flag)
 	return err;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: open additional database connections for parallel selects        *
+ *                                                                            *
+ * Parameters: num - [IN] the number of connections to open                   *
+ *                                                                            *
+ * Return value: the number of opened connections                             *
+ *                                                                            *
+ * Comments: While the connections are open, selects made with                *
+ *           DBselect_parallel() are executed concurrently from the same      *
+ *           database snapshot. Parallel selects are supported only with      *
+ *           PostgreSQL.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+int	DBparallel_open(int num)
+{
+#if defined(HAVE_POSTGRESQL)
+	return zbx_db_parallel_open(num, CONFIG_DBHOST, CONFIG_DBUSER, CONFIG_DBPASSWORD, CONFIG_DBNAME,
+			CONFIG_DBSCHEMA, CONFIG_DBSOCKET, CONFIG_DBPORT, CONFIG_DB_TLS_CONNECT, CONFIG_DB_TLS_CERT_FILE,
+			CONFIG_DB_TLS_KEY_FILE, CONFIG_DB_TLS_CA_FILE, CONFIG_DB_TLS_CIPHER, CONFIG_DB_TLS_CIPHER_13);
+#else
+	ZBX_UNUSED(num);
+
+	return 0;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: wait for selects sent over parallel database connections          *
+ *                                                                            *
+ * Return value: SUCCEED - all selects succeeded, their results can be        *
+ *                         fetched                                            *
+ *               FAIL    - a select failed, the parallel connections are      *
+ *                         closed                                             *
+ *                                                                            *
+ ******************************************************************************/
+int	DBparallel_wait(void)
+{
+#if defined(HAVE_POSTGRESQL)
+	int	rc;
+
+	if (ZBX_DB_OK == (rc = zbx_db_parallel_wait()))
+		return SUCCEED;
+
+	zbx_db_parallel_close();
+
+	if (ZBX_DB_DOWN == rc)
+		zabbix_log(LOG_LEVEL_ERR, "database is down: parallel select failed");
+#endif
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: close parallel database connections                               *
+ *                                                                            *
+ ******************************************************************************/
+void	DBparallel_close(void)
+{
+#if defined(HAVE_POSTGRESQL)
+	zbx_db_parallel_close();
+#endif
+}
+
 int	DBinit(char **error)
 {
 	return zbx_db_init(CONFIG_DBNAME, db_schema, error);
@@ -473,6 +538,46 @@ DB_RESULT	DBselect(const char *fmt, ...)
 	return rc;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: execute a select statement over parallel database connection      *
+ *                                                                            *
+ * Return value: data, NULL (on error) or (DB_RESULT)ZBX_DB_DOWN              *
+ *                                                                            *
+ * Comments: When parallel connections are open, the select is only sent and  *
+ *           DBparallel_wait() must succeed before the rows are fetched.      *
+ *           Otherwise the select is executed with DBselect().                *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	DBselect_parallel(const char *fmt, ...)
+{
+	va_list		args;
+	DB_RESULT	rc;
+	char		*sql;
+
+	va_start(args, fmt);
+	sql = zbx_dvsprintf(NULL, fmt, args);
+	va_end(args);
+
+#if defined(HAVE_POSTGRESQL)
+	if (0 != zbx_db_parallel_num() && 0 == zbx_db_txn_level())
+	{
+		if ((DB_RESULT)ZBX_DB_DOWN == (rc = zbx_db_parallel_select(sql)))
+		{
+			zbx_db_parallel_close();
+			zabbix_log(LOG_LEVEL_ERR, "database is down: cannot send parallel select");
+			rc = NULL;
+		}
+	}
+	else
+#endif
+		rc = DBselect("%s", sql);
+
+	zbx_free(sql);
+
+	return rc;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: execute a select statement and get the first N entries            *
@@ -19,6 +19,8 @@
 
 #include "common.h"
 #include "log.h"
+#include "memalloc.h"
+#include "mutexs.h"
 #include "export.h"
 
 #define ZBX_OPTION_EXPTYPE_EVENTS	"events"
@@ -28,12 +30,24 @@
 extern char		*CONFIG_EXPORT_DIR;
 extern char		*CONFIG_EXPORT_TYPE;
 extern zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE;
+extern zbx_uint64_t	CONFIG_EXPORT_CACHE_SIZE;
+
+#define ZBX_LOGGING_SUSPEND_TIME	10
 
 typedef struct
 {
 	char	*name;
 	FILE	*file;
 	int	missing;
+
+	/* the export cache file index, -1 if records are written directly to file */
+	int	fileid;
+
+	/* the records queued since the last flush when export cache is used */
+	char	*buffer;
+	size_t	buffer_alloc;
+	size_t	buffer_offset;
+	int	records_num;
 }
 zbx_export_file_t;
 
@@ -43,6 +57,83 @@ static zbx_export_file_t	*problems_file;
 
 static char	*export_dir;
 
+/*
+ * When export cache is enabled the processes do not write export files themselves. The records are
+ * buffered locally and queued into shared memory when export is flushed. The exporter process takes
+ * all queued records at once and writes them to files with writev(). When the queue is full the
+ * processes wait for exporter for a short time, then the records are dropped rather than stalling
+ * the history syncers. On shutdown the main process writes the queue itself after the final sync.
+ */
+
+#ifdef IOV_MAX
+#	define ZBX_EXPORT_IOV_MAX	IOV_MAX
+#else
+#	define ZBX_EXPORT_IOV_MAX	16
+#endif
+
+/* the maximum size of export cache reserved for export file names */
+#define ZBX_EXPORT_CACHE_FILES_SIZE	(64 * ZBX_KIBIBYTE)
+
+/* the export cache record header, followed by record data */
+typedef struct
+{
+	zbx_uint32_t	fileid;
+	zbx_uint32_t	size;
+}
+zbx_export_record_t;
+
+typedef struct
+{
+	/* the names of registered export files, indexed by record fileid */
+	char		**files;
+	int		files_num;
+
+	/* the queued records */
+	char		*data;
+	size_t		data_size;
+	size_t		data_used;
+
+	zbx_uint64_t	written_num;
+	zbx_uint64_t	dropped_num;
+}
+zbx_export_cache_t;
+
+/* the export file written by exporter process */
+typedef struct
+{
+	char		*name;
+	int		fd;
+	int		missing;
+	zbx_uint64_t	size;
+
+	struct iovec	*iov;
+	int		iov_num;
+	int		iov_alloc;
+}
+zbx_export_target_t;
+
+static zbx_mem_info_t		*export_mem = NULL;
+static zbx_mutex_t		export_lock = ZBX_MUTEX_NULL;
+static zbx_export_cache_t	*export_cache = NULL;
+
+ZBX_MEM_FUNC_IMPL(__export, export_mem)
+
+#define LOCK_EXPORT	zbx_mutex_lock(export_lock)
+#define UNLOCK_EXPORT	zbx_mutex_unlock(export_lock)
+
+/* the maximum time to wait for exporter to free space in full export cache */
+#define ZBX_EXPORT_PUSH_TIMEOUT		1
+#define ZBX_EXPORT_PUSH_SLEEP_NSEC	10000000
+
+/* set when the process writes queued records itself, after exporter has been stopped */
+static int	export_sync = 0;
+
+/* exporter process data */
+static zbx_export_target_t	*export_targets = NULL;
+static int			export_targets_num = 0;
+static char			*export_data = NULL;
+static size_t			export_data_alloc = 0;
+
 /******************************************************************************
  *                                                                            *
  * Purpose: validate export type                                              *
@@ -144,6 +235,45 @@ int	zbx_is_export_enabled(uint32_t flags)
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initializes export cache                                          *
+ *                                                                            *
+ * Parameters: error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the cache was initialized successfully             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	export_cache_init(char **error)
+{
+	zbx_uint64_t	files_size;
+
+	if (SUCCEED != zbx_mutex_create(&export_lock, ZBX_MUTEX_EXPORT, error))
+		return FAIL;
+
+	if (SUCCEED != zbx_mem_create(&export_mem, CONFIG_EXPORT_CACHE_SIZE, "export cache size", "ExportCacheSize",
+			1, error))
+	{
+		return FAIL;
+	}
+
+	export_cache = (zbx_export_cache_t *)__export_mem_malloc_func(NULL, sizeof(zbx_export_cache_t));
+	memset(export_cache, 0, sizeof(zbx_export_cache_t));
+
+	/* leave space for file names, the rest is used for queued records */
+	if (ZBX_EXPORT_CACHE_FILES_SIZE < (files_size = export_mem->free_size / 8))
+		files_size = ZBX_EXPORT_CACHE_FILES_SIZE;
+
+	export_cache->data_size = export_mem->free_size - files_size;
+	export_cache->data = (char *)__export_mem_malloc_func(NULL, export_cache->data_size);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() queue size:" ZBX_FS_SIZE_T, __func__,
+			(zbx_fs_size_t)export_cache->data_size);
+
+	return SUCCEED;
+}
+
 int	zbx_export_init(char **error)
 {
 	struct stat	fs;
@@ -189,9 +319,26 @@ int	zbx_export_init(char **error)
 	if ('/' == export_dir[strlen(export_dir) - 1])
 		export_dir[strlen(export_dir) - 1] = '\0';
 
+	if (0 != CONFIG_EXPORT_CACHE_SIZE)
+		return export_cache_init(error);
+
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if export records are queued in export cache and written   *
+ *          by exporter process                                               *
+ *                                                                            *
+ * Return value: SUCCEED - export cache is enabled                            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_is_export_cache_enabled(void)
+{
+	return NULL != export_cache ? SUCCEED : FAIL;
+}
+
 static int	open_export_file(zbx_export_file_t *file, char **error)
 {
 	if (NULL == (file->file = fopen(file->name, "a")))
@@ -205,21 +352,75 @@ static int	open_export_file(zbx_export_file_t *file, char **error)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: registers export file in export cache                             *
+ *                                                                            *
+ * Parameters: name - [IN] the export file name                               *
+ *                                                                            *
+ * Return value: The export cache file index or -1 if there is not enough     *
+ *               space in export cache.                                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	export_cache_register_file(const char *name)
+{
+	int	fileid;
+	char	**files, *file;
+	size_t	len;
+
+	LOCK_EXPORT;
+
+	for (fileid = 0; fileid < export_cache->files_num; fileid++)
+	{
+		if (0 == strcmp(export_cache->files[fileid], name))
+			goto out;
+	}
+
+	len = strlen(name) + 1;
+
+	if (NULL == (file = (char *)__export_mem_malloc_func(NULL, len)))
+		goto fail;
+
+	if (NULL == (files = (char **)__export_mem_realloc_func(export_cache->files,
+			sizeof(char *) * (size_t)(export_cache->files_num + 1))))
+	{
+		__export_mem_free_func(file);
+		goto fail;
+	}
+
+	memcpy(file, name, len);
+	files[export_cache->files_num++] = file;
+	export_cache->files = files;
+	goto out;
+fail:
+	zabbix_log(LOG_LEVEL_WARNING, "not enough space in export cache to register file \"%s\", writing it"
+			" directly", name);
+	fileid = -1;
+out:
+	UNLOCK_EXPORT;
+
+	return fileid;
+}
+
 static zbx_export_file_t	*export_init(zbx_export_file_t *file, const char *process_type, const char
 				*process_name,	int process_num)
 {
 	char	*error = NULL;
 
 	file = (zbx_export_file_t *)zbx_malloc(NULL, sizeof(zbx_export_file_t));
+	memset(file, 0, sizeof(zbx_export_file_t));
 	file->name = zbx_dsprintf(NULL, "%s/%s-%s-%d.ndjson", export_dir, process_type, process_name, process_num);
 
+	if (NULL != export_cache && -1 != (file->fileid = export_cache_register_file(file->name)))
+		return file;
+
 	if (FAIL == open_export_file(file, &error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "%s", error);
 		exit(EXIT_FAILURE);
 	}
 
-	file->missing = 0;
+	file->fileid = -1;
 
 	return file;
 }
@@ -239,15 +440,151 @@ void	zbx_problems_export_init(const char *process_name, int process_num)
 	problems_file = export_init(problems_file, "problems", process_name, process_num);
 }
 
-static void	file_write(const char *buf, size_t count, zbx_export_file_t *file)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: appends export record to the process local buffer of records to   *
+ *          be queued in export cache                                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	export_buffer_append(zbx_export_file_t *file, const char *buf, size_t count)
 {
-#define ZBX_LOGGING_SUSPEND_TIME	10
+	zbx_export_record_t	record;
+	size_t			size;
+
+	size = sizeof(record) + count + 1;
+
+	if (file->buffer_alloc < file->buffer_offset + size)
+	{
+		while (file->buffer_alloc < file->buffer_offset + size)
+			file->buffer_alloc = (0 == file->buffer_alloc ? ZBX_KIBIBYTE * 16 : file->buffer_alloc * 2);
+
+		file->buffer = (char *)zbx_realloc(file->buffer, file->buffer_alloc);
+	}
+
+	record.fileid = (zbx_uint32_t)file->fileid;
+	record.size = (zbx_uint32_t)(count + 1);
+
+	memcpy(file->buffer + file->buffer_offset, &record, sizeof(record));
+	memcpy(file->buffer + file->buffer_offset + sizeof(record), buf, count);
+	file->buffer[file->buffer_offset + sizeof(record) + count] = '\n';
+
+	file->buffer_offset += size;
+	file->records_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: queues the locally buffered export records in export cache        *
+ *                                                                            *
+ * Comments: When export cache is full the process waits for exporter to free *
+ *           space up to ZBX_EXPORT_PUSH_TIMEOUT, the records still not       *
+ *           fitting are dropped and counted. In synchronous mode the queued  *
+ *           records are written by the process itself instead.               *
+ *                                                                            *
+ ******************************************************************************/
+static void	export_cache_push(zbx_export_file_t *file)
+{
+	static time_t		last_log_time = 0;
+	static int		dropped_total = 0;
+	size_t			offset = 0, size, free_size;
+	int			records_num = 0, dropped_num = 0, empty;
+	zbx_export_record_t	record;
+	double			time_start = 0;
+	time_t			now;
+	struct timespec		ts_sleep = {0, ZBX_EXPORT_PUSH_SLEEP_NSEC};
+
+	if (0 == file->records_num)
+		return;
+
+	while (1)
+	{
+		LOCK_EXPORT;
+
+		empty = (0 == export_cache->data_used);
+		free_size = export_cache->data_size - export_cache->data_used;
+
+		for (size = 0; records_num < file->records_num; records_num++)
+		{
+			memcpy(&record, file->buffer + offset + size, sizeof(record));
+
+			if (size + sizeof(record) + record.size > free_size)
+				break;
+
+			size += sizeof(record) + record.size;
+		}
+
+		memcpy(export_cache->data + export_cache->data_used, file->buffer + offset, size);
+		export_cache->data_used += size;
+
+		UNLOCK_EXPORT;
+
+		offset += size;
+
+		if (records_num == file->records_num)
+			break;
+
+		if (0 == size && 0 != empty)
+		{
+			/* the record does not fit in empty export cache */
+			memcpy(&record, file->buffer + offset, sizeof(record));
+			offset += sizeof(record) + record.size;
+			records_num++;
+			dropped_num++;
+			continue;
+		}
+
+		if (0 != export_sync)
+		{
+			zbx_export_cache_write();
+			continue;
+		}
 
+		if (0 == time_start)
+			time_start = zbx_time();
+		else if (ZBX_EXPORT_PUSH_TIMEOUT < zbx_time() - time_start)
+			break;
+
+		nanosleep(&ts_sleep, NULL);
+	}
+
+	dropped_num += file->records_num - records_num;
+
+	file->buffer_offset = 0;
+	file->records_num = 0;
+
+	if (0 == dropped_num)
+		return;
+
+	LOCK_EXPORT;
+	export_cache->dropped_num += (zbx_uint64_t)dropped_num;
+	UNLOCK_EXPORT;
+
+	dropped_total += dropped_num;
+	now = time(NULL);
+
+	/* suppress repeated messages, but report all dropped records */
+	if (0 != export_sync || ZBX_LOGGING_SUSPEND_TIME < now - last_log_time)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "export cache is full, dropped %d records of export file '%s'",
+				dropped_total, file->name);
+		last_log_time = now;
+		dropped_total = 0;
+	}
+}
+
+static void	file_write(const char *buf, size_t count, zbx_export_file_t *file)
+{
 	static time_t	last_log_time = 0;
 	time_t		now;
 	char		*error_msg = NULL;
 	long		file_offset;
 
+	if (-1 != file->fileid)
+	{
+		export_buffer_append(file, buf, count);
+		return;
+	}
+
 	if (0 == file->missing && 0 != access(file->name, F_OK))
 	{
 		if (NULL != file->file && 0 != fclose(file->file))
@@ -334,8 +671,6 @@ error:
 	}
 
 	zbx_free(error_msg);
-
-#undef ZBX_LOGGING_SUSPEND_TIME
 }
 
 void	zbx_problems_export_write(const char *buf, size_t count)
@@ -359,20 +694,341 @@ static void	zbx_flush(FILE *file, const char *file_name)
 		zabbix_log(LOG_LEVEL_ERR, "cannot flush export file '%s': %s", file_name, zbx_strerror(errno));
 }
 
+static void	file_flush(zbx_export_file_t *file)
+{
+	if (-1 != file->fileid)
+		export_cache_push(file);
+	else if (NULL != file->file)
+		zbx_flush(file->file, file->name);
+}
+
 void	zbx_problems_export_flush(void)
 {
-	if (NULL != problems_file->file)
-		zbx_flush(problems_file->file, problems_file->name);
+	file_flush(problems_file);
 }
 
 void	zbx_history_export_flush(void)
 {
-	if (NULL != history_file->file)
-		zbx_flush(history_file->file, history_file->name);
+	file_flush(history_file);
 }
 
 void	zbx_trends_export_flush(void)
 {
-	if (NULL != trends_file->file)
-		zbx_flush(trends_file->file, trends_file->name);
+	file_flush(trends_file);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: logs export file error, suppressing repeated messages             *
+ *                                                                            *
+ ******************************************************************************/
+static void	export_target_log_error(char *error)
+{
+	static time_t	last_log_time = 0;
+	time_t		now;
+
+	now = time(NULL);
+
+	if (ZBX_LOGGING_SUSPEND_TIME < now - last_log_time)
+	{
+		zabbix_log(LOG_LEVEL_ERR, "%s", error);
+		last_log_time = now;
+	}
+
+	zbx_free(error);
+}
+
+static void	export_target_close(zbx_export_target_t *target)
+{
+	if (-1 != target->fd && 0 != close(target->fd))
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot close export file '%s': %s", target->name, zbx_strerror(errno));
+
+	target->fd = -1;
+}
+
+static int	export_target_open(zbx_export_target_t *target, char **error)
+{
+	zbx_stat_t	st;
+
+	if (-1 == (target->fd = open(target->name, O_WRONLY | O_CREAT | O_APPEND,
+			S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)))
+	{
+		*error = zbx_dsprintf(*error, "cannot open export file '%s': %s", target->name, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (0 != zbx_fstat(target->fd, &st))
+	{
+		*error = zbx_dsprintf(*error, "cannot get size of export file '%s': %s", target->name,
+				zbx_strerror(errno));
+		export_target_close(target);
+		return FAIL;
+	}
+
+	target->size = (zbx_uint64_t)st.st_size;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "successfully opened export file '%s'", target->name);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: renames export file to .old file and opens a new export file      *
+ *                                                                            *
+ ******************************************************************************/
+static int	export_target_rotate(zbx_export_target_t *target, char **error)
+{
+	char	filename_old[MAX_STRING_LEN];
+
+	strscpy(filename_old, target->name);
+	zbx_strlcat(filename_old, ".old", MAX_STRING_LEN);
+
+	export_target_close(target);
+
+	if (0 != remove(filename_old) && ENOENT != errno)
+	{
+		*error = zbx_dsprintf(*error, "cannot remove export file '%s': %s", filename_old,
+				zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (0 != rename(target->name, filename_old))
+	{
+		*error = zbx_dsprintf(*error, "cannot rename export file '%s': %s", target->name,
+				zbx_strerror(errno));
+		return FAIL;
+	}
+
+	return export_target_open(target, error);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes data vector to export file, retrying partial writes        *
+ *                                                                            *
+ ******************************************************************************/
+static int	export_target_writev(zbx_export_target_t *target, struct iovec *iov, int iov_num, char **error)
+{
+	ssize_t	n;
+
+	while (0 < iov_num)
+	{
+		if (-1 == (n = writev(target->fd, iov, iov_num)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			*error = zbx_dsprintf(*error, "cannot write to export file '%s': %s", target->name,
+					zbx_strerror(errno));
+			return FAIL;
+		}
+
+		for (; 0 < iov_num && (size_t)n >= iov->iov_len; iov++, iov_num--)
+			n -= (ssize_t)iov->iov_len;
+
+		if (0 < iov_num)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= (size_t)n;
+		}
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes the records collected for export file                      *
+ *                                                                            *
+ * Return value: The number of records written.                               *
+ *                                                                            *
+ * Comments: Export file is rotated when its size would reach ExportFileSize. *
+ *                                                                            *
+ ******************************************************************************/
+static int	export_target_write(zbx_export_target_t *target)
+{
+	int		i, start, written_num = 0;
+	zbx_uint64_t	size;
+	char		*error = NULL;
+
+	/* check once per batch if the file was removed */
+	if (-1 != target->fd && 0 != access(target->name, F_OK))
+		export_target_close(target);
+
+	if (-1 == target->fd && FAIL == export_target_open(target, &error))
+	{
+		target->missing = 1;
+		goto out;
+	}
+
+	if (1 == target->missing)
+	{
+		target->missing = 0;
+		zabbix_log(LOG_LEVEL_ERR, "regained access to export file '%s'", target->name);
+	}
+
+	for (i = 0; i < target->iov_num;)
+	{
+		for (start = i, size = 0; i < target->iov_num && i - start < ZBX_EXPORT_IOV_MAX; i++)
+		{
+			if (CONFIG_EXPORT_FILE_SIZE <= target->size + size + target->iov[i].iov_len)
+				break;
+
+			size += target->iov[i].iov_len;
+		}
+
+		if (i == start)
+		{
+			if (FAIL == export_target_rotate(target, &error))
+				goto out;
+
+			/* write the record even if it exceeds maximum file size */
+			size = target->iov[i++].iov_len;
+		}
+
+		if (FAIL == export_target_writev(target, target->iov + start, i - start, &error))
+		{
+			export_target_close(target);
+			goto out;
+		}
+
+		target->size += size;
+		written_num += i - start;
+	}
+out:
+	if (NULL != error)
+		export_target_log_error(error);
+
+	target->iov_num = 0;
+
+	return written_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes the records queued in export cache to export files         *
+ *                                                                            *
+ * Return value: The number of records taken from export cache.               *
+ *                                                                            *
+ * Comments: This function is used by exporter process.                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_export_cache_write(void)
+{
+	size_t			size, offset;
+	int			i, records_num = 0, written_num = 0;
+	zbx_export_record_t	record;
+	zbx_export_target_t	*target;
+
+	LOCK_EXPORT;
+
+	if (0 == (size = export_cache->data_used))
+	{
+		UNLOCK_EXPORT;
+		return 0;
+	}
+
+	if (export_data_alloc < size)
+	{
+		export_data_alloc = export_cache->data_size;
+		export_data = (char *)zbx_realloc(export_data, export_data_alloc);
+	}
+
+	memcpy(export_data, export_cache->data, size);
+	export_cache->data_used = 0;
+
+	if (export_targets_num < export_cache->files_num)
+	{
+		export_targets = (zbx_export_target_t *)zbx_realloc(export_targets,
+				sizeof(zbx_export_target_t) * (size_t)export_cache->files_num);
+
+		for (i = export_targets_num; i < export_cache->files_num; i++)
+		{
+			target = &export_targets[i];
+			memset(target, 0, sizeof(zbx_export_target_t));
+			target->name = zbx_strdup(NULL, export_cache->files[i]);
+			target->fd = -1;
+		}
+
+		export_targets_num = export_cache->files_num;
+	}
+
+	UNLOCK_EXPORT;
+
+	/* group records by export files */
+	for (offset = 0; offset < size; offset += sizeof(record) + record.size)
+	{
+		memcpy(&record, export_data + offset, sizeof(record));
+		target = &export_targets[record.fileid];
+
+		if (target->iov_num == target->iov_alloc)
+		{
+			target->iov_alloc = (0 == target->iov_alloc ? 64 : target->iov_alloc * 2);
+			target->iov = (struct iovec *)zbx_realloc(target->iov,
+					sizeof(struct iovec) * (size_t)target->iov_alloc);
+		}
+
+		target->iov[target->iov_num].iov_base = export_data + offset + sizeof(record);
+		target->iov[target->iov_num++].iov_len = record.size;
+		records_num++;
+	}
+
+	for (i = 0; i < export_targets_num; i++)
+	{
+		if (0 != export_targets[i].iov_num)
+			written_num += export_target_write(&export_targets[i]);
+	}
+
+	LOCK_EXPORT;
+	export_cache->written_num += (zbx_uint64_t)written_num;
+	export_cache->dropped_num += (zbx_uint64_t)(records_num - written_num);
+	UNLOCK_EXPORT;
+
+	return records_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes all records queued in export cache by the calling process  *
+ *                                                                            *
+ * Comments: This function is used on shutdown after exporter process has     *
+ *           been stopped. The records queued afterwards do not wait for      *
+ *           exporter, the calling process writes them itself when export     *
+ *           cache gets full.                                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_export_cache_flush(void)
+{
+	export_sync = 1;
+
+	while (0 != zbx_export_cache_write())
+		;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets export cache statistics                                      *
+ *                                                                            *
+ * Parameters: stats - [OUT] the export cache statistics                      *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were retrieved successfully         *
+ *               FAIL    - export cache is disabled                           *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_export_cache_get_stats(zbx_export_cache_stats_t *stats)
+{
+	if (NULL == export_cache)
+		return FAIL;
+
+	LOCK_EXPORT;
+
+	stats->total_size = export_cache->data_size;
+	stats->free_size = export_cache->data_size - export_cache->data_used;
+	stats->written_num = export_cache->written_num;
+	stats->dropped_num = export_cache->dropped_num;
+
+	UNLOCK_EXPORT;
+
+	return SUCCEED;
 }
@@ -152,6 +152,8 @@ void	diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_s
 	zbx_json_adduint64(json, "used", stats->used_size);
 	zbx_json_close(json);
 
+	zbx_json_adduint64(json, "page_size", stats->page_size);
+
 	zbx_json_addobject(json, "chunks");
 	zbx_json_adduint64(json, "free", stats->free_chunks);
 	zbx_json_adduint64(json, "used", stats->used_chunks);
@@ -175,7 +177,30 @@ void	diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_mem_s
 	}
 
 	zbx_json_close(json);
+	zbx_json_addfloat(json, "fragmentation", stats->fragmentation);
 	zbx_json_close(json);
+
+	zbx_json_addobject(json, "slabs");
+	zbx_json_adduint64(json, "free", stats->slab_free_size);
+
+	zbx_json_addarray(json, "classes");
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		if (0 == stats->slabs_num[i])
+			continue;
+
+		zbx_json_addobject(json, NULL);
+		zbx_json_adduint64(json, "size", 8 * (i + 1));
+		zbx_json_adduint64(json, "slabs", stats->slabs_num[i]);
+		zbx_json_adduint64(json, "objects", stats->slab_objects_num[i]);
+		zbx_json_adduint64(json, "used", stats->slab_used_num[i]);
+		zbx_json_close(json);
+	}
+
+	zbx_json_close(json);
+	zbx_json_close(json);
+
 	zbx_json_close(json);
 }
 
@@ -502,13 +527,13 @@ void	diag_add_locks_info(struct zbx_json *json)
 				"ZBX_MUTEX_CACHE_IDS", "ZBX_MUTEX_SELFMON", "ZBX_MUTEX_CPUSTATS", "ZBX_MUTEX_DISKSTATS",
 				"ZBX_MUTEX_VALUECACHE", "ZBX_MUTEX_VMWARE", "ZBX_MUTEX_SQLITE3",
 				"ZBX_MUTEX_PROCSTAT", "ZBX_MUTEX_PROXY_HISTORY", "ZBX_MUTEX_KSTAT", "ZBX_MUTEX_MODBUS",
-				"ZBX_MUTEX_TREND_FUNC"};
+				"ZBX_MUTEX_TREND_FUNC", "ZBX_MUTEX_EXPORT"};
 #else
 	const char	*names[ZBX_MUTEX_COUNT] = {"ZBX_MUTEX_LOG", "ZBX_MUTEX_CACHE", "ZBX_MUTEX_TRENDS",
 				"ZBX_MUTEX_CACHE_IDS", "ZBX_MUTEX_SELFMON", "ZBX_MUTEX_CPUSTATS", "ZBX_MUTEX_DISKSTATS",
 				"ZBX_MUTEX_VALUECACHE", "ZBX_MUTEX_VMWARE", "ZBX_MUTEX_SQLITE3",
 				"ZBX_MUTEX_PROCSTAT", "ZBX_MUTEX_PROXY_HISTORY", "ZBX_MUTEX_MODBUS",
-				"ZBX_MUTEX_TREND_FUNC"};
+				"ZBX_MUTEX_TREND_FUNC", "ZBX_MUTEX_EXPORT"};
 #endif
 	zbx_json_addarray(json, ZBX_DIAG_LOCKS);
 
@@ -675,7 +700,7 @@ static void	diag_log_memory_info(struct zbx_json_parse *jp, const char *field, c
 		size_t *out_alloc, size_t *out_offset)
 {
 	struct zbx_json_parse	jp_memory, jp_size, jp_chunks;
-	char			*msg = NULL;
+	char			*msg = NULL, page_size[MAX_ID_LEN + 1];
 
 	if (FAIL == zbx_json_open_path(jp, path, &jp_memory))
 		return;
@@ -688,6 +713,9 @@ static void	diag_log_memory_info(struct zbx_json_parse *jp, const char *field, c
 		zbx_free(msg);
 	}
 
+	if (SUCCEED == zbx_json_value_by_name(&jp_memory, "page_size", page_size, sizeof(page_size), NULL))
+		zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "  page size: %s", page_size);
+
 	if (SUCCEED == zbx_json_brackets_by_name(&jp_memory, "chunks", &jp_chunks))
 	{
 		struct zbx_json_parse	jp_buckets, jp_bucket;
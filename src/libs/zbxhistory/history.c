@@ -29,6 +29,7 @@ ZBX_VECTOR_IMPL(history_record, zbx_history_record_t)
 
 extern char	*CONFIG_HISTORY_STORAGE_URL;
 extern char	*CONFIG_HISTORY_STORAGE_OPTS;
+extern char	*CONFIG_HISTORY_STORAGE_DIR;
 
 zbx_history_iface_t	history_ifaces[ITEM_VALUE_TYPE_MAX];
 
@@ -38,7 +39,8 @@ zbx_history_iface_t	history_ifaces[ITEM_VALUE_TYPE_MAX];
  *                                                                                  *
  * Comments: History interfaces are created for all values types based on           *
  *           configuration. Every value type can have different history storage     *
- *           backend.                                                               *
+ *           backend. Numeric values are kept in local storage if storage directory *
+ *           is configured.                                                         *
  *                                                                                  *
  ************************************************************************************/
 int	zbx_history_init(char **error)
@@ -51,10 +53,17 @@ int	zbx_history_init(char **error)
 
 	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
 	{
-		if (NULL == CONFIG_HISTORY_STORAGE_URL || NULL == strstr(CONFIG_HISTORY_STORAGE_OPTS, opts[i]))
+		if (NULL != CONFIG_HISTORY_STORAGE_OPTS && NULL == strstr(CONFIG_HISTORY_STORAGE_OPTS, opts[i]))
 			ret = zbx_history_sql_init(&history_ifaces[i], i, error);
-		else
+		else if (NULL != CONFIG_HISTORY_STORAGE_DIR &&
+				(ITEM_VALUE_TYPE_FLOAT == i || ITEM_VALUE_TYPE_UINT64 == i))
+		{
+			ret = zbx_history_local_init(&history_ifaces[i], i, error);
+		}
+		else if (NULL != CONFIG_HISTORY_STORAGE_URL)
 			ret = zbx_history_elastic_init(&history_ifaces[i], i, error);
+		else
+			ret = zbx_history_sql_init(&history_ifaces[i], i, error);
 
 		if (FAIL == ret)
 			return FAIL;
@@ -174,6 +183,30 @@ int	zbx_history_get_values(zbx_uint64_t itemid, int value_type, int start, int c
 	return ret;
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: removes expired history values from history storage                     *
+ *                                                                                  *
+ * Parameters: value_type - [IN] the value type                                     *
+ *             keep_from  - [IN] the timestamp of the oldest value to keep          *
+ *             removed    - [OUT] the number of removed storage units               *
+ *                                                                                  *
+ * Return value: SUCCEED - the history storage removes expired values itself        *
+ *               FAIL - the history must be removed from database by housekeeper    *
+ *                                                                                  *
+ ************************************************************************************/
+int	zbx_history_housekeep(int value_type, int keep_from, int *removed)
+{
+	zbx_history_iface_t	*writer = &history_ifaces[value_type];
+
+	if (NULL == writer->housekeep)
+		return FAIL;
+
+	*removed = writer->housekeep(writer, keep_from);
+
+	return SUCCEED;
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: checks if the value type requires trends data calculations              *
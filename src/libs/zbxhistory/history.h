@@ -24,6 +24,7 @@
 
 #define ZBX_HISTORY_IFACE_SQL		0
 #define ZBX_HISTORY_IFACE_ELASTIC	1
+#define ZBX_HISTORY_IFACE_LOCAL		2
 
 typedef struct zbx_history_iface zbx_history_iface_t;
 
@@ -32,6 +33,7 @@ typedef int (*zbx_history_add_values_func_t)(struct zbx_history_iface *hist, con
 typedef int (*zbx_history_get_values_func_t)(struct zbx_history_iface *hist, zbx_uint64_t itemid, int start,
 		int count, int end, zbx_vector_history_record_t *values);
 typedef int (*zbx_history_flush_func_t)(struct zbx_history_iface *hist);
+typedef int (*zbx_history_housekeep_func_t)(struct zbx_history_iface *hist, int keep_from);
 
 struct zbx_history_iface
 {
@@ -43,6 +45,9 @@ struct zbx_history_iface
 	zbx_history_add_values_func_t	add_values;
 	zbx_history_get_values_func_t	get_values;
 	zbx_history_flush_func_t	flush;
+
+	/* optional, set if the storage removes expired history itself */
+	zbx_history_housekeep_func_t	housekeep;
 };
 
 /* SQL hist */
@@ -53,4 +58,7 @@ int	zbx_history_elastic_init(zbx_history_iface_t *hist, unsigned char value_type
 void	zbx_elastic_version_extract(struct zbx_json *json);
 zbx_uint32_t	zbx_elastic_version_get(void);
 
+/* local hist */
+int	zbx_history_local_init(zbx_history_iface_t *hist, unsigned char value_type, char **error);
+
 #endif
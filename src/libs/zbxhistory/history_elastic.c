@@ -22,6 +22,7 @@
 #include "zbxalgo.h"
 #include "dbcache.h"
 #include "zbxhistory.h"
+#include "zbxcompress.h"
 
 #include "history.h"
 
@@ -35,8 +36,22 @@
 
 const char	*value_type_str[] = {"dbl", "str", "log", "uint", "text"};
 
-extern char	*CONFIG_HISTORY_STORAGE_URL;
-extern int	CONFIG_HISTORY_STORAGE_PIPELINES;
+extern char		*CONFIG_HISTORY_STORAGE_URL;
+extern int		CONFIG_HISTORY_STORAGE_PIPELINES;
+extern int		CONFIG_HISTORY_STORAGE_COMPRESSION;
+extern zbx_uint64_t	CONFIG_HISTORY_STORAGE_BULK_SIZE;
+
+/* the maximum number of concurrent bulk requests to history storage */
+#define ZBX_ELASTIC_MAX_CONNECTIONS	8
+
+/* the delay in seconds before the first retry, doubled with each retry up to ZBX_HISTORY_STORAGE_DOWN */
+#define ZBX_ELASTIC_RETRY_DELAY_MIN	1
+
+/* the maximum number of times the documents rejected with temporary errors are resent */
+#define ZBX_ELASTIC_MAX_DOC_RETRIES	5
+
+/* the interval of logging bulk request statistics, in seconds */
+#define ZBX_ELASTIC_STATS_INTERVAL	(5 * SEC_PER_MIN)
 
 static zbx_uint32_t	ZBX_ELASTIC_SVERSION = ZBX_DBVERSION_UNDEFINED;
 
@@ -44,22 +59,11 @@ typedef struct
 {
 	char	*base_url;
 	char	*post_url;
-	char	*buf;
+	char	*bulk_url;
 	CURL	*handle;
 }
 zbx_elastic_data_t;
 
-typedef struct
-{
-	unsigned char		initialized;
-	zbx_vector_ptr_t	ifaces;
-
-	CURLM			*handle;
-}
-zbx_elastic_writer_t;
-
-static zbx_elastic_writer_t	writer;
-
 typedef struct
 {
 	char	*data;
@@ -77,7 +81,64 @@ typedef struct
 }
 zbx_curlpage_t;
 
-static zbx_curlpage_t	page_w[ITEM_VALUE_TYPE_MAX];
+/* bulk request with history values of a single value type */
+typedef struct
+{
+	zbx_history_iface_t	*hist;
+
+	/* the response page */
+	zbx_curlpage_t		page;
+
+	/* newline delimited index action and document pairs */
+	char			*buf;
+	size_t			buf_alloc;
+	size_t			buf_offset;
+
+	/* the offsets of index action and document pairs in buffer */
+	zbx_vector_uint64_t	docs;
+
+	/* the compressed buffer, NULL if compression is disabled or failed */
+	char			*post;
+	size_t			post_size;
+
+	/* the number of times the documents rejected with temporary errors were resent */
+	int			doc_retries;
+
+	CURL			*handle;
+}
+zbx_elastic_bulk_t;
+
+/* bulk request statistics per value type, logged after each flush and */
+/* accumulated for ZBX_ELASTIC_STATS_INTERVAL                          */
+typedef struct
+{
+	int		requests_num;
+	int		docs_num;
+	int		retried_num;
+	int		rejected_num;
+	zbx_uint64_t	size;
+	zbx_uint64_t	size_sent;
+}
+zbx_elastic_stats_t;
+
+typedef struct
+{
+	unsigned char		initialized;
+	zbx_vector_ptr_t	bulks;
+
+	/* the multi handle and idle easy handles are kept between flushes to reuse connections */
+	CURLM			*handle;
+	zbx_vector_ptr_t	handles;
+
+	struct curl_slist	*headers;
+	struct curl_slist	*headers_gzip;
+}
+zbx_elastic_writer_t;
+
+static zbx_elastic_writer_t	writer;
+
+static zbx_elastic_stats_t	stats_total[ITEM_VALUE_TYPE_MAX];
+static time_t			stats_time = 0;
 
 static size_t	curl_write_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
@@ -229,14 +290,10 @@ static void	elastic_close(zbx_history_iface_t *hist)
 {
 	zbx_elastic_data_t	*data = (zbx_elastic_data_t *)hist->data;
 
-	zbx_free(data->buf);
 	zbx_free(data->post_url);
 
 	if (NULL != data->handle)
 	{
-		if (NULL != writer.handle)
-			curl_multi_remove_handle(writer.handle, data->handle);
-
 		curl_easy_cleanup(data->handle);
 		data->handle = NULL;
 	}
@@ -244,70 +301,115 @@ static void	elastic_close(zbx_history_iface_t *hist)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: check a error from Elastic json response                          *
+ * Purpose: checks if bulk request was rejected with a temporary error        *
  *                                                                            *
- * Parameters: page - [IN]  the buffer with json response                     *
- *             err  - [OUT] the parse error message. If the error value is    *
- *                           set it must be freed by caller after it has      *
- *                           been used.                                       *
+ * Parameters: status - [IN] the HTTP status of the request or document       *
  *                                                                            *
- * Return value: SUCCEED - the response contains an error                     *
+ * Return value: SUCCEED - the request or document must be retried            *
  *               FAIL    - otherwise                                          *
  *                                                                            *
+ * Comments: Elastic rejects documents with 429 status when the indexing      *
+ *           queue is full and with 5xx statuses on shard failures.           *
+ *                                                                            *
+ ******************************************************************************/
+static int	elastic_is_retryable(long int status)
+{
+	return 429 == status || 500 <= status ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the documents rejected by Elastic from bulk json response     *
+ *                                                                            *
+ * Parameters: page    - [IN] the buffer with json response                   *
+ *             docs    - [IN] the number of documents in bulk request         *
+ *             retries - [OUT] the indexes of documents rejected with         *
+ *                             temporary errors                               *
+ *             err     - [OUT] the first error message. If the error value    *
+ *                             is set it must be freed by caller after it     *
+ *                             has been used.                                 *
+ *                                                                            *
+ * Return value: the number of documents rejected with permanent errors       *
+ *                                                                            *
+ * Comments: If the response reports errors, but the items cannot be parsed   *
+ *           all documents are retried.                                       *
+ *                                                                            *
  ******************************************************************************/
-static int	elastic_is_error_present(zbx_httppage_t *page, char **err)
+static int	elastic_get_rejected(zbx_httppage_t *page, int docs, zbx_vector_uint64_t *retries, char **err)
 {
 	struct zbx_json_parse	jp, jp_values, jp_index, jp_error, jp_items, jp_item;
 	const char		*errors, *p = NULL;
 	char			*index = NULL, *status = NULL, *type = NULL, *reason = NULL;
 	size_t			index_alloc = 0, status_alloc = 0, type_alloc = 0, reason_alloc = 0;
-	int			rc_js = SUCCEED;
+	int			rc_js = SUCCEED, i, rejected = 0;
+	long int		code;
 
 	zabbix_log(LOG_LEVEL_TRACE, "%s() raw json: %s", __func__, ZBX_NULL2EMPTY_STR(page->data));
 
 	if (SUCCEED != zbx_json_open(page->data, &jp) || SUCCEED != zbx_json_brackets_open(jp.start, &jp_values))
-		return FAIL;
+		return 0;
 
 	if (NULL == (errors = zbx_json_pair_by_name(&jp_values, "errors")) || 0 != strncmp("true", errors, 4))
-		return FAIL;
+		return 0;
 
 	if (SUCCEED == zbx_json_brackets_by_name(&jp, "items", &jp_items))
 	{
-		while (NULL != (p = zbx_json_next(&jp_items, p)))
+		for (i = 0; NULL != (p = zbx_json_next(&jp_items, p)); i++)
 		{
-			if (SUCCEED == zbx_json_brackets_open(p, &jp_item) &&
-					SUCCEED == zbx_json_brackets_by_name(&jp_item, "index", &jp_index) &&
-					SUCCEED == zbx_json_brackets_by_name(&jp_index, "error", &jp_error))
+			if (SUCCEED != zbx_json_brackets_open(p, &jp_item) ||
+					SUCCEED != zbx_json_brackets_by_name(&jp_item, "index", &jp_index) ||
+					SUCCEED != zbx_json_brackets_by_name(&jp_index, "error", &jp_error))
 			{
-				if (SUCCEED != zbx_json_value_by_name_dyn(&jp_error, "type", &type, &type_alloc, NULL))
-					rc_js = FAIL;
-				if (SUCCEED != zbx_json_value_by_name_dyn(&jp_error, "reason", &reason, &reason_alloc, NULL))
-					rc_js = FAIL;
+				continue;
+			}
+
+			if (SUCCEED == zbx_json_value_by_name_dyn(&jp_index, "status", &status, &status_alloc, NULL))
+			{
+				code = atol(status);
 			}
 			else
+			{
+				code = 0;
+				rc_js = FAIL;
+			}
+
+			if (SUCCEED == elastic_is_retryable(code))
+				zbx_vector_uint64_append(retries, (zbx_uint64_t)i);
+			else
+				rejected++;
+
+			if (NULL != *err)
 				continue;
 
-			if (SUCCEED != zbx_json_value_by_name_dyn(&jp_index, "status", &status, &status_alloc, NULL))
+			if (SUCCEED != zbx_json_value_by_name_dyn(&jp_error, "type", &type, &type_alloc, NULL))
+				rc_js = FAIL;
+			if (SUCCEED != zbx_json_value_by_name_dyn(&jp_error, "reason", &reason, &reason_alloc, NULL))
 				rc_js = FAIL;
 			if (SUCCEED != zbx_json_value_by_name_dyn(&jp_index, "_index", &index, &index_alloc, NULL))
 				rc_js = FAIL;
 
-			break;
+			*err = zbx_dsprintf(NULL, "index:%s status:%s type:%s reason:%s%s", ZBX_NULL2EMPTY_STR(index),
+					ZBX_NULL2EMPTY_STR(status), ZBX_NULL2EMPTY_STR(type),
+					ZBX_NULL2EMPTY_STR(reason), FAIL == rc_js ?
+					" / elasticsearch version is not fully compatible with zabbix server" : "");
 		}
 	}
-	else
-		rc_js = FAIL;
 
-	*err = zbx_dsprintf(NULL,"index:%s status:%s type:%s reason:%s%s", ZBX_NULL2EMPTY_STR(index),
-			ZBX_NULL2EMPTY_STR(status), ZBX_NULL2EMPTY_STR(type), ZBX_NULL2EMPTY_STR(reason),
-			FAIL == rc_js ? " / elasticsearch version is not fully compatible with zabbix server" : "");
+	if (NULL == *err)
+	{
+		*err = zbx_strdup(NULL, "cannot parse bulk response items / elasticsearch version is not fully"
+				" compatible with zabbix server");
+
+		for (i = 0; i < docs; i++)
+			zbx_vector_uint64_append(retries, (zbx_uint64_t)i);
+	}
 
 	zbx_free(status);
 	zbx_free(type);
 	zbx_free(reason);
 	zbx_free(index);
 
-	return SUCCEED;
+	return rejected;
 }
 
 /******************************************************************************************************************
@@ -320,116 +422,430 @@ static int	elastic_is_error_present(zbx_httppage_t *page, char **err)
  *                                                                                  *
  * Purpose: initializes elastic writer for a new batch of history values            *
  *                                                                                  *
+ * Comments: The multi handle is created once and kept for process lifetime so     *
+ *           the connections to history storage are reused between flushes.         *
+ *                                                                                  *
  ************************************************************************************/
 static void	elastic_writer_init(void)
 {
 	if (0 != writer.initialized)
 		return;
 
-	zbx_vector_ptr_create(&writer.ifaces);
+	zbx_vector_ptr_create(&writer.bulks);
 
-	if (NULL == (writer.handle = curl_multi_init()))
+	if (NULL == writer.handle)
 	{
-		zbx_error("Cannot initialize cURL multi session");
-		exit(EXIT_FAILURE);
+		if (NULL == (writer.handle = curl_multi_init()))
+		{
+			zbx_error("Cannot initialize cURL multi session");
+			exit(EXIT_FAILURE);
+		}
+
+#if LIBCURL_VERSION_NUM >= 0x071e00
+		/* bulk requests over the limit are queued by cURL until a connection is available */
+		curl_multi_setopt(writer.handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)ZBX_ELASTIC_MAX_CONNECTIONS);
+#endif
+		zbx_vector_ptr_create(&writer.handles);
+
+		writer.headers = curl_slist_append(NULL, "Content-Type: application/x-ndjson");
+		writer.headers_gzip = curl_slist_append(NULL, "Content-Type: application/x-ndjson");
+		writer.headers_gzip = curl_slist_append(writer.headers_gzip, "Content-Encoding: gzip");
 	}
 
 	writer.initialized = 1;
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: frees bulk request                                                      *
+ *                                                                                  *
+ ************************************************************************************/
+static void	elastic_bulk_free(zbx_elastic_bulk_t *bulk)
+{
+	if (NULL != bulk->handle)
+	{
+		curl_multi_remove_handle(writer.handle, bulk->handle);
+		zbx_vector_ptr_append(&writer.handles, bulk->handle);
+	}
+
+	zbx_free(bulk->page.page.data);
+	zbx_free(bulk->buf);
+	zbx_free(bulk->post);
+	zbx_vector_uint64_destroy(&bulk->docs);
+	zbx_free(bulk);
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: releases initialized elastic writer by freeing allocated resources and  *
  *          setting its state to uninitialized.                                     *
  *                                                                                  *
+ * Comments: The easy handles are returned to the idle handle pool.                 *
+ *                                                                                  *
  ************************************************************************************/
 static void	elastic_writer_release(void)
+{
+	zbx_vector_ptr_clear_ext(&writer.bulks, (zbx_clean_func_t)elastic_bulk_free);
+	zbx_vector_ptr_destroy(&writer.bulks);
+
+	writer.initialized = 0;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: destroys elastic writer, closing the history storage connections        *
+ *                                                                                  *
+ ************************************************************************************/
+static void	elastic_writer_destroy(void)
 {
 	int	i;
 
-	for (i = 0; i < writer.ifaces.values_num; i++)
-		elastic_close((zbx_history_iface_t *)writer.ifaces.values[i]);
+	if (0 != writer.initialized)
+		elastic_writer_release();
+
+	if (NULL == writer.handle)
+		return;
+
+	for (i = 0; i < writer.handles.values_num; i++)
+		curl_easy_cleanup(writer.handles.values[i]);
+
+	zbx_vector_ptr_destroy(&writer.handles);
 
 	curl_multi_cleanup(writer.handle);
 	writer.handle = NULL;
 
-	zbx_vector_ptr_destroy(&writer.ifaces);
+	curl_slist_free_all(writer.headers);
+	curl_slist_free_all(writer.headers_gzip);
+}
 
-	writer.initialized = 0;
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: creates new bulk request for history storage interface                  *
+ *                                                                                  *
+ * Parameters: hist - [IN] the history storage interface                            *
+ *                                                                                  *
+ * Return value: the bulk request                                                   *
+ *                                                                                  *
+ ************************************************************************************/
+static zbx_elastic_bulk_t	*elastic_writer_add_bulk(zbx_history_iface_t *hist)
+{
+	zbx_elastic_bulk_t	*bulk;
+
+	elastic_writer_init();
+
+	bulk = (zbx_elastic_bulk_t *)zbx_malloc(NULL, sizeof(zbx_elastic_bulk_t));
+	memset(bulk, 0, sizeof(zbx_elastic_bulk_t));
+	bulk->hist = hist;
+	zbx_vector_uint64_create(&bulk->docs);
+
+	zbx_vector_ptr_append(&writer.bulks, bulk);
+
+	return bulk;
 }
 
 /************************************************************************************
  *                                                                                  *
- * Purpose: adds history storage interface to be flushed later                      *
+ * Purpose: prepares bulk request and adds it to the multi handle                   *
  *                                                                                  *
- * Parameters: db_insert - [IN] bulk insert data                                    *
+ * Parameters: bulk  - [IN] the bulk request                                        *
+ *             stats - [IN/OUT] the bulk request statistics                         *
+ *                                                                                  *
+ * Return value: SUCCEED - the request was added to the multi handle                *
+ *               FAIL    - otherwise                                                *
  *                                                                                  *
  ************************************************************************************/
-static void	elastic_writer_add_iface(zbx_history_iface_t *hist)
+static int	elastic_bulk_post(zbx_elastic_bulk_t *bulk, zbx_elastic_stats_t *stats)
 {
-	zbx_elastic_data_t	*data = (zbx_elastic_data_t *)hist->data;
+	zbx_elastic_data_t	*data = (zbx_elastic_data_t *)bulk->hist->data;
 	CURLoption		opt;
 	CURLcode		err;
+	const char		*post = bulk->buf;
+	size_t			post_size = bulk->buf_offset;
+	struct curl_slist	*headers = writer.headers;
 
-	elastic_writer_init();
+	zbx_free(bulk->post);
 
-	if (NULL == (data->handle = curl_easy_init()))
+	if (1 == CONFIG_HISTORY_STORAGE_COMPRESSION)
 	{
-		zabbix_log(LOG_LEVEL_ERR, "cannot initialize cURL session");
-		return;
+		if (SUCCEED == zbx_compress_gzip(bulk->buf, bulk->buf_offset, &bulk->post, &bulk->post_size))
+		{
+			post = bulk->post;
+			post_size = bulk->post_size;
+			headers = writer.headers_gzip;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot compress data for elasticsearch: %s",
+					zbx_compress_strerror());
+		}
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_URL, data->post_url)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_POST, 1L)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_POSTFIELDS, data->buf)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_WRITEFUNCTION,
+	if (NULL == bulk->handle)
+	{
+		if (0 != writer.handles.values_num)
+		{
+			bulk->handle = writer.handles.values[writer.handles.values_num - 1];
+			zbx_vector_ptr_remove_noorder(&writer.handles, writer.handles.values_num - 1);
+		}
+		else if (NULL == (bulk->handle = curl_easy_init()))
+		{
+			zabbix_log(LOG_LEVEL_ERR, "cannot initialize cURL session");
+			return FAIL;
+		}
+	}
+
+	if (CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_URL, data->bulk_url)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_POST, 1L)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_POSTFIELDS, post)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_POSTFIELDSIZE,
+					(long)post_size)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_HTTPHEADER, headers)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_WRITEFUNCTION,
 					curl_write_cb)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_WRITEDATA,
-					&page_w[hist->value_type].page)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_FAILONERROR, 1L)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_ERRORBUFFER,
-					page_w[hist->value_type].errbuf)) ||
-			CURLE_OK != (err = curl_easy_setopt(data->handle, opt = ZBX_CURLOPT_ACCEPT_ENCODING, "")))
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_WRITEDATA,
+					&bulk->page.page)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_FAILONERROR, 1L)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_ERRORBUFFER,
+					bulk->page.errbuf)) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = ZBX_CURLOPT_ACCEPT_ENCODING, "")) ||
+			CURLE_OK != (err = curl_easy_setopt(bulk->handle, opt = CURLOPT_PRIVATE, bulk)))
 	{
 		zabbix_log(LOG_LEVEL_ERR, "cannot set cURL option %d: [%s]", (int)opt, curl_easy_strerror(err));
-		goto out;
+		return FAIL;
 	}
 
-	*page_w[hist->value_type].errbuf = '\0';
+	*bulk->page.errbuf = '\0';
+	bulk->page.page.offset = 0;
+
+	if (0 < bulk->page.page.alloc)
+		*bulk->page.page.data = '\0';
+
+	zabbix_log(LOG_LEVEL_DEBUG, "sending %d %s documents, %d bytes", bulk->docs.values_num,
+			value_type_str[bulk->hist->value_type], (int)post_size);
+	zabbix_log(LOG_LEVEL_TRACE, "sending %.*s", (int)bulk->buf_offset, bulk->buf);
+
+	curl_multi_add_handle(writer.handle, bulk->handle);
+
+	stats->requests_num++;
+	stats->size += bulk->buf_offset;
+	stats->size_sent += post_size;
+
+	return SUCCEED;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: removes successfully sent documents from bulk request, leaving only     *
+ *          the documents to be retried                                             *
+ *                                                                                  *
+ * Parameters: bulk    - [IN/OUT] the bulk request                                  *
+ *             retries - [IN] the indexes of documents to retry, sorted             *
+ *                                                                                  *
+ ************************************************************************************/
+static void	elastic_bulk_retain(zbx_elastic_bulk_t *bulk, const zbx_vector_uint64_t *retries)
+{
+	char			*buf = NULL;
+	size_t			buf_alloc = 0, buf_offset = 0, doc_start, doc_end;
+	int			i, index;
+	zbx_vector_uint64_t	docs;
+
+	zbx_vector_uint64_create(&docs);
+	zbx_vector_uint64_reserve(&docs, (size_t)retries->values_num);
 
-	if (CURLE_OK != (err = curl_easy_setopt(data->handle, opt = CURLOPT_PRIVATE, &page_w[hist->value_type])))
+	for (i = 0; i < retries->values_num; i++)
 	{
-		zabbix_log(LOG_LEVEL_ERR, "cannot set cURL option %d: [%s]", (int)opt, curl_easy_strerror(err));
-		goto out;
+		if (bulk->docs.values_num <= (index = (int)retries->values[i]))
+			break;
+
+		doc_start = (size_t)bulk->docs.values[index];
+		doc_end = (index + 1 < bulk->docs.values_num ? (size_t)bulk->docs.values[index + 1] :
+				bulk->buf_offset);
+
+		zbx_vector_uint64_append(&docs, buf_offset);
+		zbx_strncpy_alloc(&buf, &buf_alloc, &buf_offset, bulk->buf + doc_start, doc_end - doc_start);
+	}
+
+	zbx_free(bulk->buf);
+	bulk->buf = buf;
+	bulk->buf_alloc = buf_alloc;
+	bulk->buf_offset = buf_offset;
+
+	zbx_vector_uint64_destroy(&bulk->docs);
+	bulk->docs = docs;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: processes completed bulk request                                        *
+ *                                                                                  *
+ * Parameters: bulk   - [IN/OUT] the bulk request                                  *
+ *             result - [IN] the transfer result                                    *
+ *             stats  - [IN/OUT] the bulk request statistics                        *
+ *                                                                                  *
+ * Return value: SUCCEED - the bulk request must be retried                         *
+ *               FAIL    - otherwise                                                *
+ *                                                                                  *
+ ************************************************************************************/
+static int	elastic_bulk_complete(zbx_elastic_bulk_t *bulk, CURLcode result, zbx_elastic_stats_t *stats)
+{
+	char			*error = NULL;
+	int			ret = FAIL, rejected;
+	long int		response_code;
+	zbx_vector_uint64_t	retries;
+
+	curl_multi_remove_handle(writer.handle, bulk->handle);
+
+	/* If the error is due to malformed data, there is no sense on re-trying to send. */
+	/* That's why we actually check for transport and curl errors separately */
+	if (CURLE_HTTP_RETURNED_ERROR == result)
+	{
+		char	http_status[MAX_STRING_LEN];
+
+		if (CURLE_OK == curl_easy_getinfo(bulk->handle, CURLINFO_RESPONSE_CODE, &response_code))
+		{
+			zbx_snprintf(http_status, sizeof(http_status), "HTTP status code: %ld", response_code);
+
+			/* the whole request was rejected because of indexing pressure */
+			if (SUCCEED == elastic_is_retryable(response_code))
+				ret = SUCCEED;
+		}
+		else
+			zbx_strlcpy(http_status, "unknown HTTP status code", sizeof(http_status));
+
+		if ('\0' != *bulk->page.errbuf)
+		{
+			zabbix_log(LOG_LEVEL_ERR, "cannot send data to elasticsearch, HTTP error message: %s",
+					bulk->page.errbuf);
+		}
+		else
+			zabbix_log(LOG_LEVEL_ERR, "cannot send data to elasticsearch, %s", http_status);
+
+		if (FAIL == ret)
+			stats->rejected_num += bulk->docs.values_num;
 	}
+	else if (CURLE_OK != result)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send data to elasticsearch: %s",
+				'\0' != *bulk->page.errbuf ? bulk->page.errbuf : curl_easy_strerror(result));
 
-	page_w[hist->value_type].page.offset = 0;
+		/* If the error is due to curl internal problems or unrelated */
+		/* problems with HTTP, the whole request is retried */
+		ret = SUCCEED;
+	}
+	else
+	{
+		zbx_vector_uint64_create(&retries);
 
-	if (0 < page_w[hist->value_type].page.alloc)
-		*page_w[hist->value_type].page.data = '\0';
+		rejected = elastic_get_rejected(&bulk->page.page, bulk->docs.values_num, &retries, &error);
+		stats->rejected_num += rejected;
+		stats->docs_num += bulk->docs.values_num - rejected - retries.values_num;
 
-	curl_multi_add_handle(writer.handle, data->handle);
+		if (NULL != error)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "%s() cannot send %d of %d documents to elasticsearch, %d will be"
+					" retried: %s", __func__, rejected + retries.values_num, bulk->docs.values_num,
+					retries.values_num, error);
+			zbx_free(error);
+		}
 
-	zbx_vector_ptr_append(&writer.ifaces, hist);
+		/* If the documents were rejected due to elastic internal problems (for example */
+		/* indexing queue is full), only the rejected documents are retried */
+		if (0 != retries.values_num)
+		{
+			if (ZBX_ELASTIC_MAX_DOC_RETRIES <= bulk->doc_retries++)
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot send %d documents to elasticsearch after %d retries,"
+						" dropping them", retries.values_num, ZBX_ELASTIC_MAX_DOC_RETRIES);
+				stats->rejected_num += retries.values_num;
+			}
+			else
+			{
+				if (retries.values_num != bulk->docs.values_num)
+					elastic_bulk_retain(bulk, &retries);
 
-	return;
-out:
-	elastic_close(hist);
+				ret = SUCCEED;
+			}
+		}
+
+		zbx_vector_uint64_destroy(&retries);
+	}
+
+	if (SUCCEED == ret)
+		stats->retried_num += bulk->docs.values_num;
+
+	return ret;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: accumulates bulk request statistics and logs them once per              *
+ *          ZBX_ELASTIC_STATS_INTERVAL                                              *
+ *                                                                                  *
+ * Parameters: stats - [IN] the statistics of the last flush per value type         *
+ *                                                                                  *
+ * Comments: The statistics are collected by each history syncer separately.        *
+ *                                                                                  *
+ ************************************************************************************/
+static void	elastic_stats_update(const zbx_elastic_stats_t *stats)
+{
+	int	i;
+	time_t	now;
+
+	now = time(NULL);
+
+	if (0 == stats_time)
+		stats_time = now;
+
+	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
+	{
+		stats_total[i].requests_num += stats[i].requests_num;
+		stats_total[i].docs_num += stats[i].docs_num;
+		stats_total[i].retried_num += stats[i].retried_num;
+		stats_total[i].rejected_num += stats[i].rejected_num;
+		stats_total[i].size += stats[i].size;
+		stats_total[i].size_sent += stats[i].size_sent;
+	}
+
+	if (ZBX_ELASTIC_STATS_INTERVAL > now - stats_time)
+		return;
+
+	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
+	{
+		if (0 == stats_total[i].requests_num)
+			continue;
+
+		zabbix_log(LOG_LEVEL_INFORMATION, "elasticsearch %s history: indexed %d documents in %d requests,"
+				" retried %d, rejected %d, sent " ZBX_FS_UI64 " of " ZBX_FS_UI64 " bytes during %d sec"
+				" (" ZBX_FS_DBL " documents/sec)", value_type_str[i], stats_total[i].docs_num,
+				stats_total[i].requests_num, stats_total[i].retried_num, stats_total[i].rejected_num,
+				stats_total[i].size_sent, stats_total[i].size, (int)(now - stats_time),
+				(double)stats_total[i].docs_num / (double)(now - stats_time));
+	}
+
+	memset(stats_total, 0, sizeof(stats_total));
+	stats_time = now;
 }
 
 /************************************************************************************
  *                                                                                  *
  * Purpose: posts historical data to elastic storage                                *
  *                                                                                  *
+ * Comments: The bulk requests are sent concurrently. The requests failed due to    *
+ *           transport errors are retried until they succeed, the documents         *
+ *           rejected with temporary errors are retried at most                     *
+ *           ZBX_ELASTIC_MAX_DOC_RETRIES times. The delay between retries starts    *
+ *           at ZBX_ELASTIC_RETRY_DELAY_MIN and doubles up to                       *
+ *           ZBX_HISTORY_STORAGE_DOWN.                                              *
+ *                                                                                  *
  ************************************************************************************/
 static int	elastic_writer_flush(void)
 {
-	struct curl_slist	*curl_headers = NULL;
-	int			i, running, previous, msgnum;
+	int			i, running, previous, msgnum, delay = ZBX_ELASTIC_RETRY_DELAY_MIN;
 	CURLMsg			*msg;
 	zbx_vector_ptr_t	retries;
-	CURLcode		err;
 	int			ret = SUCCEED;
+	double			time_start;
+	zbx_elastic_stats_t	stats[ITEM_VALUE_TYPE_MAX];
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -439,23 +855,18 @@ static int	elastic_writer_flush(void)
 		goto end;
 
 	zbx_vector_ptr_create(&retries);
+	memset(stats, 0, sizeof(stats));
+	time_start = zbx_time();
 
-	curl_headers = curl_slist_append(curl_headers, "Content-Type: application/x-ndjson");
-
-	for (i = 0; i < writer.ifaces.values_num; i++)
+	for (i = 0; i < writer.bulks.values_num; i++)
 	{
-		zbx_history_iface_t	*hist = (zbx_history_iface_t *)writer.ifaces.values[i];
-		zbx_elastic_data_t	*data = (zbx_elastic_data_t *)hist->data;
+		zbx_elastic_bulk_t	*bulk = (zbx_elastic_bulk_t *)writer.bulks.values[i];
 
-		if (CURLE_OK != (err = curl_easy_setopt(data->handle, CURLOPT_HTTPHEADER, curl_headers)))
+		if (SUCCEED != elastic_bulk_post(bulk, &stats[bulk->hist->value_type]))
 		{
-			zabbix_log(LOG_LEVEL_ERR, "cannot set cURL option %d: [%s]", (int)CURLOPT_HTTPHEADER,
-					curl_easy_strerror(err));
 			ret = FAIL;
 			goto clean;
 		}
-
-		zabbix_log(LOG_LEVEL_DEBUG, "sending %s", data->buf);
 	}
 
 try_again:
@@ -465,8 +876,6 @@ try_again:
 	{
 		int		fds;
 		CURLMcode	code;
-		char		*error;
-		zbx_curlpage_t	*curl_page;
 
 		if (CURLM_OK != (code = curl_multi_perform(writer.handle, &running)))
 		{
@@ -485,91 +894,72 @@ try_again:
 
 		while (NULL != (msg = curl_multi_info_read(writer.handle, &msgnum)))
 		{
-			/* If the error is due to malformed data, there is no sense on re-trying to send. */
-			/* That's why we actually check for transport and curl errors separately */
-			if (CURLE_HTTP_RETURNED_ERROR == msg->data.result)
-			{
-				if (CURLE_OK == curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
-						(char **)&curl_page) && '\0' != *curl_page->errbuf)
-				{
-					zabbix_log(LOG_LEVEL_ERR, "cannot send data to elasticsearch, HTTP error"
-							" message: %s", curl_page->errbuf);
-				}
-				else
-				{
-					char		http_status[MAX_STRING_LEN];
-					long int	response_code;
-
-					if (CURLE_OK == curl_easy_getinfo(msg->easy_handle,
-							CURLINFO_RESPONSE_CODE, &response_code))
-					{
-						zbx_snprintf(http_status, sizeof(http_status), "HTTP status code: %ld",
-								response_code);
-					}
-					else
-					{
-						zbx_strlcpy(http_status, "unknown HTTP status code",
-								sizeof(http_status));
-					}
-
-					zabbix_log(LOG_LEVEL_ERR, "cannot send data to elasticsearch, %s", http_status);
-				}
-			}
-			else if (CURLE_OK != msg->data.result)
-			{
-				if (CURLE_OK == curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
-						(char **)&curl_page) && '\0' != *curl_page->errbuf)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "cannot send data to elasticsearch: %s",
-							curl_page->errbuf);
-				}
-				else
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "cannot send data to elasticsearch: %s",
-							curl_easy_strerror(msg->data.result));
-				}
-
-				/* If the error is due to curl internal problems or unrelated */
-				/* problems with HTTP, we put the handle in a retry list and */
-				/* remove it from the current execution loop */
-				zbx_vector_ptr_append(&retries, msg->easy_handle);
-				curl_multi_remove_handle(writer.handle, msg->easy_handle);
-			}
-			else if (CURLE_OK == curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&curl_page)
-					&& SUCCEED == elastic_is_error_present(&curl_page->page, &error))
+			zbx_elastic_bulk_t	*bulk;
+
+			if (CURLMSG_DONE != msg->msg)
+				continue;
+
+			if (CURLE_OK != curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&bulk))
 			{
-				zabbix_log(LOG_LEVEL_WARNING, "%s() cannot send data to elasticsearch: %s",
-						__func__, error);
-				zbx_free(error);
-
-				/* If the error is due to elastic internal problems (for example an index */
-				/* became read-only), we put the handle in a retry list and */
-				/* remove it from the current execution loop */
-				zbx_vector_ptr_append(&retries, msg->easy_handle);
-				curl_multi_remove_handle(writer.handle, msg->easy_handle);
+				THIS_SHOULD_NEVER_HAPPEN;
+				continue;
 			}
+
+			if (SUCCEED == elastic_bulk_complete(bulk, msg->data.result, &stats[bulk->hist->value_type]))
+				zbx_vector_ptr_append(&retries, bulk);
 		}
 
 		previous = running;
 	}
 	while (running);
 
-	/* We check if we have handles to retry. If yes, we put them back in the multi */
+	/* We check if we have requests to retry. If yes, we put them back in the multi */
 	/* handle and go to the beginning of the do while() for try sending the data again */
-	/* after sleeping for ZBX_HISTORY_STORAGE_DOWN / 1000 (seconds) */
+	/* after sleeping for exponentially increasing delay */
 	if (0 < retries.values_num)
 	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() retrying %d requests in %d sec", __func__, retries.values_num, delay);
+
+		sleep((unsigned int)delay);
+
+		if (ZBX_HISTORY_STORAGE_DOWN / 1000 < (delay *= 2))
+			delay = ZBX_HISTORY_STORAGE_DOWN / 1000;
+
 		for (i = 0; i < retries.values_num; i++)
-			curl_multi_add_handle(writer.handle, retries.values[i]);
+		{
+			zbx_elastic_bulk_t	*bulk = (zbx_elastic_bulk_t *)retries.values[i];
+
+			if (SUCCEED != elastic_bulk_post(bulk, &stats[bulk->hist->value_type]))
+			{
+				ret = FAIL;
+				goto clean;
+			}
+		}
 
 		zbx_vector_ptr_clear(&retries);
 
-		sleep(ZBX_HISTORY_STORAGE_DOWN / 1000);
 		goto try_again;
 	}
-clean:
-	curl_slist_free_all(curl_headers);
 
+	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
+	{
+		double	time_sent;
+
+		if (0 == stats[i].requests_num)
+			continue;
+
+		time_sent = zbx_time() - time_start;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() %s: indexed %d documents in %d requests, retried %d, rejected %d,"
+				" sent " ZBX_FS_UI64 " of " ZBX_FS_UI64 " bytes in " ZBX_FS_DBL " sec ("
+				ZBX_FS_DBL " documents/sec)", __func__, value_type_str[i], stats[i].docs_num,
+				stats[i].requests_num, stats[i].retried_num, stats[i].rejected_num,
+				stats[i].size_sent, stats[i].size, time_sent,
+				0 < time_sent ? stats[i].docs_num / time_sent : 0);
+	}
+
+	elastic_stats_update(stats);
+clean:
 	zbx_vector_ptr_destroy(&retries);
 
 	elastic_writer_release();
@@ -598,7 +988,9 @@ static void	elastic_destroy(zbx_history_iface_t *hist)
 	zbx_elastic_data_t	*data = (zbx_elastic_data_t *)hist->data;
 
 	elastic_close(hist);
+	elastic_writer_destroy();
 
+	zbx_free(data->bulk_url);
 	zbx_free(data->base_url);
 	zbx_free(data);
 }
@@ -859,11 +1251,10 @@ out:
  ************************************************************************************/
 static int	elastic_add_values(zbx_history_iface_t *hist, const zbx_vector_ptr_t *history)
 {
-	zbx_elastic_data_t	*data = (zbx_elastic_data_t *)hist->data;
 	int			i, num = 0;
 	ZBX_DC_HISTORY		*h;
 	struct zbx_json		json_idx, json;
-	size_t			buf_alloc = 0, buf_offset = 0;
+	zbx_elastic_bulk_t	*bulk = NULL;
 	char			pipeline[14]; /* index name length + suffix "-pipeline" */
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
@@ -913,19 +1304,22 @@ static int	elastic_add_values(zbx_history_iface_t *hist, const zbx_vector_ptr_t
 
 		zbx_json_close(&json);
 
-		zbx_snprintf_alloc(&data->buf, &buf_alloc, &buf_offset, "%s\n%s\n", json_idx.buffer, json.buffer);
+		/* split large batches into bulk requests of limited size */
+		if (NULL == bulk || (0 != CONFIG_HISTORY_STORAGE_BULK_SIZE &&
+				CONFIG_HISTORY_STORAGE_BULK_SIZE <= bulk->buf_offset))
+		{
+			bulk = elastic_writer_add_bulk(hist);
+		}
+
+		zbx_vector_uint64_append(&bulk->docs, bulk->buf_offset);
+		zbx_snprintf_alloc(&bulk->buf, &bulk->buf_alloc, &bulk->buf_offset, "%s\n%s\n", json_idx.buffer,
+				json.buffer);
 
 		zbx_json_free(&json);
 
 		num++;
 	}
 
-	if (num > 0)
-	{
-		data->post_url = zbx_dsprintf(NULL, "%s/_bulk?refresh=true", data->base_url);
-		elastic_writer_add_iface(hist);
-	}
-
 	zbx_json_free(&json_idx);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -976,7 +1370,7 @@ int	zbx_history_elastic_init(zbx_history_iface_t *hist, unsigned char value_type
 	memset(data, 0, sizeof(zbx_elastic_data_t));
 	data->base_url = zbx_strdup(NULL, CONFIG_HISTORY_STORAGE_URL);
 	zbx_rtrim(data->base_url, "/");
-	data->buf = NULL;
+	data->bulk_url = zbx_dsprintf(NULL, "%s/_bulk?refresh=true", data->base_url);
 	data->post_url = NULL;
 	data->handle = NULL;
 
@@ -986,6 +1380,7 @@ int	zbx_history_elastic_init(zbx_history_iface_t *hist, unsigned char value_type
 	hist->add_values = elastic_add_values;
 	hist->flush = elastic_flush;
 	hist->get_values = elastic_get_values;
+	hist->housekeep = NULL;
 	hist->requires_trends = 0;
 
 	return SUCCEED;
@@ -0,0 +1,861 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "dbcache.h"
+#include "zbxhistory.h"
+#include "history.h"
+
+#include "../zbxalgo/vectorimpl.h"
+
+#include <sys/mman.h>
+
+/*
+ * Local history storage keeps numeric history in append-only segment files:
+ *
+ *   <HistoryStorageDir>/<dbl|uint>/<block>/<pid>.seg
+ *
+ * where <block> is the start timestamp of the time block the values belong to. Every writer
+ * process appends to its own segment file, so no locking is required. A segment file consists
+ * of chunks written by a single flush:
+ *
+ *   header | itemid column | value column | clock column | ns column | trailer
+ *
+ * Chunk records are sorted by itemid and timestamp, which allows locating item values with
+ * binary search. A chunk is valid only when its trailer is present, so readers simply stop at
+ * the chunk being appended. An incomplete chunk left by a terminated process is truncated when
+ * the segment file is opened for appending again. Expired history is removed by dropping whole
+ * time blocks.
+ */
+
+#define ZBX_HISTORY_LOCAL_BLOCK_PERIOD	SEC_PER_HOUR
+
+#define ZBX_HISTORY_LOCAL_CHUNK_HEAD	0x4b43485a	/* "ZHCK" */
+#define ZBX_HISTORY_LOCAL_CHUNK_TAIL	0x444e455a	/* "ZEND" */
+
+#define ZBX_HISTORY_LOCAL_SEGMENT_EXT	".seg"
+
+extern char	*CONFIG_HISTORY_STORAGE_DIR;
+
+static const char	*local_type_str[] = {"dbl", "str", "log", "uint", "text"};
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	count;
+	zbx_uint64_t	itemid_min;
+	zbx_uint64_t	itemid_max;
+	int		clock_min;
+	int		clock_max;
+}
+zbx_local_chunk_head_t;
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	count;
+}
+zbx_local_chunk_tail_t;
+
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	history_value_t	value;
+	int		clock;
+	int		ns;
+}
+zbx_local_record_t;
+
+ZBX_VECTOR_DECL(local_record, zbx_local_record_t)
+ZBX_VECTOR_IMPL(local_record, zbx_local_record_t)
+
+typedef struct
+{
+	/* the value type directory <HistoryStorageDir>/<type> */
+	char				*path;
+
+	/* the values waiting to be flushed */
+	zbx_vector_local_record_t	records;
+
+	/* the segment file opened for appending and its time block */
+	int				fd;
+	int				block;
+}
+zbx_local_data_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns start of the time block containing the specified clock   *
+ *                                                                            *
+ ******************************************************************************/
+static int	local_block(int clock)
+{
+	return clock - clock % ZBX_HISTORY_LOCAL_BLOCK_PERIOD;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns size of a chunk with the specified number of records      *
+ *                                                                            *
+ ******************************************************************************/
+static size_t	local_chunk_size(zbx_uint32_t count)
+{
+	return sizeof(zbx_local_chunk_head_t) + (size_t)count * (sizeof(zbx_uint64_t) * 2 + sizeof(int) * 2) +
+			sizeof(zbx_local_chunk_tail_t);
+}
+
+static int	local_record_compare(const void *d1, const void *d2)
+{
+	const zbx_local_record_t	*r1 = (const zbx_local_record_t *)d1;
+	const zbx_local_record_t	*r2 = (const zbx_local_record_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(local_block(r1->clock), local_block(r2->clock));
+	ZBX_RETURN_IF_NOT_EQUAL(r1->itemid, r2->itemid);
+	ZBX_RETURN_IF_NOT_EQUAL(r1->clock, r2->clock);
+	ZBX_RETURN_IF_NOT_EQUAL(r1->ns, r2->ns);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets sorted list of the time blocks present in storage            *
+ *                                                                            *
+ * Parameters: data   - [IN] the local storage data                           *
+ *             blocks - [OUT] the time block start timestamps                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	local_get_blocks(const zbx_local_data_t *data, zbx_vector_uint64_t *blocks)
+{
+	DIR		*dir;
+	struct dirent	*entry;
+	char		*end;
+	zbx_uint64_t	block;
+
+	if (NULL == (dir = opendir(data->path)))
+	{
+		if (ENOENT != errno)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot open directory \"%s\": %s", data->path,
+					zbx_strerror(errno));
+		}
+		return;
+	}
+
+	while (NULL != (entry = readdir(dir)))
+	{
+		if (0 == isdigit((unsigned char)entry->d_name[0]))
+			continue;
+
+		block = strtoull(entry->d_name, &end, 10);
+
+		if ('\0' == *end)
+			zbx_vector_uint64_append(blocks, block);
+	}
+
+	closedir(dir);
+
+	zbx_vector_uint64_sort(blocks, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: truncates incomplete chunk at the end of segment file             *
+ *                                                                            *
+ * Parameters: fd   - [IN] the segment file descriptor                        *
+ *             path - [IN] the segment file path                              *
+ *                                                                            *
+ * Return value: SUCCEED - the segment file ends with a complete chunk        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: A process terminated while writing leaves an incomplete chunk.   *
+ *           Readers stop at the first incomplete chunk, so it must be        *
+ *           removed before a process with the same pid appends new chunks.   *
+ *                                                                            *
+ ******************************************************************************/
+static int	local_segment_truncate(int fd, const char *path)
+{
+	zbx_local_chunk_head_t	head;
+	zbx_local_chunk_tail_t	tail;
+	zbx_stat_t		st;
+	size_t			offset, size;
+
+	if (0 != zbx_fstat(fd, &st))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot obtain information of file \"%s\": %s", path, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	for (offset = 0; offset < (size_t)st.st_size; offset += size)
+	{
+		if ((ssize_t)sizeof(head) != pread(fd, &head, sizeof(head), (off_t)offset) ||
+				ZBX_HISTORY_LOCAL_CHUNK_HEAD != head.magic)
+		{
+			break;
+		}
+
+		if ((size_t)st.st_size - offset < (size = local_chunk_size(head.count)))
+			break;
+
+		if ((ssize_t)sizeof(tail) != pread(fd, &tail, sizeof(tail), (off_t)(offset + size - sizeof(tail))) ||
+				ZBX_HISTORY_LOCAL_CHUNK_TAIL != tail.magic || tail.count != head.count)
+		{
+			break;
+		}
+	}
+
+	if (offset == (size_t)st.st_size)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_WARNING, "truncating incomplete chunk at offset " ZBX_FS_SIZE_T " of history segment"
+			" file \"%s\"", (zbx_fs_size_t)offset, path);
+
+	if (0 != ftruncate(fd, (off_t)offset))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot truncate file \"%s\": %s", path, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: opens segment file of the current process for the time block      *
+ *                                                                            *
+ * Parameters: data  - [IN] the local storage data                            *
+ *             block - [IN] the time block                                    *
+ *                                                                            *
+ * Return value: SUCCEED - the segment file was opened                        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	local_segment_open(zbx_local_data_t *data, int block)
+{
+	char	*path;
+	int	ret = FAIL;
+
+	if (-1 != data->fd)
+	{
+		if (data->block == block)
+			return SUCCEED;
+
+		close(data->fd);
+		data->fd = -1;
+	}
+
+	if (0 != mkdir(data->path, 0750) && EEXIST != errno)
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot create directory \"%s\": %s", data->path, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	path = zbx_dsprintf(NULL, "%s/%d", data->path, block);
+
+	if (0 != mkdir(path, 0750) && EEXIST != errno)
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot create directory \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	path = zbx_dsprintf(path, "%s/%d/%d" ZBX_HISTORY_LOCAL_SEGMENT_EXT, data->path, block, (int)getpid());
+
+	if (-1 == (data->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0640)))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot open file \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	if (SUCCEED != local_segment_truncate(data->fd, path))
+	{
+		close(data->fd);
+		data->fd = -1;
+		goto out;
+	}
+
+	data->block = block;
+	ret = SUCCEED;
+out:
+	zbx_free(path);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: appends records of a single time block as new chunk of segment    *
+ *          file                                                              *
+ *                                                                            *
+ * Parameters: data    - [IN] the local storage data                          *
+ *             records - [IN] the records sorted by itemid and timestamp      *
+ *             num     - [IN] the number of records                           *
+ *                                                                            *
+ * Return value: SUCCEED - the chunk was written                              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: On write failure the segment file is truncated back to its       *
+ *           previous size, so later chunks are not lost behind a broken one. *
+ *                                                                            *
+ ******************************************************************************/
+static int	local_segment_write(zbx_local_data_t *data, const zbx_local_record_t *records, int num)
+{
+	zbx_local_chunk_head_t	*head;
+	zbx_local_chunk_tail_t	*tail;
+	zbx_uint64_t		*itemids, *values;
+	int			*clocks, *ns, i, ret = FAIL;
+	char			*buf;
+	size_t			size, written = 0;
+	ssize_t			rc;
+	zbx_stat_t		st;
+
+	if (SUCCEED != local_segment_open(data, local_block(records[0].clock)))
+		return FAIL;
+
+	size = local_chunk_size((zbx_uint32_t)num);
+	buf = (char *)zbx_malloc(NULL, size);
+
+	head = (zbx_local_chunk_head_t *)buf;
+	itemids = (zbx_uint64_t *)(head + 1);
+	values = itemids + num;
+	clocks = (int *)(values + num);
+	ns = clocks + num;
+	tail = (zbx_local_chunk_tail_t *)(ns + num);
+
+	head->magic = ZBX_HISTORY_LOCAL_CHUNK_HEAD;
+	head->count = (zbx_uint32_t)num;
+	head->itemid_min = records[0].itemid;
+	head->itemid_max = records[num - 1].itemid;
+	head->clock_min = records[0].clock;
+	head->clock_max = records[0].clock;
+
+	for (i = 0; i < num; i++)
+	{
+		itemids[i] = records[i].itemid;
+		memcpy(&values[i], &records[i].value, sizeof(zbx_uint64_t));
+		clocks[i] = records[i].clock;
+		ns[i] = records[i].ns;
+
+		if (head->clock_min > clocks[i])
+			head->clock_min = clocks[i];
+
+		if (head->clock_max < clocks[i])
+			head->clock_max = clocks[i];
+	}
+
+	tail->magic = ZBX_HISTORY_LOCAL_CHUNK_TAIL;
+	tail->count = (zbx_uint32_t)num;
+
+	if (0 != zbx_fstat(data->fd, &st))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot obtain history segment file information: %s", zbx_strerror(errno));
+		goto out;
+	}
+
+	while (written < size)
+	{
+		if (-1 == (rc = write(data->fd, buf + written, size - written)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			zabbix_log(LOG_LEVEL_ERR, "cannot write to history segment file: %s", zbx_strerror(errno));
+
+			if (0 != ftruncate(data->fd, st.st_size))
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot truncate history segment file: %s",
+						zbx_strerror(errno));
+			}
+
+			close(data->fd);
+			data->fd = -1;
+			goto out;
+		}
+
+		written += (size_t)rc;
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_free(buf);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads item values from the memory mapped segment file             *
+ *                                                                            *
+ * Parameters: path    - [IN] the segment file path                           *
+ *             itemid  - [IN] the itemid                                      *
+ *             from    - [IN] the period start timestamp (excluding)          *
+ *             to      - [IN] the period end timestamp (including)            *
+ *             records - [OUT] the item values                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	local_segment_read(const char *path, zbx_uint64_t itemid, int from, int to,
+		zbx_vector_local_record_t *records)
+{
+	int				fd, lo, hi, mid;
+	zbx_stat_t			st;
+	void				*addr;
+	size_t				offset, size;
+	const zbx_local_chunk_head_t	*head;
+	const zbx_local_chunk_tail_t	*tail;
+	const zbx_uint64_t		*itemids, *values;
+	const int			*clocks, *ns;
+
+	if (-1 == (fd = open(path, O_RDONLY)))
+	{
+		/* the time block might have been dropped by housekeeper */
+		if (ENOENT != errno)
+			zabbix_log(LOG_LEVEL_WARNING, "cannot open file \"%s\": %s", path, zbx_strerror(errno));
+
+		return;
+	}
+
+	if (0 != zbx_fstat(fd, &st) || 0 == st.st_size)
+	{
+		close(fd);
+		return;
+	}
+
+	addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == addr)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot map file \"%s\": %s", path, zbx_strerror(errno));
+		return;
+	}
+
+	for (offset = 0; offset + sizeof(zbx_local_chunk_head_t) <= (size_t)st.st_size; offset += size)
+	{
+		head = (const zbx_local_chunk_head_t *)((const char *)addr + offset);
+
+		if (ZBX_HISTORY_LOCAL_CHUNK_HEAD != head->magic)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "invalid history segment file \"%s\" chunk at offset "
+					ZBX_FS_SIZE_T, path, (zbx_fs_size_t)offset);
+			break;
+		}
+
+		/* stop at chunk that is still being written */
+		if ((size_t)st.st_size - offset < (size = local_chunk_size(head->count)))
+			break;
+
+		tail = (const zbx_local_chunk_tail_t *)((const char *)head + size - sizeof(zbx_local_chunk_tail_t));
+
+		if (ZBX_HISTORY_LOCAL_CHUNK_TAIL != tail->magic || tail->count != head->count)
+			break;
+
+		if (itemid < head->itemid_min || itemid > head->itemid_max || head->clock_max <= from ||
+				head->clock_min > to)
+		{
+			continue;
+		}
+
+		itemids = (const zbx_uint64_t *)(head + 1);
+		values = itemids + head->count;
+		clocks = (const int *)(values + head->count);
+		ns = clocks + head->count;
+
+		/* find the first item record */
+		for (lo = 0, hi = (int)head->count; lo < hi;)
+		{
+			mid = lo + (hi - lo) / 2;
+
+			if (itemids[mid] < itemid)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for (; lo < (int)head->count && itemids[lo] == itemid; lo++)
+		{
+			zbx_local_record_t	record;
+
+			if (clocks[lo] <= from)
+				continue;
+
+			if (clocks[lo] > to)
+				break;
+
+			record.itemid = itemid;
+			memcpy(&record.value, &values[lo], sizeof(zbx_uint64_t));
+			record.clock = clocks[lo];
+			record.ns = ns[lo];
+
+			zbx_vector_local_record_append_ptr(records, &record);
+		}
+	}
+
+	munmap(addr, (size_t)st.st_size);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads item values from all segment files of the time block        *
+ *                                                                            *
+ * Parameters: data    - [IN] the local storage data                          *
+ *             block   - [IN] the time block                                  *
+ *             itemid  - [IN] the itemid                                      *
+ *             from    - [IN] the period start timestamp (excluding)          *
+ *             to      - [IN] the period end timestamp (including)            *
+ *             records - [OUT] the item values                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	local_block_read(const zbx_local_data_t *data, int block, zbx_uint64_t itemid, int from, int to,
+		zbx_vector_local_record_t *records)
+{
+	DIR		*dir;
+	struct dirent	*entry;
+	char		*path, *ext;
+
+	path = zbx_dsprintf(NULL, "%s/%d", data->path, block);
+
+	if (NULL == (dir = opendir(path)))
+	{
+		zbx_free(path);
+		return;
+	}
+
+	while (NULL != (entry = readdir(dir)))
+	{
+		if (NULL == (ext = strrchr(entry->d_name, '.')) || 0 != strcmp(ext, ZBX_HISTORY_LOCAL_SEGMENT_EXT))
+			continue;
+
+		path = zbx_dsprintf(path, "%s/%d/%s", data->path, block, entry->d_name);
+		local_segment_read(path, itemid, from, to, records);
+	}
+
+	closedir(dir);
+	zbx_free(path);
+}
+
+/******************************************************************************************************************
+ *                                                                                                                *
+ * history interface support                                                                                      *
+ *                                                                                                                *
+ ******************************************************************************************************************/
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: destroys history storage interface                                      *
+ *                                                                                  *
+ * Parameters:  hist    - [IN] the history storage interface                        *
+ *                                                                                  *
+ ************************************************************************************/
+static void	local_destroy(zbx_history_iface_t *hist)
+{
+	zbx_local_data_t	*data = (zbx_local_data_t *)hist->data;
+
+	if (-1 != data->fd)
+		close(data->fd);
+
+	zbx_vector_local_record_destroy(&data->records);
+	zbx_free(data->path);
+	zbx_free(data);
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: gets item history data from history storage                             *
+ *                                                                                  *
+ * Parameters:  hist    - [IN] the history storage interface                        *
+ *              itemid  - [IN] the itemid                                           *
+ *              start   - [IN] the period start timestamp                           *
+ *              count   - [IN] the number of values to read                         *
+ *              end     - [IN] the period end timestamp                             *
+ *              values  - [OUT] the item history data values                        *
+ *                                                                                  *
+ * Return value: SUCCEED - the history data were read successfully                  *
+ *               FAIL - otherwise                                                   *
+ *                                                                                  *
+ * Comments: This function reads <count> values from ]<start>,<end>] interval or    *
+ *           all values from the specified interval if count is zero. Like with SQL *
+ *           storage all values of the last returned second are included.           *
+ *                                                                                  *
+ *           Time blocks are read from the newest to the oldest until the requested *
+ *           number of values is found, the values are returned sorted by           *
+ *           timestamp in descending order.                                         *
+ *                                                                                  *
+ ************************************************************************************/
+static int	local_get_values(zbx_history_iface_t *hist, zbx_uint64_t itemid, int start, int count, int end,
+		zbx_vector_history_record_t *values)
+{
+	zbx_local_data_t		*data = (zbx_local_data_t *)hist->data;
+	zbx_vector_uint64_t		blocks;
+	zbx_vector_local_record_t	records;
+	int				i, j, block;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " start:%d count:%d end:%d", __func__, itemid,
+			start, count, end);
+
+	zbx_vector_uint64_create(&blocks);
+	zbx_vector_local_record_create(&records);
+
+	local_get_blocks(data, &blocks);
+
+	for (i = blocks.values_num - 1; 0 <= i; i--)
+	{
+		block = (int)blocks.values[i];
+
+		if (block > end)
+			continue;
+
+		if (block + ZBX_HISTORY_LOCAL_BLOCK_PERIOD <= start)
+			break;
+
+		/* older blocks contain only older values, so the whole block can be read before */
+		/* checking whether enough values were found                                      */
+		local_block_read(data, block, itemid, start, end, &records);
+
+		if (0 != count && count <= records.values_num)
+			break;
+	}
+
+	zbx_vector_local_record_sort(&records, local_record_compare);
+
+	/* records are sorted in ascending order, return the newest values */
+	i = 0;
+
+	if (0 != count && count < records.values_num)
+	{
+		block = records.values[records.values_num - count].clock;
+
+		for (i = records.values_num - count; 0 < i && records.values[i - 1].clock == block; i--)
+			;
+	}
+
+	zbx_vector_history_record_reserve(values, (size_t)(values->values_num + records.values_num - i));
+
+	for (j = records.values_num - 1; j >= i; j--)
+	{
+		zbx_history_record_t	value;
+
+		value.timestamp.sec = records.values[j].clock;
+		value.timestamp.ns = records.values[j].ns;
+		value.value = records.values[j].value;
+
+		zbx_vector_history_record_append_ptr(values, &value);
+	}
+
+	zbx_vector_local_record_destroy(&records);
+	zbx_vector_uint64_destroy(&blocks);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() values:%d", __func__, values->values_num);
+
+	return SUCCEED;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: sends history data to the storage                                       *
+ *                                                                                  *
+ * Parameters:  hist    - [IN] the history storage interface                        *
+ *              history - [IN] the history data vector (may have mixed value types) *
+ *                                                                                  *
+ ************************************************************************************/
+static int	local_add_values(zbx_history_iface_t *hist, const zbx_vector_ptr_t *history)
+{
+	zbx_local_data_t	*data = (zbx_local_data_t *)hist->data;
+	int			i, num = 0;
+
+	for (i = 0; i < history->values_num; i++)
+	{
+		const ZBX_DC_HISTORY	*h = (ZBX_DC_HISTORY *)history->values[i];
+		zbx_local_record_t	record;
+
+		if (h->value_type != hist->value_type)
+			continue;
+
+		record.itemid = h->itemid;
+		record.value = h->value;
+		record.clock = h->ts.sec;
+		record.ns = h->ts.ns;
+
+		zbx_vector_local_record_append_ptr(&data->records, &record);
+		num++;
+	}
+
+	return num;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: flushes the history data to storage                                     *
+ *                                                                                  *
+ * Parameters:  hist    - [IN] the history storage interface                        *
+ *                                                                                  *
+ * Comments: Values are written as one chunk per time block. Values that cannot be  *
+ *           written are discarded.                                                 *
+ *                                                                                  *
+ ************************************************************************************/
+static int	local_flush(zbx_history_iface_t *hist)
+{
+	zbx_local_data_t	*data = (zbx_local_data_t *)hist->data;
+	zbx_local_record_t	*records = data->records.values;
+	int			i, j, ret = FLUSH_SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() values:%d", __func__, data->records.values_num);
+
+	zbx_vector_local_record_sort(&data->records, local_record_compare);
+
+	for (i = 0; i < data->records.values_num; i = j)
+	{
+		for (j = i + 1; j < data->records.values_num &&
+				local_block(records[j].clock) == local_block(records[i].clock); j++)
+			;
+
+		if (SUCCEED != local_segment_write(data, records + i, j - i))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "%d %s history values were not written to local storage",
+					j - i, local_type_str[hist->value_type]);
+			ret = FLUSH_FAIL;
+		}
+	}
+
+	zbx_vector_local_record_clear(&data->records);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+
+	return ret;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: removes expired history from storage                                    *
+ *                                                                                  *
+ * Parameters:  hist      - [IN] the history storage interface                      *
+ *              keep_from - [IN] the timestamp of the oldest value to keep          *
+ *                                                                                  *
+ * Return value: The number of removed time blocks.                                 *
+ *                                                                                  *
+ * Comments: Only time blocks with all values older than keep_from are removed.     *
+ *                                                                                  *
+ ************************************************************************************/
+static int	local_housekeep(zbx_history_iface_t *hist, int keep_from)
+{
+	zbx_local_data_t	*data = (zbx_local_data_t *)hist->data;
+	zbx_vector_uint64_t	blocks;
+	DIR			*dir;
+	struct dirent		*entry;
+	char			*path = NULL;
+	int			i, block, removed = 0;
+
+	zbx_vector_uint64_create(&blocks);
+
+	local_get_blocks(data, &blocks);
+
+	for (i = 0; i < blocks.values_num; i++)
+	{
+		block = (int)blocks.values[i];
+
+		if (block + ZBX_HISTORY_LOCAL_BLOCK_PERIOD > keep_from)
+			break;
+
+		path = zbx_dsprintf(path, "%s/%d", data->path, block);
+
+		if (NULL == (dir = opendir(path)))
+			continue;
+
+		while (NULL != (entry = readdir(dir)))
+		{
+			if ('.' == entry->d_name[0])
+				continue;
+
+			path = zbx_dsprintf(path, "%s/%d/%s", data->path, block, entry->d_name);
+
+			if (0 != unlink(path))
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "cannot remove file \"%s\": %s", path,
+						zbx_strerror(errno));
+			}
+		}
+
+		closedir(dir);
+
+		path = zbx_dsprintf(path, "%s/%d", data->path, block);
+
+		if (0 != rmdir(path))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot remove directory \"%s\": %s", path, zbx_strerror(errno));
+			continue;
+		}
+
+		removed++;
+	}
+
+	zbx_free(path);
+	zbx_vector_uint64_destroy(&blocks);
+
+	return removed;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: initializes history storage interface                                   *
+ *                                                                                  *
+ * Parameters:  hist       - [IN] the history storage interface                     *
+ *              value_type - [IN] the target value type                             *
+ *              error      - [OUT] the error message                                *
+ *                                                                                  *
+ * Return value: SUCCEED - the history storage interface was initialized            *
+ *               FAIL    - otherwise                                                *
+ *                                                                                  *
+ ************************************************************************************/
+int	zbx_history_local_init(zbx_history_iface_t *hist, unsigned char value_type, char **error)
+{
+	zbx_local_data_t	*data;
+
+	if (ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type)
+	{
+		*error = zbx_dsprintf(*error, "local history storage does not support \"%s\" values",
+				local_type_str[value_type]);
+		return FAIL;
+	}
+
+	if (0 != access(CONFIG_HISTORY_STORAGE_DIR, W_OK | X_OK))
+	{
+		*error = zbx_dsprintf(*error, "cannot access history storage directory \"%s\": %s",
+				CONFIG_HISTORY_STORAGE_DIR, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	data = (zbx_local_data_t *)zbx_malloc(NULL, sizeof(zbx_local_data_t));
+	data->path = zbx_strdup(NULL, CONFIG_HISTORY_STORAGE_DIR);
+	zbx_rtrim(data->path, "/");
+	data->path = zbx_dsprintf(data->path, "%s/%s", data->path, local_type_str[value_type]);
+	zbx_vector_local_record_create(&data->records);
+	data->fd = -1;
+	data->block = 0;
+
+	hist->value_type = value_type;
+	hist->data = data;
+	hist->destroy = local_destroy;
+	hist->add_values = local_add_values;
+	hist->flush = local_flush;
+	hist->get_values = local_get_values;
+	hist->housekeep = local_housekeep;
+	hist->requires_trends = 1;
+
+	return SUCCEED;
+}
@@ -83,6 +83,29 @@
  *  lo_bound             `size' fields in chunk B                   hi_bound  *
  *  (aligned)            have MEM_FLG_USED bit set                 (aligned)  *
  *                                                                            *
+ * (*) slab: a used chunk split into MEM_SLAB_OBJECTS objects of equal size   *
+ *                                                                            *
+ *     allocations up to MEM_SLAB_MAX_ALLOC bytes are served from slabs of    *
+ *     the matching size class, each class keeping a list of slabs that have  *
+ *     free objects                                                           *
+ *                                                                            *
+ *                +- slab header -+--- object ---+--- object ---+...          *
+ *                |               |              |              |             *
+ *                v               v              v              v             *
+ *                                                                            *
+ *                |---------------|----|---------|----|---------|...          *
+ *                                                                            *
+ *                                  ^                                         *
+ *                                  |                                         *
+ *          object header (8 bytes): MEM_FLG_SLAB bit, MEM_FLG_USED bit       *
+ *          when the object is used and the offset of object from slab        *
+ *                                                                            *
+ *     when an object is free, the first ZBX_PTR_SIZE bytes of its            *
+ *     allocatable memory contain pointer to the next free object in slab     *
+ *                                                                            *
+ *     object header is placed where chunk `size' field would be, so the      *
+ *     public interface can tell slab objects from chunks by MEM_FLG_SLAB bit *
+ *                                                                            *
  ******************************************************************************/
 
 static void	*ALIGN4(void *ptr);
@@ -109,6 +132,13 @@ static void	*__mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size);
 static void	*__mem_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size);
 static void	__mem_free(zbx_mem_info_t *info, void *ptr);
 
+static void	*mem_slab_malloc(zbx_mem_info_t *info, zbx_uint64_t size);
+static void	*mem_slab_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size);
+static void	mem_slab_free(zbx_mem_info_t *info, void *ptr);
+static void	*mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size);
+
+static int	mem_huge_pages = 0;
+
 #define MEM_SIZE_FIELD		sizeof(zbx_uint64_t)
 
 #define MEM_FLG_USED		((__UINT64_C(1))<<63)
@@ -119,6 +149,36 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr);
 #define MEM_MIN_SIZE		__UINT64_C(128)
 #define MEM_MAX_SIZE		__UINT64_C(0x1000000000)	/* 64 GB */
 
+#define MEM_FLG_SLAB		((__UINT64_C(1))<<62)
+#define MEM_SLAB_OFFSET_MASK	(MEM_FLG_SLAB - 1)
+
+#define SLAB_OBJECT(ptr)	(((*(zbx_uint64_t *)(ptr)) & MEM_FLG_SLAB) != 0)
+
+#define MEM_SLAB_OBJECTS	32
+
+/* slabs are used only in caches large enough to make unused slab space negligible */
+#define MEM_SLAB_MIN_TOTAL_SIZE	(4 * ZBX_MEBIBYTE)
+
+#define MEM_SLAB_CLASS_BY_SIZE(size)	((int)(((size) - 1) >> 3))
+#define MEM_SLAB_OBJECT_SIZE(index)	(MEM_SIZE_FIELD + ((zbx_uint64_t)(index) + 1) * 8)
+#define MEM_SLAB_HEADER_SIZE		((sizeof(zbx_mem_slab_t) + 7) & ~(size_t)7)
+
+typedef struct zbx_mem_slab
+{
+	struct zbx_mem_slab	*prev;
+	struct zbx_mem_slab	*next;
+
+	/* the freed objects */
+	void			*free_objects;
+
+	int			class_index;
+	int			used_num;
+
+	/* the number of objects at the end of slab that were never allocated */
+	int			unused_num;
+}
+zbx_mem_slab_t;
+
 /* helper functions */
 
 static void	*ALIGN4(void *ptr)
@@ -525,13 +585,296 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr)
 	}
 }
 
+/* private slab functions */
+
+static void	mem_slab_link(zbx_mem_slab_class_t *slab_class, zbx_mem_slab_t *slab)
+{
+	slab->prev = NULL;
+	slab->next = (zbx_mem_slab_t *)slab_class->slabs;
+
+	if (NULL != slab->next)
+		slab->next->prev = slab;
+
+	slab_class->slabs = slab;
+}
+
+static void	mem_slab_unlink(zbx_mem_slab_class_t *slab_class, zbx_mem_slab_t *slab)
+{
+	if (NULL != slab->prev)
+		slab->prev->next = slab->next;
+	else
+		slab_class->slabs = slab->next;
+
+	if (NULL != slab->next)
+		slab->next->prev = slab->prev;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: allocate a new slab for the specified size class                  *
+ *                                                                            *
+ * Comments: Memory of unallocated slab objects is accounted as free slab     *
+ *           memory, it is not available for allocations of other sizes.      *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_mem_slab_t	*mem_slab_create(zbx_mem_info_t *info, int index)
+{
+	void		*chunk;
+	zbx_mem_slab_t	*slab;
+	zbx_uint64_t	objects_size = MEM_SLAB_OBJECTS * MEM_SLAB_OBJECT_SIZE(index);
+
+	if (NULL == (chunk = __mem_malloc(info, MEM_SLAB_HEADER_SIZE + objects_size)))
+		return NULL;
+
+	info->used_size -= objects_size;
+	info->slab_free_size += objects_size;
+
+	slab = (zbx_mem_slab_t *)((char *)chunk + MEM_SIZE_FIELD);
+	slab->free_objects = NULL;
+	slab->class_index = index;
+	slab->used_num = 0;
+	slab->unused_num = MEM_SLAB_OBJECTS;
+
+	mem_slab_link(&info->slab_classes[index], slab);
+	info->slab_classes[index].slabs_num++;
+	info->slab_classes[index].objects_num += MEM_SLAB_OBJECTS;
+
+	return slab;
+}
+
+static void	mem_slab_destroy(zbx_mem_info_t *info, zbx_mem_slab_t *slab)
+{
+	zbx_mem_slab_class_t	*slab_class = &info->slab_classes[slab->class_index];
+	zbx_uint64_t		objects_size = MEM_SLAB_OBJECTS * MEM_SLAB_OBJECT_SIZE(slab->class_index);
+
+	mem_slab_unlink(slab_class, slab);
+	slab_class->slabs_num--;
+	slab_class->objects_num -= MEM_SLAB_OBJECTS;
+
+	info->used_size += objects_size;
+	info->slab_free_size -= objects_size;
+
+	__mem_free(info, slab);
+}
+
+static void	*mem_slab_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	int			index = MEM_SLAB_CLASS_BY_SIZE(size);
+	zbx_mem_slab_class_t	*slab_class = &info->slab_classes[index];
+	zbx_mem_slab_t		*slab;
+	zbx_uint64_t		object_size = MEM_SLAB_OBJECT_SIZE(index);
+	void			*object;
+
+	if (NULL == (slab = (zbx_mem_slab_t *)slab_class->slabs) && NULL == (slab = mem_slab_create(info, index)))
+		return NULL;
+
+	if (NULL != slab->free_objects)
+	{
+		object = slab->free_objects;
+		slab->free_objects = *(void **)((char *)object + MEM_SIZE_FIELD);
+	}
+	else
+	{
+		object = (char *)slab + MEM_SLAB_HEADER_SIZE + (MEM_SLAB_OBJECTS - slab->unused_num) * object_size;
+		slab->unused_num--;
+	}
+
+	*(zbx_uint64_t *)object = MEM_FLG_USED | MEM_FLG_SLAB | (zbx_uint64_t)((char *)object - (char *)slab);
+
+	slab->used_num++;
+	slab_class->used_num++;
+
+	if (NULL == slab->free_objects && 0 == slab->unused_num)
+		mem_slab_unlink(slab_class, slab);
+
+	info->used_size += object_size;
+	info->slab_free_size -= object_size;
+
+	return object;
+}
+
+static void	mem_slab_free(zbx_mem_info_t *info, void *ptr)
+{
+	void			*object;
+	zbx_mem_slab_t		*slab;
+	zbx_mem_slab_class_t	*slab_class;
+	zbx_uint64_t		object_size;
+	int			full;
+
+	object = (void *)((char *)ptr - MEM_SIZE_FIELD);
+	slab = (zbx_mem_slab_t *)((char *)object - (*(zbx_uint64_t *)object & MEM_SLAB_OFFSET_MASK));
+	slab_class = &info->slab_classes[slab->class_index];
+	object_size = MEM_SLAB_OBJECT_SIZE(slab->class_index);
+
+	full = (NULL == slab->free_objects && 0 == slab->unused_num);
+
+	*(zbx_uint64_t *)object &= ~MEM_FLG_USED;
+	*(void **)ptr = slab->free_objects;
+	slab->free_objects = object;
+
+	slab->used_num--;
+	slab_class->used_num--;
+
+	info->used_size -= object_size;
+	info->slab_free_size += object_size;
+
+	if (0 != full)
+		mem_slab_link(slab_class, slab);
+
+	/* keep one empty slab per class to avoid creating and destroying slabs on every allocation */
+	if (0 == slab->used_num && (slab_class->slabs != slab || NULL != slab->next))
+		mem_slab_destroy(info, slab);
+}
+
+static void	*mem_slab_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size)
+{
+	void		*object;
+	zbx_mem_slab_t	*slab;
+	zbx_uint64_t	old_size;
+
+	object = (void *)((char *)old - MEM_SIZE_FIELD);
+	slab = (zbx_mem_slab_t *)((char *)object - (*(zbx_uint64_t *)object & MEM_SLAB_OFFSET_MASK));
+
+	if (size <= MEM_SLAB_MAX_ALLOC && MEM_SLAB_CLASS_BY_SIZE(size) == slab->class_index)
+		return object;
+
+	if (NULL == (object = mem_malloc(info, size)))
+		return NULL;
+
+	old_size = MEM_SLAB_OBJECT_SIZE(slab->class_index) - MEM_SIZE_FIELD;
+	memcpy((char *)object + MEM_SIZE_FIELD, old, MIN(old_size, size));
+
+	mem_slab_free(info, old);
+
+	return object;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: allocate memory from slab if possible, otherwise from chunks      *
+ *                                                                            *
+ ******************************************************************************/
+static void	*mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	void	*chunk;
+
+	if (NULL != info->slab_classes && size <= MEM_SLAB_MAX_ALLOC && NULL != (chunk = mem_slab_malloc(info, size)))
+		return chunk;
+
+	return __mem_malloc(info, size);
+}
+
+static void	mem_slab_clear(zbx_mem_info_t *info)
+{
+	if (NULL != info->slab_classes)
+		memset(info->slab_classes, 0, MEM_SLAB_CLASS_COUNT * sizeof(zbx_mem_slab_class_t));
+}
+
+#ifdef SHM_HUGETLB
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get default huge page size                                        *
+ *                                                                            *
+ * Return value: huge page size in bytes or 0 if huge pages are not supported *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	mem_get_huge_page_size(void)
+{
+	FILE		*f;
+	char		line[MAX_STRING_LEN];
+	zbx_uint64_t	page_size = 0;
+
+	if (NULL == (f = fopen("/proc/meminfo", "r")))
+		return 0;
+
+	while (NULL != fgets(line, sizeof(line), f))
+	{
+		if (1 == sscanf(line, "Hugepagesize: " ZBX_FS_UI64 " kB", &page_size))
+		{
+			page_size *= ZBX_KIBIBYTE;
+			break;
+		}
+	}
+
+	zbx_fclose(f);
+
+	return page_size;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get private shared memory segment, backed by huge pages if        *
+ *          enabled and available                                             *
+ *                                                                            *
+ * Parameters: size      - [IN] the requested segment size                    *
+ *             descr     - [IN] the segment description for logging           *
+ *             page_size - [OUT] the size of memory pages backing segment     *
+ *                                                                            *
+ * Return value: shared memory identifier or -1 on failure                    *
+ *                                                                            *
+ * Comments: When huge pages cannot be used the segment is allocated with     *
+ *           regular pages.                                                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	mem_shm_create(zbx_uint64_t size, const char *descr, zbx_uint64_t *page_size)
+{
+#ifdef SHM_HUGETLB
+	if (0 != mem_huge_pages)
+	{
+		zbx_uint64_t	huge_page_size;
+		int		shm_id;
+
+		if (0 == (huge_page_size = mem_get_huge_page_size()))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot use huge pages for %s: huge pages are not supported",
+					descr);
+		}
+		else if (-1 == (shm_id = shmget(IPC_PRIVATE, (size + huge_page_size - 1) & ~(huge_page_size - 1),
+				SHM_HUGETLB | 0600)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot use huge pages for %s: %s", descr, zbx_strerror(errno));
+		}
+		else
+		{
+			*page_size = huge_page_size;
+			return shm_id;
+		}
+	}
+#else
+	if (0 != mem_huge_pages)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot use huge pages for %s: huge pages are not supported on this"
+				" platform", descr);
+	}
+#endif
+	*page_size = (zbx_uint64_t)sysconf(_SC_PAGESIZE);
+
+	return shmget(IPC_PRIVATE, size, 0600);
+}
+
 /* public memory interface */
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: enable huge page backing for shared memory segments created      *
+ *          afterwards                                                        *
+ *                                                                            *
+ * Parameters: huge_pages - [IN] 1 - try to use huge pages, 0 - use regular   *
+ *                               pages                                        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_set_huge_pages(int huge_pages)
+{
+	mem_huge_pages = huge_pages;
+}
+
 int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr, const char *param, int allow_oom,
 		char **error)
 {
-	int	shm_id, index, ret = FAIL;
-	void	*base;
+	int		shm_id, index, ret = FAIL;
+	void		*base;
+	zbx_uint64_t	page_size;
 
 	descr = ZBX_NULL2STR(descr);
 	param = ZBX_NULL2STR(param);
@@ -554,7 +897,7 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 		goto out;
 	}
 
-	if (-1 == (shm_id = shmget(IPC_PRIVATE, size, 0600)))
+	if (-1 == (shm_id = mem_shm_create(size, descr, &page_size)))
 	{
 		*error = zbx_dsprintf(*error, "cannot get private shared memory of size " ZBX_FS_SIZE_T " for %s: %s",
 				(zbx_fs_size_t)size, descr, zbx_strerror(errno));
@@ -578,6 +921,7 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 	(*info)->base = base;
 	(*info)->shm_id = shm_id;
 	(*info)->orig_size = size;
+	(*info)->page_size = page_size;
 	size -= (char *)(*info + 1) - (char *)base;
 
 	base = (void *)(*info + 1);
@@ -587,6 +931,11 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 	size -= (char *)((*info)->buckets + MEM_BUCKET_COUNT) - (char *)base;
 	base = (void *)((*info)->buckets + MEM_BUCKET_COUNT);
 
+	(*info)->slab_classes = (zbx_mem_slab_class_t *)ALIGN8(base);
+	memset((*info)->slab_classes, 0, MEM_SLAB_CLASS_COUNT * sizeof(zbx_mem_slab_class_t));
+	size -= (char *)((*info)->slab_classes + MEM_SLAB_CLASS_COUNT) - (char *)base;
+	base = (void *)((*info)->slab_classes + MEM_SLAB_CLASS_COUNT);
+
 	zbx_strlcpy((char *)base, descr, size);
 	(*info)->mem_descr = (char *)base;
 	size -= strlen(descr) + 1;
@@ -614,6 +963,10 @@ int	zbx_mem_create(zbx_mem_info_t **info, zbx_uint64_t size, const char *descr,
 
 	(*info)->used_size = 0;
 	(*info)->free_size = (*info)->total_size;
+	(*info)->slab_free_size = 0;
+
+	if (MEM_SLAB_MIN_TOTAL_SIZE > (*info)->total_size)
+		(*info)->slab_classes = NULL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "valid user addresses: [%p, %p] total size: " ZBX_FS_SIZE_T,
 			(void *)((char *)(*info)->lo_bound + MEM_SIZE_FIELD),
@@ -648,7 +1001,7 @@ void	*__zbx_mem_malloc(const char *file, int line, zbx_mem_info_t *info, const v
 		exit(EXIT_FAILURE);
 	}
 
-	chunk = __mem_malloc(info, size);
+	chunk = mem_malloc(info, size);
 
 	if (NULL == chunk)
 	{
@@ -679,7 +1032,9 @@ void	*__zbx_mem_realloc(const char *file, int line, zbx_mem_info_t *info, void *
 	}
 
 	if (NULL == old)
-		chunk = __mem_malloc(info, size);
+		chunk = mem_malloc(info, size);
+	else if (SLAB_OBJECT((char *)old - MEM_SIZE_FIELD))
+		chunk = mem_slab_realloc(info, old, size);
 	else
 		chunk = __mem_realloc(info, old, size);
 
@@ -708,7 +1063,10 @@ void	__zbx_mem_free(const char *file, int line, zbx_mem_info_t *info, void *ptr)
 		exit(EXIT_FAILURE);
 	}
 
-	__mem_free(info, ptr);
+	if (SLAB_OBJECT((char *)ptr - MEM_SIZE_FIELD))
+		mem_slab_free(info, ptr);
+	else
+		__mem_free(info, ptr);
 }
 
 void	zbx_mem_clear(zbx_mem_info_t *info)
@@ -725,6 +1083,8 @@ void	zbx_mem_clear(zbx_mem_info_t *info)
 	mem_set_next_chunk(info->buckets[index], NULL);
 	info->used_size = 0;
 	info->free_size = info->total_size;
+	info->slab_free_size = 0;
+	mem_slab_clear(info);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -756,10 +1116,32 @@ void	zbx_mem_get_stats(const zbx_mem_info_t *info, zbx_mem_stats_t *stats)
 		stats->chunks_num[i] = counter;
 	}
 
-	stats->overhead = info->total_size - info->used_size - info->free_size;
+	stats->overhead = info->total_size - info->used_size - info->free_size - info->slab_free_size;
 	stats->used_chunks = stats->overhead / (2 * MEM_SIZE_FIELD) + 1 - stats->free_chunks;
 	stats->free_size = info->free_size;
 	stats->used_size = info->used_size;
+	stats->slab_free_size = info->slab_free_size;
+	stats->page_size = info->page_size;
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		if (NULL == info->slab_classes)
+		{
+			stats->slabs_num[i] = 0;
+			stats->slab_objects_num[i] = 0;
+			stats->slab_used_num[i] = 0;
+			continue;
+		}
+
+		stats->slabs_num[i] = (unsigned int)info->slab_classes[i].slabs_num;
+		stats->slab_objects_num[i] = (unsigned int)info->slab_classes[i].objects_num;
+		stats->slab_used_num[i] = (unsigned int)info->slab_classes[i].used_num;
+	}
+
+	if (0 != stats->free_size && 0 != stats->free_chunks)
+		stats->fragmentation = 100 * (double)(stats->free_size - stats->max_chunk_size) / stats->free_size;
+	else
+		stats->fragmentation = 0;
 }
 
 void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
@@ -770,6 +1152,7 @@ void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
 	zbx_mem_get_stats(info, &stats);
 
 	zabbix_log(level, "=== memory statistics for %s ===", info->mem_descr);
+	zabbix_log(level, "memory page size: %llu bytes", (unsigned long long)stats.page_size);
 
 	for (i = 0; i < MEM_BUCKET_COUNT; i++)
 	{
@@ -782,12 +1165,24 @@ void	zbx_mem_dump_stats(int level, zbx_mem_info_t *info)
 
 	zabbix_log(level, "min chunk size: %10llu bytes", (unsigned long long)stats.min_chunk_size);
 	zabbix_log(level, "max chunk size: %10llu bytes", (unsigned long long)stats.max_chunk_size);
+	zabbix_log(level, "free chunk fragmentation: %.2f%%", stats.fragmentation);
+
+	for (i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+	{
+		if (0 == stats.slabs_num[i])
+			continue;
+
+		zabbix_log(level, "slabs of %3d byte objects: %8u, objects used: %8u of %8u", 8 * (i + 1),
+				stats.slabs_num[i], stats.slab_used_num[i], stats.slab_objects_num[i]);
+	}
 
 	zabbix_log(level, "memory of total size %llu bytes fragmented into %llu chunks",
-			(unsigned long long)stats.free_size + stats.used_size,
+			(unsigned long long)stats.free_size + stats.slab_free_size + stats.used_size,
 			(unsigned long long)stats.free_chunks + stats.used_chunks);
 	zabbix_log(level, "of those, %10llu bytes are in %8llu free chunks",
 			(unsigned long long)stats.free_size, (unsigned long long)stats.free_chunks);
+	zabbix_log(level, "of those, %10llu bytes are in free slab objects",
+			(unsigned long long)stats.slab_free_size);
 	zabbix_log(level, "of those, %10llu bytes are in %8llu used chunks",
 			(unsigned long long)stats.used_size, (unsigned long long)stats.used_chunks);
 	zabbix_log(level, "of those, %10llu bytes are used by allocation overhead",
@@ -811,6 +1206,8 @@ size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *para
 	size += sizeof(zbx_mem_info_t);
 	size += ZBX_PTR_SIZE - 1;			/* ensure we allocate enough to align bucket pointers */
 	size += ZBX_PTR_SIZE * MEM_BUCKET_COUNT;
+	size += 7;					/* ensure we allocate enough to 8-align slab classes */
+	size += sizeof(zbx_mem_slab_class_t) * MEM_SLAB_CLASS_COUNT;
 	size += strlen(descr) + 1;
 	size += strlen(param) + 1;
 	size += (MEM_SIZE_FIELD - 1) + 8;		/* ensure we allocate enough to align the first chunk */
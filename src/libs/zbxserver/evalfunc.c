@@ -1392,6 +1392,27 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_ITEM *item, const char *param
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	/* plain count of numeric values in time period does not need the values themselves */
+	if (ZBX_VALUE_SECONDS == arg1_type && COUNT_UNIQUE != unique && '\0' == *pattern &&
+			(NULL == operator || '\0' == *operator) &&
+			(ITEM_VALUE_TYPE_UINT64 == item->value_type || ITEM_VALUE_TYPE_FLOAT == item->value_type))
+	{
+		zbx_vc_aggregate_t	aggregate;
+
+		if (FAIL == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		if ((count = aggregate.count) > limit)
+			count = limit;
+
+		zbx_variant_set_dbl(value, count);
+		ret = SUCCEED;
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1580,6 +1601,21 @@ static int	evaluate_SUM(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type)
+	{
+		zbx_vc_aggregate_t	aggregate;
+
+		if (FAIL == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		zbx_history_value2variant(&aggregate.sum, item->value_type, value);
+		ret = SUCCEED;
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1671,6 +1707,38 @@ static int	evaluate_AVG(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type)
+	{
+		zbx_vc_aggregate_t	aggregate;
+
+		if (FAIL == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		/* fall back to summing values one by one if unsigned sum has overflowed */
+		if (0 == aggregate.sum_overflow)
+		{
+			if (0 < aggregate.count)
+			{
+				if (ITEM_VALUE_TYPE_FLOAT == item->value_type)
+					zbx_variant_set_dbl(value, aggregate.sum.dbl / aggregate.count);
+				else
+					zbx_variant_set_dbl(value, (double)aggregate.sum.ui64 / aggregate.count);
+
+				ret = SUCCEED;
+			}
+			else
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "result for AVG is empty");
+				*error = zbx_strdup(*error, "not enough data");
+			}
+
+			goto out;
+		}
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1803,6 +1871,30 @@ static int	evaluate_MIN(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type)
+	{
+		zbx_vc_aggregate_t	aggregate;
+
+		if (FAIL == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		if (0 < aggregate.count)
+		{
+			zbx_history_value2variant(&aggregate.min, item->value_type, value);
+			ret = SUCCEED;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "result for MIN is empty");
+			*error = zbx_strdup(*error, "not enough data");
+		}
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1906,6 +1998,30 @@ static int	evaluate_MAX(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type)
+	{
+		zbx_vc_aggregate_t	aggregate;
+
+		if (FAIL == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+		{
+			*error = zbx_strdup(*error, "cannot get values from value cache");
+			goto out;
+		}
+
+		if (0 < aggregate.count)
+		{
+			zbx_history_value2variant(&aggregate.max, item->value_type, value);
+			ret = SUCCEED;
+		}
+		else
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "result for MAX is empty");
+			*error = zbx_strdup(*error, "not enough data");
+		}
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -2690,13 +2806,31 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the trend hours of STL decomposition                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_stl_get_ranges(int start, int end, zbx_vector_trend_range_t *ranges)
+{
+	zbx_trend_range_t	range;
+
+	for (range.start = start; range.start <= end; range.start += SEC_PER_HOUR)
+	{
+		range.end = range.start;
+		zbx_vector_trend_range_append(ranges, range);
+	}
+}
+
 static int	trends_eval_stl(const char *table, zbx_uint64_t itemid, int start, int end, int start_detect_period,
 		int end_detect_period, int season, double deviations, const char *dev_alg, int s_window,
 		double *value, char **error)
 {
-	int				i, period_counter, ret = FAIL;
-	double				tmp_res, neighboring_right_value, neighboring_left_value = ZBX_INFINITY;
+	int				i, ret = FAIL;
+	double				neighboring_right_value, neighboring_left_value = ZBX_INFINITY, *avgs;
 	zbx_vector_history_record_t	values, trend, seasonal, remainder;
+	zbx_vector_trend_range_t	ranges;
+	zbx_trend_state_t		*states;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -2704,26 +2838,37 @@ static int	trends_eval_stl(const char *table, zbx_uint64_t itemid, int start, in
 	zbx_history_record_vector_create(&trend);
 	zbx_history_record_vector_create(&seasonal);
 	zbx_history_record_vector_create(&remainder);
+	zbx_vector_trend_range_create(&ranges);
+
+	trends_stl_get_ranges(start, end, &ranges);
 
-	for (period_counter = start; period_counter <= end; period_counter += 3600)
+	/* get all hourly averages at once, trends missing from cache are selected with a single query */
+	avgs = (double *)zbx_malloc(NULL, sizeof(double) * (size_t)(ranges.values_num + 1));
+	states = (zbx_trend_state_t *)zbx_malloc(NULL, sizeof(zbx_trend_state_t) * (size_t)(ranges.values_num + 1));
+	zbx_trends_get_avgs(table, itemid, &ranges, avgs, states);
+
+	for (i = 0; i < ranges.values_num; i++)
 	{
 		zbx_history_record_t	val;
 
-		val.timestamp.sec = period_counter;
+		val.timestamp.sec = ranges.values[i].start;
 
-		if (FAIL == zbx_trends_eval_avg(table, itemid, period_counter, period_counter, &tmp_res, NULL))
+		if (ZBX_TREND_STATE_NORMAL != states[i])
 		{
 			val.value.dbl = neighboring_left_value;
 		}
 		else
 		{
-			val.value.dbl = tmp_res;
-			neighboring_left_value = tmp_res;
+			val.value.dbl = avgs[i];
+			neighboring_left_value = avgs[i];
 		}
 
 		zbx_vector_history_record_append_ptr(&values, &val);
 	}
 
+	zbx_free(states);
+	zbx_free(avgs);
+
 	if (ZBX_INFINITY == neighboring_left_value)
 	{
 		*error = zbx_strdup(*error, "all data is empty");
@@ -2754,6 +2899,7 @@ out:
 	zbx_history_record_vector_destroy(&seasonal, ITEM_VALUE_TYPE_FLOAT);
 	zbx_history_record_vector_destroy(&remainder, ITEM_VALUE_TYPE_FLOAT);
 	zbx_history_record_vector_destroy(&values, ITEM_VALUE_TYPE_FLOAT);
+	zbx_vector_trend_range_destroy(&ranges);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
@@ -3575,6 +3721,59 @@ out:
 #undef PREV
 #undef LAST
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parse baseline* function parameters                               *
+ *                                                                            *
+ * Parameters: parameters  - [IN] function parameters                         *
+ *             period      - [OUT] the data period                            *
+ *             season_unit - [OUT] the season time unit                       *
+ *             season_num  - [OUT] the number of seasons                      *
+ *             error       - [OUT] the error message                          *
+ *                                                                            *
+ * Return value: SUCCEED - parameters were parsed successfully                *
+ *               FAIL - invalid parameters                                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	baseline_parse_params(const char *parameters, char **period, zbx_time_unit_t *season_unit,
+		int *season_num, char **error)
+{
+	char	*tmp = NULL;
+	int	ret = FAIL;
+
+	if (3 != num_param(parameters))
+	{
+		*error = zbx_strdup(*error, "invalid number of parameters");
+		goto out;
+	}
+
+	if (SUCCEED != get_function_parameter_str(parameters, 1, period))
+	{
+		*error = zbx_strdup(*error, "invalid second parameter");
+		goto out;
+	}
+
+	if (SUCCEED != get_function_parameter_str(parameters, 2, &tmp) ||
+			ZBX_TIME_UNIT_HOUR > (*season_unit = zbx_tm_str_to_unit(tmp)))
+	{
+		*error = zbx_strdup(*error, "invalid third parameter");
+		goto out;
+	}
+	zbx_free(tmp);
+
+	if (SUCCEED != get_function_parameter_str(parameters, 3, &tmp) || 0 >= (*season_num = atoi(tmp)))
+	{
+		*error = zbx_strdup(*error, "invalid fourth parameter");
+		goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_free(tmp);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: evaluate baseline* functions for the item                         *
@@ -3595,7 +3794,7 @@ static int	evaluate_BASELINE(zbx_variant_t *value, DC_ITEM *item, const char *fu
 		const zbx_timespec_t *ts, char **error)
 {
 	int			ret = FAIL, season_num;
-	char			*period = NULL, *tmp = NULL;
+	char			*period = NULL;
 	zbx_vector_dbl_t	values;
 	zbx_vector_uint64_t	index;
 	double			value_dbl;
@@ -3606,31 +3805,8 @@ static int	evaluate_BASELINE(zbx_variant_t *value, DC_ITEM *item, const char *fu
 	zbx_vector_dbl_create(&values);
 	zbx_vector_uint64_create(&index);
 
-	if (3 != num_param(parameters))
-	{
-		*error = zbx_strdup(*error, "invalid number of parameters");
-		goto out;
-	}
-
-	if (SUCCEED != get_function_parameter_str(parameters, 1, &period))
-	{
-		*error = zbx_strdup(*error, "invalid second parameter");
-		goto out;
-	}
-
-	if (SUCCEED != get_function_parameter_str(parameters, 2, &tmp) ||
-			ZBX_TIME_UNIT_HOUR > (season_unit = zbx_tm_str_to_unit(tmp)))
-	{
-		*error = zbx_strdup(*error, "invalid third parameter");
-		goto out;
-	}
-	zbx_free(tmp);
-
-	if (SUCCEED != get_function_parameter_str(parameters, 3, &tmp) || 0 >= (season_num = atoi(tmp)))
-	{
-		*error = zbx_strdup(*error, "invalid fourth parameter");
+	if (SUCCEED != baseline_parse_params(parameters, &period, &season_unit, &season_num, error))
 		goto out;
-	}
 
 	if (0 == strcmp(func, "wma"))
 	{
@@ -3704,7 +3880,6 @@ static int	evaluate_BASELINE(zbx_variant_t *value, DC_ITEM *item, const char *fu
 
 	ret = SUCCEED;
 out:
-	zbx_free(tmp);
 	zbx_free(period);
 
 	zbx_vector_uint64_destroy(&index);
@@ -3788,6 +3963,57 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the trend ranges function will request when evaluated         *
+ *                                                                            *
+ * Parameters: function  - [IN] function (for example, 'baselinewma')        *
+ *             parameter - [IN] parameter of the function                     *
+ *             ts        - [IN] the starting timestamp                        *
+ *             ranges    - [OUT] the ranges of trend averages used by the     *
+ *                               function                                     *
+ *                                                                            *
+ * Return value: SUCCEED - the function uses trend averages of the returned   *
+ *                         ranges                                             *
+ *               FAIL - the function does not use trend averages or has       *
+ *                      invalid parameters                                    *
+ *                                                                            *
+ * Comments: Used to prefetch trends of multiple items with baseline and STL  *
+ *           anomaly functions before evaluating them.                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_get_trend_function_ranges(const char *function, const char *parameter, const zbx_timespec_t *ts,
+		zbx_vector_trend_range_t *ranges)
+{
+	int		ret = FAIL, start, end, season_num;
+	char		*period = NULL, *error = NULL;
+	zbx_time_unit_t	season_unit;
+
+	if (0 == strcmp(function, "trendstl"))
+	{
+		if (SUCCEED == get_function_parameter_str(parameter, 1, &period) &&
+				SUCCEED == zbx_trends_parse_range(ts->sec, period, &start, &end, &error))
+		{
+			trends_stl_get_ranges(start, end, ranges);
+			ret = SUCCEED;
+		}
+	}
+	else if (0 == strcmp(function, "baselinewma") || 0 == strcmp(function, "baselinedev"))
+	{
+		if (SUCCEED == baseline_parse_params(parameter, &period, &season_unit, &season_num, &error))
+		{
+			/* baselinewma skips the current data period, see evaluate_BASELINE() */
+			ret = zbx_baseline_get_ranges(ts->sec, period, season_num, season_unit,
+					0 == strcmp(function, "baselinewma") ? 1 : 0, ranges, &error);
+		}
+	}
+
+	zbx_free(error);
+	zbx_free(period);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: evaluate function                                                 *
@@ -20,8 +20,12 @@
 #ifndef ZABBIX_EVALFUNC_H
 #define ZABBIX_EVALFUNC_H
 
+#include "zbxtrends.h"
+
 int	zbx_evaluatable_for_notsupported(const char *fn);
 int	zbx_evaluate_RATE(zbx_variant_t *value, DC_ITEM *item, const char *parameters, const zbx_timespec_t *ts,
 		char **error);
+int	zbx_get_trend_function_ranges(const char *function, const char *parameter, const zbx_timespec_t *ts,
+		zbx_vector_trend_range_t *ranges);
 
 #endif
@@ -19,6 +19,7 @@
 
 #include "zbxserver.h"
 #include "evalfunc.h"
+#include "evalfunc_common.h"
 #include "log.h"
 #include "zbxregexp.h"
 #include "zbxvariant.h"
@@ -4893,12 +4894,17 @@ typedef struct
 	zbx_uint64_t	itemid;
 	char		*function;
 	char		*parameter;
+	char		*parameter_norm;	/* normalized parameter used to identify function */
 	zbx_timespec_t	timespec;
 	unsigned char	type;
 
 	/* output data */
 	zbx_variant_t	value;
 	char		*error;
+
+	/* item host and key for error messages, set when evaluation fails */
+	char		*host;
+	char		*key;
 }
 zbx_func_t;
 
@@ -4906,6 +4912,7 @@ typedef struct
 {
 	zbx_uint64_t	functionid;
 	zbx_func_t	*func;
+	char		*parameter;	/* the parameter as written in trigger, NULL if the same as in func */
 }
 zbx_ifunc_t;
 
@@ -4916,7 +4923,7 @@ static zbx_hash_t	func_hash_func(const void *data)
 
 	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&func->itemid);
 	hash = ZBX_DEFAULT_STRING_HASH_ALGO(func->function, strlen(func->function), hash);
-	hash = ZBX_DEFAULT_STRING_HASH_ALGO(func->parameter, strlen(func->parameter), hash);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(func->parameter_norm, strlen(func->parameter_norm), hash);
 	hash = ZBX_DEFAULT_HASH_ALGO(&func->timespec.sec, sizeof(func->timespec.sec), hash);
 	hash = ZBX_DEFAULT_HASH_ALGO(&func->timespec.ns, sizeof(func->timespec.ns), hash);
 
@@ -4934,7 +4941,7 @@ static int	func_compare_func(const void *d1, const void *d2)
 	if (0 != (ret = strcmp(func1->function, func2->function)))
 		return ret;
 
-	if (0 != (ret = strcmp(func1->parameter, func2->parameter)))
+	if (0 != (ret = strcmp(func1->parameter_norm, func2->parameter_norm)))
 		return ret;
 
 	ZBX_RETURN_IF_NOT_EQUAL(func1->timespec.sec, func2->timespec.sec);
@@ -4943,17 +4950,206 @@ static int	func_compare_func(const void *d1, const void *d2)
 	return 0;
 }
 
+static int	func_compare_by_itemid(const void *d1, const void *d2)
+{
+	const zbx_func_t	*func1 = *(const zbx_func_t * const *)d1;
+	const zbx_func_t	*func2 = *(const zbx_func_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(func1->itemid, func2->itemid);
+
+	return 0;
+}
+
 static void	func_clean(void *ptr)
 {
 	zbx_func_t	*func = (zbx_func_t *)ptr;
 
 	zbx_free(func->function);
 	zbx_free(func->parameter);
+	zbx_free(func->parameter_norm);
 	zbx_free(func->error);
+	zbx_free(func->host);
+	zbx_free(func->key);
 
 	zbx_variant_clear(&func->value);
 }
 
+static void	ifunc_clean(void *ptr)
+{
+	zbx_ifunc_t	*ifunc = (zbx_ifunc_t *)ptr;
+
+	zbx_free(ifunc->parameter);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: set function evaluation error                                     *
+ *                                                                            *
+ * Parameters: func  - [IN/OUT] the function                                  *
+ *             item  - [IN] the function item, NULL if it does not exist      *
+ *             error - [IN] the error message                                 *
+ *                                                                            *
+ * Comments: The error is formatted for each trigger with its own function    *
+ *           parameters by ifunc_format_error().                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	func_set_error(zbx_func_t *func, const zbx_history_sync_item_t *item, const char *error)
+{
+	if (NULL != item)
+	{
+		func->host = zbx_strdup(func->host, item->host.host);
+		func->key = zbx_strdup(func->key, item->key_orig);
+	}
+
+	func->error = zbx_strdup(func->error, error);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: set function value to error                                       *
+ *                                                                            *
+ * Parameters: func  - [IN/OUT] the function                                  *
+ *             item  - [IN] the function item                                 *
+ *             error - [IN] the error message, freed by the function          *
+ *                                                                            *
+ ******************************************************************************/
+static void	func_set_value_error(zbx_func_t *func, const zbx_history_sync_item_t *item, char *error)
+{
+	func->host = zbx_strdup(func->host, item->host.host);
+	func->key = zbx_strdup(func->key, item->key_orig);
+
+	zbx_variant_clear(&func->value);
+	zbx_variant_set_error(&func->value, error);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: format function evaluation error for a trigger                    *
+ *                                                                            *
+ * Parameters: ifunc - [IN] the trigger function                              *
+ *             error - [IN] the error message                                 *
+ *                                                                            *
+ * Return value: The formatted error message. This value must be freed by     *
+ *               the caller.                                                  *
+ *                                                                            *
+ * Comments: Triggers share the evaluation of functions with equivalent       *
+ *           parameters, the error message uses the parameters of the         *
+ *           trigger function.                                                *
+ *                                                                            *
+ ******************************************************************************/
+static char	*ifunc_format_error(const zbx_ifunc_t *ifunc, const char *error)
+{
+	const zbx_func_t	*func = ifunc->func;
+
+	return zbx_eval_format_function_error(func->function, func->host, func->key,
+			NULL != ifunc->parameter ? ifunc->parameter : func->parameter, error);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: normalize function parameters so that functions giving the same   *
+ *          result are evaluated only once                                    *
+ *                                                                            *
+ * Parameters: type      - [IN] the function type (ZBX_FUNCTION_TYPE_*)       *
+ *             parameter - [IN] the function parameters without item query    *
+ *             out       - [IN/OUT] the normalized parameters                 *
+ *             out_alloc - [IN/OUT] the allocated size of output buffer       *
+ *                                                                            *
+ * Comments: Leading whitespace is removed from parameters and the time       *
+ *           period of history functions is converted to seconds, so for      *
+ *           example avg(/host/key,5m) and avg(/host/key, 300s) are           *
+ *           evaluated together.                                              *
+ *                                                                            *
+ *           The output buffer is reused between calls.                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	func_normalize_parameter(unsigned char type, const char *parameter, char **out, size_t *out_alloc)
+{
+	const char	*ptr;
+	size_t		out_offset = 0, param_pos, param_len, sep_pos;
+	int		index, period;
+
+	if (NULL == *out)
+	{
+		*out_alloc = 64;
+		*out = (char *)zbx_malloc(NULL, *out_alloc);
+	}
+
+	**out = '\0';
+
+	for (ptr = parameter, index = 1;; index++)
+	{
+		zbx_function_param_parse(ptr, &param_pos, &param_len, &sep_pos);
+
+		if (1 != index)
+			zbx_chrcpy_alloc(out, out_alloc, &out_offset, ',');
+
+		/* first parameter of history and timer functions is sec|#num[:timeshift] */
+		if (1 == index && (ZBX_FUNCTION_TYPE_HISTORY == type || ZBX_FUNCTION_TYPE_TIMER == type) &&
+				0 != param_len && SUCCEED == is_time_suffix(ptr + param_pos, &period, (int)param_len))
+		{
+			zbx_snprintf_alloc(out, out_alloc, &out_offset, "%d", period);
+		}
+		else
+			zbx_strncpy_alloc(out, out_alloc, &out_offset, ptr + param_pos, param_len);
+
+		if (',' != ptr[sep_pos])
+			break;
+
+		ptr += sep_pos + 1;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add function to the hashsets of functions to evaluate             *
+ *                                                                            *
+ * Parameters: funcs      - [IN/OUT] functions indexed by itemid, name,       *
+ *                                   parameter, timestamp                     *
+ *             ifuncs     - [IN/OUT] function index by functionid             *
+ *             function   - [IN] the function                                 *
+ *             ts         - [IN] the function evaluation timestamp            *
+ *             norm       - [IN/OUT] the normalized parameter buffer          *
+ *             norm_alloc - [IN/OUT] the normalized parameter buffer size     *
+ *                                                                            *
+ ******************************************************************************/
+static void	func_add(zbx_hashset_t *funcs, zbx_hashset_t *ifuncs, const DC_FUNCTION *function,
+		const zbx_timespec_t *ts, char **norm, size_t *norm_alloc)
+{
+	zbx_ifunc_t	ifunc_local;
+	zbx_func_t	*func, func_local;
+
+	func_local.itemid = function->itemid;
+	func_local.timespec = *ts;
+	func_local.function = function->function;
+
+	func_normalize_parameter(function->type, function->parameter, norm, norm_alloc);
+	func_local.parameter_norm = *norm;
+
+	if (NULL == (func = (zbx_func_t *)zbx_hashset_search(funcs, &func_local)))
+	{
+		func = (zbx_func_t *)zbx_hashset_insert(funcs, &func_local, sizeof(func_local));
+		func->function = zbx_strdup(NULL, function->function);
+		func->parameter = zbx_strdup(NULL, function->parameter);
+		func->parameter_norm = zbx_strdup(NULL, *norm);
+		func->type = function->type;
+		func->error = NULL;
+		func->host = NULL;
+		func->key = NULL;
+		zbx_variant_set_none(&func->value);
+	}
+
+	ifunc_local.functionid = function->functionid;
+	ifunc_local.func = func;
+
+	if (0 != strcmp(func->parameter, function->parameter))
+		ifunc_local.parameter = zbx_strdup(NULL, function->parameter);
+	else
+		ifunc_local.parameter = NULL;
+
+	zbx_hashset_insert(ifuncs, &ifunc_local, sizeof(ifunc_local));
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: prepare hashset of functions to evaluate                          *
@@ -4972,14 +5168,12 @@ static void	zbx_populate_function_items(const zbx_vector_uint64_t *functionids,
 	DC_TRIGGER	*tr;
 	DC_FUNCTION	*functions = NULL;
 	int		*errcodes = NULL;
-	zbx_ifunc_t	ifunc_local;
-	zbx_func_t	*func, func_local;
+	zbx_timespec_t	ts;
+	char		*norm = NULL;
+	size_t		norm_alloc = 0;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() functionids_num:%d", __func__, functionids->values_num);
 
-	zbx_variant_set_none(&func_local.value);
-	func_local.error = NULL;
-
 	functions = (DC_FUNCTION *)zbx_malloc(functions, sizeof(DC_FUNCTION) * functionids->values_num);
 	errcodes = (int *)zbx_malloc(errcodes, sizeof(int) * functionids->values_num);
 
@@ -4990,37 +5184,22 @@ static void	zbx_populate_function_items(const zbx_vector_uint64_t *functionids,
 		if (SUCCEED != errcodes[i])
 			continue;
 
-		func_local.itemid = functions[i].itemid;
-
 		if (FAIL != (j = zbx_vector_ptr_bsearch(triggers, &functions[i].triggerid,
 				ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
 		{
 			tr = (DC_TRIGGER *)triggers->values[j];
-			func_local.timespec = tr->timespec;
+			ts = tr->timespec;
 		}
 		else
 		{
-			func_local.timespec.sec = 0;
-			func_local.timespec.ns = 0;
+			ts.sec = 0;
+			ts.ns = 0;
 		}
 
-		func_local.function = functions[i].function;
-		func_local.parameter = functions[i].parameter;
-
-		if (NULL == (func = (zbx_func_t *)zbx_hashset_search(funcs, &func_local)))
-		{
-			func = (zbx_func_t *)zbx_hashset_insert(funcs, &func_local, sizeof(func_local));
-			func->function = zbx_strdup(NULL, func_local.function);
-			func->parameter = zbx_strdup(NULL, func_local.parameter);
-			func->type = functions[i].type;
-			zbx_variant_set_none(&func->value);
-		}
-
-		ifunc_local.functionid = functions[i].functionid;
-		ifunc_local.func = func;
-		zbx_hashset_insert(ifuncs, &ifunc_local, sizeof(ifunc_local));
+		func_add(funcs, ifuncs, &functions[i], &ts, &norm, &norm_alloc);
 	}
 
+	zbx_free(norm);
 	DCconfig_clean_functions(functions, errcodes, functionids->values_num);
 
 	zbx_free(errcodes);
@@ -5029,65 +5208,294 @@ static void	zbx_populate_function_items(const zbx_vector_uint64_t *functionids,
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() ifuncs_num:%d", __func__, ifuncs->num_data);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the union of value ranges requested by history functions    *
+ *          of the same item                                                  *
+ *                                                                            *
+ * Parameters: funcs   - [IN] the functions sorted by itemid                  *
+ *             index   - [IN] the index of the first function of the item to  *
+ *                            check                                           *
+ *             ts      - [OUT] the latest end of requested ranges             *
+ *             seconds - [OUT] the number of seconds before ts covering all   *
+ *                             time based ranges, 0 if there are none         *
+ *             count   - [OUT] the largest number of requested values         *
+ *                                                                            *
+ * Return value: SUCCEED - the item has several history functions and some    *
+ *                         of them request more than one value                *
+ *               FAIL    - prefetching item values would not save cache       *
+ *                         requests                                           *
+ *                                                                            *
+ * Comments: Functions without period parameter request the last value, or    *
+ *           the last two values in the case of change(). Functions with      *
+ *           invalid period are not counted, they fail without reading        *
+ *           history.                                                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	item_functions_get_history_range(const zbx_vector_ptr_t *funcs, int index, zbx_timespec_t *ts,
+		int *seconds, int *count)
+{
+	const zbx_func_t	*func;
+	zbx_uint64_t		itemid = ((const zbx_func_t *)funcs->values[index])->itemid;
+	zbx_timespec_t		start;
+	int			num = 0, periods_num = 0;
+
+	ts->sec = 0;
+	ts->ns = 0;
+	*count = 0;
+
+	for (; index < funcs->values_num && itemid == (func = (const zbx_func_t *)funcs->values[index])->itemid;
+			index++)
+	{
+		zbx_timespec_t		end, period_start;
+		zbx_value_type_t	type;
+		int			value, time_shift;
+
+		if (ZBX_FUNCTION_TYPE_HISTORY != func->type && ZBX_FUNCTION_TYPE_TIMER != func->type)
+			continue;
+
+		if (SUCCEED != get_function_parameter_hist_range(func->timespec.sec, func->parameter, 1, &value,
+				&type, &time_shift))
+		{
+			continue;
+		}
+
+		end = func->timespec;
+		end.sec -= time_shift;
+
+		if (0 < zbx_timespec_compare(&end, ts))
+			*ts = end;
+
+		switch (type)
+		{
+			case ZBX_VALUE_SECONDS:
+				period_start.sec = end.sec - value;
+				period_start.ns = end.ns;
+
+				if (0 == periods_num++ || 0 > zbx_timespec_compare(&period_start, &start))
+					start = period_start;
+				break;
+			case ZBX_VALUE_NVALUES:
+				*count = MAX(*count, value);
+				break;
+			default:
+				*count = MAX(*count, 0 == strcmp(func->function, "change") ? 2 : 1);
+		}
+
+		num++;
+	}
+
+	if (0 == periods_num)
+		*seconds = 0;
+	else
+		*seconds = ts->sec - start.sec + (start.ns < ts->ns ? 1 : 0);
+
+	if (2 > num || (0 == *seconds && 1 >= *count))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find function item retrieved either when saving history or when   *
+ *          evaluating functions                                              *
+ *                                                                            *
+ * Parameters: itemid           - [IN] the item identifier                    *
+ *             history_itemids  - [IN] the sorted identifiers of items        *
+ *                                      retrieved when saving history         *
+ *             history_items    - [IN] the items retrieved when saving        *
+ *                                     history                                *
+ *             history_errcodes - [IN] the item retrieval error codes         *
+ *             itemids          - [IN] the sorted identifiers of other items  *
+ *             items            - [IN] the other items                        *
+ *             errcodes         - [IN] the other item retrieval error codes   *
+ *             errcode          - [OUT] the item retrieval error code         *
+ *                                                                            *
+ * Return value: The item.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_history_sync_item_t	*func_get_item(zbx_uint64_t itemid,
+		const zbx_vector_uint64_t *history_itemids, const zbx_history_sync_item_t *history_items,
+		const int *history_errcodes, const zbx_vector_uint64_t *itemids, const zbx_history_sync_item_t *items,
+		const int *errcodes, int *errcode)
+{
+	int	i;
+
+	/* avoid double copying from configuration cache if already retrieved when saving history */
+	if (FAIL != (i = zbx_vector_uint64_bsearch(history_itemids, itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC)))
+	{
+		*errcode = history_errcodes[i];
+		return history_items + i;
+	}
+
+	i = zbx_vector_uint64_bsearch(itemids, itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	*errcode = errcodes[i];
+
+	return items + i;
+}
+
+#define ZBX_TRENDS_PREFETCH_ITEMS_MAX	1000
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: prefetch trends used by trend functions of the next items         *
+ *                                                                            *
+ * Parameters: funcs - [IN] the functions sorted by itemid                    *
+ *             index - [IN] the index of the first function of the item       *
+ *             ...   - [IN] the item lookup data, see func_get_item()         *
+ *                                                                            *
+ * Return value: The index of the first function of the items following the   *
+ *               prefetched ones.                                             *
+ *                                                                            *
+ * Comments: Baseline and STL anomaly functions of many items evaluated at    *
+ *           the same time request the same trend ranges. Their trends are    *
+ *           selected with a single query per value type and ranges instead   *
+ *           of a query per function.                                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	item_functions_prefetch_trends(const zbx_vector_ptr_t *funcs, int index,
+		const zbx_vector_uint64_t *history_itemids, const zbx_history_sync_item_t *history_items,
+		const int *history_errcodes, const zbx_vector_uint64_t *itemids, const zbx_history_sync_item_t *items,
+		const int *errcodes)
+{
+	const zbx_func_t		*func;
+	const zbx_history_sync_item_t	*item;
+	zbx_uint64_t			itemid = 0;
+	int				items_num = 0, errcode;
+	zbx_vector_trend_range_t	ranges;
+
+	zbx_vector_trend_range_create(&ranges);
+
+	for (; index < funcs->values_num; index++)
+	{
+		func = (const zbx_func_t *)funcs->values[index];
+
+		if (itemid != func->itemid)
+		{
+			if (ZBX_TRENDS_PREFETCH_ITEMS_MAX == items_num)
+				break;
+
+			itemid = func->itemid;
+			items_num++;
+		}
+
+		if (ZBX_FUNCTION_TYPE_TRENDS != func->type)
+			continue;
+
+		item = func_get_item(func->itemid, history_itemids, history_items, history_errcodes, itemids, items,
+				errcodes, &errcode);
+
+		if (SUCCEED != errcode || ITEM_STATUS_ACTIVE != item->status || 0 == item->trends)
+			continue;
+
+		zbx_vector_trend_range_clear(&ranges);
+
+		if (SUCCEED == zbx_get_trend_function_ranges(func->function, func->parameter, &func->timespec,
+				&ranges))
+		{
+			zbx_trends_prefetch_add(func->itemid, item->value_type, &ranges);
+		}
+	}
+
+	zbx_trends_prefetch();
+	zbx_vector_trend_range_destroy(&ranges);
+
+	return index;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluates item functions                                          *
+ *                                                                            *
+ * Parameters: funcs            - [IN/OUT] the functions to evaluate          *
+ *             history_itemids  - [IN] the sorted identifiers of items        *
+ *                                      retrieved when saving history         *
+ *             history_items    - [IN] the items retrieved when saving        *
+ *                                     history                                *
+ *             history_errcodes - [IN] the item retrieval error codes         *
+ *                                                                            *
+ * Comments: Functions are evaluated grouped by items. When a numeric item    *
+ *           has several history functions the union of their value ranges is *
+ *           prefetched from value cache with a single lock and the functions *
+ *           are evaluated from the prefetched values whenever possible.      *
+ *                                                                            *
+ ******************************************************************************/
 static void	zbx_evaluate_item_functions(zbx_hashset_t *funcs, const zbx_vector_uint64_t *history_itemids,
-		const DC_ITEM *history_items, const int *history_errcodes)
+		const zbx_history_sync_item_t *history_items, const int *history_errcodes)
 {
-	DC_ITEM			*items = NULL;
+	zbx_history_sync_item_t	*items = NULL;
+	DC_ITEM			*dc_item;
 	char			*error = NULL;
-	int			i;
+	int			j, prefetch = 0, trends_prefetch_index = 0, prefetch_seconds, prefetch_count;
 	zbx_func_t		*func;
 	zbx_vector_uint64_t	itemids;
+	zbx_vector_ptr_t	funcs_sorted;
 	int			*errcodes = NULL;
 	zbx_hashset_iter_t	iter;
+	zbx_timespec_t		prefetch_ts;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() funcs_num:%d", __func__, funcs->num_data);
 
 	zbx_vector_uint64_create(&itemids);
+	zbx_vector_ptr_create(&funcs_sorted);
+	zbx_vector_ptr_reserve(&funcs_sorted, (size_t)funcs->num_data);
 
 	zbx_hashset_iter_reset(funcs, &iter);
 	while (NULL != (func = (zbx_func_t *)zbx_hashset_iter_next(&iter)))
 	{
+		zbx_vector_ptr_append(&funcs_sorted, func);
+
 		if (FAIL == zbx_vector_uint64_bsearch(history_itemids, func->itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
 			zbx_vector_uint64_append(&itemids, func->itemid);
 	}
 
+	/* group functions by items to evaluate them from the same prefetched item values */
+	zbx_vector_ptr_sort(&funcs_sorted, func_compare_by_itemid);
+
 	if (0 != itemids.values_num)
 	{
 		zbx_vector_uint64_sort(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 		zbx_vector_uint64_uniq(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
-		items = (DC_ITEM *)zbx_malloc(items, sizeof(DC_ITEM) * (size_t)itemids.values_num);
+		items = (zbx_history_sync_item_t *)zbx_malloc(items, sizeof(zbx_history_sync_item_t) *
+				(size_t)itemids.values_num);
 		errcodes = (int *)zbx_malloc(errcodes, sizeof(int) * (size_t)itemids.values_num);
 
-		DCconfig_get_items_by_itemids_partial(items, itemids.values, errcodes, itemids.values_num,
+		DCconfig_history_sync_get_items_by_itemids(items, itemids.values, errcodes, itemids.values_num,
 				ZBX_ITEM_GET_SYNC);
 	}
 
-	zbx_hashset_iter_reset(funcs, &iter);
-	while (NULL != (func = (zbx_func_t *)zbx_hashset_iter_next(&iter)))
+	/* item functions are evaluated with DC_ITEM, only its identification fields are used */
+	dc_item = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM));
+
+	for (j = 0; j < funcs_sorted.values_num; j++)
 	{
-		int		errcode;
-		const DC_ITEM	*item;
+		int				errcode;
+		const zbx_history_sync_item_t	*item;
 
-		/* avoid double copying from configuration cache if already retrieved when saving history */
-		if (FAIL != (i = zbx_vector_uint64_bsearch(history_itemids, func->itemid,
-				ZBX_DEFAULT_UINT64_COMPARE_FUNC)))
-		{
-			item = history_items + i;
-			errcode = history_errcodes[i];
-		}
-		else
+		func = (zbx_func_t *)funcs_sorted.values[j];
+
+		if (0 == j || ((zbx_func_t *)funcs_sorted.values[j - 1])->itemid != func->itemid)
 		{
-			i = zbx_vector_uint64_bsearch(&itemids, func->itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
-			item = items + i;
-			errcode = errcodes[i];
+			zbx_vc_prefetch_clear();
+			prefetch = 1;
+
+			if (j == trends_prefetch_index)
+			{
+				zbx_trends_prefetch_clear();
+				trends_prefetch_index = item_functions_prefetch_trends(&funcs_sorted, j,
+						history_itemids, history_items, history_errcodes, &itemids, items,
+						errcodes);
+			}
 		}
 
+		item = func_get_item(func->itemid, history_itemids, history_items, history_errcodes, &itemids, items,
+				errcodes, &errcode);
+
 		if (SUCCEED != errcode)
 		{
-			zbx_free(func->error);
-			func->error = zbx_eval_format_function_error(func->function, NULL, NULL, func->parameter,
-					"item does not exist");
+			func_set_error(func, NULL, "item does not exist");
 			continue;
 		}
 
@@ -5095,34 +5503,26 @@ static void	zbx_evaluate_item_functions(zbx_hashset_t *funcs, const zbx_vector_u
 
 		if (ITEM_STATUS_ACTIVE != item->status)
 		{
-			zbx_free(func->error);
-			func->error = zbx_eval_format_function_error(func->function, item->host.host,
-					item->key_orig, func->parameter, "item is disabled");
+			func_set_error(func, item, "item is disabled");
 			continue;
 		}
 
 		if ((ZBX_FUNCTION_TYPE_HISTORY == func->type || ZBX_FUNCTION_TYPE_TIMER == func->type) &&
 				0 == item->history)
 		{
-			zbx_free(func->error);
-			func->error = zbx_eval_format_function_error(func->function, item->host.host,
-					item->key_orig, func->parameter, "item history is disabled");
+			func_set_error(func, item, "item history is disabled");
 			continue;
 		}
 
 		if (ZBX_FUNCTION_TYPE_TRENDS == func->type && 0 == item->trends)
 		{
-			zbx_free(func->error);
-			func->error = zbx_eval_format_function_error(func->function, item->host.host,
-					item->key_orig, func->parameter, "item trends are disabled");
+			func_set_error(func, item, "item trends are disabled");
 			continue;
 		}
 
 		if (HOST_STATUS_MONITORED != item->host.status)
 		{
-			zbx_free(func->error);
-			func->error = zbx_eval_format_function_error(func->function, item->host.host,
-					item->key_orig, func->parameter, "item belongs to a disabled host");
+			func_set_error(func, item, "item belongs to a disabled host");
 			continue;
 		}
 
@@ -5130,27 +5530,47 @@ static void	zbx_evaluate_item_functions(zbx_hashset_t *funcs, const zbx_vector_u
 				FAIL == zbx_evaluatable_for_notsupported(func->function))
 		{
 			/* set 'unknown' error value */
-			zbx_variant_set_error(&func->value,
-					zbx_eval_format_function_error(func->function, item->host.host,
-							item->key_orig, func->parameter, "item is not supported"));
+			func_set_value_error(func, item, zbx_strdup(NULL, "item is not supported"));
 			continue;
 		}
 
-		if (SUCCEED != evaluate_function2(&func->value, (DC_ITEM *)item, func->function, func->parameter,
+		dc_item->host = item->host;
+		dc_item->itemid = item->itemid;
+		dc_item->value_type = item->value_type;
+		strscpy(dc_item->key_orig, item->key_orig);
+
+		/* prefetch numeric item values once for all its history functions, string values are */
+		/* requested by functions directly to avoid copying them                               */
+		if (0 != prefetch)
+		{
+			if ((ITEM_VALUE_TYPE_FLOAT == item->value_type || ITEM_VALUE_TYPE_UINT64 == item->value_type) &&
+					SUCCEED == item_functions_get_history_range(&funcs_sorted, j, &prefetch_ts,
+					&prefetch_seconds, &prefetch_count))
+			{
+				zbx_vc_prefetch_values(item->itemid, item->value_type, prefetch_seconds, prefetch_count,
+						&prefetch_ts);
+			}
+
+			prefetch = 0;
+		}
+
+		if (SUCCEED != evaluate_function2(&func->value, dc_item, func->function, func->parameter,
 				&func->timespec, &error))
 		{
-			/* compose and store error message for future use */
-			zbx_variant_set_error(&func->value,
-					zbx_eval_format_function_error(func->function, item->host.host,
-							item->key_orig, func->parameter, error));
-			zbx_free(error);
+			/* store error message to be composed for each trigger */
+			func_set_value_error(func, item, error);
+			error = NULL;
 			continue;
 		}
 	}
 
+	zbx_vc_prefetch_clear();
 	zbx_vc_flush_stats();
+	zbx_trends_prefetch_clear();
 
-	DCconfig_clean_items(items, errcodes, itemids.values_num);
+	zbx_free(dc_item);
+	DCconfig_clean_history_sync_items(items, errcodes, itemids.values_num);
+	zbx_vector_ptr_destroy(&funcs_sorted);
 	zbx_vector_uint64_destroy(&itemids);
 
 	zbx_free(errcodes);
@@ -5194,7 +5614,8 @@ static int	substitute_expression_functions_results(zbx_hashset_t *ifuncs, zbx_ev
 
 		if (NULL != func->error)
 		{
-			*error = zbx_strdup(*error, func->error);
+			zbx_free(*error);
+			*error = ifunc_format_error(ifunc, func->error);
 			return FAIL;
 		}
 
@@ -5204,7 +5625,10 @@ static int	substitute_expression_functions_results(zbx_hashset_t *ifuncs, zbx_ev
 			return FAIL;
 		}
 
-		zbx_variant_copy(&token->value, &func->value);
+		if (ZBX_VARIANT_ERR == func->value.type)
+			zbx_variant_set_error(&token->value, ifunc_format_error(ifunc, func->value.data.err));
+		else
+			zbx_variant_copy(&token->value, &func->value);
 	}
 
 	return SUCCEED;
@@ -5274,7 +5698,7 @@ static void	zbx_substitute_functions_results(zbx_hashset_t *ifuncs, zbx_vector_p
  *                                                                            *
  ******************************************************************************/
 static void	substitute_functions(zbx_vector_ptr_t *triggers, const zbx_vector_uint64_t *history_itemids,
-		const DC_ITEM *history_items, const int *history_errcodes)
+		const zbx_history_sync_item_t *history_items, const int *history_errcodes)
 {
 	zbx_vector_uint64_t	functionids;
 	zbx_hashset_t		ifuncs, funcs;
@@ -5287,8 +5711,9 @@ static void	substitute_functions(zbx_vector_ptr_t *triggers, const zbx_vector_ui
 	if (0 == functionids.values_num)
 		goto empty;
 
-	zbx_hashset_create(&ifuncs, triggers->values_num, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create_ext(&ifuncs, triggers->values_num, ZBX_DEFAULT_UINT64_HASH_FUNC,
+			ZBX_DEFAULT_UINT64_COMPARE_FUNC, ifunc_clean, ZBX_DEFAULT_MEM_MALLOC_FUNC,
+			ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
 
 	zbx_hashset_create_ext(&funcs, triggers->values_num, func_hash_func, func_compare_func, func_clean,
 				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
@@ -5375,7 +5800,7 @@ static int	evaluate_expression(zbx_eval_context_t *ctx, const zbx_timespec_t *ts
  *                                                                            *
  ******************************************************************************/
 void	evaluate_expressions(zbx_vector_ptr_t *triggers, const zbx_vector_uint64_t *history_itemids,
-		const DC_ITEM *history_items, const int *history_errcodes)
+		const zbx_history_sync_item_t *history_items, const int *history_errcodes)
 {
 	DB_EVENT		event;
 	DC_TRIGGER		*tr;
@@ -6687,3 +7112,7 @@ int	zbx_host_macro_index(const char *macro)
 
 	return -1;
 }
+
+#ifdef HAVE_TESTS
+#	include "../../../tests/libs/zbxserver/expression_funcs_test.c"
+#endif
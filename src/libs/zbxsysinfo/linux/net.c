@@ -222,6 +222,283 @@ out:
 }
 #endif
 
+#ifdef HAVE_SOCK_DIAG
+#	include <linux/rtnetlink.h>
+#	include <linux/sock_diag.h>
+
+/* request sockets of listening TCP sockets, reported by kernel in SYN_RECV state */
+#define STATE_NEW_SYN_RECV	12
+
+#define SOCK_DIAG_STATES_ALL	0xffffffff
+#define SOCK_DIAG_BC_OPS_MAX	8
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds port filter to netlink sock_diag request bytecode            *
+ *                                                                            *
+ * Parameters: bc      - [OUT] the bytecode operations                        *
+ *             bc_num  - [IN/OUT] the number of bytecode operations           *
+ *             code_ge - [IN] the port 'greater or equal' operation code      *
+ *             code_le - [IN] the port 'less or equal' operation code         *
+ *             port    - [IN] the port to match                               *
+ *                                                                            *
+ * Comments: The jump offsets for failed conditions are set when the whole    *
+ *           bytecode is composed, see sock_diag_bc_finalize().               *
+ *                                                                            *
+ ******************************************************************************/
+static void	sock_diag_bc_add_port(struct inet_diag_bc_op *bc, int *bc_num, unsigned char code_ge,
+		unsigned char code_le, unsigned short port)
+{
+	struct inet_diag_bc_op	*op = &bc[*bc_num];
+
+	memset(op, 0, sizeof(struct inet_diag_bc_op) * 4);
+
+	op[0].code = code_ge;
+	op[0].yes = sizeof(struct inet_diag_bc_op) * 2;
+	op[1].no = port;
+	op[2].code = code_le;
+	op[2].yes = sizeof(struct inet_diag_bc_op) * 2;
+	op[3].no = port;
+
+	*bc_num += 4;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sets failed condition jump offsets of the bytecode                *
+ *                                                                            *
+ * Comments: Jumping past the end of bytecode rejects the socket.             *
+ *                                                                            *
+ ******************************************************************************/
+static void	sock_diag_bc_finalize(struct inet_diag_bc_op *bc, int bc_num)
+{
+	int	i;
+
+	for (i = 0; i < bc_num; i += 2)
+		bc[i].no = (unsigned short)(sizeof(struct inet_diag_bc_op) * (bc_num - i) + 4);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: counts sockets of the specified family and protocol using         *
+ *          NETLINK_SOCK_DIAG interface                                       *
+ *                                                                            *
+ * Parameters: family   - [IN] the address family (AF_INET, AF_INET6)         *
+ *             protocol - [IN] the protocol (IPPROTO_TCP, IPPROTO_UDP)        *
+ *             states   - [IN] the bitmask of socket states to count          *
+ *             exp_l    - [IN] the local address and port filter              *
+ *             exp_r    - [IN] the remote address and port filter             *
+ *             count    - [IN/OUT] the number of matching sockets             *
+ *             error    - [OUT] the error message                             *
+ *                                                                            *
+ * Return value: SUCCEED - the sockets were counted                           *
+ *               FAIL    - netlink request has failed                         *
+ *                                                                            *
+ * Comments: The socket states and ports are filtered by kernel, so only the  *
+ *           matching sockets are transferred to user space. Addresses are    *
+ *           matched here to support CIDR and IPv4-mapped IPv6 addresses.     *
+ *                                                                            *
+ ******************************************************************************/
+static int	sock_diag_count_family(unsigned char family, unsigned char protocol, unsigned int states,
+		const net_count_info_t *exp_l, const net_count_info_t *exp_r, zbx_uint64_t *count, char **error)
+{
+	struct
+	{
+		struct nlmsghdr		nlhdr;
+		struct inet_diag_req_v2	r;
+		struct rtattr		rta;
+		struct inet_diag_bc_op	bc[SOCK_DIAG_BC_OPS_MAX];
+	}
+	request;
+
+	int			ret = FAIL, fd, status, bc_num = 0, done = 0;
+	unsigned int		sequence = 0x58425A;
+	struct timeval		timeout = { 1, 500 * 1000 };
+	struct sockaddr_nl	sa = { AF_NETLINK, 0, 0, 0 };
+	struct nlmsghdr		*r_hdr;
+	ZBX_SOCKADDR		sockaddr_l, sockaddr_r;
+	char			buffer[32 * ZBX_KIBIBYTE];
+
+	memset(&request, 0, sizeof(request));
+
+	if (0 != exp_l->port)
+		sock_diag_bc_add_port(request.bc, &bc_num, INET_DIAG_BC_S_GE, INET_DIAG_BC_S_LE, exp_l->port);
+
+	if (0 != exp_r->port)
+		sock_diag_bc_add_port(request.bc, &bc_num, INET_DIAG_BC_D_GE, INET_DIAG_BC_D_LE, exp_r->port);
+
+	request.nlhdr.nlmsg_len = NLMSG_LENGTH(sizeof(request.r));
+	request.nlhdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	request.nlhdr.nlmsg_seq = sequence;
+	request.nlhdr.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+
+	request.r.sdiag_family = family;
+	request.r.sdiag_protocol = protocol;
+	request.r.idiag_states = states;
+
+	if (0 != bc_num)
+	{
+		sock_diag_bc_finalize(request.bc, bc_num);
+
+		request.rta.rta_type = INET_DIAG_REQ_BYTECODE;
+		request.rta.rta_len = RTA_LENGTH(sizeof(struct inet_diag_bc_op) * bc_num);
+		request.nlhdr.nlmsg_len += RTA_SPACE(sizeof(struct inet_diag_bc_op) * bc_num);
+	}
+
+	if (-1 == (fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG)))
+	{
+		*error = zbx_dsprintf(*error, "cannot create netlink socket: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (0 != setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(struct timeval)))
+	{
+		*error = zbx_dsprintf(*error, "cannot set netlink socket options: %s", zbx_strerror(errno));
+		goto out;
+	}
+
+	if (-1 == sendto(fd, &request, request.nlhdr.nlmsg_len, 0, (struct sockaddr *)&sa, sizeof(sa)))
+	{
+		*error = zbx_dsprintf(*error, "cannot send netlink message to kernel: %s", zbx_strerror(errno));
+		goto out;
+	}
+
+	memset(&sockaddr_l, 0, sizeof(sockaddr_l));
+	memset(&sockaddr_r, 0, sizeof(sockaddr_r));
+
+	while (0 == done)
+	{
+		if (0 > (status = recv(fd, buffer, sizeof(buffer), 0)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			*error = zbx_dsprintf(*error, "cannot receive netlink message from kernel: %s",
+					zbx_strerror(errno));
+			goto out;
+		}
+
+		if (0 == status)
+			break;
+
+		for (r_hdr = (struct nlmsghdr *)buffer; NLMSG_OK(r_hdr, (unsigned)status);
+				r_hdr = NLMSG_NEXT(r_hdr, status))
+		{
+			struct inet_diag_msg	*r = (struct inet_diag_msg *)NLMSG_DATA(r_hdr);
+
+			if (sequence != r_hdr->nlmsg_seq)
+				continue;
+
+			if (NLMSG_DONE == r_hdr->nlmsg_type)
+			{
+				done = 1;
+				break;
+			}
+
+			if (NLMSG_ERROR == r_hdr->nlmsg_type)
+			{
+				struct nlmsgerr	*err = (struct nlmsgerr *)NLMSG_DATA(r_hdr);
+
+				if (NLMSG_LENGTH(sizeof(struct nlmsgerr)) > r_hdr->nlmsg_len)
+					*error = zbx_strdup(*error, "received truncated netlink response from kernel");
+				else
+					*error = zbx_dsprintf(*error, "netlink error: %s", zbx_strerror(-err->error));
+
+				goto out;
+			}
+
+			if (SOCK_DIAG_BY_FAMILY != r_hdr->nlmsg_type)
+			{
+				*error = zbx_strdup(*error, "received message of unrecognized type from kernel");
+				goto out;
+			}
+
+			if (NULL != exp_l->ai || NULL != exp_r->ai)
+			{
+#ifdef HAVE_IPV6
+				if (AF_INET6 == r->idiag_family)
+				{
+					((struct sockaddr_in6 *)&sockaddr_l)->sin6_family = AF_INET6;
+					memcpy(&((struct sockaddr_in6 *)&sockaddr_l)->sin6_addr, r->id.idiag_src,
+							sizeof(struct in6_addr));
+					((struct sockaddr_in6 *)&sockaddr_r)->sin6_family = AF_INET6;
+					memcpy(&((struct sockaddr_in6 *)&sockaddr_r)->sin6_addr, r->id.idiag_dst,
+							sizeof(struct in6_addr));
+				}
+				else
+#endif
+				{
+					((struct sockaddr_in *)&sockaddr_l)->sin_family = AF_INET;
+					((struct sockaddr_in *)&sockaddr_l)->sin_addr.s_addr = r->id.idiag_src[0];
+					((struct sockaddr_in *)&sockaddr_r)->sin_family = AF_INET;
+					((struct sockaddr_in *)&sockaddr_r)->sin_addr.s_addr = r->id.idiag_dst[0];
+				}
+
+				if ((NULL != exp_l->ai &&
+						FAIL == zbx_ip_cmp(exp_l->prefix_sz, exp_l->ai, sockaddr_l,
+						1 == exp_l->mapped && 0 != exp_l->prefix_sz ? 0 : 1)) ||
+						(NULL != exp_r->ai &&
+						FAIL == zbx_ip_cmp(exp_r->prefix_sz, exp_r->ai, sockaddr_r,
+						1 == exp_r->mapped && 0 != exp_r->prefix_sz ? 0 : 1)))
+				{
+					continue;
+				}
+			}
+
+			(*count)++;
+		}
+	}
+
+	ret = SUCCEED;
+out:
+	close(fd);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: counts sockets using NETLINK_SOCK_DIAG interface                  *
+ *                                                                            *
+ * Parameters: conn_type - [IN] the connection type (NET_CONN_TYPE_TCP,       *
+ *                              NET_CONN_TYPE_UDP)                            *
+ *             state     - [IN] the socket state to count, 0 - all states     *
+ *             exp_l     - [IN] the local address and port filter             *
+ *             exp_r     - [IN] the remote address and port filter            *
+ *             count     - [OUT] the number of matching sockets               *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
+ * Return value: SUCCEED - the sockets were counted                           *
+ *               FAIL    - netlink interface is not available                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	sock_diag_count(int conn_type, unsigned char state, const net_count_info_t *exp_l,
+		const net_count_info_t *exp_r, zbx_uint64_t *count, char **error)
+{
+	unsigned char	protocol;
+	unsigned int	states;
+
+	protocol = (NET_CONN_TYPE_TCP == conn_type ? IPPROTO_TCP : IPPROTO_UDP);
+
+	if (0 == state)
+		states = SOCK_DIAG_STATES_ALL;
+	else if (NET_CONN_TYPE_TCP == conn_type && STATE_SYN_RECV == state)
+		states = (1 << STATE_SYN_RECV) | (1 << STATE_NEW_SYN_RECV);
+	else
+		states = 1 << state;
+
+	*count = 0;
+
+	if (SUCCEED != sock_diag_count_family(AF_INET, protocol, states, exp_l, exp_r, count, error))
+		return FAIL;
+#ifdef HAVE_IPV6
+	if (SUCCEED != sock_diag_count_family(AF_INET6, protocol, states, exp_l, exp_r, count, error))
+		return FAIL;
+#endif
+	return SUCCEED;
+}
+#endif
+
 static int	get_net_stat(const char *if_name, net_stat_t *result, char **error)
 {
 	int	ret = SYSINFO_RET_FAIL;
@@ -622,6 +899,10 @@ int	NET_TCP_LISTEN(AGENT_REQUEST *request, AGENT_RESULT *result)
 	int		ret = SYSINFO_RET_FAIL, buffer_alloc = 64 * ZBX_KIBIBYTE;
 #ifdef HAVE_INET_DIAG
 	int		found;
+#endif
+#ifdef HAVE_SOCK_DIAG
+	net_count_info_t	info_l, info_r;
+	char			*diag_error = NULL;
 #endif
 	if (1 < request->nparam)
 	{
@@ -637,6 +918,22 @@ int	NET_TCP_LISTEN(AGENT_REQUEST *request, AGENT_RESULT *result)
 		return SYSINFO_RET_FAIL;
 	}
 
+#ifdef HAVE_SOCK_DIAG
+	memset(&info_l, 0, sizeof(info_l));
+	memset(&info_r, 0, sizeof(info_r));
+	info_l.port = port;
+
+	if (SUCCEED == sock_diag_count(NET_CONN_TYPE_TCP, STATE_LISTEN, &info_l, &info_r, &listen, &diag_error))
+	{
+		SET_UI64_RESULT(result, 0 != listen ? 1 : 0);
+
+		return SYSINFO_RET_OK;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "cannot count sockets using sock_diag: %s", diag_error);
+	zbx_free(diag_error);
+	listen = 0;
+#endif
 #ifdef HAVE_INET_DIAG
 	if (SUCCEED == find_tcp_port_by_state_nl(port, STATE_LISTEN, &found))
 	{
@@ -1133,6 +1430,18 @@ static int	net_socket_count(int conn_type, AGENT_REQUEST *request, AGENT_RESULT
 		goto err;
 	}
 
+#ifdef HAVE_SOCK_DIAG
+	if (SUCCEED == sock_diag_count(conn_type, state_num, &info_l, &info_r, &count, &error))
+	{
+		SET_UI64_RESULT(result, count);
+		ret = SYSINFO_RET_OK;
+		goto err;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "cannot count sockets using sock_diag: %s", error);
+	zbx_free(error);
+	count = 0;
+#endif
 	if (SUCCEED != get_proc_net_count_ipv4(NET_CONN_TYPE_TCP == conn_type ? "/proc/net/tcp" : "/proc/net/udp",
 			state_num, &info_l, &info_r, &count, &error))
 	{
@@ -55,288 +55,612 @@ static void	zbx_sysinfo_proc_free(zbx_sysinfo_proc_t *proc)
 	zbx_free(proc);
 }
 
-static int	get_cmdline(FILE *f_cmd, char **line, size_t *line_offset)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses amount of memory in bytes from a /proc file value, for     *
+ *          example "   176712 kB" will produce 176712*1024 = 180953088 bytes *
+ *                                                                            *
+ * Parameters: value - [IN/OUT] the value following label, modified during    *
+ *                              parsing                                       *
+ *             bytes - [OUT] result in bytes                                  *
+ *                                                                            *
+ * Return value: SUCCEED - the value was parsed successfully                  *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	byte_value_from_proc_line(char *value, zbx_uint64_t *bytes)
 {
-	size_t	line_alloc = ZBX_KIBIBYTE, n;
+	char	*p_unit;
 
-	rewind(f_cmd);
+	if (NULL == (p_unit = strrchr(value, ' ')))
+		return FAIL;
 
-	*line = (char *)zbx_malloc(*line, line_alloc + 2);
-	*line_offset = 0;
+	*p_unit++ = '\0';
 
-	while (0 != (n = fread(*line + *line_offset, 1, line_alloc - *line_offset, f_cmd)))
-	{
-		*line_offset += n;
+	while (' ' == *value)
+		value++;
+
+	if (FAIL == is_uint64(value, bytes))
+		return FAIL;
+
+	zbx_rtrim(p_unit, "\n");
+
+	if (0 == strcasecmp(p_unit, "kB"))
+		*bytes <<= 10;
+	else if (0 == strcasecmp(p_unit, "mB"))
+		*bytes <<= 20;
+	else if (0 == strcasecmp(p_unit, "GB"))
+		*bytes <<= 30;
+	else if (0 == strcasecmp(p_unit, "TB"))
+		*bytes <<= 40;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: Read amount of memory in bytes from a string in /proc file.       *
+ *          For example, reading "VmSize:   176712 kB" from /proc/1/status    *
+ *          will produce a result 176712*1024 = 180953088 bytes               *
+ *                                                                            *
+ * Parameters:                                                                *
+ *     f     - [IN] file to read from                                         *
+ *     label - [IN] label to look for, e.g. "VmData:\t"                       *
+ *     guard - [IN] label before which to stop, e.g. "VmStk:\t" (optional)    *
+ *     bytes - [OUT] result in bytes                                          *
+ *                                                                            *
+ * Return value: SUCCEED - successful reading,                                *
+ *               NOTSUPPORTED - the search string was not found. For example, *
+ *                              /proc/NNN/status files for kernel threads do  *
+ *                              not contain "VmSize:" string.                 *
+ *               FAIL - the search string was found but could not be parsed.  *
+ *                                                                            *
+ ******************************************************************************/
+int	byte_value_from_proc_file(FILE *f, const char *label, const char *guard, zbx_uint64_t *bytes)
+{
+	char	buf[MAX_STRING_LEN];
+	size_t	label_len, guard_len;
+	long	pos = 0;
+	int	ret = NOTSUPPORTED;
 
-		if (0 != feof(f_cmd))
-			break;
+	label_len = strlen(label);
 
-		line_alloc *= 2;
-		*line = (char *)zbx_realloc(*line, line_alloc + 2);
+	if (NULL != guard)
+	{
+		guard_len = strlen(guard);
+		if (0 > (pos = ftell(f)))
+			return FAIL;
 	}
 
-	if (0 == ferror(f_cmd))
+	while (NULL != fgets(buf, (int)sizeof(buf), f))
 	{
-		if (0 == *line_offset || '\0' != (*line)[*line_offset - 1])
-			(*line)[(*line_offset)++] = '\0';
-		if (1 == *line_offset || '\0' != (*line)[*line_offset - 2])
-			(*line)[(*line_offset)++] = '\0';
+		if (NULL != guard)
+		{
+			if (0 == strncmp(buf, guard, guard_len))
+			{
+				if (0 != fseek(f, pos, SEEK_SET))
+					ret = FAIL;
+				break;
+			}
 
-		return SUCCEED;
+			if (0 > (pos = ftell(f)))
+			{
+				ret = FAIL;
+				break;
+			}
+		}
+
+		if (0 != strncmp(buf, label, label_len))
+			continue;
+
+		ret = byte_value_from_proc_line(buf + label_len, bytes);
+		break;
 	}
 
-	zbx_free(*line);
+	return ret;
+}
+
+static int	get_total_memory(zbx_uint64_t *total_memory)
+{
+	FILE	*f;
+	int	ret = FAIL;
 
-	return FAIL;
+	if (NULL != (f = fopen("/proc/meminfo", "r")))
+	{
+		ret = byte_value_from_proc_file(f, "MemTotal:", NULL, total_memory);
+		zbx_fclose(f);
+	}
+
+	return ret;
 }
 
-static int	cmp_status(FILE *f_stat, const char *procname)
+/* /proc/<pid>/status memory fields cached by process snapshot */
+static const char	*proc_vm_labels[] = {"VmPeak:\t", "VmSize:\t", "VmLck:\t", "VmPin:\t", "VmHWM:\t", "VmRSS:\t",
+		"VmData:\t", "VmStk:\t", "VmExe:\t", "VmLib:\t", "VmPTE:\t", "VmSwap:\t"};
+
+#define ZBX_PROC_VM_NUM			ARRSIZE(proc_vm_labels)
+
+/* time in seconds during which the process snapshot is reused by proc.num[] and proc.mem[] checks */
+#define ZBX_PROC_SNAPSHOT_TTL		1.0
+
+#define ZBX_PROC_SNAPSHOT_STATUS	0x01
+#define ZBX_PROC_SNAPSHOT_CMDLINE	0x02
+#define ZBX_PROC_SNAPSHOT_GONE		0x04
+#define ZBX_PROC_SNAPSHOT_STAT		0x08
+
+typedef struct
 {
-	char	tmp[MAX_STRING_LEN];
+	pid_t		pid;
+	unsigned char	flags;
+
+	/* process start time from /proc/<pid>/stat, loaded with ZBX_PROC_SNAPSHOT_STAT flag */
+	zbx_uint64_t	starttime;
 
-	rewind(f_stat);
+	/* data parsed from /proc/<pid>/status, loaded with ZBX_PROC_SNAPSHOT_STATUS flag */
+	char		*name;
+	uid_t		uid;
+	char		state;
+	zbx_uint64_t	vm[ZBX_PROC_VM_NUM];
+	int		vm_res[ZBX_PROC_VM_NUM];
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	/* data from /proc/<pid>/cmdline, loaded with ZBX_PROC_SNAPSHOT_CMDLINE flag */
+
+	/* the process name taken from the 0th argument */
+	char		*name_arg0;
+
+	/* process command line in format <arg0> <arg1> ... <argN>\0 */
+	char		*cmdline;
+}
+zbx_proc_snapshot_entry_t;
+
+static zbx_vector_ptr_t	proc_snapshot;
+static double		proc_snapshot_time;
+static int		proc_snapshot_init = 0;
+
+static void	proc_snapshot_entry_free(zbx_proc_snapshot_entry_t *entry)
+{
+	zbx_free(entry->name);
+	zbx_free(entry->name_arg0);
+	zbx_free(entry->cmdline);
+
+	zbx_free(entry);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads whole /proc file into a buffer                              *
+ *                                                                            *
+ * Parameters: path - [IN] the file path                                      *
+ *             data - [OUT] the file contents, terminated with two NUL        *
+ *                          characters unless already terminated so           *
+ *             size - [OUT] the number of bytes in buffer including the       *
+ *                          added terminating characters                      *
+ *                                                                            *
+ * Return value: SUCCEED - the file was read successfully                     *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The buffer is allocated by this function and must be freed by    *
+ *           the caller.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_read_file(const char *path, char **data, size_t *size)
+{
+	int	fd;
+	ssize_t	n;
+	size_t	data_alloc = ZBX_KIBIBYTE;
+
+	if (-1 == (fd = open(path, O_RDONLY)))
+		return FAIL;
+
+	*size = 0;
+	*data = (char *)zbx_malloc(NULL, data_alloc + 2);
+
+	while (0 < (n = read(fd, *data + *size, data_alloc - *size)))
 	{
-		if (0 != strncmp(tmp, "Name:\t", 6))
-			continue;
+		*size += (size_t)n;
 
-		zbx_rtrim(tmp + 6, "\n");
-		if (0 == strcmp(tmp + 6, procname))
-			return SUCCEED;
-		break;
+		if (*size == data_alloc)
+		{
+			data_alloc *= 2;
+			*data = (char *)zbx_realloc(*data, data_alloc + 2);
+		}
 	}
 
-	return FAIL;
+	close(fd);
+
+	if (-1 == n)
+	{
+		zbx_free(*data);
+		return FAIL;
+	}
+
+	if (0 == *size || '\0' != (*data)[*size - 1])
+		(*data)[(*size)++] = '\0';
+	if (1 == *size || '\0' != (*data)[*size - 2])
+		(*data)[(*size)++] = '\0';
+
+	return SUCCEED;
 }
 
-static int	check_procname(FILE *f_cmd, FILE *f_stat, const char *procname)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads process start time from /proc/<pid>/stat file               *
+ *                                                                            *
+ * Parameters: pid       - [IN] the process identifier                        *
+ *             starttime - [OUT] the process start time in clock ticks after  *
+ *                                system boot                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the start time was read                            *
+ *               FAIL    - the process has exited or cannot be accessed       *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_read_starttime(pid_t pid, zbx_uint64_t *starttime)
 {
-	char	*tmp = NULL, *p;
-	size_t	l;
-	int	ret = SUCCEED;
+	char	tmp[MAX_STRING_LEN], *ptr, *end;
+	int	fd, n;
 
-	if (NULL == procname || '\0' == *procname)
-		return SUCCEED;
+	zbx_snprintf(tmp, sizeof(tmp), "/proc/%d/stat", (int)pid);
 
-	/* process name in /proc/[pid]/status contains limited number of characters */
-	if (SUCCEED == cmp_status(f_stat, procname))
-		return SUCCEED;
+	if (-1 == (fd = open(tmp, O_RDONLY)))
+		return FAIL;
+
+	n = read(fd, tmp, sizeof(tmp) - 1);
+	close(fd);
+
+	if (-1 == n)
+		return FAIL;
 
-	if (SUCCEED == get_cmdline(f_cmd, &tmp, &l))
+	tmp[n] = '\0';
+
+	/* skip to the end of process name to avoid dealing with possible spaces in process name */
+	if (NULL == (ptr = strrchr(tmp, ')')))
+		return FAIL;
+
+	/* start time is the 22nd field, the process name being the 2nd */
+	for (n = 2; n < 22; n++)
 	{
-		if (NULL == (p = strrchr(tmp, '/')))
-			p = tmp;
-		else
-			p++;
+		if (NULL == (ptr = strchr(ptr, ' ')))
+			return FAIL;
+		ptr++;
+	}
+
+	if (NULL == (end = strchr(ptr, ' ')))
+		end = ptr + strlen(ptr);
 
-		if (0 == strcmp(p, procname))
-			goto clean;
+	return is_uint64_n(ptr, end - ptr, starttime);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads process start time into snapshot entry                      *
+ *                                                                            *
+ * Return value: SUCCEED - the start time was loaded                          *
+ *               FAIL    - the process has exited or cannot be accessed       *
+ *                                                                            *
+ * Comments: The start time is loaded together with the first other data      *
+ *           of the process, so it can be told apart from a later process     *
+ *           reusing the same pid.                                            *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_snapshot_load_stat(zbx_proc_snapshot_entry_t *entry)
+{
+	if (0 != (entry->flags & ZBX_PROC_SNAPSHOT_STAT))
+		return SUCCEED;
+
+	if (0 != (entry->flags & ZBX_PROC_SNAPSHOT_GONE))
+		return FAIL;
+
+	if (SUCCEED != proc_read_starttime(entry->pid, &entry->starttime))
+	{
+		entry->flags |= ZBX_PROC_SNAPSHOT_GONE;
+		return FAIL;
 	}
 
-	ret = FAIL;
-clean:
-	zbx_free(tmp);
+	entry->flags |= ZBX_PROC_SNAPSHOT_STAT;
 
-	return ret;
+	return SUCCEED;
 }
 
-static int	check_user(FILE *f_stat, struct passwd *usrinfo)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads process name, user, state and memory usage from            *
+ *          /proc/<pid>/status file into snapshot entry                       *
+ *                                                                            *
+ * Return value: SUCCEED - the data was loaded                                *
+ *               FAIL    - the process has exited or cannot be accessed       *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_snapshot_load_status(zbx_proc_snapshot_entry_t *entry)
 {
-	char	tmp[MAX_STRING_LEN], *p, *p1;
-	uid_t	uid;
+	char	tmp[MAX_STRING_LEN], *data, *line, *next;
+	size_t	size, i;
 
-	if (NULL == usrinfo)
+	if (0 != (entry->flags & ZBX_PROC_SNAPSHOT_STATUS))
 		return SUCCEED;
 
-	rewind(f_stat);
+	if (SUCCEED != proc_snapshot_load_stat(entry))
+		return FAIL;
+
+	zbx_snprintf(tmp, sizeof(tmp), "/proc/%d/status", (int)entry->pid);
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	if (SUCCEED != proc_read_file(tmp, &data, &size))
 	{
-		if (0 != strncmp(tmp, "Uid:\t", 5))
-			continue;
+		entry->flags |= ZBX_PROC_SNAPSHOT_GONE;
+		return FAIL;
+	}
 
-		p = tmp + 5;
+	entry->uid = (uid_t)-1;
 
-		if (NULL != (p1 = strchr(p, '\t')))
-			*p1 = '\0';
+	for (i = 0; i < ZBX_PROC_VM_NUM; i++)
+		entry->vm_res[i] = NOTSUPPORTED;
 
-		uid = (uid_t)atoi(p);
+	for (line = data; '\0' != *line; line = next)
+	{
+		if (NULL != (next = strchr(line, '\n')))
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
 
-		if (usrinfo->pw_uid == uid)
-			return SUCCEED;
-		break;
+		if (0 == strncmp(line, "Vm", 2))
+		{
+			for (i = 0; i < ZBX_PROC_VM_NUM; i++)
+			{
+				size_t	len = strlen(proc_vm_labels[i]);
+
+				if (0 == strncmp(line, proc_vm_labels[i], len))
+				{
+					entry->vm_res[i] = byte_value_from_proc_line(line + len, &entry->vm[i]);
+					break;
+				}
+			}
+		}
+		else if (0 == strncmp(line, "Name:\t", 6))
+		{
+			if (NULL == entry->name)
+				entry->name = zbx_strdup(NULL, line + 6);
+		}
+		else if (0 == strncmp(line, "State:\t", 7))
+		{
+			entry->state = line[7];
+		}
+		else if (0 == strncmp(line, "Uid:\t", 5))
+		{
+			entry->uid = (uid_t)atoi(line + 5);
+		}
 	}
 
-	return FAIL;
+	zbx_free(data);
+	entry->flags |= ZBX_PROC_SNAPSHOT_STATUS;
+
+	return SUCCEED;
 }
 
-static int	check_proccomm(FILE *f_cmd, const char *proccomm)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads process command line from /proc/<pid>/cmdline file into     *
+ *          snapshot entry                                                    *
+ *                                                                            *
+ * Return value: SUCCEED - the data was loaded                                *
+ *               FAIL    - the process has exited or cannot be accessed       *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_snapshot_load_cmdline(zbx_proc_snapshot_entry_t *entry)
 {
-	char	*tmp = NULL;
-	size_t	i, l;
-	int	ret = SUCCEED;
+	char	tmp[MAX_STRING_LEN], *ptr;
+	size_t	size, i;
 
-	if (NULL == proccomm || '\0' == *proccomm)
+	if (0 != (entry->flags & ZBX_PROC_SNAPSHOT_CMDLINE))
 		return SUCCEED;
 
-	if (SUCCEED == get_cmdline(f_cmd, &tmp, &l))
+	if (SUCCEED != proc_snapshot_load_stat(entry))
+		return FAIL;
+
+	zbx_snprintf(tmp, sizeof(tmp), "/proc/%d/cmdline", (int)entry->pid);
+
+	if (SUCCEED != proc_read_file(tmp, &entry->cmdline, &size))
 	{
-		for (i = 0, l -= 2; i < l; i++)
-			if ('\0' == tmp[i])
-				tmp[i] = ' ';
+		entry->flags |= ZBX_PROC_SNAPSHOT_GONE;
+		return FAIL;
+	}
 
-		if (NULL != zbx_regexp_match(tmp, proccomm, NULL))
-			goto clean;
+	if (NULL == (ptr = strrchr(entry->cmdline, '/')))
+		entry->name_arg0 = zbx_strdup(NULL, entry->cmdline);
+	else
+		entry->name_arg0 = zbx_strdup(NULL, ptr + 1);
+
+	/* according to proc(5) the arguments are separated by '\0' */
+	for (i = 0, size -= 2; i < size; i++)
+	{
+		if ('\0' == entry->cmdline[i])
+			entry->cmdline[i] = ' ';
 	}
 
-	ret = FAIL;
-clean:
-	zbx_free(tmp);
+	entry->flags |= ZBX_PROC_SNAPSHOT_CMDLINE;
 
-	return ret;
+	return SUCCEED;
 }
 
-static int	check_procstate(FILE *f_stat, int zbx_proc_stat)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns list of running processes                                 *
+ *                                                                            *
+ * Parameters: error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: The process snapshot or NULL if /proc could not be read.     *
+ *                                                                            *
+ * Comments: The /proc directory is scanned once per ZBX_PROC_SNAPSHOT_TTL    *
+ *           seconds and the resulting snapshot is shared by all proc.num[]   *
+ *           and proc.mem[] checks performed by this process meanwhile.       *
+ *           Process status and command line are read only when first        *
+ *           requested by a check and cached for the snapshot lifetime.       *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vector_ptr_t	*proc_snapshot_get(char **error)
 {
-	char	tmp[MAX_STRING_LEN], *p;
+	DIR				*dir;
+	struct dirent			*entries;
+	zbx_proc_snapshot_entry_t	*entry;
+	double				now;
+	pid_t				pid;
 
-	if (ZBX_PROC_STAT_ALL == zbx_proc_stat)
-		return SUCCEED;
+	now = zbx_time();
+
+	if (0 == proc_snapshot_init)
+	{
+		zbx_vector_ptr_create(&proc_snapshot);
+		proc_snapshot_init = 1;
+	}
+	else if (now >= proc_snapshot_time && now < proc_snapshot_time + ZBX_PROC_SNAPSHOT_TTL)
+		return &proc_snapshot;
 
-	rewind(f_stat);
+	zbx_vector_ptr_clear_ext(&proc_snapshot, (zbx_clean_func_t)proc_snapshot_entry_free);
 
-	while (NULL != fgets(tmp, (int)sizeof(tmp), f_stat))
+	if (NULL == (dir = opendir("/proc")))
 	{
-		if (0 != strncmp(tmp, "State:\t", 7))
+		*error = zbx_dsprintf(NULL, "Cannot open /proc: %s", zbx_strerror(errno));
+		proc_snapshot_time = 0;
+		return NULL;
+	}
+
+	while (NULL != (entries = readdir(dir)))
+	{
+		if (0 == (pid = (pid_t)atoi(entries->d_name)))
 			continue;
 
-		p = tmp + 7;
+		entry = (zbx_proc_snapshot_entry_t *)zbx_malloc(NULL, sizeof(zbx_proc_snapshot_entry_t));
+		memset(entry, 0, sizeof(zbx_proc_snapshot_entry_t));
+		entry->pid = pid;
 
-		switch (zbx_proc_stat)
-		{
-			case ZBX_PROC_STAT_RUN:
-				return ('R' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_SLEEP:
-				return ('S' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_ZOMB:
-				return ('Z' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_DISK:
-				return ('D' == *p) ? SUCCEED : FAIL;
-			case ZBX_PROC_STAT_TRACE:
-				return ('T' == *p) ? SUCCEED : FAIL;
-			default:
-				return FAIL;
-		}
+		zbx_vector_ptr_append(&proc_snapshot, entry);
 	}
 
-	return FAIL;
+	closedir(dir);
+	proc_snapshot_time = now;
+
+	return &proc_snapshot;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: Read amount of memory in bytes from a string in /proc file.       *
- *          For example, reading "VmSize:   176712 kB" from /proc/1/status    *
- *          will produce a result 176712*1024 = 180953088 bytes               *
+ * Purpose: checks if the snapshot process is still running                   *
  *                                                                            *
- * Parameters:                                                                *
- *     f     - [IN] file to read from                                         *
- *     label - [IN] label to look for, e.g. "VmData:\t"                       *
- *     guard - [IN] label before which to stop, e.g. "VmStk:\t" (optional)    *
- *     bytes - [OUT] result in bytes                                          *
+ * Return value: SUCCEED - the process exists                                 *
+ *               FAIL    - the process has exited since the snapshot was made *
  *                                                                            *
- * Return value: SUCCEED - successful reading,                                *
- *               NOTSUPPORTED - the search string was not found. For example, *
- *                              /proc/NNN/status files for kernel threads do  *
- *                              not contain "VmSize:" string.                 *
- *               FAIL - the search string was found but could not be parsed.  *
+ * Comments: The snapshot is reused for up to ZBX_PROC_SNAPSHOT_TTL seconds,  *
+ *           so processes matched from it are checked before being counted.   *
+ *           The process start time is compared with the one recorded when    *
+ *           the entry data was loaded to detect pid reuse.                   *
  *                                                                            *
  ******************************************************************************/
-int	byte_value_from_proc_file(FILE *f, const char *label, const char *guard, zbx_uint64_t *bytes)
+static int	proc_snapshot_check_alive(zbx_proc_snapshot_entry_t *entry)
 {
-	char	buf[MAX_STRING_LEN], *p_value, *p_unit;
-	size_t	label_len, guard_len;
-	long	pos = 0;
-	int	ret = NOTSUPPORTED;
+	zbx_uint64_t	starttime;
 
-	label_len = strlen(label);
-	p_value = buf + label_len;
+	if (0 != (entry->flags & ZBX_PROC_SNAPSHOT_GONE))
+		return FAIL;
 
-	if (NULL != guard)
+	if (0 == (entry->flags & ZBX_PROC_SNAPSHOT_STAT))
+		return proc_snapshot_load_stat(entry);
+
+	if (SUCCEED != proc_read_starttime(entry->pid, &starttime) || starttime != entry->starttime)
 	{
-		guard_len = strlen(guard);
-		if (0 > (pos = ftell(f)))
-			return FAIL;
+		entry->flags |= ZBX_PROC_SNAPSHOT_GONE;
+		return FAIL;
 	}
 
-	while (NULL != fgets(buf, (int)sizeof(buf), f))
-	{
-		if (NULL != guard)
-		{
-			if (0 == strncmp(buf, guard, guard_len))
-			{
-				if (0 != fseek(f, pos, SEEK_SET))
-					ret = FAIL;
-				break;
-			}
+	return SUCCEED;
+}
 
-			if (0 > (pos = ftell(f)))
-			{
-				ret = FAIL;
-				break;
-			}
-		}
+static int	proc_snapshot_match_name(zbx_proc_snapshot_entry_t *entry, const char *procname)
+{
+	if (NULL == procname || '\0' == *procname)
+		return SUCCEED;
 
-		if (0 != strncmp(buf, label, label_len))
-			continue;
+	/* process name in /proc/[pid]/status contains limited number of characters */
+	if (SUCCEED == proc_snapshot_load_status(entry) && NULL != entry->name && 0 == strcmp(entry->name, procname))
+		return SUCCEED;
 
-		if (NULL == (p_unit = strrchr(p_value, ' ')))
-		{
-			ret = FAIL;
-			break;
-		}
+	if (SUCCEED == proc_snapshot_load_cmdline(entry) && 0 == strcmp(entry->name_arg0, procname))
+		return SUCCEED;
 
-		*p_unit++ = '\0';
+	return FAIL;
+}
 
-		while (' ' == *p_value)
-			p_value++;
+static int	proc_snapshot_match_user(zbx_proc_snapshot_entry_t *entry, const struct passwd *usrinfo)
+{
+	if (NULL == usrinfo)
+		return SUCCEED;
 
-		if (FAIL == is_uint64(p_value, bytes))
-		{
-			ret = FAIL;
-			break;
-		}
+	if (SUCCEED == proc_snapshot_load_status(entry) && usrinfo->pw_uid == entry->uid)
+		return SUCCEED;
 
-		zbx_rtrim(p_unit, "\n");
+	return FAIL;
+}
 
-		if (0 == strcasecmp(p_unit, "kB"))
-			*bytes <<= 10;
-		else if (0 == strcasecmp(p_unit, "mB"))
-			*bytes <<= 20;
-		else if (0 == strcasecmp(p_unit, "GB"))
-			*bytes <<= 30;
-		else if (0 == strcasecmp(p_unit, "TB"))
-			*bytes <<= 40;
+static int	proc_snapshot_match_cmdline(zbx_proc_snapshot_entry_t *entry, const char *proccomm)
+{
+	if (NULL == proccomm || '\0' == *proccomm)
+		return SUCCEED;
 
-		ret = SUCCEED;
-		break;
-	}
+	if (SUCCEED == proc_snapshot_load_cmdline(entry) && NULL != zbx_regexp_match(entry->cmdline, proccomm, NULL))
+		return SUCCEED;
 
-	return ret;
+	return FAIL;
 }
 
-static int	get_total_memory(zbx_uint64_t *total_memory)
+static int	proc_snapshot_match_state(zbx_proc_snapshot_entry_t *entry, int zbx_proc_stat)
 {
-	FILE	*f;
-	int	ret = FAIL;
+	if (ZBX_PROC_STAT_ALL == zbx_proc_stat)
+		return SUCCEED;
 
-	if (NULL != (f = fopen("/proc/meminfo", "r")))
+	if (SUCCEED != proc_snapshot_load_status(entry))
+		return FAIL;
+
+	switch (zbx_proc_stat)
 	{
-		ret = byte_value_from_proc_file(f, "MemTotal:", NULL, total_memory);
-		zbx_fclose(f);
+		case ZBX_PROC_STAT_RUN:
+			return ('R' == entry->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_SLEEP:
+			return ('S' == entry->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_ZOMB:
+			return ('Z' == entry->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_DISK:
+			return ('D' == entry->state) ? SUCCEED : FAIL;
+		case ZBX_PROC_STAT_TRACE:
+			return ('T' == entry->state) ? SUCCEED : FAIL;
+		default:
+			return FAIL;
 	}
+}
 
-	return ret;
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets cached process memory value                                  *
+ *                                                                            *
+ * Parameters: entry - [IN] the process snapshot entry with loaded status     *
+ *             label - [IN] the memory label, e.g. "VmData:\t"                *
+ *             bytes - [OUT] result in bytes                                  *
+ *                                                                            *
+ * Return value: see byte_value_from_proc_file()                              *
+ *                                                                            *
+ ******************************************************************************/
+static int	proc_snapshot_get_vm(const zbx_proc_snapshot_entry_t *entry, const char *label, zbx_uint64_t *bytes)
+{
+	size_t	i;
+
+	for (i = 0; i < ZBX_PROC_VM_NUM; i++)
+	{
+		if (0 != strcmp(proc_vm_labels[i], label))
+			continue;
+
+		if (SUCCEED == entry->vm_res[i])
+			*bytes = entry->vm[i];
+
+		return entry->vm_res[i];
+	}
+
+	return NOTSUPPORTED;
 }
 
 int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
@@ -356,17 +680,16 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 #define ZBX_VMEXE	12
 #define ZBX_VMPTE	13
 
-	char		tmp[MAX_STRING_LEN], *procname, *proccomm, *param;
-	DIR		*dir;
-	struct dirent	*entries;
-	struct passwd	*usrinfo;
-	FILE		*f_cmd = NULL, *f_stat = NULL;
-	zbx_uint64_t	mem_size = 0, byte_value = 0, total_memory;
-	double		pct_size = 0.0, pct_value = 0.0;
-	int		do_task, res, proccount = 0, invalid_user = 0, invalid_read = 0;
-	int		mem_type_tried = 0, mem_type_code;
-	char		*mem_type = NULL;
-	const char	*mem_type_search = NULL;
+	char				*procname, *proccomm, *param, *error = NULL;
+	struct passwd			*usrinfo;
+	zbx_vector_ptr_t		*snapshot;
+	zbx_proc_snapshot_entry_t	*entry;
+	zbx_uint64_t			mem_size = 0, byte_value = 0, total_memory;
+	double				pct_size = 0.0, pct_value = 0.0;
+	int				do_task, res, proccount = 0, invalid_user = 0, invalid_read = 0, i;
+	int				mem_type_tried = 0, mem_type_code;
+	char				*mem_type = NULL;
+	const char			*mem_type_search = NULL;
 
 	if (5 < request->nparam)
 	{
@@ -513,41 +836,31 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 		}
 	}
 
-	if (NULL == (dir = opendir("/proc")))
+	if (NULL == (snapshot = proc_snapshot_get(&error)))
 	{
-		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot open /proc: %s", zbx_strerror(errno)));
+		SET_MSG_RESULT(result, error);
 		return SYSINFO_RET_FAIL;
 	}
 
-	while (NULL != (entries = readdir(dir)))
+	for (i = 0; i < snapshot->values_num; i++)
 	{
-		zbx_fclose(f_cmd);
-		zbx_fclose(f_stat);
+		entry = (zbx_proc_snapshot_entry_t *)snapshot->values[i];
 
-		if (0 == atoi(entries->d_name))
+		if (FAIL == proc_snapshot_match_name(entry, procname))
 			continue;
 
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/cmdline", entries->d_name);
-
-		if (NULL == (f_cmd = fopen(tmp, "r")))
+		if (FAIL == proc_snapshot_match_user(entry, usrinfo))
 			continue;
 
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/status", entries->d_name);
-
-		if (NULL == (f_stat = fopen(tmp, "r")))
-			continue;
-
-		if (FAIL == check_procname(f_cmd, f_stat, procname))
+		if (FAIL == proc_snapshot_match_cmdline(entry, proccomm))
 			continue;
 
-		if (FAIL == check_user(f_stat, usrinfo))
+		if (SUCCEED != proc_snapshot_load_status(entry))
 			continue;
 
-		if (FAIL == check_proccomm(f_cmd, proccomm))
+		if (FAIL == proc_snapshot_check_alive(entry))
 			continue;
 
-		rewind(f_stat);
-
 		if (0 == mem_type_tried)
 			mem_type_tried = 1;
 
@@ -565,7 +878,7 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 			case ZBX_VMSTK:
 			case ZBX_VMEXE:
 			case ZBX_VMPTE:
-				res = byte_value_from_proc_file(f_stat, mem_type_search, NULL, &byte_value);
+				res = proc_snapshot_get_vm(entry, mem_type_search, &byte_value);
 
 				if (NOTSUPPORTED == res)
 					continue;
@@ -580,24 +893,18 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 				{
 					zbx_uint64_t	m;
 
-					/* VmData, VmStk and VmExe follow in /proc/PID/status file in that order. */
-					/* Therefore we do not rewind f_stat between calls. */
-
 					mem_type_search = "VmData:\t";
 
-					if (SUCCEED == (res = byte_value_from_proc_file(f_stat, mem_type_search, NULL,
-							&byte_value)))
+					if (SUCCEED == (res = proc_snapshot_get_vm(entry, mem_type_search, &byte_value)))
 					{
 						mem_type_search = "VmStk:\t";
 
-						if (SUCCEED == (res = byte_value_from_proc_file(f_stat, mem_type_search,
-								NULL, &m)))
+						if (SUCCEED == (res = proc_snapshot_get_vm(entry, mem_type_search, &m)))
 						{
 							byte_value += m;
 							mem_type_search = "VmExe:\t";
 
-							if (SUCCEED == (res = byte_value_from_proc_file(f_stat,
-									mem_type_search, NULL, &m)))
+							if (SUCCEED == (res = proc_snapshot_get_vm(entry, mem_type_search, &m)))
 							{
 								byte_value += m;
 							}
@@ -622,7 +929,7 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 				break;
 			case ZBX_PMEM:
 				mem_type_search = "VmRSS:\t";
-				res = byte_value_from_proc_file(f_stat, mem_type_search, NULL, &byte_value);
+				res = proc_snapshot_get_vm(entry, mem_type_search, &byte_value);
 
 				if (SUCCEED == res)
 				{
@@ -670,10 +977,6 @@ int	PROC_MEM(AGENT_REQUEST *request, AGENT_RESULT *result)
 		}
 	}
 clean:
-	zbx_fclose(f_cmd);
-	zbx_fclose(f_stat);
-	closedir(dir);
-
 	if ((0 == proccount && 0 != mem_type_tried) || 0 != invalid_read)
 	{
 		char	*s;
@@ -720,12 +1023,11 @@ out:
 
 int	PROC_NUM(AGENT_REQUEST *request, AGENT_RESULT *result)
 {
-	char		tmp[MAX_STRING_LEN], *procname, *proccomm, *param;
-	DIR		*dir;
-	struct dirent	*entries;
-	struct passwd	*usrinfo;
-	FILE		*f_cmd = NULL, *f_stat = NULL;
-	int		proccount = 0, invalid_user = 0, zbx_proc_stat;
+	char				*procname, *proccomm, *param, *error = NULL;
+	struct passwd			*usrinfo;
+	zbx_vector_ptr_t		*snapshot;
+	zbx_proc_snapshot_entry_t	*entry;
+	int				proccount = 0, invalid_user = 0, zbx_proc_stat, i;
 
 	if (4 < request->nparam)
 	{
@@ -780,47 +1082,33 @@ int	PROC_NUM(AGENT_REQUEST *request, AGENT_RESULT *result)
 	if (1 == invalid_user)	/* handle 0 for non-existent user after all parameters have been parsed and validated */
 		goto out;
 
-	if (NULL == (dir = opendir("/proc")))
+	if (NULL == (snapshot = proc_snapshot_get(&error)))
 	{
-		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot open /proc: %s", zbx_strerror(errno)));
+		SET_MSG_RESULT(result, error);
 		return SYSINFO_RET_FAIL;
 	}
 
-	while (NULL != (entries = readdir(dir)))
+	for (i = 0; i < snapshot->values_num; i++)
 	{
-		zbx_fclose(f_cmd);
-		zbx_fclose(f_stat);
+		entry = (zbx_proc_snapshot_entry_t *)snapshot->values[i];
 
-		if (0 == atoi(entries->d_name))
+		if (FAIL == proc_snapshot_match_name(entry, procname))
 			continue;
 
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/cmdline", entries->d_name);
-
-		if (NULL == (f_cmd = fopen(tmp, "r")))
+		if (FAIL == proc_snapshot_match_user(entry, usrinfo))
 			continue;
 
-		zbx_snprintf(tmp, sizeof(tmp), "/proc/%s/status", entries->d_name);
-
-		if (NULL == (f_stat = fopen(tmp, "r")))
+		if (FAIL == proc_snapshot_match_cmdline(entry, proccomm))
 			continue;
 
-		if (FAIL == check_procname(f_cmd, f_stat, procname))
+		if (FAIL == proc_snapshot_match_state(entry, zbx_proc_stat))
 			continue;
 
-		if (FAIL == check_user(f_stat, usrinfo))
-			continue;
-
-		if (FAIL == check_proccomm(f_cmd, proccomm))
-			continue;
-
-		if (FAIL == check_procstate(f_stat, zbx_proc_stat))
+		if (FAIL == proc_snapshot_check_alive(entry))
 			continue;
 
 		proccount++;
 	}
-	zbx_fclose(f_cmd);
-	zbx_fclose(f_stat);
-	closedir(dir);
 out:
 	SET_UI64_RESULT(result, proccount);
 
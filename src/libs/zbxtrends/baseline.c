@@ -23,62 +23,34 @@
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get baseline data for common period/season combinations           *
+ * Purpose: get baseline data ranges for common period/season combinations    *
  *                                                                            *
- * Parameters: itemid      - [IN] the item identifier                         *
- *             table       - [IN] the trends table name                       *
- *             now         - [IN] the current timestamp                       *
+ * Parameters: now         - [IN] the current timestamp                       *
  *             period      - [IN] the data period                             *
  *             season_num  - [IN] the number of seasons                       *
  *             season_unit - [IN] the season time unit                        *
- *             skip        - [IN] how many data periods to skip               *
- *             values      - [OUT] the average data period value in each      *
- *                                 season                                     *
- *             index      - [OUT] the index of returned values, starting      *
- *                                with 0. It will have values be from 0 to    *
- *                                <seasons num> + 1 - <skip> with holes for   *
- *                                periods without data.                       *
+ *             ranges      - [OUT] the data period range in each season       *
  *             error       - [OUT] the error message if parsing failed        *
  *                                                                            *
- * Return value: SUCCEED - data were retrieved successfully                   *
+ * Return value: SUCCEED - ranges were calculated successfully                *
  *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static int	baseline_get_common_data(zbx_uint64_t itemid, const char *table, time_t now, const char *period,
-		int season_num, zbx_time_unit_t season_unit, int skip, zbx_vector_dbl_t *values,
-		zbx_vector_uint64_t *index, char **error)
+static int	baseline_get_common_ranges(time_t now, const char *period, int season_num,
+		zbx_time_unit_t season_unit, zbx_vector_trend_range_t *ranges, char **error)
 {
-	int			i, start, end;
-	double			value_dbl;
+	int			i;
+	zbx_trend_range_t	range;
 	struct tm		tm, tm_now;
 
 	tm_now = *localtime(&now);
 
 	for (i = 0; i < season_num; i++)
 	{
-		if (FAIL == zbx_trends_parse_range(now, period, &start, &end, error))
+		if (FAIL == zbx_trends_parse_range(now, period, &range.start, &range.end, error))
 			return FAIL;
 
-		if (skip <= i)
-		{
-			zbx_trend_state_t	state;
-
-			state = zbx_trends_get_avg(table, itemid, start, end, &value_dbl);
-
-			if (ZBX_TREND_STATE_NORMAL != state)
-			{
-				if (0 == i || ZBX_TREND_STATE_NODATA != state)
-				{
-					*error = zbx_strdup(NULL, zbx_trends_error(state));
-					return FAIL;
-				}
-			}
-			else
-			{
-				zbx_vector_dbl_append(values, value_dbl);
-				zbx_vector_uint64_append(index, (zbx_uint64_t)(i - skip));
-			}
-		}
+		zbx_vector_trend_range_append(ranges, range);
 
 		tm = tm_now;
 		zbx_tm_sub(&tm, i + 1, season_unit);
@@ -95,71 +67,44 @@ static int	baseline_get_common_data(zbx_uint64_t itemid, const char *table, time
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get baseline data for week based periods in a year                *
+ * Purpose: get baseline data ranges for week based periods in a year         *
  *                                                                            *
- * Parameters: itemid     - [IN] the item identifier                          *
- *             table      - [IN] the trends table name                        *
- *             now        - [IN] the current timestamp                        *
+ * Parameters: now        - [IN] the current timestamp                        *
  *             period     - [IN] the data period                              *
  *             season_num - [IN] the number of seasons                        *
- *             skip       - [IN] how many data periods to skip                *
- *             values     - [OUT] the average data period value in each       *
- *                                season                                      *
- *             index      - [OUT] the index of returned values, starting      *
- *                                with 0. It will have values be from 0 to    *
- *                                <seasons num> + 1 - <skip> with holes for   *
- *                                periods without data.                       *
+ *             ranges     - [OUT] the data period range in each season        *
  *             error      - [OUT] the error message if parsing failed         *
  *                                                                            *
- * Return value: SUCCEED - data were retrieved successfully                   *
+ * Return value: SUCCEED - ranges were calculated successfully                *
  *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, time_t now, const char *period,
-		int season_num, int skip, zbx_vector_dbl_t *values, zbx_vector_uint64_t *index, char **error)
+static int	baseline_get_isoyear_ranges(time_t now, const char *period, int season_num,
+		zbx_vector_trend_range_t *ranges, char **error)
 {
-	int		i, start, end, period_num;
-	time_t		time_tmp;
-	double		value_dbl;
-	struct tm	tm_end, tm_start;
-	size_t		len;
-	zbx_time_unit_t	period_unit;
+	int			i, period_num;
+	time_t			time_tmp;
+	struct tm		tm_end, tm_start;
+	size_t			len;
+	zbx_time_unit_t		period_unit;
+	zbx_trend_range_t	range;
 
 	if (FAIL == zbx_tm_parse_period(period, &len, &period_num, &period_unit, error))
 		return FAIL;
 
-	if (FAIL == zbx_trends_parse_range(now, period, &start, &end, error))
+	if (FAIL == zbx_trends_parse_range(now, period, &range.start, &range.end, error))
 		return FAIL;
 
-	time_tmp = end;
+	time_tmp = range.end;
 	tm_end = *localtime(&time_tmp);
 
 	for (i = 0; i < season_num; i++)
 	{
-		if (skip <= i)
-		{
-			zbx_trend_state_t	state;
-
-			state = zbx_trends_get_avg(table, itemid, start, end, &value_dbl);
-
-			if (ZBX_TREND_STATE_NORMAL != state)
-			{
-				if (0 == i || ZBX_TREND_STATE_NODATA != state)
-				{
-					*error = zbx_strdup(NULL, zbx_trends_error(state));
-					return FAIL;
-				}
-			}
-			else
-			{
-				zbx_vector_dbl_append(values, value_dbl);
-				zbx_vector_uint64_append(index, (zbx_uint64_t)(i - skip));
-			}
-		}
+		zbx_vector_trend_range_append(ranges, range);
 
 		zbx_tm_sub(&tm_end, 1, ZBX_TIME_UNIT_ISOYEAR);
 
-		if (-1 == (end = (int)mktime(&tm_end)))
+		if (-1 == (range.end = (int)mktime(&tm_end)))
 		{
 			*error = zbx_dsprintf(*error, "cannot convert data period end time: %s", zbx_strerror(errno));
 			return FAIL;
@@ -170,7 +115,7 @@ static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, tim
 		zbx_tm_add(&tm_start, 1, ZBX_TIME_UNIT_HOUR);
 		zbx_tm_sub(&tm_start, period_num, period_unit);
 
-		if (-1 == (start = (int)mktime(&tm_start)))
+		if (-1 == (range.start = (int)mktime(&tm_start)))
 		{
 			*error = zbx_dsprintf(*error, "cannot convert data period start time: %s", zbx_strerror(errno));
 			return FAIL;
@@ -180,6 +125,66 @@ static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, tim
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get baseline data ranges for the specified period                 *
+ *                                                                            *
+ * Parameters: now         - [IN] the current timestamp                       *
+ *             period      - [IN] the data period                             *
+ *             season_num  - [IN] the number of seasons                       *
+ *             season_unit - [IN] the season time unit                        *
+ *             skip        - [IN] how many data periods to skip               *
+ *             ranges      - [OUT] the data period range in each season,      *
+ *                                 starting with the first not skipped period *
+ *             error       - [OUT] the error message if parsing failed        *
+ *                                                                            *
+ * Return value: SUCCEED - ranges were calculated successfully                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The returned ranges are the ones zbx_baseline_get_data() gets    *
+ *           data for, so the trends can be prefetched for multiple items.    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_baseline_get_ranges(time_t now, const char *period, int season_num, zbx_time_unit_t season_unit,
+		int skip, zbx_vector_trend_range_t *ranges, char **error)
+{
+	zbx_time_unit_t	period_unit;
+	int		ret;
+
+	if (FAIL == zbx_trends_parse_base(period, &period_unit, error))
+		return FAIL;
+
+	if (ZBX_TIME_UNIT_MONTH == season_unit && ZBX_TIME_UNIT_WEEK == period_unit)
+	{
+		*error = zbx_strdup(*error, "weekly data periods cannot be used with month seasons");
+		return FAIL;
+	}
+
+	if (season_unit < period_unit)
+	{
+		*error = zbx_strdup(*error, "season cannot be less than data period base");
+		return FAIL;
+	}
+
+	/* include the data period which might be skipped because of 'skip' parameter */
+	season_num++;
+
+	if (ZBX_TIME_UNIT_WEEK == period_unit && ZBX_TIME_UNIT_YEAR == season_unit)
+		ret = baseline_get_isoyear_ranges(now, period, season_num, ranges, error);
+	else
+		ret = baseline_get_common_ranges(now, period, season_num, season_unit, ranges, error);
+
+	if (SUCCEED == ret && 0 < skip)
+	{
+		skip = MIN(skip, ranges->values_num);
+		memmove(ranges->values, ranges->values + skip, sizeof(zbx_trend_range_t) *
+				(size_t)(ranges->values_num - skip));
+		ranges->values_num -= skip;
+	}
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get baseline data for the specified period                        *
@@ -205,18 +210,24 @@ static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, tim
  *           returned vector contains data for this period + data from        *
  *           seasons. To retrieve only data from seasons use pass 1 to skip   *
  *           parameter.                                                       *
+ *           The averages of all seasons are retrieved at once, with a single *
+ *           query for the trends not found in cache.                         *
  *                                                                            *
  ******************************************************************************/
 int	zbx_baseline_get_data(zbx_uint64_t itemid, unsigned char value_type, time_t now, const char *period,
 		int season_num, zbx_time_unit_t season_unit, int skip, zbx_vector_dbl_t *values,
 		zbx_vector_uint64_t *index, char **error)
 {
-	zbx_time_unit_t	period_unit;
-	int		ret = FAIL;
-	const char	*table;
+	int				i, ret = FAIL;
+	const char			*table;
+	zbx_vector_trend_range_t	ranges;
+	double				*avgs = NULL;
+	zbx_trend_state_t		*states = NULL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	zbx_vector_trend_range_create(&ranges);
+
 	switch (value_type)
 	{
 		case ITEM_VALUE_TYPE_FLOAT:
@@ -230,34 +241,37 @@ int	zbx_baseline_get_data(zbx_uint64_t itemid, unsigned char value_type, time_t
 			goto out;
 	}
 
-	if (FAIL == zbx_trends_parse_base(period, &period_unit, error))
+	if (FAIL == zbx_baseline_get_ranges(now, period, season_num, season_unit, skip, &ranges, error))
 		goto out;
 
-	if (ZBX_TIME_UNIT_MONTH == season_unit && ZBX_TIME_UNIT_WEEK == period_unit)
-	{
-		*error = zbx_strdup(*error, "weekly data periods cannot be used with month seasons");
-		goto out;
-	}
+	avgs = (double *)zbx_malloc(NULL, sizeof(double) * (size_t)(ranges.values_num + 1));
+	states = (zbx_trend_state_t *)zbx_malloc(NULL, sizeof(zbx_trend_state_t) * (size_t)(ranges.values_num + 1));
 
-	if (season_unit < period_unit)
-	{
-		*error = zbx_strdup(*error, "season cannot be less than data period base");
-		goto out;
-	}
-
-	/* include the data period which might be skipped because of 'skip' parameter */
-	season_num++;
+	zbx_trends_get_avgs(table, itemid, &ranges, avgs, states);
 
-	if (ZBX_TIME_UNIT_WEEK == period_unit && ZBX_TIME_UNIT_YEAR == season_unit)
+	for (i = 0; i < ranges.values_num; i++)
 	{
-		ret = baseline_get_isoyear_data(itemid, table, now, period, season_num, skip, values, index, error);
-	}
-	else
-	{
-		ret = baseline_get_common_data(itemid, table, now, period, season_num, season_unit, skip, values,
-				index, error);
+		if (ZBX_TREND_STATE_NORMAL != states[i])
+		{
+			if (0 == i + skip || ZBX_TREND_STATE_NODATA != states[i])
+			{
+				*error = zbx_strdup(NULL, zbx_trends_error(states[i]));
+				goto out;
+			}
+		}
+		else
+		{
+			zbx_vector_dbl_append(values, avgs[i]);
+			zbx_vector_uint64_append(index, (zbx_uint64_t)i);
+		}
 	}
+
+	ret = SUCCEED;
 out:
+	zbx_free(states);
+	zbx_free(avgs);
+	zbx_vector_trend_range_destroy(&ranges);
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s %s", __func__, zbx_result_string(ret), ZBX_NULL2EMPTY_STR(*error));
 
 	return ret;
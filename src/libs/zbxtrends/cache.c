@@ -33,8 +33,15 @@ typedef struct
 	int			start;		/* the period start time */
 	int			end;		/* the period end time */
 	zbx_trend_function_t	function;	/* the trends function */
-	zbx_trend_state_t	state;		/* the cached value state */
-	double			value;		/* the cached value */
+	zbx_trend_state_t	state;		/* the cached value state, unknown while rollup is loaded */
+	union
+	{
+		double			value;	/* the cached function value */
+		zbx_tfc_rollup_t	rollup;	/* the cached period rollup (rollup functions) */
+	}
+	cached;
+	zbx_uint32_t		revision;	/* the rollup loading revision, reset if the rollup was updated */
+						/* while being loaded                                           */
 	zbx_uint32_t		prev;		/* index of the previous LRU list or unused entry */
 	zbx_uint32_t		next;		/* index of the next LRU list or unused entry */
 	zbx_uint32_t		prev_value;	/* index of the previous value list */
@@ -61,6 +68,8 @@ typedef struct
 	zbx_uint64_t	hits;
 	zbx_uint64_t	misses;
 	zbx_uint64_t	items_num;
+	zbx_uint32_t	rollup_revision;	/* the last rollup loading revision */
+	int		trends_syncing;		/* number of trend flushes in progress */
 }
 zbx_tfc_t;
 
@@ -313,6 +322,51 @@ static zbx_tfc_data_t	*tfc_index_add(zbx_tfc_data_t *data_local)
 	return data;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find or add item value data                                       *
+ *                                                                            *
+ * Parameters: data_local - [IN] the value key (itemid, start, end, function) *
+ *                                                                            *
+ * Return value: The value data. Newly added data has unknown state.          *
+ *                                                                            *
+ * Comments: This function must be called with cache locked.                  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_tfc_data_t	*tfc_value_add(const zbx_tfc_data_t *data_local)
+{
+	zbx_tfc_data_t	*data, root_local, *root;
+
+	root_local.itemid = data_local->itemid;
+	root_local.start = 0;
+	root_local.end = 0;
+	root_local.function = ZBX_TREND_FUNCTION_UNKNOWN;
+
+	tfc_reserve_slot();
+
+	if (NULL == (root = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &root_local)))
+	{
+		root = tfc_index_add(&root_local);
+		root->prev_value = tfc_data_slot_index(root);
+		root->next_value = root->prev_value;
+		cache->items_num++;
+		tfc_reserve_slot();
+	}
+
+	root_local = *data_local;
+	root_local.state = ZBX_TREND_STATE_UNKNOWN;
+	data = tfc_index_add(&root_local);
+
+	if (ZBX_TREND_STATE_UNKNOWN == data->state)
+	{
+		/* new slot was allocated, link it */
+		tfc_lru_append(data);
+		tfc_value_append(root, data);
+	}
+
+	return data;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: return trend function name in readable format                     *
@@ -334,6 +388,9 @@ static const char	*tfc_function_str(zbx_trend_function_t function)
 			return "min";
 		case ZBX_TREND_FUNCTION_SUM:
 			return "sum";
+		case ZBX_TREND_FUNCTION_ROLLUP_FLOAT:
+		case ZBX_TREND_FUNCTION_ROLLUP_UINT:
+			return "rollup";
 		default:
 			return "unknown";
 	}
@@ -419,6 +476,8 @@ int	zbx_tfc_init(char **error)
 	cache->hits = 0;
 	cache->misses = 0;
 	cache->items_num = 0;
+	cache->rollup_revision = 0;
+	cache->trends_syncing = 0;
 
 	ret = SUCCEED;
 out:
@@ -494,7 +553,7 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 		tfc_lru_remove(data);
 		tfc_lru_append(data);
 
-		*value = data->value;
+		*value = data->cached.value;
 		*state = data->state;
 
 		cache->hits++;
@@ -511,7 +570,8 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 			char	buf[ZBX_MAX_DOUBLE_LEN + 1];
 
 			zabbix_log(LOG_LEVEL_DEBUG, "End of %s() state:%s value:%s", __func__,
-					tfc_state_str(data->state), zbx_print_double(buf, sizeof(buf), data->value));
+					tfc_state_str(data->state),
+					zbx_print_double(buf, sizeof(buf), data->cached.value));
 		}
 		else
 			zabbix_log(LOG_LEVEL_DEBUG, "End of %s():not cached", __func__);
@@ -520,6 +580,65 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 	return NULL != data ? SUCCEED : FAIL;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get values and states of multiple periods from trend function     *
+ *          cache                                                             *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the itemid                                   *
+ *             function   - [IN] the trend function                           *
+ *             ranges     - [IN] the periods                                  *
+ *             ranges_num - [IN] the number of periods                        *
+ *             values     - [OUT] the cached values                           *
+ *             states     - [OUT] the cached states, left unchanged for the   *
+ *                                periods not in cache                        *
+ *                                                                            *
+ * Return value: The number of periods found in cache.                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tfc_get_values(zbx_uint64_t itemid, zbx_trend_function_t function, const zbx_trend_range_t *ranges,
+		int ranges_num, double *values, zbx_trend_state_t *states)
+{
+	zbx_tfc_data_t	*data, data_local;
+	int		i, hits = 0;
+
+	if (NULL == cache)
+		return 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " %s ranges_num:%d", __func__, itemid,
+			tfc_function_str(function), ranges_num);
+
+	data_local.itemid = itemid;
+	data_local.function = function;
+
+	LOCK_CACHE;
+
+	for (i = 0; i < ranges_num; i++)
+	{
+		data_local.start = ranges[i].start;
+		data_local.end = ranges[i].end;
+
+		if (NULL == (data = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
+			continue;
+
+		tfc_lru_remove(data);
+		tfc_lru_append(data);
+
+		values[i] = data->cached.value;
+		states[i] = data->state;
+		hits++;
+	}
+
+	cache->hits += hits;
+	cache->misses += ranges_num - hits;
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() hits:%d", __func__, hits);
+
+	return hits;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: put value and state from trend function cache                     *
@@ -535,7 +654,7 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double value,
 		zbx_trend_state_t state)
 {
-	zbx_tfc_data_t	*data, data_local, *root;
+	zbx_tfc_data_t	*data, data_local;
 
 	if (NULL == cache)
 		return;
@@ -563,44 +682,81 @@ void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functi
 	}
 
 	data_local.itemid = itemid;
-	data_local.start = 0;
-	data_local.end = 0;
-	data_local.function = ZBX_TREND_FUNCTION_UNKNOWN;
+	data_local.start = start;
+	data_local.end = end;
+	data_local.function = function;
 
 	LOCK_CACHE;
 
-	tfc_reserve_slot();
+	data = tfc_value_add(&data_local);
+	data->cached.value = value;
+	data->state = state;
 
-	if (NULL == (root = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
-	{
-		root = tfc_index_add(&data_local);
-		root->prev_value = tfc_data_slot_index(root);
-		root->next_value = root->prev_value;
-		cache->items_num++;
-		tfc_reserve_slot();
-	}
+	UNLOCK_CACHE;
 
-	data_local.start = start;
-	data_local.end = end;
-	data_local.function = function;
-	data_local.state = ZBX_TREND_STATE_UNKNOWN;
-	data = tfc_index_add(&data_local);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
 
-	if (ZBX_TREND_STATE_UNKNOWN == data->state)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if the cached data is a period rollup                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	tfc_is_rollup(const zbx_tfc_data_t *data)
+{
+	if (ZBX_TREND_FUNCTION_ROLLUP_FLOAT == data->function || ZBX_TREND_FUNCTION_ROLLUP_UINT == data->function)
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add trend to the cached period rollup                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	tfc_rollup_add_trend(zbx_tfc_rollup_t *rollup, const ZBX_DC_TREND *trend)
+{
+	double	min, max;
+
+	if (ITEM_VALUE_TYPE_FLOAT == trend->value_type)
 	{
-		/* new slot was allocated, link it */
-		tfc_lru_append(data);
-		tfc_value_append(root, data);
+		min = trend->value_min.dbl;
+		max = trend->value_max.dbl;
+		rollup->sum += trend->value_avg.dbl * trend->num;
+	}
+	else
+	{
+		min = (double)trend->value_min.ui64;
+		max = (double)trend->value_max.ui64;
+		/* the unsigned trend average holds the 128 bit sum of values */
+		rollup->sum += (double)trend->value_avg.ui64.hi * ((double)ZBX_MAX_UINT64 + 1) +
+				(double)trend->value_avg.ui64.lo;
 	}
 
-	data->value = value;
-	data->state = state;
+	if (0 == rollup->num || min < rollup->min)
+		rollup->min = min;
 
-	UNLOCK_CACHE;
+	if (0 == rollup->num || max > rollup->max)
+		rollup->max = max;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	rollup->num += trend->num;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: invalidate cached function values affected by the trends being    *
+ *          flushed to database                                               *
+ *                                                                            *
+ * Parameters: trends     - [IN] the trends                                   *
+ *             trends_num - [IN] the number of trends                         *
+ *                                                                            *
+ * Comments: Period rollups are kept and updated by zbx_tfc_update_trends()   *
+ *           after the trends are committed. Until then new rollups are not   *
+ *           cached and the rollups being currently loaded are discarded, as  *
+ *           they might or might not include the flushed trends.              *
+ *                                                                            *
+ ******************************************************************************/
 void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num)
 {
 	zbx_tfc_data_t	*root, *data, data_local;
@@ -617,6 +773,8 @@ void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num)
 
 	LOCK_CACHE;
 
+	cache->trends_syncing++;
+
 	for (i = 0; i < trends_num; i++)
 	{
 		data_local.itemid = trends[i].itemid;
@@ -631,6 +789,13 @@ void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num)
 			if (trends[i].clock < data->start || trends[i].clock > data->end)
 				continue;
 
+			if (SUCCEED == tfc_is_rollup(data))
+			{
+				if (ZBX_TREND_STATE_UNKNOWN == data->state)
+					data->revision = 0;
+				continue;
+			}
+
 			tfc_free_data(data);
 		}
 	}
@@ -640,6 +805,207 @@ void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: update cached period rollups with the flushed trends              *
+ *                                                                            *
+ * Parameters: trends     - [IN] the trends                                   *
+ *             trends_num - [IN] the number of trends                         *
+ *             committed  - [IN] SUCCEED - the trends were committed to       *
+ *                                         database                           *
+ *                               FAIL    - the trends were not flushed        *
+ *                                                                            *
+ * Comments: Must be called after zbx_tfc_invalidate_trends() with the same   *
+ *           trends once the database transaction is finished.                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_tfc_update_trends(const ZBX_DC_TREND *trends, int trends_num, int committed)
+{
+	zbx_tfc_data_t		*root, *data, data_local;
+	int			i, updated = 0;
+	zbx_trend_function_t	function;
+
+	if (NULL == cache)
+		return;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() trends_num:%d", __func__, trends_num);
+
+	data_local.start = 0;
+	data_local.end = 0;
+	data_local.function = ZBX_TREND_FUNCTION_UNKNOWN;
+
+	LOCK_CACHE;
+
+	cache->trends_syncing--;
+
+	for (i = 0; SUCCEED == committed && i < trends_num; i++)
+	{
+		data_local.itemid = trends[i].itemid;
+
+		if (NULL == (root = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
+			continue;
+
+		function = (ITEM_VALUE_TYPE_FLOAT == trends[i].value_type ? ZBX_TREND_FUNCTION_ROLLUP_FLOAT :
+				ZBX_TREND_FUNCTION_ROLLUP_UINT);
+
+		for (data = &cache->slots[root->next_value].data; data != root;
+				data = &cache->slots[data->next_value].data)
+		{
+			if (function != data->function || trends[i].clock < data->start || trends[i].clock > data->end)
+				continue;
+
+			/* rollups being loaded were already discarded when trends flush started */
+			if (ZBX_TREND_STATE_UNKNOWN == data->state)
+				continue;
+
+			tfc_rollup_add_trend(&data->cached.rollup, &trends[i]);
+			data->state = ZBX_TREND_STATE_NORMAL;
+			updated++;
+		}
+	}
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() updated:%d", __func__, updated);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get period rollups from cache                                     *
+ *                                                                            *
+ * Parameters: itemid      - [IN] the itemid                                  *
+ *             type        - [IN] the rollup type (float or unsigned trends)  *
+ *             buckets     - [IN/OUT] the periods to get                      *
+ *             buckets_num - [IN] the number of periods                       *
+ *                                                                            *
+ * Return value: SUCCEED - the buckets were processed                         *
+ *               FAIL - trend function cache is disabled                      *
+ *                                                                            *
+ * Comments: Found rollups are copied to buckets and their cached flag is     *
+ *           set. For the rollups not in cache a slot is reserved for loading *
+ *           and its revision is stored in bucket. The reserved slots must be *
+ *           filled or released with zbx_tfc_put_rollups().                   *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tfc_get_rollups(zbx_uint64_t itemid, zbx_trend_function_t type, zbx_tfc_bucket_t *buckets,
+		int buckets_num)
+{
+	zbx_tfc_data_t	*data, data_local;
+	int		i, hits = 0;
+
+	if (NULL == cache)
+		return FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " buckets_num:%d", __func__, itemid, buckets_num);
+
+	data_local.itemid = itemid;
+	data_local.function = type;
+
+	LOCK_CACHE;
+
+	for (i = 0; i < buckets_num; i++)
+	{
+		buckets[i].cached = 0;
+		buckets[i].revision = 0;
+
+		data_local.start = buckets[i].start;
+		data_local.end = buckets[i].end;
+
+		if (NULL != (data = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
+		{
+			if (ZBX_TREND_STATE_UNKNOWN == data->state)
+				continue;
+
+			tfc_lru_remove(data);
+			tfc_lru_append(data);
+
+			buckets[i].rollup = data->cached.rollup;
+			buckets[i].cached = 1;
+			hits++;
+			continue;
+		}
+
+		/* rollups loaded during trends flush might miss the flushed trends */
+		if (0 != cache->trends_syncing)
+			continue;
+
+		if (0 == ++cache->rollup_revision)
+			cache->rollup_revision++;
+
+		data = tfc_value_add(&data_local);
+		data->revision = cache->rollup_revision;
+		buckets[i].revision = data->revision;
+	}
+
+	cache->hits += hits;
+	cache->misses += buckets_num - hits;
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() hits:%d", __func__, hits);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: put loaded period rollups into cache                              *
+ *                                                                            *
+ * Parameters: itemid      - [IN] the itemid                                  *
+ *             type        - [IN] the rollup type (float or unsigned trends)  *
+ *             buckets     - [IN] the periods returned by                     *
+ *                                zbx_tfc_get_rollups()                       *
+ *             buckets_num - [IN] the number of periods                       *
+ *             loaded      - [IN] SUCCEED - the rollups were loaded           *
+ *                                FAIL    - the reserved slots must be        *
+ *                                          released                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_tfc_put_rollups(zbx_uint64_t itemid, zbx_trend_function_t type, const zbx_tfc_bucket_t *buckets,
+		int buckets_num, int loaded)
+{
+	zbx_tfc_data_t	*data, data_local;
+	int		i;
+
+	if (NULL == cache)
+		return;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() itemid:" ZBX_FS_UI64 " buckets_num:%d", __func__, itemid, buckets_num);
+
+	data_local.itemid = itemid;
+	data_local.function = type;
+
+	LOCK_CACHE;
+
+	for (i = 0; i < buckets_num; i++)
+	{
+		if (0 == buckets[i].revision)
+			continue;
+
+		data_local.start = buckets[i].start;
+		data_local.end = buckets[i].end;
+
+		if (NULL == (data = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
+			continue;
+
+		if (ZBX_TREND_STATE_UNKNOWN != data->state)
+			continue;
+
+		if (SUCCEED != loaded || data->revision != buckets[i].revision)
+		{
+			tfc_free_data(data);
+			continue;
+		}
+
+		data->cached.rollup = buckets[i].rollup;
+		data->state = (0 != buckets[i].rollup.num ? ZBX_TREND_STATE_NORMAL : ZBX_TREND_STATE_NODATA);
+	}
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
 int	zbx_tfc_get_stats(zbx_tfc_stats_t *stats, char **error)
 {
 	if (NULL == cache)
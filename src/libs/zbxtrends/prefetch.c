@@ -0,0 +1,421 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "db.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "zbxtrends.h"
+#include "trends.h"
+#include "../zbxalgo/vectorimpl.h"
+
+/* the prefetched trend hour */
+typedef struct
+{
+	int	clock;
+	double	num;
+	double	sum;
+}
+zbx_trends_prefetch_row_t;
+
+ZBX_VECTOR_DECL(trends_prefetch_row, zbx_trends_prefetch_row_t)
+ZBX_VECTOR_IMPL(trends_prefetch_row, zbx_trends_prefetch_row_t)
+
+typedef struct
+{
+	zbx_uint64_t				itemid;
+	unsigned char				value_type;
+	unsigned char				loaded;
+
+	/* the requested ranges, merged and sorted by time after prefetch */
+	zbx_vector_trend_range_t		ranges;
+
+	/* the trend hours of the requested ranges, sorted by time */
+	zbx_vector_trends_prefetch_row_t	rows;
+}
+zbx_trends_prefetch_item_t;
+
+static zbx_hashset_t	prefetch_items;
+static int		prefetch_initialized = 0;
+
+static void	trends_prefetch_item_clean(void *data)
+{
+	zbx_trends_prefetch_item_t	*item = (zbx_trends_prefetch_item_t *)data;
+
+	zbx_vector_trend_range_destroy(&item->ranges);
+	zbx_vector_trends_prefetch_row_destroy(&item->rows);
+}
+
+static int	trends_range_compare(const void *d1, const void *d2)
+{
+	const zbx_trend_range_t	*r1 = (const zbx_trend_range_t *)d1;
+	const zbx_trend_range_t	*r2 = (const zbx_trend_range_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(r1->start, r2->start);
+	ZBX_RETURN_IF_NOT_EQUAL(r1->end, r2->end);
+
+	return 0;
+}
+
+static int	trends_prefetch_row_compare(const void *d1, const void *d2)
+{
+	const zbx_trends_prefetch_row_t	*r1 = (const zbx_trends_prefetch_row_t *)d1;
+	const zbx_trends_prefetch_row_t	*r2 = (const zbx_trends_prefetch_row_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(r1->clock, r2->clock);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sort prefetched items by value type and requested ranges          *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_prefetch_item_compare(const void *d1, const void *d2)
+{
+	const zbx_trends_prefetch_item_t	*i1 = *(const zbx_trends_prefetch_item_t * const *)d1;
+	const zbx_trends_prefetch_item_t	*i2 = *(const zbx_trends_prefetch_item_t * const *)d2;
+	int					i, ret;
+
+	ZBX_RETURN_IF_NOT_EQUAL(i1->value_type, i2->value_type);
+	ZBX_RETURN_IF_NOT_EQUAL(i1->ranges.values_num, i2->ranges.values_num);
+
+	for (i = 0; i < i1->ranges.values_num; i++)
+	{
+		if (0 != (ret = trends_range_compare(&i1->ranges.values[i], &i2->ranges.values[i])))
+			return ret;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sort and merge overlapping and adjacent ranges                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_ranges_merge(zbx_vector_trend_range_t *ranges)
+{
+	int	i, j;
+
+	zbx_vector_trend_range_sort(ranges, trends_range_compare);
+
+	for (i = 0, j = 1; j < ranges->values_num; j++)
+	{
+		if (ranges->values[j].start <= ranges->values[i].end + 1)
+		{
+			if (ranges->values[j].end > ranges->values[i].end)
+				ranges->values[i].end = ranges->values[j].end;
+			continue;
+		}
+
+		ranges->values[++i] = ranges->values[j];
+	}
+
+	if (0 != ranges->values_num)
+		ranges->values_num = i + 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add item trend ranges to be prefetched                            *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the itemid                                   *
+ *             value_type - [IN] the item value type                          *
+ *             ranges     - [IN] the ranges that will be requested with       *
+ *                               zbx_trends_get_avgs()                        *
+ *                                                                            *
+ * Comments: The ranges with average values already in trend function cache   *
+ *           are not prefetched.                                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_prefetch_add(zbx_uint64_t itemid, unsigned char value_type,
+		const zbx_vector_trend_range_t *ranges)
+{
+	zbx_trends_prefetch_item_t	*item, item_local;
+	double				*values;
+	zbx_trend_state_t		*states;
+	int				i;
+
+	if ((ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type) || 0 == ranges->values_num)
+		return;
+
+	values = (double *)zbx_malloc(NULL, sizeof(double) * (size_t)ranges->values_num);
+	states = (zbx_trend_state_t *)zbx_malloc(NULL, sizeof(zbx_trend_state_t) * (size_t)ranges->values_num);
+
+	for (i = 0; i < ranges->values_num; i++)
+		states[i] = ZBX_TREND_STATE_UNKNOWN;
+
+	if (ranges->values_num == zbx_tfc_get_values(itemid, ZBX_TREND_FUNCTION_AVG, ranges->values,
+			ranges->values_num, values, states))
+	{
+		goto out;
+	}
+
+	if (0 == prefetch_initialized)
+	{
+		zbx_hashset_create_ext(&prefetch_items, 100, ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC, trends_prefetch_item_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+		prefetch_initialized = 1;
+	}
+
+	if (NULL == (item = (zbx_trends_prefetch_item_t *)zbx_hashset_search(&prefetch_items, &itemid)))
+	{
+		item_local.itemid = itemid;
+		item_local.value_type = value_type;
+		item_local.loaded = 0;
+
+		item = (zbx_trends_prefetch_item_t *)zbx_hashset_insert(&prefetch_items, &item_local,
+				sizeof(item_local));
+
+		zbx_vector_trend_range_create(&item->ranges);
+		zbx_vector_trends_prefetch_row_create(&item->rows);
+	}
+
+	for (i = 0; i < ranges->values_num; i++)
+	{
+		if (ZBX_TREND_STATE_UNKNOWN == states[i])
+			zbx_vector_trend_range_append(&item->ranges, ranges->values[i]);
+	}
+out:
+	zbx_free(states);
+	zbx_free(values);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: select trends of items sharing the same ranges                    *
+ *                                                                            *
+ * Parameters: items     - [IN] the items                                     *
+ *             items_num - [IN] the number of items                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_prefetch_items(zbx_trends_prefetch_item_t **items, int items_num)
+{
+	DB_RESULT			result;
+	DB_ROW				row;
+	char				*sql = NULL;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	const char			*table;
+	int				i;
+	zbx_uint64_t			*itemids, itemid;
+	zbx_trends_prefetch_item_t	*item;
+	zbx_trends_prefetch_row_t	trend;
+	const zbx_vector_trend_range_t	*ranges = &items[0]->ranges;
+
+	table = (ITEM_VALUE_TYPE_FLOAT == items[0]->value_type ? "trends" : "trends_uint");
+
+	itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)items_num);
+
+	for (i = 0; i < items_num; i++)
+		itemids[i] = items[i]->itemid;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select itemid,clock,num,value_avg from %s where", table);
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids, items_num);
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " and (");
+
+	for (i = 0; i < ranges->values_num; i++)
+	{
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "%s(clock>=%d and clock<=%d)", 0 == i ? "" : " or ",
+				ranges->values[i].start, ranges->values[i].end);
+	}
+
+	zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ')');
+
+	if (NULL != (result = DBselect("%s", sql)))
+	{
+		while (NULL != (row = DBfetch(result)))
+		{
+			ZBX_STR2UINT64(itemid, row[0]);
+
+			if (NULL == (item = (zbx_trends_prefetch_item_t *)zbx_hashset_search(&prefetch_items,
+					&itemid)))
+			{
+				THIS_SHOULD_NEVER_HAPPEN;
+				continue;
+			}
+
+			trend.clock = atoi(row[1]);
+			trend.num = atof(row[2]);
+			trend.sum = atof(row[3]) * trend.num;
+			zbx_vector_trends_prefetch_row_append(&item->rows, trend);
+		}
+
+		DBfree_result(result);
+
+		for (i = 0; i < items_num; i++)
+		{
+			zbx_vector_trends_prefetch_row_sort(&items[i]->rows, trends_prefetch_row_compare);
+			items[i]->loaded = 1;
+		}
+	}
+
+	zbx_free(itemids);
+	zbx_free(sql);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: prefetch trends of the added item ranges                          *
+ *                                                                            *
+ * Comments: Items with the same value type and ranges (the same functions    *
+ *           evaluated at the same time) are selected with a single query.    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_prefetch(void)
+{
+	zbx_hashset_iter_t		iter;
+	zbx_trends_prefetch_item_t	*item;
+	zbx_vector_ptr_t		items;
+	int				i, j, queries = 0;
+
+	if (0 == prefetch_initialized || 0 == prefetch_items.num_data)
+		return;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() items:%d", __func__, prefetch_items.num_data);
+
+	zbx_vector_ptr_create(&items);
+
+	zbx_hashset_iter_reset(&prefetch_items, &iter);
+	while (NULL != (item = (zbx_trends_prefetch_item_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (0 != item->loaded || 0 == item->ranges.values_num)
+			continue;
+
+		trends_ranges_merge(&item->ranges);
+		zbx_vector_ptr_append(&items, item);
+	}
+
+	zbx_vector_ptr_sort(&items, trends_prefetch_item_compare);
+
+	for (i = 0; i < items.values_num; i = j)
+	{
+		for (j = i + 1; j < items.values_num; j++)
+		{
+			if (0 != trends_prefetch_item_compare(&items.values[i], &items.values[j]))
+				break;
+		}
+
+		trends_prefetch_items((zbx_trends_prefetch_item_t **)items.values + i, j - i);
+		queries++;
+	}
+
+	zbx_vector_ptr_destroy(&items);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() queries:%d", __func__, queries);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: discard prefetched trends                                         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_prefetch_clear(void)
+{
+	if (0 == prefetch_initialized)
+		return;
+
+	zbx_hashset_destroy(&prefetch_items);
+	prefetch_initialized = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get average values of ranges from prefetched trends               *
+ *                                                                            *
+ * Parameters: table      - [IN] the trends table name                        *
+ *             itemid     - [IN] the itemid                                   *
+ *             ranges     - [IN] the ranges                                   *
+ *             ranges_num - [IN] the number of ranges                         *
+ *             values     - [OUT] the average values                          *
+ *             states     - [IN/OUT] the value states, only ranges with       *
+ *                                   unknown state and fully covered by       *
+ *                                   prefetched trends are evaluated          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_prefetch_get_avgs(const char *table, zbx_uint64_t itemid, const zbx_trend_range_t *ranges,
+		int ranges_num, double *values, zbx_trend_state_t *states)
+{
+	zbx_trends_prefetch_item_t	*item;
+	unsigned char			value_type;
+	int				i, j, lo, hi;
+	double				num, sum;
+
+	if (0 == prefetch_initialized)
+		return;
+
+	if (NULL == (item = (zbx_trends_prefetch_item_t *)zbx_hashset_search(&prefetch_items, &itemid)) ||
+			0 == item->loaded)
+	{
+		return;
+	}
+
+	value_type = (0 == strcmp(table, "trends") ? ITEM_VALUE_TYPE_FLOAT : ITEM_VALUE_TYPE_UINT64);
+
+	if (value_type != item->value_type)
+		return;
+
+	for (i = 0; i < ranges_num; i++)
+	{
+		if (ZBX_TREND_STATE_UNKNOWN != states[i])
+			continue;
+
+		/* find the last merged range starting before the requested range */
+		for (lo = 0, hi = item->ranges.values_num; lo < hi;)
+		{
+			j = lo + (hi - lo) / 2;
+
+			if (item->ranges.values[j].start <= ranges[i].start)
+				lo = j + 1;
+			else
+				hi = j;
+		}
+
+		if (0 == lo || item->ranges.values[lo - 1].end < ranges[i].end)
+			continue;
+
+		/* find the first trend hour of the requested range */
+		for (lo = 0, hi = item->rows.values_num; lo < hi;)
+		{
+			j = lo + (hi - lo) / 2;
+
+			if (item->rows.values[j].clock < ranges[i].start)
+				lo = j + 1;
+			else
+				hi = j;
+		}
+
+		for (num = 0, sum = 0; lo < item->rows.values_num && item->rows.values[lo].clock <= ranges[i].end;
+				lo++)
+		{
+			num += item->rows.values[lo].num;
+			sum += item->rows.values[lo].sum;
+		}
+
+		if (0 != num)
+		{
+			values[i] = sum / num;
+			states[i] = ZBX_TREND_STATE_NORMAL;
+		}
+		else
+			states[i] = ZBX_TREND_STATE_NODATA;
+	}
+}
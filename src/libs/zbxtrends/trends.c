@@ -22,6 +22,14 @@
 #include "log.h"
 #include "zbxtrends.h"
 #include "trends.h"
+#include "../zbxalgo/vectorimpl.h"
+
+ZBX_VECTOR_IMPL(trend_range, zbx_trend_range_t)
+ZBX_VECTOR_IMPL(tfc_bucket, zbx_tfc_bucket_t)
+
+#define ZBX_TRENDS_ROLLUP_CACHE_REQUIRED	0
+#define ZBX_TRENDS_ROLLUP_CACHE_OPTIONAL	1
+#define ZBX_TRENDS_ROLLUP_CACHE_NONE		2
 
 static char	*trends_errors[ZBX_TREND_STATE_COUNT] = {
 		"unknown error",
@@ -574,13 +582,476 @@ static zbx_trend_state_t	trends_eval_sum(const char *table, zbx_uint64_t itemid,
 	return ZBX_TREND_STATE_NORMAL;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: round time up to the trend hour                                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_ceil_hour(time_t t)
+{
+	return (int)((t + SEC_PER_HOUR - 1) / SEC_PER_HOUR * SEC_PER_HOUR);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find the largest calendar period (month, week, day) starting at   *
+ *          the specified trend hour and fitting in the requested range       *
+ *                                                                            *
+ * Parameters: pos  - [IN] the first trend hour of the period                 *
+ *             stop - [IN] the trend hour following the requested range       *
+ *                                                                            *
+ * Return value: The last trend hour of the period, or pos if no calendar     *
+ *               period fits.                                                 *
+ *                                                                            *
+ * Comments: The periods are defined in local time, but are stored as the     *
+ *           ranges of trend hours they include. This keeps the cached        *
+ *           rollups shared between all requests over the same periods.       *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_rollup_period_end(int pos, int stop)
+{
+	const zbx_time_unit_t	units[] = {ZBX_TIME_UNIT_MONTH, ZBX_TIME_UNIT_WEEK, ZBX_TIME_UNIT_DAY};
+	size_t			i;
+
+	for (i = 0; i < ARRSIZE(units); i++)
+	{
+		time_t		from, to;
+		struct tm	tm;
+
+		from = pos;
+		localtime_r(&from, &tm);
+		zbx_tm_round_down(&tm, units[i]);
+
+		if (-1 == (from = mktime(&tm)) || trends_ceil_hour(from) != pos)
+			continue;
+
+		zbx_tm_add(&tm, 1, units[i]);
+
+		if (-1 == (to = mktime(&tm)) || trends_ceil_hour(to) > stop)
+			continue;
+
+		return trends_ceil_hour(to) - SEC_PER_HOUR;
+	}
+
+	return pos;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compare period rollup with trend clock                            *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_bucket_compare(const void *d1, const void *d2)
+{
+	const int		*clock = (const int *)d1;
+	const zbx_tfc_bucket_t	*bucket = (const zbx_tfc_bucket_t *)d2;
+
+	if (*clock < bucket->start)
+		return -1;
+
+	if (*clock > bucket->end)
+		return 1;
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sort period rollups by start and end time                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_bucket_sort(const void *d1, const void *d2)
+{
+	const zbx_tfc_bucket_t	*b1 = (const zbx_tfc_bucket_t *)d1;
+	const zbx_tfc_bucket_t	*b2 = (const zbx_tfc_bucket_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(b1->start, b2->start);
+	ZBX_RETURN_IF_NOT_EQUAL(b1->end, b2->end);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: split range into calendar periods                                 *
+ *                                                                            *
+ * Parameters: start   - [IN] the range start time                            *
+ *             end     - [IN] the range end time                              *
+ *             buckets - [OUT] the periods                                    *
+ *                                                                            *
+ * Return value: The number of periods added.                                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_rollup_split(int start, int end, zbx_vector_tfc_bucket_t *buckets)
+{
+	int			pos, stop, num = 0;
+	zbx_tfc_bucket_t	bucket;
+
+	memset(&bucket, 0, sizeof(bucket));
+
+	for (pos = trends_ceil_hour(start), stop = trends_ceil_hour((time_t)end + 1); pos < stop;
+			pos = bucket.end + SEC_PER_HOUR)
+	{
+		bucket.start = pos;
+		bucket.end = trends_rollup_period_end(pos, stop);
+		zbx_vector_tfc_bucket_append(buckets, bucket);
+		num++;
+	}
+
+	return num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add trend clock interval to the rollup loading query              *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_sql_add_interval(char **sql, size_t *sql_alloc, size_t *sql_offset, int *intervals_num,
+		int from, int to)
+{
+	zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "%s(clock>=%d and clock<=%d)",
+			0 == (*intervals_num)++ ? "" : " or ", from, to);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: load trends of the period rollups missing from cache              *
+ *                                                                            *
+ * Parameters: table       - [IN] the trends table name                       *
+ *             itemid      - [IN] the itemid                                  *
+ *             buckets     - [IN/OUT] the period rollups, sorted by time and  *
+ *                                    not overlapping                         *
+ *             buckets_num - [IN] the number of period rollups                *
+ *                                                                            *
+ * Return value: SUCCEED - the missing rollups were loaded                    *
+ *               FAIL    - database error                                     *
+ *                                                                            *
+ * Comments: The trends of all missing rollups are selected with a single     *
+ *           query, adjacent periods are merged into one clock interval.      *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_load_rollups(const char *table, zbx_uint64_t itemid, zbx_tfc_bucket_t *buckets,
+		int buckets_num)
+{
+	DB_RESULT		result;
+	DB_ROW			row;
+	int			i, from = -1, to = -1, clock, intervals_num = 0;
+	double			num, min, max;
+	zbx_tfc_bucket_t	*bucket;
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select clock,num,value_min,value_avg,value_max from %s"
+			" where itemid=" ZBX_FS_UI64
+				" and (",
+			table, itemid);
+
+	for (i = 0; i < buckets_num; i++)
+	{
+		if (0 != buckets[i].cached)
+			continue;
+
+		memset(&buckets[i].rollup, 0, sizeof(zbx_tfc_rollup_t));
+
+		if (-1 != from && buckets[i].start == to + SEC_PER_HOUR)
+		{
+			to = buckets[i].end;
+			continue;
+		}
+
+		if (-1 != from)
+			trends_sql_add_interval(&sql, &sql_alloc, &sql_offset, &intervals_num, from, to);
+
+		from = buckets[i].start;
+		to = buckets[i].end;
+	}
+
+	if (-1 == from)
+	{
+		zbx_free(sql);
+		return SUCCEED;
+	}
+
+	trends_sql_add_interval(&sql, &sql_alloc, &sql_offset, &intervals_num, from, to);
+	zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ')');
+
+	result = DBselect("%s", sql);
+	zbx_free(sql);
+
+	if (NULL == result)
+		return FAIL;
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		clock = atoi(row[0]);
+
+		if (NULL == (bucket = (zbx_tfc_bucket_t *)bsearch(&clock, buckets, (size_t)buckets_num,
+				sizeof(zbx_tfc_bucket_t), trends_bucket_compare)) || 0 != bucket->cached)
+		{
+			continue;
+		}
+
+		num = atof(row[1]);
+		min = atof(row[2]);
+		max = atof(row[4]);
+
+		if (0 == bucket->rollup.num || min < bucket->rollup.min)
+			bucket->rollup.min = min;
+
+		if (0 == bucket->rollup.num || max > bucket->rollup.max)
+			bucket->rollup.max = max;
+
+		bucket->rollup.sum += atof(row[3]) * num;
+		bucket->rollup.num += num;
+	}
+
+	DBfree_result(result);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculate trend function value from the period rollups            *
+ *                                                                            *
+ * Parameters: total    - [IN] the aggregated rollup of the range             *
+ *             function - [IN] the trend function (avg, count, min, max, sum) *
+ *             value    - [OUT] the function value                            *
+ *                                                                            *
+ * Return value: Trend value state of the range and function.                 *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_trend_state_t	trends_rollup_value(const zbx_tfc_rollup_t *total, zbx_trend_function_t function,
+		double *value)
+{
+	switch (function)
+	{
+		case ZBX_TREND_FUNCTION_COUNT:
+			*value = total->num;
+			return ZBX_TREND_STATE_NORMAL;
+		case ZBX_TREND_FUNCTION_SUM:
+			if (ZBX_INFINITY == total->sum)
+				return ZBX_TREND_STATE_OVERFLOW;
+			*value = total->sum;
+			return ZBX_TREND_STATE_NORMAL;
+		default:
+			break;
+	}
+
+	if (0 == total->num)
+		return ZBX_TREND_STATE_NODATA;
+
+	switch (function)
+	{
+		case ZBX_TREND_FUNCTION_AVG:
+			*value = total->sum / total->num;
+			break;
+		case ZBX_TREND_FUNCTION_MIN:
+			*value = total->min;
+			break;
+		case ZBX_TREND_FUNCTION_MAX:
+			*value = total->max;
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+			return ZBX_TREND_STATE_UNKNOWN;
+	}
+
+	return ZBX_TREND_STATE_NORMAL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluate trend function over multiple ranges from period rollups  *
+ *                                                                            *
+ * Parameters: table      - [IN] the trends table name                        *
+ *             itemid     - [IN] the itemid                                   *
+ *             ranges     - [IN] the ranges to evaluate                       *
+ *             ranges_num - [IN] the number of ranges                         *
+ *             function   - [IN] the trend function (avg, count, min, max,    *
+ *                               sum)                                         *
+ *             cache_mode - [IN] ZBX_TRENDS_ROLLUP_CACHE_REQUIRED - fail if   *
+ *                                   the rollup cache is disabled             *
+ *                               ZBX_TRENDS_ROLLUP_CACHE_OPTIONAL - load all  *
+ *                                   rollups from database if the rollup      *
+ *                                   cache is disabled                        *
+ *                               ZBX_TRENDS_ROLLUP_CACHE_NONE - do not cache  *
+ *                                   the rollups                              *
+ *             values     - [OUT] the function values                         *
+ *             states     - [IN/OUT] the value states, only ranges with       *
+ *                                   unknown state are evaluated              *
+ *                                                                            *
+ * Return value: SUCCEED - the ranges were evaluated                          *
+ *               FAIL    - rollups cannot be used, the values must be         *
+ *                         evaluated directly from trends                     *
+ *                                                                            *
+ * Comments: The ranges are split into the largest calendar periods (month,   *
+ *           week, day and hour) so that long ranges are evaluated from a few *
+ *           cached rollups. The rollups missing from cache are loaded for    *
+ *           all ranges with a single database query.                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	trends_eval_rollups(const char *table, zbx_uint64_t itemid, const zbx_trend_range_t *ranges,
+		int ranges_num, zbx_trend_function_t function, int cache_mode, double *values,
+		zbx_trend_state_t *states)
+{
+	zbx_trend_function_t	type;
+	zbx_vector_tfc_bucket_t	splits, buckets;
+	int			i, j, k, ret = FAIL, *splits_num;
+
+	if (0 == strcmp(table, "trends"))
+		type = ZBX_TREND_FUNCTION_ROLLUP_FLOAT;
+	else if (0 == strcmp(table, "trends_uint"))
+		type = ZBX_TREND_FUNCTION_ROLLUP_UINT;
+	else
+		return FAIL;
+
+	zbx_vector_tfc_bucket_create(&splits);
+	zbx_vector_tfc_bucket_create(&buckets);
+	splits_num = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)ranges_num);
+
+	for (i = 0; i < ranges_num; i++)
+	{
+		splits_num[i] = (ZBX_TREND_STATE_UNKNOWN == states[i] ?
+				trends_rollup_split(ranges[i].start, ranges[i].end, &splits) : 0);
+	}
+
+	if (0 == splits.values_num)
+	{
+		/* a single range without trend hours is evaluated directly, as before rollups */
+		if (1 == ranges_num)
+			goto out;
+
+		for (i = 0; i < ranges_num; i++)
+		{
+			zbx_tfc_rollup_t	total = {0, 0, 0, 0};
+
+			if (ZBX_TREND_STATE_UNKNOWN == states[i])
+				states[i] = trends_rollup_value(&total, function, &values[i]);
+		}
+
+		ret = SUCCEED;
+		goto out;
+	}
+
+	zbx_vector_tfc_bucket_append_array(&buckets, splits.values, splits.values_num);
+	zbx_vector_tfc_bucket_sort(&buckets, trends_bucket_sort);
+	zbx_vector_tfc_bucket_uniq(&buckets, trends_bucket_sort);
+
+	/* the periods of overlapping ranges might be split differently */
+	for (i = 1; i < buckets.values_num; i++)
+	{
+		if (buckets.values[i].start <= buckets.values[i - 1].end)
+			goto out;
+	}
+
+	if (ZBX_TRENDS_ROLLUP_CACHE_NONE == cache_mode ||
+			SUCCEED != zbx_tfc_get_rollups(itemid, type, buckets.values, buckets.values_num))
+	{
+		if (ZBX_TRENDS_ROLLUP_CACHE_REQUIRED == cache_mode)
+			goto out;
+
+		for (i = 0; i < buckets.values_num; i++)
+		{
+			buckets.values[i].cached = 0;
+			buckets.values[i].revision = 0;
+		}
+
+		cache_mode = ZBX_TRENDS_ROLLUP_CACHE_NONE;
+	}
+
+	ret = trends_load_rollups(table, itemid, buckets.values, buckets.values_num);
+
+	if (ZBX_TRENDS_ROLLUP_CACHE_NONE != cache_mode)
+		zbx_tfc_put_rollups(itemid, type, buckets.values, buckets.values_num, ret);
+
+	if (SUCCEED != ret)
+		goto out;
+
+	for (i = 0, k = 0; i < ranges_num; i++)
+	{
+		zbx_tfc_rollup_t	total = {0, 0, 0, 0};
+
+		if (ZBX_TREND_STATE_UNKNOWN != states[i])
+			continue;
+
+		for (j = 0; j < splits_num[i]; j++, k++)
+		{
+			const zbx_tfc_rollup_t	*rollup;
+
+			rollup = &((zbx_tfc_bucket_t *)bsearch(&splits.values[k].start, buckets.values,
+					(size_t)buckets.values_num, sizeof(zbx_tfc_bucket_t),
+					trends_bucket_compare))->rollup;
+
+			if (0 == rollup->num)
+				continue;
+
+			if (0 == total.num || rollup->min < total.min)
+				total.min = rollup->min;
+
+			if (0 == total.num || rollup->max > total.max)
+				total.max = rollup->max;
+
+			total.sum += rollup->sum;
+			total.num += rollup->num;
+		}
+
+		states[i] = trends_rollup_value(&total, function, &values[i]);
+	}
+out:
+	zbx_free(splits_num);
+	zbx_vector_tfc_bucket_destroy(&buckets);
+	zbx_vector_tfc_bucket_destroy(&splits);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluate trend function from the cached period rollups            *
+ *                                                                            *
+ * Parameters: table    - [IN] the trends table name                          *
+ *             itemid   - [IN] the itemid                                     *
+ *             start    - [IN] the period start time in seconds since Epoch   *
+ *             end      - [IN] the period end time in seconds since Epoch     *
+ *             function - [IN] the trend function (avg, count, min, max, sum) *
+ *             value    - [OUT] the evaluation result                         *
+ *                                                                            *
+ * Return value: Trend value state of the specified period and function or    *
+ *               ZBX_TREND_STATE_UNKNOWN if rollups cannot be used.           *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_trend_state_t	trends_eval_rollup(const char *table, zbx_uint64_t itemid, int start, int end,
+		zbx_trend_function_t function, double *value)
+{
+	zbx_trend_range_t	range;
+	zbx_trend_state_t	state = ZBX_TREND_STATE_UNKNOWN;
+
+	range.start = start;
+	range.end = end;
+
+	if (SUCCEED != trends_eval_rollups(table, itemid, &range, 1, function, ZBX_TRENDS_ROLLUP_CACHE_REQUIRED,
+			value, &state))
+	{
+		return ZBX_TREND_STATE_UNKNOWN;
+	}
+
+	return state;
+}
+
 int	zbx_trends_eval_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value, char **error)
 {
 	zbx_trend_state_t	state;
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, value, &state))
 	{
-		state = trends_eval_avg(table, itemid, start, end, value);
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_AVG, value)))
+		{
+			state = trends_eval_avg(table, itemid, start, end, value);
+		}
+
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, *value, state);
 	}
 
@@ -601,7 +1072,13 @@ int	zbx_trends_eval_count(const char *table, zbx_uint64_t itemid, int start, int
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_COUNT, value, &state))
 	{
-		if (ZBX_TREND_STATE_NORMAL != (state = trends_eval(table, itemid, start, end, "num", "sum(num)", value)))
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_COUNT, value)))
+		{
+			state = trends_eval(table, itemid, start, end, "num", "sum(num)", value);
+		}
+
+		if (ZBX_TREND_STATE_NORMAL != state)
 		{
 			state = ZBX_TREND_STATE_NORMAL;
 			*value = 0;
@@ -619,7 +1096,12 @@ int	zbx_trends_eval_max(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_MAX, value, &state))
 	{
-		state = trends_eval(table, itemid, start, end, "value_max", "max(value_max)", value);
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_MAX, value)))
+		{
+			state = trends_eval(table, itemid, start, end, "value_max", "max(value_max)", value);
+		}
+
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_MAX, *value, state);
 	}
 
@@ -638,7 +1120,12 @@ int	zbx_trends_eval_min(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_MIN, value, &state))
 	{
-		state = trends_eval(table, itemid, start, end, "value_min", "min(value_min)", value);
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_MIN, value)))
+		{
+			state = trends_eval(table, itemid, start, end, "value_min", "min(value_min)", value);
+		}
+
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_MIN, *value, state);
 	}
 
@@ -657,7 +1144,12 @@ int	zbx_trends_eval_sum(const char *table, zbx_uint64_t itemid, int start, int e
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_SUM, value, &state))
 	{
-		state = trends_eval_sum(table, itemid, start, end, value);
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_SUM, value)))
+		{
+			state = trends_eval_sum(table, itemid, start, end, value);
+		}
+
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_SUM, *value, state);
 	}
 
@@ -676,13 +1168,94 @@ zbx_trend_state_t	zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int
 
 	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, value, &state))
 	{
-		state = trends_eval_avg(table, itemid, start, end, value);
+		if (ZBX_TREND_STATE_UNKNOWN == (state = trends_eval_rollup(table, itemid, start, end,
+				ZBX_TREND_FUNCTION_AVG, value)))
+		{
+			state = trends_eval_avg(table, itemid, start, end, value);
+		}
+
 		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, *value, state);
 	}
 
 	return state;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get average values of multiple ranges                             *
+ *                                                                            *
+ * Parameters: table  - [IN] the trends table name                            *
+ *             itemid - [IN] the itemid                                       *
+ *             ranges - [IN] the ranges                                       *
+ *             values - [OUT] the average values                              *
+ *             states - [OUT] the value states                                *
+ *                                                                            *
+ * Comments: The values are taken from trend function cache, prefetched       *
+ *           trends or period rollups. The trends missing from all of them    *
+ *           are selected with a single database query for all ranges.        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_get_avgs(const char *table, zbx_uint64_t itemid, const zbx_vector_trend_range_t *ranges,
+		double *values, zbx_trend_state_t *states)
+{
+	int		i, cache_mode = ZBX_TRENDS_ROLLUP_CACHE_NONE;
+	unsigned char	*cached;
+
+	if (0 == ranges->values_num)
+		return;
+
+	for (i = 0; i < ranges->values_num; i++)
+		states[i] = ZBX_TREND_STATE_UNKNOWN;
+
+	if (ranges->values_num == zbx_tfc_get_values(itemid, ZBX_TREND_FUNCTION_AVG, ranges->values,
+			ranges->values_num, values, states))
+	{
+		return;
+	}
+
+	cached = (unsigned char *)zbx_malloc(NULL, (size_t)ranges->values_num);
+
+	for (i = 0; i < ranges->values_num; i++)
+		cached[i] = (ZBX_TREND_STATE_UNKNOWN != states[i]);
+
+	zbx_trends_prefetch_get_avgs(table, itemid, ranges->values, ranges->values_num, values, states);
+
+	/* single trend hours are cached as function values, rollups are cached only for longer periods */
+	for (i = 0; i < ranges->values_num; i++)
+	{
+		if (ZBX_TREND_STATE_UNKNOWN == states[i] && ranges->values[i].end - ranges->values[i].start >=
+				SEC_PER_HOUR)
+		{
+			cache_mode = ZBX_TRENDS_ROLLUP_CACHE_OPTIONAL;
+			break;
+		}
+	}
+
+	if (SUCCEED != trends_eval_rollups(table, itemid, ranges->values, ranges->values_num, ZBX_TREND_FUNCTION_AVG,
+			cache_mode, values, states))
+	{
+		for (i = 0; i < ranges->values_num; i++)
+		{
+			if (ZBX_TREND_STATE_UNKNOWN == states[i])
+			{
+				states[i] = trends_eval_avg(table, itemid, ranges->values[i].start,
+						ranges->values[i].end, &values[i]);
+			}
+		}
+	}
+
+	for (i = 0; i < ranges->values_num; i++)
+	{
+		if (0 == cached[i])
+		{
+			zbx_tfc_put_value(itemid, ranges->values[i].start, ranges->values[i].end,
+					ZBX_TREND_FUNCTION_AVG, values[i], states[i]);
+		}
+	}
+
+	zbx_free(cached);
+}
+
 const char	*zbx_trends_error(zbx_trend_state_t state)
 {
 	if (0 > state || state >= ZBX_TREND_STATE_COUNT)
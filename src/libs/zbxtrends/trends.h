@@ -31,13 +31,48 @@ typedef enum
 	ZBX_TREND_FUNCTION_DELTA,
 	ZBX_TREND_FUNCTION_MAX,
 	ZBX_TREND_FUNCTION_MIN,
-	ZBX_TREND_FUNCTION_SUM
+	ZBX_TREND_FUNCTION_SUM,
+	ZBX_TREND_FUNCTION_ROLLUP_FLOAT,
+	ZBX_TREND_FUNCTION_ROLLUP_UINT
 }
 zbx_trend_function_t;
 
+/* the aggregated trends of a period */
+typedef struct
+{
+	double	num;
+	double	sum;
+	double	min;
+	double	max;
+}
+zbx_tfc_rollup_t;
+
+/* the period rollup request */
+typedef struct
+{
+	int			start;		/* the first trend clock of the period */
+	int			end;		/* the last trend clock of the period */
+	zbx_tfc_rollup_t	rollup;
+	unsigned char		cached;		/* 1 if the rollup was found in cache */
+	zbx_uint32_t		revision;	/* non zero if the rollup slot is reserved for loading */
+}
+zbx_tfc_bucket_t;
+
+ZBX_VECTOR_DECL(tfc_bucket, zbx_tfc_bucket_t)
+
 int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double *value,
 		zbx_trend_state_t *state);
+int	zbx_tfc_get_values(zbx_uint64_t itemid, zbx_trend_function_t function, const zbx_trend_range_t *ranges,
+		int ranges_num, double *values, zbx_trend_state_t *states);
 void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double value,
 		zbx_trend_state_t state);
 
+int	zbx_tfc_get_rollups(zbx_uint64_t itemid, zbx_trend_function_t type, zbx_tfc_bucket_t *buckets,
+		int buckets_num);
+void	zbx_tfc_put_rollups(zbx_uint64_t itemid, zbx_trend_function_t type, const zbx_tfc_bucket_t *buckets,
+		int buckets_num, int loaded);
+
+void	zbx_trends_prefetch_get_avgs(const char *table, zbx_uint64_t itemid, const zbx_trend_range_t *ranges,
+		int ranges_num, double *values, zbx_trend_state_t *states);
+
 #endif
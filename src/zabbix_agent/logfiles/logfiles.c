@@ -1928,13 +1928,40 @@ clean:
 	return	ret;
 }
 
+/* tests if any byte in a 64-bit word is zero, see "Bit Twiddling Hacks" by Sean Eron Anderson */
+#define ZBX_WORD_HAS_ZERO_BYTE(v)	(((v) - __UINT64_C(0x0101010101010101)) & ~(v) & \
+		__UINT64_C(0x8080808080808080))
+
+/* tests if a 64-bit word contains NUL, LF or CR byte */
+#define ZBX_WORD_HAS_NUL_CR_LF(v)	(ZBX_WORD_HAS_ZERO_BYTE(v) |					\
+		ZBX_WORD_HAS_ZERO_BYTE((v) ^ __UINT64_C(0x0a0a0a0a0a0a0a0a)) |				\
+		ZBX_WORD_HAS_ZERO_BYTE((v) ^ __UINT64_C(0x0d0d0d0d0d0d0d0d)))
+
 static char	*buf_find_newline(char *p, char **p_next, const char *p_end, const char *cr, const char *lf,
 		size_t szbyte)
 {
 	if (1 == szbyte)	/* single-byte character set */
 	{
+		zbx_uint64_t	word;
+
 		for (; p < p_end; p++)
 		{
+			/* Skip over regular text 8 bytes at a time, only words containing NUL, CR or LF bytes */
+			/* are examined byte by byte. memcpy() is used for unaligned access and is compiled */
+			/* into a single load instruction. */
+			while (p + sizeof(word) <= p_end)
+			{
+				memcpy(&word, p, sizeof(word));
+
+				if (0 != ZBX_WORD_HAS_NUL_CR_LF(word))
+					break;
+
+				p += sizeof(word);
+			}
+
+			if (p == p_end)
+				break;
+
 			/* detect NULL byte and replace it with '?' character */
 			if (0x0 == *p)
 			{
@@ -2003,6 +2030,9 @@ static char	*buf_find_newline(char *p, char **p_next, const char *p_end, const c
 	}
 }
 
+#undef ZBX_WORD_HAS_ZERO_BYTE
+#undef ZBX_WORD_HAS_NUL_CR_LF
+
 static int	zbx_match_log_rec(const zbx_vector_ptr_t *regexps, const char *value, const char *pattern,
 		const char *output_template, char **output, char **err_msg)
 {
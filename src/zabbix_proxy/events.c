@@ -100,3 +100,8 @@ void	zbx_events_update_itservices(void)
 {
 	THIS_SHOULD_NEVER_HAPPEN;
 }
+
+void	zbx_events_update_open_problems(void)
+{
+	THIS_SHOULD_NEVER_HAPPEN;
+}
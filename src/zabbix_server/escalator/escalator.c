@@ -29,7 +29,6 @@
 #include "zbxcrypto.h"
 #include "comms.h"
 #include "../../libs/zbxserver/get_host_from_event.h"
-#include "../../libs/zbxserver/zabbix_users.h"
 #include "zbxservice.h"
 #include "service_protocol.h"
 #include "dbcache.h"
@@ -37,6 +36,7 @@
 #include "escalator.h"
 
 extern int	CONFIG_ESCALATOR_FORKS;
+extern int	CONFIG_CONFSYNCER_FREQUENCY;
 
 #define CONFIG_ESCALATOR_FREQUENCY	3
 
@@ -100,6 +100,64 @@ typedef struct
 }
 zbx_service_role_t;
 
+/* user data required to check permissions and resolve media of message recipients */
+typedef struct
+{
+	zbx_uint64_t			userid;
+	zbx_uint64_t			roleid;
+
+	/* the user type, -1 if user was not found */
+	int				type;
+
+	/* SUCCEED if user does not belong to disabled user groups, FAIL otherwise */
+	int				perm2system;
+
+	char				*timezone;
+
+	/* host group identifier, permission pairs sorted by host group identifier */
+	zbx_vector_uint64_pair_t	rights;
+
+	/* the tag filters (zbx_tag_filter_t) sorted by host group identifier */
+	zbx_vector_ptr_t		tag_filters;
+
+	/* the media types of user media */
+	zbx_vector_uint64_t		mediatypeids;
+}
+zbx_escalator_user_t;
+
+/* the media type message template */
+typedef struct
+{
+	zbx_uint64_t	mediatypeid;
+	int		eventsource;
+	int		recovery;
+	char		*subject;
+	char		*message;
+}
+zbx_mediatype_message_t;
+
+/* the host groups of the event source object */
+typedef struct
+{
+	zbx_uint64_t		objectid;
+	int			object;
+	zbx_vector_uint64_t	hostgroupids;
+}
+zbx_object_hostgroups_t;
+
+/* Recipient permission and media cache. User data and media type message templates are */
+/* refreshed with configuration cache update frequency, object host groups - on every   */
+/* escalator cycle.                                                                      */
+typedef struct
+{
+	zbx_hashset_t	users;
+	zbx_hashset_t	mediatype_messages;
+	zbx_hashset_t	object_hostgroups;
+	int		mediatype_messages_loaded;
+	time_t		lastrefresh;
+}
+zbx_escalator_cache_t;
+
 ZBX_VECTOR_DECL(service_alarm, zbx_service_alarm_t)
 ZBX_VECTOR_IMPL(service_alarm, zbx_service_alarm_t)
 
@@ -121,32 +179,506 @@ extern ZBX_THREAD_LOCAL unsigned char	process_type;
 extern unsigned char			program_type;
 extern ZBX_THREAD_LOCAL int		server_num, process_num;
 
+static zbx_escalator_cache_t	escalator_cache;
+
 static void	add_message_alert(const DB_EVENT *event, const DB_EVENT *r_event, zbx_uint64_t actionid, int esc_step,
 		zbx_uint64_t userid, zbx_uint64_t mediatypeid, const char *subject, const char *message,
 		const DB_ACKNOWLEDGE *ack, const zbx_service_alarm_t *service_alarm, const DB_SERVICE *service,
 		int err_type, const char *tz);
 
-static int	get_user_info(zbx_uint64_t userid, zbx_uint64_t *roleid, char **user_timezone)
+static void	escalator_user_clean(zbx_escalator_user_t *user)
 {
-	int		user_type = -1;
-	DB_RESULT	result;
-	DB_ROW		row;
+	zbx_free(user->timezone);
+	zbx_vector_uint64_pair_destroy(&user->rights);
+	zbx_vector_ptr_clear_ext(&user->tag_filters, (zbx_clean_func_t)zbx_tag_filter_free);
+	zbx_vector_ptr_destroy(&user->tag_filters);
+	zbx_vector_uint64_destroy(&user->mediatypeids);
+}
+
+static void	mediatype_message_clean(zbx_mediatype_message_t *message)
+{
+	zbx_free(message->subject);
+	zbx_free(message->message);
+}
+
+static void	object_hostgroups_clean(zbx_object_hostgroups_t *object_hostgroups)
+{
+	zbx_vector_uint64_destroy(&object_hostgroups->hostgroupids);
+}
+
+static zbx_hash_t	mediatype_message_hash(const void *data)
+{
+	const zbx_mediatype_message_t	*message = (const zbx_mediatype_message_t *)data;
+	zbx_hash_t			hash;
+
+	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&message->mediatypeid);
+	hash = ZBX_DEFAULT_HASH_ALGO(&message->eventsource, sizeof(message->eventsource), hash);
+
+	return ZBX_DEFAULT_HASH_ALGO(&message->recovery, sizeof(message->recovery), hash);
+}
+
+static int	mediatype_message_compare(const void *d1, const void *d2)
+{
+	const zbx_mediatype_message_t	*m1 = (const zbx_mediatype_message_t *)d1;
+	const zbx_mediatype_message_t	*m2 = (const zbx_mediatype_message_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(m1->mediatypeid, m2->mediatypeid);
+	ZBX_RETURN_IF_NOT_EQUAL(m1->eventsource, m2->eventsource);
+
+	return m1->recovery - m2->recovery;
+}
+
+static zbx_hash_t	object_hostgroups_hash(const void *data)
+{
+	const zbx_object_hostgroups_t	*object_hostgroups = (const zbx_object_hostgroups_t *)data;
+	zbx_hash_t			hash;
+
+	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&object_hostgroups->objectid);
+
+	return ZBX_DEFAULT_HASH_ALGO(&object_hostgroups->object, sizeof(object_hostgroups->object), hash);
+}
+
+static int	object_hostgroups_compare(const void *d1, const void *d2)
+{
+	const zbx_object_hostgroups_t	*o1 = (const zbx_object_hostgroups_t *)d1;
+	const zbx_object_hostgroups_t	*o2 = (const zbx_object_hostgroups_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(o1->objectid, o2->objectid);
+
+	return o1->object - o2->object;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initializes escalator recipient cache                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	escalator_cache_init(void)
+{
+	zbx_hashset_create_ext(&escalator_cache.users, 100, ZBX_DEFAULT_UINT64_HASH_FUNC,
+			ZBX_DEFAULT_UINT64_COMPARE_FUNC, (zbx_clean_func_t)escalator_user_clean,
+			ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+	zbx_hashset_create_ext(&escalator_cache.mediatype_messages, 100, mediatype_message_hash,
+			mediatype_message_compare, (zbx_clean_func_t)mediatype_message_clean,
+			ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+	zbx_hashset_create_ext(&escalator_cache.object_hostgroups, 100, object_hostgroups_hash,
+			object_hostgroups_compare, (zbx_clean_func_t)object_hostgroups_clean,
+			ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+
+	escalator_cache.mediatype_messages_loaded = FAIL;
+	escalator_cache.lastrefresh = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: drops outdated escalator recipient cache data                     *
+ *                                                                            *
+ * Parameters: now - [IN] the current time                                    *
+ *                                                                            *
+ * Comments: The user permissions, media and media type message templates are *
+ *           reloaded from database with configuration cache update           *
+ *           frequency. The host groups of event source objects are reloaded  *
+ *           on every escalator cycle.                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	escalator_cache_refresh(time_t now)
+{
+	zbx_hashset_clear(&escalator_cache.object_hostgroups);
+
+	if (now - escalator_cache.lastrefresh < CONFIG_CONFSYNCER_FREQUENCY)
+		return;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() users:%d media type messages:%d", __func__,
+			escalator_cache.users.num_data, escalator_cache.mediatype_messages.num_data);
+
+	zbx_hashset_clear(&escalator_cache.users);
+	zbx_hashset_clear(&escalator_cache.mediatype_messages);
+	escalator_cache.mediatype_messages_loaded = FAIL;
+	escalator_cache.lastrefresh = now;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: merges host group rights of user groups keeping the lowest        *
+ *          permission, the same way as frontend does                         *
+ *                                                                            *
+ * Parameters: rights - [IN/OUT] the host group identifier, permission pairs  *
+ *                                                                            *
+ * Comments: The merged rights are sorted by host group identifier.           *
+ *                                                                            *
+ ******************************************************************************/
+static void	escalator_merge_rights(zbx_vector_uint64_pair_t *rights)
+{
+	int	i, j;
+
+	zbx_vector_uint64_pair_sort(rights, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0, j = 1; j < rights->values_num; j++)
+	{
+		if (rights->values[i].first != rights->values[j].first)
+		{
+			rights->values[++i] = rights->values[j];
+			continue;
+		}
+
+		if (rights->values[j].second < rights->values[i].second)
+			rights->values[i].second = rights->values[j].second;
+	}
+
+	if (0 != rights->values_num)
+		rights->values_num = i + 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads data of users missing in escalator recipient cache          *
+ *                                                                            *
+ * Parameters: userids - [IN] the user identifiers                            *
+ *                                                                            *
+ * Comments: The data of all users is loaded with one query per table, so     *
+ *           all recipients of an operation should be loaded at once before   *
+ *           checking their permissions.                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	escalator_load_users(const zbx_vector_uint64_t *userids)
+{
+	zbx_escalator_user_t	*user, user_local;
+	zbx_vector_uint64_t	loadids, rightids;
+	zbx_uint64_t		userid;
+	DB_RESULT		result;
+	DB_ROW			row;
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
+	int			i;
+
+	zbx_vector_uint64_create(&loadids);
 
-	*user_timezone = NULL;
+	for (i = 0; i < userids->values_num; i++)
+	{
+		if (NULL == zbx_hashset_search(&escalator_cache.users, &userids->values[i]))
+			zbx_vector_uint64_append(&loadids, userids->values[i]);
+	}
+
+	if (0 == loadids.values_num)
+		goto out;
 
-	result = DBselect("select r.type,u.roleid,u.timezone from users u,role r where u.roleid=r.roleid and"
-			" userid=" ZBX_FS_UI64, userid);
+	zbx_vector_uint64_sort(&loadids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_uniq(&loadids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
-	if (NULL != (row = DBfetch(result)) && FAIL == DBis_null(row[0]))
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() users:%d", __func__, loadids.values_num);
+
+	for (i = 0; i < loadids.values_num; i++)
 	{
-		user_type = atoi(row[0]);
-		ZBX_STR2UINT64(*roleid, row[1]);
-		*user_timezone = zbx_strdup(NULL, row[2]);
+		user_local.userid = loadids.values[i];
+		user_local.roleid = 0;
+		user_local.type = -1;
+		user_local.perm2system = SUCCEED;
+		user_local.timezone = NULL;
+		zbx_vector_uint64_pair_create(&user_local.rights);
+		zbx_vector_ptr_create(&user_local.tag_filters);
+		zbx_vector_uint64_create(&user_local.mediatypeids);
+
+		zbx_hashset_insert(&escalator_cache.users, &user_local, sizeof(user_local));
 	}
 
+	zbx_vector_uint64_create(&rightids);
+
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
+			"select u.userid,r.type,u.roleid,u.timezone from users u,role r where u.roleid=r.roleid and");
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "u.userid", loadids.values, loadids.values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		if (SUCCEED == DBis_null(row[1]))
+			continue;
+
+		ZBX_STR2UINT64(userid, row[0]);
+
+		if (NULL == (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &userid)))
+			continue;
+
+		user->type = atoi(row[1]);
+		ZBX_STR2UINT64(user->roleid, row[2]);
+		user->timezone = zbx_strdup(user->timezone, row[3]);
+
+		/* super admins have access to all host groups, rights and tag filters are not checked */
+		if (USER_TYPE_SUPER_ADMIN != user->type)
+			zbx_vector_uint64_append(&rightids, userid);
+	}
 	DBfree_result(result);
 
-	return user_type;
+	sql_offset = 0;
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select distinct ug.userid"
+			" from usrgrp g,users_groups ug"
+			" where g.usrgrpid=ug.usrgrpid"
+				" and g.users_status=%d"
+				" and",
+			GROUP_STATUS_DISABLED);
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "ug.userid", loadids.values, loadids.values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(userid, row[0]);
+
+		if (NULL != (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &userid)))
+			user->perm2system = FAIL;
+	}
+	DBfree_result(result);
+
+	if (0 != rightids.values_num)
+	{
+		zbx_uint64_pair_t	right;
+		zbx_tag_filter_t	*tag_filter;
+
+		sql_offset = 0;
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
+				"select ug.userid,r.id,r.permission"
+				" from rights r"
+				" join users_groups ug on ug.usrgrpid=r.groupid"
+					" where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "ug.userid", rightids.values,
+				rightids.values_num);
+
+		result = DBselect("%s", sql);
+
+		while (NULL != (row = DBfetch(result)))
+		{
+			ZBX_STR2UINT64(userid, row[0]);
+
+			if (NULL == (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users,
+					&userid)))
+			{
+				continue;
+			}
+
+			ZBX_STR2UINT64(right.first, row[1]);
+			right.second = (zbx_uint64_t)atoi(row[2]);
+			zbx_vector_uint64_pair_append(&user->rights, right);
+		}
+		DBfree_result(result);
+
+		sql_offset = 0;
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
+				"select ug.userid,tf.groupid,tf.tag,tf.value"
+				" from tag_filter tf"
+				" join users_groups ug on ug.usrgrpid=tf.usrgrpid"
+					" where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "ug.userid", rightids.values,
+				rightids.values_num);
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " order by ug.userid,tf.groupid");
+
+		result = DBselect("%s", sql);
+
+		while (NULL != (row = DBfetch(result)))
+		{
+			ZBX_STR2UINT64(userid, row[0]);
+
+			if (NULL == (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users,
+					&userid)))
+			{
+				continue;
+			}
+
+			tag_filter = (zbx_tag_filter_t *)zbx_malloc(NULL, sizeof(zbx_tag_filter_t));
+			ZBX_STR2UINT64(tag_filter->hostgroupid, row[1]);
+			tag_filter->tag = zbx_strdup(NULL, row[2]);
+			tag_filter->value = zbx_strdup(NULL, row[3]);
+			zbx_vector_ptr_append(&user->tag_filters, tag_filter);
+		}
+		DBfree_result(result);
+
+		for (i = 0; i < rightids.values_num; i++)
+		{
+			user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &rightids.values[i]);
+			escalator_merge_rights(&user->rights);
+		}
+	}
+
+	sql_offset = 0;
+	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, "select distinct userid,mediatypeid from media where");
+	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "userid", loadids.values, loadids.values_num);
+
+	result = DBselect("%s", sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		zbx_uint64_t	mediatypeid;
+
+		ZBX_STR2UINT64(userid, row[0]);
+
+		if (NULL == (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &userid)))
+			continue;
+
+		ZBX_STR2UINT64(mediatypeid, row[1]);
+		zbx_vector_uint64_append(&user->mediatypeids, mediatypeid);
+	}
+	DBfree_result(result);
+
+	zbx_free(sql);
+	zbx_vector_uint64_destroy(&rightids);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+out:
+	zbx_vector_uint64_destroy(&loadids);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets cached user data, loading it from database if necessary      *
+ *                                                                            *
+ * Parameters: userid - [IN] the user identifier                              *
+ *                                                                            *
+ * Return value: the cached user data                                         *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_escalator_user_t	*escalator_get_user(zbx_uint64_t userid)
+{
+	zbx_escalator_user_t	*user;
+	zbx_vector_uint64_t	userids;
+
+	if (NULL != (user = (zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &userid)))
+		return user;
+
+	zbx_vector_uint64_create(&userids);
+	zbx_vector_uint64_append(&userids, userid);
+	escalator_load_users(&userids);
+	zbx_vector_uint64_destroy(&userids);
+
+	return (const zbx_escalator_user_t *)zbx_hashset_search(&escalator_cache.users, &userid);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets cached media type message template                           *
+ *                                                                            *
+ * Parameters: mediatypeid - [IN] the media type identifier                   *
+ *             eventsource - [IN] the event source                            *
+ *             recovery    - [IN] the operation mode                          *
+ *                                                                            *
+ * Return value: the media type message template or NULL if media type has no *
+ *               template for the specified event source and operation mode   *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_mediatype_message_t	*escalator_get_mediatype_message(zbx_uint64_t mediatypeid,
+		unsigned char eventsource, unsigned char recovery)
+{
+	zbx_mediatype_message_t	message_local;
+
+	if (SUCCEED != escalator_cache.mediatype_messages_loaded)
+	{
+		DB_RESULT	result;
+		DB_ROW		row;
+
+		result = DBselect("select mediatypeid,eventsource,recovery,subject,message from media_type_message");
+
+		while (NULL != (row = DBfetch(result)))
+		{
+			ZBX_STR2UINT64(message_local.mediatypeid, row[0]);
+			message_local.eventsource = atoi(row[1]);
+			message_local.recovery = atoi(row[2]);
+			message_local.subject = zbx_strdup(NULL, row[3]);
+			message_local.message = zbx_strdup(NULL, row[4]);
+
+			zbx_hashset_insert(&escalator_cache.mediatype_messages, &message_local, sizeof(message_local));
+		}
+		DBfree_result(result);
+
+		escalator_cache.mediatype_messages_loaded = SUCCEED;
+	}
+
+	message_local.mediatypeid = mediatypeid;
+	message_local.eventsource = eventsource;
+	message_local.recovery = recovery;
+
+	return (const zbx_mediatype_message_t *)zbx_hashset_search(&escalator_cache.mediatype_messages,
+			&message_local);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets cached host groups of event source object                    *
+ *                                                                            *
+ * Parameters: object   - [IN] the event object (EVENT_OBJECT_*)              *
+ *             objectid - [IN] the trigger or item identifier                 *
+ *                                                                            *
+ * Return value: the sorted host group identifiers                            *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_vector_uint64_t	*escalator_get_object_hostgroups(int object, zbx_uint64_t objectid)
+{
+	zbx_object_hostgroups_t	*object_hostgroups, object_hostgroups_local;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_uint64_t		hostgroupid;
+
+	object_hostgroups_local.objectid = objectid;
+	object_hostgroups_local.object = object;
+
+	if (NULL != (object_hostgroups = (zbx_object_hostgroups_t *)zbx_hashset_search(
+			&escalator_cache.object_hostgroups, &object_hostgroups_local)))
+	{
+		return &object_hostgroups->hostgroupids;
+	}
+
+	zbx_vector_uint64_create(&object_hostgroups_local.hostgroupids);
+
+	if (EVENT_OBJECT_TRIGGER == object)
+	{
+		result = DBselect(
+				"select distinct hg.groupid from items i"
+				" join functions f on i.itemid=f.itemid"
+				" join hosts_groups hg on hg.hostid = i.hostid"
+					" and f.triggerid=" ZBX_FS_UI64,
+				objectid);
+	}
+	else
+	{
+		result = DBselect(
+				"select hg.groupid from items i"
+				" join hosts_groups hg on hg.hostid=i.hostid"
+				" where i.itemid=" ZBX_FS_UI64,
+				objectid);
+	}
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(hostgroupid, row[0]);
+		zbx_vector_uint64_append(&object_hostgroups_local.hostgroupids, hostgroupid);
+	}
+	DBfree_result(result);
+
+	zbx_vector_uint64_sort(&object_hostgroups_local.hostgroupids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	object_hostgroups = (zbx_object_hostgroups_t *)zbx_hashset_insert(&escalator_cache.object_hostgroups,
+			&object_hostgroups_local, sizeof(object_hostgroups_local));
+
+	return &object_hostgroups->hostgroupids;
+}
+
+static char	*escalator_get_user_timezone(zbx_uint64_t userid)
+{
+	const zbx_escalator_user_t	*user;
+
+	user = escalator_get_user(userid);
+
+	return NULL != user->timezone ? zbx_strdup(NULL, user->timezone) : NULL;
+}
+
+static int	get_user_info(zbx_uint64_t userid, zbx_uint64_t *roleid, char **user_timezone)
+{
+	const zbx_escalator_user_t	*user;
+
+	user = escalator_get_user(userid);
+
+	*roleid = user->roleid;
+	*user_timezone = escalator_get_user_timezone(userid);
+
+	return user->type;
 }
 
 /******************************************************************************
@@ -159,33 +691,32 @@ static int	get_user_info(zbx_uint64_t userid, zbx_uint64_t *roleid, char **user_
  *                   or permission otherwise                                  *
  *                                                                            *
  ******************************************************************************/
-static int	get_hostgroups_permission(zbx_uint64_t userid, zbx_vector_uint64_t *hostgroupids)
+static int	get_hostgroups_permission(zbx_uint64_t userid, const zbx_vector_uint64_t *hostgroupids)
 {
-	int		perm = PERM_DENY;
-	char		*sql = NULL;
-	size_t		sql_alloc = 0, sql_offset = 0;
-	DB_RESULT	result;
-	DB_ROW		row;
+	int				i, perm = PERM_DENY, found = FAIL;
+	const zbx_escalator_user_t	*user;
+	const zbx_uint64_pair_t		*right;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	if (0 == hostgroupids->values_num)
 		goto out;
 
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-			"select min(r.permission)"
-			" from rights r"
-			" join users_groups ug on ug.usrgrpid=r.groupid"
-				" where ug.userid=" ZBX_FS_UI64 " and", userid);
-	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "r.id",
-			hostgroupids->values, hostgroupids->values_num);
-	result = DBselect("%s", sql);
+	user = escalator_get_user(userid);
 
-	if (NULL != (row = DBfetch(result)) && FAIL == DBis_null(row[0]))
-		perm = atoi(row[0]);
+	for (i = 0; i < user->rights.values_num; i++)
+	{
+		right = &user->rights.values[i];
 
-	DBfree_result(result);
-	zbx_free(sql);
+		if (FAIL == zbx_vector_uint64_bsearch(hostgroupids, right->first, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+			continue;
+
+		if (SUCCEED != found || (int)right->second < perm)
+		{
+			perm = (int)right->second;
+			found = SUCCEED;
+		}
+	}
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_permission_string(perm));
 
@@ -205,49 +736,29 @@ out:
  *               FAIL    - user does not have access                          *
  *                                                                            *
  ******************************************************************************/
-static int	check_tag_based_permission(zbx_uint64_t userid, zbx_vector_uint64_t *hostgroupids,
+static int	check_tag_based_permission(zbx_uint64_t userid, const zbx_vector_uint64_t *hostgroupids,
 		const DB_EVENT *event)
 {
-	char			*sql = NULL, hostgroupid[ZBX_MAX_UINT64_LEN + 1];
-	size_t			sql_alloc = 0, sql_offset = 0;
-	DB_RESULT		result;
-	DB_ROW			row;
-	int			ret = FAIL, i;
-	zbx_vector_ptr_t	tag_filters;
-	zbx_tag_filter_t	*tag_filter;
-	zbx_condition_t		condition;
+	char				hostgroupid[ZBX_MAX_UINT64_LEN + 1];
+	int				ret = FAIL, i;
+	const zbx_escalator_user_t	*user;
+	const zbx_tag_filter_t		*tag_filter;
+	zbx_condition_t			condition;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	zbx_vector_ptr_create(&tag_filters);
-
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-			"select tf.groupid,tf.tag,tf.value from tag_filter tf"
-			" join users_groups ug on ug.usrgrpid=tf.usrgrpid"
-				" where ug.userid=" ZBX_FS_UI64, userid);
-	result = DBselect("%s order by tf.groupid", sql);
+	user = escalator_get_user(userid);
 
-	while (NULL != (row = DBfetch(result)))
-	{
-		tag_filter = (zbx_tag_filter_t *)zbx_malloc(NULL, sizeof(zbx_tag_filter_t));
-		ZBX_STR2UINT64(tag_filter->hostgroupid, row[0]);
-		tag_filter->tag = zbx_strdup(NULL, row[1]);
-		tag_filter->value = zbx_strdup(NULL, row[2]);
-		zbx_vector_ptr_append(&tag_filters, tag_filter);
-	}
-	zbx_free(sql);
-	DBfree_result(result);
-
-	if (0 < tag_filters.values_num)
+	if (0 < user->tag_filters.values_num)
 		condition.op = CONDITION_OPERATOR_EQUAL;
 	else
 		ret = SUCCEED;
 
-	for (i = 0; i < tag_filters.values_num && SUCCEED != ret; i++)
+	for (i = 0; i < user->tag_filters.values_num && SUCCEED != ret; i++)
 	{
-		tag_filter = (zbx_tag_filter_t *)tag_filters.values[i];
+		tag_filter = (const zbx_tag_filter_t *)user->tag_filters.values[i];
 
-		if (FAIL == zbx_vector_uint64_search(hostgroupids, tag_filter->hostgroupid,
+		if (FAIL == zbx_vector_uint64_bsearch(hostgroupids, tag_filter->hostgroupid,
 				ZBX_DEFAULT_UINT64_COMPARE_FUNC))
 		{
 			continue;
@@ -276,8 +787,6 @@ static int	check_tag_based_permission(zbx_uint64_t userid, zbx_vector_uint64_t *
 		else
 			ret = SUCCEED;
 	}
-	zbx_vector_ptr_clear_ext(&tag_filters, (zbx_clean_func_t)zbx_tag_filter_free);
-	zbx_vector_ptr_destroy(&tag_filters);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
@@ -294,11 +803,9 @@ static int	check_tag_based_permission(zbx_uint64_t userid, zbx_vector_uint64_t *
  ******************************************************************************/
 static int	get_trigger_permission(zbx_uint64_t userid, const DB_EVENT *event, char **user_timezone)
 {
-	int			perm = PERM_DENY;
-	DB_RESULT		result;
-	DB_ROW			row;
-	zbx_vector_uint64_t	hostgroupids;
-	zbx_uint64_t		hostgroupid, roleid;
+	int				perm = PERM_DENY;
+	const zbx_vector_uint64_t	*hostgroupids;
+	zbx_uint64_t			roleid;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -308,31 +815,13 @@ static int	get_trigger_permission(zbx_uint64_t userid, const DB_EVENT *event, ch
 		goto out;
 	}
 
-	zbx_vector_uint64_create(&hostgroupids);
-
-	result = DBselect(
-			"select distinct hg.groupid from items i"
-			" join functions f on i.itemid=f.itemid"
-			" join hosts_groups hg on hg.hostid = i.hostid"
-				" and f.triggerid=" ZBX_FS_UI64,
-			event->objectid);
+	hostgroupids = escalator_get_object_hostgroups(EVENT_OBJECT_TRIGGER, event->objectid);
 
-	while (NULL != (row = DBfetch(result)))
-	{
-		ZBX_STR2UINT64(hostgroupid, row[0]);
-		zbx_vector_uint64_append(&hostgroupids, hostgroupid);
-	}
-	DBfree_result(result);
-
-	zbx_vector_uint64_sort(&hostgroupids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
-
-	if (PERM_DENY < (perm = get_hostgroups_permission(userid, &hostgroupids)) &&
-			FAIL == check_tag_based_permission(userid, &hostgroupids, event))
+	if (PERM_DENY < (perm = get_hostgroups_permission(userid, hostgroupids)) &&
+			FAIL == check_tag_based_permission(userid, hostgroupids, event))
 	{
 		perm = PERM_DENY;
 	}
-
-	zbx_vector_uint64_destroy(&hostgroupids);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_permission_string(perm));
 
@@ -349,39 +838,19 @@ out:
  ******************************************************************************/
 static int	get_item_permission(zbx_uint64_t userid, zbx_uint64_t itemid, char **user_timezone)
 {
-	DB_RESULT		result;
-	DB_ROW			row;
-	int			perm = PERM_DENY;
-	zbx_vector_uint64_t	hostgroupids;
-	zbx_uint64_t		hostgroupid, roleid;
+	int		perm = PERM_DENY;
+	zbx_uint64_t	roleid;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	zbx_vector_uint64_create(&hostgroupids);
-	zbx_vector_uint64_sort(&hostgroupids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
-
 	if (USER_TYPE_SUPER_ADMIN == get_user_info(userid, &roleid, user_timezone))
 	{
 		perm = PERM_READ_WRITE;
 		goto out;
 	}
 
-	result = DBselect(
-			"select hg.groupid from items i"
-			" join hosts_groups hg on hg.hostid=i.hostid"
-			" where i.itemid=" ZBX_FS_UI64,
-			itemid);
-
-	while (NULL != (row = DBfetch(result)))
-	{
-		ZBX_STR2UINT64(hostgroupid, row[0]);
-		zbx_vector_uint64_append(&hostgroupids, hostgroupid);
-	}
-	DBfree_result(result);
-
-	perm = get_hostgroups_permission(userid, &hostgroupids);
+	perm = get_hostgroups_permission(userid, escalator_get_object_hostgroups(EVENT_OBJECT_ITEM, itemid));
 out:
-	zbx_vector_uint64_destroy(&hostgroupids);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_permission_string(perm));
 
@@ -720,10 +1189,11 @@ static void	add_user_msgs(zbx_uint64_t userid, zbx_uint64_t operationid, zbx_uin
 		int macro_type, unsigned char evt_src, unsigned char op_mode, const char *default_timezone,
 		const char *user_timezone)
 {
-	DB_RESULT	result;
-	DB_ROW		row;
-	zbx_uint64_t	mtid;
-	const char	*tz;
+	DB_RESULT			result;
+	DB_ROW				row;
+	zbx_uint64_t			mtid;
+	const char			*tz;
+	const zbx_mediatype_message_t	*mediatype_message;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -750,8 +1220,6 @@ static void	add_user_msgs(zbx_uint64_t userid, zbx_uint64_t operationid, zbx_uin
 					ZBX_ALERT_MESSAGE_ERR_NONE, tz);
 			goto out;
 		}
-
-		DBfree_result(result);
 	}
 	else
 		goto out;
@@ -760,40 +1228,40 @@ static void	add_user_msgs(zbx_uint64_t userid, zbx_uint64_t operationid, zbx_uin
 
 	if (0 != mediatypeid)
 	{
-		result = DBselect("select mediatype_messageid,subject,message,mediatypeid from media_type_message"
-				" where eventsource=%d and recovery=%d and mediatypeid=" ZBX_FS_UI64,
-				evt_src, op_mode, mediatypeid);
-
-		mediatypeid = 0;
+		if (NULL != (mediatype_message = escalator_get_mediatype_message(mediatypeid, evt_src, op_mode)))
+		{
+			add_user_msg(userid, mediatypeid, user_msg, mediatype_message->subject,
+					mediatype_message->message, actionid, event, r_event, ack, service_alarm,
+					service, MACRO_EXPAND_YES, macro_type, ZBX_ALERT_MESSAGE_ERR_NONE, tz);
+		}
+		else
+			mediatypeid = 0;
 	}
 	else
 	{
-		result = DBselect(
-				"select mm.mediatype_messageid,mm.subject,mm.message,mt.mediatypeid from media_type mt"
-				" left join (select mediatypeid,subject,message,mediatype_messageid"
-				" from media_type_message where eventsource=%d and recovery=%d) mm"
-				" on mt.mediatypeid=mm.mediatypeid"
-				" join (select distinct mediatypeid from media where userid=" ZBX_FS_UI64 ") m"
-				" on mt.mediatypeid=m.mediatypeid",
-				evt_src, op_mode, userid);
-	}
+		const zbx_escalator_user_t	*user;
+		int				i;
 
-	while (NULL != (row = DBfetch(result)))
-	{
-		zbx_uint64_t	mtmid;
+		user = escalator_get_user(userid);
 
-		ZBX_DBROW2UINT64(mtmid, row[0]);
-		ZBX_STR2UINT64(mediatypeid, row[3]);
-
-		if (0 != mtmid)
-		{
-			add_user_msg(userid, mediatypeid, user_msg, row[1], row[2], actionid, event, r_event, ack,
-					service_alarm, service, MACRO_EXPAND_YES, macro_type, ZBX_ALERT_MESSAGE_ERR_NONE, tz);
-		}
-		else
+		for (i = 0; i < user->mediatypeids.values_num; i++)
 		{
-			add_user_msg(userid, mediatypeid, user_msg, "", "", actionid, event, r_event, ack,
-					service_alarm, service, MACRO_EXPAND_NO, 0, ZBX_ALERT_MESSAGE_ERR_MSG, tz);
+			mediatypeid = user->mediatypeids.values[i];
+
+			if (NULL != (mediatype_message = escalator_get_mediatype_message(mediatypeid, evt_src,
+					op_mode)))
+			{
+				add_user_msg(userid, mediatypeid, user_msg, mediatype_message->subject,
+						mediatype_message->message, actionid, event, r_event, ack,
+						service_alarm, service, MACRO_EXPAND_YES, macro_type,
+						ZBX_ALERT_MESSAGE_ERR_NONE, tz);
+			}
+			else
+			{
+				add_user_msg(userid, mediatypeid, user_msg, "", "", actionid, event, r_event, ack,
+						service_alarm, service, MACRO_EXPAND_NO, 0,
+						ZBX_ALERT_MESSAGE_ERR_MSG, tz);
+			}
 		}
 	}
 
@@ -815,11 +1283,15 @@ static void	add_object_msg(zbx_uint64_t actionid, zbx_uint64_t operationid, ZBX_
 		const zbx_service_alarm_t *service_alarm, const DB_SERVICE *service, int macro_type,
 		unsigned char evt_src, unsigned char op_mode, const char *default_timezone, zbx_hashset_t *roles)
 {
-	DB_RESULT	result;
-	DB_ROW		row;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_vector_uint64_t	userids;
+	int			i;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	zbx_vector_uint64_create(&userids);
+
 	result = DBselect(
 			"select userid"
 			" from opmessage_usr"
@@ -834,7 +1306,6 @@ static void	add_object_msg(zbx_uint64_t actionid, zbx_uint64_t operationid, ZBX_
 	while (NULL != (row = DBfetch(result)))
 	{
 		zbx_uint64_t	userid;
-		char		*user_timezone = NULL;
 
 		ZBX_STR2UINT64(userid, row[0]);
 
@@ -842,7 +1313,18 @@ static void	add_object_msg(zbx_uint64_t actionid, zbx_uint64_t operationid, ZBX_
 		if (NULL != ack && ack->userid == userid)
 			continue;
 
-		if (SUCCEED != check_perm2system(userid))
+		zbx_vector_uint64_append(&userids, userid);
+	}
+	DBfree_result(result);
+
+	escalator_load_users(&userids);
+
+	for (i = 0; i < userids.values_num; i++)
+	{
+		zbx_uint64_t	userid = userids.values[i];
+		char		*user_timezone = NULL;
+
+		if (SUCCEED != escalator_get_user(userid)->perm2system)
 			continue;
 
 		switch (event->object)
@@ -861,7 +1343,7 @@ static void	add_object_msg(zbx_uint64_t actionid, zbx_uint64_t operationid, ZBX_
 					goto clean;
 				break;
 			default:
-				user_timezone = get_user_timezone(userid);
+				user_timezone = escalator_get_user_timezone(userid);
 		}
 
 		add_user_msgs(userid, operationid, 0, user_msg, actionid, event, r_event, ack, service_alarm, service,
@@ -869,7 +1351,8 @@ static void	add_object_msg(zbx_uint64_t actionid, zbx_uint64_t operationid, ZBX_
 clean:
 		zbx_free(user_timezone);
 	}
-	DBfree_result(result);
+
+	zbx_vector_uint64_destroy(&userids);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -896,12 +1379,14 @@ static void	add_sentusers_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid, zb
 		unsigned char op_mode,
 		const char *default_timezone, zbx_hashset_t *roles)
 {
-	char		*sql = NULL;
-	DB_RESULT	result;
-	DB_ROW		row;
-	zbx_uint64_t	userid, mediatypeid;
-	int		message_type;
-	size_t		sql_alloc = 0, sql_offset = 0;
+	char				*sql = NULL;
+	DB_RESULT			result;
+	DB_ROW				row;
+	zbx_uint64_t			userid, mediatypeid;
+	int				message_type, i;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	zbx_vector_uint64_pair_t	recipients;
+	zbx_vector_uint64_t		userids;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -928,22 +1413,38 @@ static void	add_sentusers_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid, zb
 	if (NULL != ack)
 		message_type = MACRO_TYPE_MESSAGE_UPDATE;
 
+	zbx_vector_uint64_pair_create(&recipients);
+	zbx_vector_uint64_create(&userids);
+
 	result = DBselect("%s", sql);
 
 	while (NULL != (row = DBfetch(result)))
 	{
-		char	*user_timezone = NULL;
+		zbx_uint64_pair_t	recipient;
 
-		ZBX_DBROW2UINT64(userid, row[0]);
+		ZBX_DBROW2UINT64(recipient.first, row[0]);
 
 		/* exclude acknowledgement author from the recipient list */
-		if (NULL != ack && ack->userid == userid)
+		if (NULL != ack && ack->userid == recipient.first)
 			continue;
 
-		if (SUCCEED != check_perm2system(userid))
-			continue;
+		ZBX_STR2UINT64(recipient.second, row[1]);
+		zbx_vector_uint64_pair_append(&recipients, recipient);
+		zbx_vector_uint64_append(&userids, recipient.first);
+	}
+	DBfree_result(result);
 
-		ZBX_STR2UINT64(mediatypeid, row[1]);
+	escalator_load_users(&userids);
+
+	for (i = 0; i < recipients.values_num; i++)
+	{
+		char	*user_timezone = NULL;
+
+		userid = recipients.values[i].first;
+		mediatypeid = recipients.values[i].second;
+
+		if (SUCCEED != escalator_get_user(userid)->perm2system)
+			continue;
 
 		switch (event->object)
 		{
@@ -961,7 +1462,7 @@ static void	add_sentusers_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid, zb
 					goto clean;
 				break;
 			default:
-				user_timezone = get_user_timezone(userid);
+				user_timezone = escalator_get_user_timezone(userid);
 		}
 
 		add_user_msgs(userid, operationid, mediatypeid, user_msg, actionid, event, r_event, ack, service_alarm,
@@ -969,8 +1470,9 @@ static void	add_sentusers_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid, zb
 clean:
 		zbx_free(user_timezone);
 	}
-	DBfree_result(result);
 
+	zbx_vector_uint64_destroy(&userids);
+	zbx_vector_uint64_pair_destroy(&recipients);
 	zbx_free(sql);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -1034,7 +1536,7 @@ static void	add_sentusers_msg_esc_cancel(ZBX_USER_MSG **user_msg, zbx_uint64_t a
 		mediatypeid_prev = mediatypeid;
 		esc_step_prev = esc_step;
 
-		if (SUCCEED != check_perm2system(userid))
+		if (SUCCEED != escalator_get_user(userid)->perm2system)
 			continue;
 
 		switch (event->object)
@@ -1053,7 +1555,7 @@ static void	add_sentusers_msg_esc_cancel(ZBX_USER_MSG **user_msg, zbx_uint64_t a
 					goto clean;
 				break;
 			default:
-				user_timezone = get_user_timezone(userid);
+				user_timezone = escalator_get_user_timezone(userid);
 		}
 
 		message_dyn = zbx_dsprintf(NULL, "NOTE: Escalation canceled: %s\nLast message sent:\n%s", error,
@@ -1092,12 +1594,16 @@ static void	add_sentusers_ack_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid
 		const DB_EVENT *event, const DB_EVENT *r_event, const DB_ACKNOWLEDGE *ack, unsigned char evt_src,
 		const char *default_timezone)
 {
-	DB_RESULT	result;
-	DB_ROW		row;
-	zbx_uint64_t	userid;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_uint64_t		userid;
+	zbx_vector_uint64_t	userids;
+	int			i;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
+	zbx_vector_uint64_create(&userids);
+
 	result = DBselect(
 			"select distinct userid"
 			" from acknowledges"
@@ -1106,15 +1612,25 @@ static void	add_sentusers_ack_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid
 
 	while (NULL != (row = DBfetch(result)))
 	{
-		char	*user_timezone = NULL;
-
 		ZBX_DBROW2UINT64(userid, row[0]);
 
 		/* exclude acknowledgement author from the recipient list */
 		if (ack->userid == userid)
 			continue;
 
-		if (SUCCEED != check_perm2system(userid))
+		zbx_vector_uint64_append(&userids, userid);
+	}
+	DBfree_result(result);
+
+	escalator_load_users(&userids);
+
+	for (i = 0; i < userids.values_num; i++)
+	{
+		char	*user_timezone = NULL;
+
+		userid = userids.values[i];
+
+		if (SUCCEED != escalator_get_user(userid)->perm2system)
 			continue;
 
 		if (PERM_READ > get_trigger_permission(userid, event, &user_timezone))
@@ -1126,7 +1642,8 @@ static void	add_sentusers_ack_msg(ZBX_USER_MSG **user_msg, zbx_uint64_t actionid
 clean:
 		zbx_free(user_timezone);
 	}
-	DBfree_result(result);
+
+	zbx_vector_uint64_destroy(&userids);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -3402,6 +3919,8 @@ ZBX_THREAD_ENTRY(escalator_thread, args)
 
 	DBconnect(ZBX_DB_CONNECT_NORMAL);
 
+	escalator_cache_init();
+
 	while (ZBX_IS_RUNNING())
 	{
 		sec = zbx_time();
@@ -3415,6 +3934,7 @@ ZBX_THREAD_ENTRY(escalator_thread, args)
 		}
 
 		zbx_config_get(&cfg, ZBX_CONFIG_FLAGS_DEFAULT_TIMEZONE);
+		escalator_cache_refresh(time(NULL));
 
 		nextcheck = time(NULL) + CONFIG_ESCALATOR_FREQUENCY;
 		escalations_count += process_escalations(time(NULL), &nextcheck, ZBX_ESCALATION_SOURCE_TRIGGER,
@@ -3463,3 +3983,7 @@ ZBX_THREAD_ENTRY(escalator_thread, args)
 	while (1)
 		zbx_sleep(SEC_PER_MIN);
 }
+
+#ifdef HAVE_TESTS
+#	include "../../../tests/zabbix_server/escalator/escalator_get_permission_test.c"
+#endif
@@ -41,16 +41,6 @@ typedef struct
 }
 zbx_event_recovery_t;
 
-/* problem event, used to cache open problems for recovery attempts */
-typedef struct
-{
-	zbx_uint64_t		eventid;
-	zbx_uint64_t		triggerid;
-
-	zbx_vector_ptr_t	tags;
-}
-zbx_event_problem_t;
-
 typedef enum
 {
 	CORRELATION_MATCH = 0,
@@ -630,6 +620,18 @@ static DB_EVENT	*get_event_by_source_object_id(int source, int object, zbx_uint6
 	return NULL;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees cached problem event                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	event_problem_free(zbx_event_problem_t *problem)
+{
+	zbx_vector_ptr_clear_ext(&problem->tags, (zbx_clean_func_t)zbx_free_tag);
+	zbx_vector_ptr_destroy(&problem->tags);
+	zbx_free(problem);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: checks if the event matches the specified host group              *
@@ -644,37 +646,12 @@ static DB_EVENT	*get_event_by_source_object_id(int source, int object, zbx_uint6
  ******************************************************************************/
 static int	correlation_match_event_hostgroup(const DB_EVENT *event, zbx_uint64_t groupid)
 {
-	DB_RESULT		result;
-	int			ret = FAIL;
-	zbx_vector_uint64_t	groupids;
-	char			*sql = NULL;
-	size_t			sql_alloc = 0, sql_offset = 0;
-
-	zbx_vector_uint64_create(&groupids);
-	zbx_dc_get_nested_hostgroupids(&groupid, 1, &groupids);
-
-	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
-			"select hg.groupid"
-				" from hstgrp g,hosts_groups hg,items i,functions f"
-				" where f.triggerid=" ZBX_FS_UI64
-				" and i.itemid=f.itemid"
-				" and hg.hostid=i.hostid"
-				" and",
-				event->objectid);
-
-	DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "hg.groupid", groupids.values,
-			groupids.values_num);
-
-	result = DBselect("%s", sql);
+	const zbx_vector_uint64_t	*hostids;
 
-	if (NULL != DBfetch(result))
-		ret = SUCCEED;
-
-	DBfree_result(result);
-	zbx_free(sql);
-	zbx_vector_uint64_destroy(&groupids);
+	if (SUCCEED != zbx_db_trigger_get_all_hostids(&event->trigger, &hostids))
+		return FAIL;
 
-	return ret;
+	return zbx_dc_check_hostgroup_hosts(groupid, hostids);
 }
 
 /******************************************************************************
@@ -757,6 +734,57 @@ static const char	*correlation_condition_match_new_event(zbx_corr_condition_t *c
 	return "0";
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluates correlation rule formula with the specified condition   *
+ *          values                                                            *
+ *                                                                            *
+ * Parameters: correlation - [IN] the correlation rule                        *
+ *             values      - [IN] the condition values in the same order as   *
+ *                                correlation rule conditions                 *
+ *             result      - [OUT] the evaluation result                      *
+ *                                                                            *
+ * Return value: SUCCEED - the formula was evaluated successfully             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	correlation_evaluate(const zbx_correlation_t *correlation, const char **values, double *result)
+{
+	char		*expression, error[256];
+	zbx_token_t	token;
+	int		pos = 0, index, ret = FAIL;
+	zbx_uint64_t	conditionid;
+	zbx_strloc_t	*loc;
+
+	expression = zbx_strdup(NULL, correlation->formula);
+
+	for (; SUCCEED == zbx_token_find(expression, pos, &token, ZBX_TOKEN_SEARCH_BASIC); pos++)
+	{
+		if (ZBX_TOKEN_OBJECTID != token.type)
+			continue;
+
+		loc = &token.data.objectid.name;
+
+		if (SUCCEED != is_uint64_n(expression + loc->l, loc->r - loc->l + 1, &conditionid))
+			continue;
+
+		if (FAIL == (index = zbx_vector_ptr_search(&correlation->conditions, &conditionid,
+				ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
+		{
+			goto out;
+		}
+
+		zbx_replace_string(&expression, token.loc.l, &token.loc.r, values[index]);
+		pos = token.loc.r;
+	}
+
+	ret = evaluate_unknown(expression, result, error, sizeof(error));
+out:
+	zbx_free(expression);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: checks if the correlation rule might match the new event          *
@@ -777,42 +805,23 @@ static const char	*correlation_condition_match_new_event(zbx_corr_condition_t *c
 static zbx_correlation_match_result_t	correlation_match_new_event(zbx_correlation_t *correlation,
 		const DB_EVENT *event, int old_value)
 {
-	char				*expression, error[256];
-	const char			*value;
-	zbx_token_t			token;
-	int				pos = 0;
-	zbx_uint64_t			conditionid;
-	zbx_strloc_t			*loc;
-	zbx_corr_condition_t		*condition;
+	const char			**values;
+	int				i;
 	double				result;
 	zbx_correlation_match_result_t	ret = CORRELATION_NO_MATCH;
 
 	if ('\0' == *correlation->formula)
 		return CORRELATION_MAY_MATCH;
 
-	expression = zbx_strdup(NULL, correlation->formula);
+	values = (const char **)zbx_malloc(NULL, sizeof(char *) * (size_t)correlation->conditions.values_num);
 
-	for (; SUCCEED == zbx_token_find(expression, pos, &token, ZBX_TOKEN_SEARCH_BASIC); pos++)
+	for (i = 0; i < correlation->conditions.values_num; i++)
 	{
-		if (ZBX_TOKEN_OBJECTID != token.type)
-			continue;
-
-		loc = &token.data.objectid.name;
-
-		if (SUCCEED != is_uint64_n(expression + loc->l, loc->r - loc->l + 1, &conditionid))
-			continue;
-
-		if (NULL == (condition = (zbx_corr_condition_t *)zbx_hashset_search(&correlation_rules.conditions,
-				&conditionid)))
-			goto out;
-
-		value = correlation_condition_match_new_event(condition, event, old_value);
-
-		zbx_replace_string(&expression, token.loc.l, &token.loc.r, value);
-		pos = token.loc.r;
+		values[i] = correlation_condition_match_new_event(
+				(zbx_corr_condition_t *)correlation->conditions.values[i], event, old_value);
 	}
 
-	if (SUCCEED == evaluate_unknown(expression, &result, error, sizeof(error)))
+	if (SUCCEED == correlation_evaluate(correlation, values, &result))
 	{
 		if (result == ZBX_UNKNOWN)
 			ret = CORRELATION_MAY_MATCH;
@@ -820,8 +829,7 @@ static zbx_correlation_match_result_t	correlation_match_new_event(zbx_correlatio
 			ret = CORRELATION_MATCH;
 	}
 
-out:
-	zbx_free(expression);
+	zbx_free(values);
 
 	return ret;
 }
@@ -857,205 +865,347 @@ static int	correlation_has_old_event_operation(const zbx_correlation_t *correlat
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds sql statement to match tag according to the defined          *
- *          matching operation                                                *
+ * Purpose: checks if the correlation condition type depends on old events    *
  *                                                                            *
- * Parameters: sql         - [IN/OUT]                                         *
- *             sql_alloc   - [IN/OUT]                                         *
- *             sql_offset  - [IN/OUT]                                         *
- *             tag         - [IN] the tag to match                            *
- *             value       - [IN] the tag value to match                      *
- *             op          - [IN] the matching operation (CONDITION_OPERATOR_)*
+ ******************************************************************************/
+static int	correlation_condition_is_old_event(const zbx_corr_condition_t *condition)
+{
+	switch (condition->type)
+	{
+		case ZBX_CORR_CONDITION_OLD_EVENT_TAG:
+		case ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE:
+		case ZBX_CORR_CONDITION_EVENT_TAG_PAIR:
+			return SUCCEED;
+	}
+
+	return FAIL;
+}
+
+#if defined(HAVE_MYSQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if problem tag values are compared case insensitively by   *
+ *          database collation                                                *
+ *                                                                            *
+ * Return value: SUCCEED - the problem_tag.value column collation is case     *
+ *                         insensitive                                        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The collation is read once per process, Zabbix supports only     *
+ *           binary collations but databases created with case insensitive    *
+ *           collation matched like conditions case insensitively.            *
  *                                                                            *
  ******************************************************************************/
-static void	correlation_condition_add_tag_match(char **sql, size_t *sql_alloc, size_t *sql_offset, const char *tag,
-		const char *value, unsigned char op)
+static int	correlation_like_is_case_insensitive(void)
 {
-	char	*tag_esc, *value_esc;
+	static int	case_insensitive = -1;
+	DB_RESULT	result;
+	DB_ROW		row;
+	size_t		len;
+
+	if (-1 != case_insensitive)
+		return 1 == case_insensitive ? SUCCEED : FAIL;
+
+	result = DBselect(
+			"select collation_name"
+			" from information_schema.columns"
+			" where table_schema=database()"
+				" and table_name='problem_tag'"
+				" and column_name='value'");
+
+	if (NULL == result)
+		return FAIL;
 
-	tag_esc = DBdyn_escape_string(tag);
-	value_esc = DBdyn_escape_string(value);
+	if (NULL != (row = DBfetch(result)) && SUCCEED != DBis_null(row[0]) && 3 <= (len = strlen(row[0])) &&
+			0 == strcmp(row[0] + len - 3, "_ci"))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "problem tag values have case insensitive collation \"%s\","
+				" old event tag value like conditions of event correlation are matched case"
+				" insensitively", row[0]);
+		case_insensitive = 1;
+	}
+	else
+		case_insensitive = 0;
 
-	switch (op)
+	DBfree_result(result);
+
+	return 1 == case_insensitive ? SUCCEED : FAIL;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns the next UTF-8 character in string                        *
+ *                                                                            *
+ ******************************************************************************/
+static const char	*correlation_like_next_char(const char *str)
+{
+	size_t	len;
+
+	if (0 == (len = zbx_utf8_char_len(str)))
+		len = 1;
+
+	while (0 != len-- && '\0' != *str)
+		str++;
+
+	return str;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: matches value with SQL like pattern enclosed in '%' wildcards     *
+ *                                                                            *
+ * Parameters: value   - [IN] the value to match                              *
+ *             pattern - [IN] the pattern, '%' matches any number of          *
+ *                            characters and '_' matches a single character   *
+ *                                                                            *
+ * Return value: SUCCEED - the value matches "like '%<pattern>%'"             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: On MySQL ASCII letters are compared case insensitively if the    *
+ *           problem tag value collation is case insensitive.                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	correlation_match_like(const char *value, const char *pattern)
+{
+	const char	*v = value, *p = pattern, *wildcard_v = value, *wildcard_p = pattern;
+	int		case_insensitive = 0;
+
+#if defined(HAVE_MYSQL)
+	if (SUCCEED == correlation_like_is_case_insensitive())
+		case_insensitive = 1;
+#endif
+	/* the leading '%' wildcard is implied by initial wildcard positions */
+	while ('\0' != *p)
 	{
-		case CONDITION_OPERATOR_NOT_EQUAL:
-		case CONDITION_OPERATOR_NOT_LIKE:
-			zbx_strcpy_alloc(sql, sql_alloc, sql_offset, "not ");
-			break;
+		if ('%' == *p)
+		{
+			wildcard_p = ++p;
+			wildcard_v = v;
+			continue;
+		}
+
+		if ('\0' != *v)
+		{
+			if ('_' == *p)
+			{
+				v = correlation_like_next_char(v);
+				p++;
+				continue;
+			}
+
+			if (*p == *v || (0 != case_insensitive && tolower((unsigned char)*p) ==
+					tolower((unsigned char)*v)))
+			{
+				v++;
+				p++;
+				continue;
+			}
+		}
+
+		/* retry matching after the last wildcard from the next value character */
+		if ('\0' == *wildcard_v)
+			return FAIL;
+
+		v = wildcard_v = correlation_like_next_char(wildcard_v);
+		p = wildcard_p;
 	}
 
-	zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
-			"exists (select null from problem_tag pt where p.eventid=pt.eventid and ");
+	/* the trailing '%' wildcard matches the rest of value */
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if the problem has tag with value matching the defined     *
+ *          matching operation                                                *
+ *                                                                            *
+ * Parameters: problem - [IN] the open problem                                *
+ *             tag     - [IN] the tag to match                                *
+ *             value   - [IN] the tag value to match                          *
+ *             op      - [IN] the matching operation (CONDITION_OPERATOR_)    *
+ *                                                                            *
+ * Return value: SUCCEED - the problem matches                                *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The negative operations match problems without any tag matching  *
+ *           the corresponding positive operation.                            *
+ *                                                                            *
+ *           The operations match the same problems as the SQL conditions     *
+ *           used before open problems were cached, equal is case sensitive   *
+ *           and like treats '%' and '_' in the condition value as wildcards. *
+ *                                                                            *
+ ******************************************************************************/
+static int	correlation_match_problem_tag_value(const zbx_event_problem_t *problem, const char *tag,
+		const char *value, unsigned char op)
+{
+	int		i, ret = FAIL;
+	unsigned char	match_op = op;
+	const zbx_tag_t	*problem_tag;
 
 	switch (op)
 	{
-		case CONDITION_OPERATOR_EQUAL:
 		case CONDITION_OPERATOR_NOT_EQUAL:
-			zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "pt.tag='%s' and pt.value" ZBX_SQL_STRCMP,
-					tag_esc, ZBX_SQL_STRVAL_EQ(value_esc));
+			match_op = CONDITION_OPERATOR_EQUAL;
 			break;
-		case CONDITION_OPERATOR_LIKE:
 		case CONDITION_OPERATOR_NOT_LIKE:
-			zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "pt.tag='%s' and pt.value like '%%%s%%'",
-					tag_esc, value_esc);
+			match_op = CONDITION_OPERATOR_LIKE;
 			break;
 	}
 
-	zbx_chrcpy_alloc(sql, sql_alloc, sql_offset, ')');
+	for (i = 0; i < problem->tags.values_num; i++)
+	{
+		problem_tag = (const zbx_tag_t *)problem->tags.values[i];
+
+		if (0 != strcmp(problem_tag->tag, tag))
+			continue;
+
+		if (CONDITION_OPERATOR_LIKE == match_op)
+			ret = correlation_match_like(problem_tag->value, value);
+		else
+			ret = (0 == strcmp(problem_tag->value, value) ? SUCCEED : FAIL);
+
+		if (SUCCEED == ret)
+			break;
+	}
 
-	zbx_free(value_esc);
-	zbx_free(tag_esc);
+	if (match_op != op)
+		ret = (SUCCEED == ret ? FAIL : SUCCEED);
+
+	return ret;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: creates sql filter to find events matching a correlation          *
- *          condition                                                         *
+ * Purpose: checks if the correlation condition matches the new event and     *
+ *          open problem                                                      *
  *                                                                            *
- * Parameters: condition - [IN] the correlation condition to match            *
+ * Parameters: condition - [IN] the old event correlation condition to check  *
  *             event     - [IN] the new event to match                        *
+ *             problem   - [IN] the open problem to match                     *
  *                                                                            *
- * Return value: the created filter or NULL                                   *
+ * Return value: "1" - the correlation condition matches                      *
+ *               "0" - otherwise                                              *
  *                                                                            *
  ******************************************************************************/
-static char	*correlation_condition_get_event_filter(zbx_corr_condition_t *condition, const DB_EVENT *event)
+static const char	*correlation_condition_match_old_event(const zbx_corr_condition_t *condition,
+		const DB_EVENT *event, const zbx_event_problem_t *problem)
 {
-	int			i;
-	zbx_tag_t		*tag;
-	char			*tag_esc, *filter = NULL;
-	size_t			filter_alloc = 0, filter_offset = 0;
-	zbx_vector_str_t	values;
-
-	/* replace new event dependent condition with precalculated value */
-	switch (condition->type)
-	{
-		case ZBX_CORR_CONDITION_NEW_EVENT_TAG:
-		case ZBX_CORR_CONDITION_NEW_EVENT_TAG_VALUE:
-		case ZBX_CORR_CONDITION_NEW_EVENT_HOSTGROUP:
-			return zbx_dsprintf(NULL, "%s=1",
-					correlation_condition_match_new_event(condition, event, SUCCEED));
-	}
+	int		i, j;
+	const zbx_tag_t	*tag, *problem_tag;
 
-	/* replace old event dependent condition with sql filter on problem_tag pt table */
 	switch (condition->type)
 	{
 		case ZBX_CORR_CONDITION_OLD_EVENT_TAG:
-			tag_esc = DBdyn_escape_string(condition->data.tag.tag);
-			zbx_snprintf_alloc(&filter, &filter_alloc, &filter_offset,
-					"exists (select null from problem_tag pt"
-						" where p.eventid=pt.eventid"
-							" and pt.tag='%s')",
-					tag_esc);
-			zbx_free(tag_esc);
-			return filter;
-
-		case ZBX_CORR_CONDITION_EVENT_TAG_PAIR:
-			zbx_vector_str_create(&values);
-
-			for (i = 0; i < event->tags.values_num; i++)
+			for (i = 0; i < problem->tags.values_num; i++)
 			{
-				tag = (zbx_tag_t *)event->tags.values[i];
-				if (0 == strcmp(tag->tag, condition->data.tag_pair.newtag))
-					zbx_vector_str_append(&values, zbx_strdup(NULL, tag->value));
+				problem_tag = (const zbx_tag_t *)problem->tags.values[i];
+
+				if (0 == strcmp(problem_tag->tag, condition->data.tag.tag))
+					return "1";
 			}
+			break;
 
-			if (0 == values.values_num)
+		case ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE:
+			if (SUCCEED == correlation_match_problem_tag_value(problem, condition->data.tag_value.tag,
+					condition->data.tag_value.value, condition->data.tag_value.op))
 			{
-				/* no new tag found, substitute condition with failure expression */
-				filter = zbx_strdup(NULL, "1=0");
+				return "1";
 			}
-			else
-			{
-				tag_esc = DBdyn_escape_string(condition->data.tag_pair.oldtag);
+			break;
 
-				zbx_snprintf_alloc(&filter, &filter_alloc, &filter_offset,
-						"exists (select null from problem_tag pt"
-							" where p.eventid=pt.eventid"
-								" and pt.tag='%s'"
-								" and",
-						tag_esc);
+		case ZBX_CORR_CONDITION_EVENT_TAG_PAIR:
+			for (i = 0; i < problem->tags.values_num; i++)
+			{
+				problem_tag = (const zbx_tag_t *)problem->tags.values[i];
 
-				DBadd_str_condition_alloc(&filter, &filter_alloc, &filter_offset, "pt.value",
-						(const char **)values.values, values.values_num);
+				if (0 != strcmp(problem_tag->tag, condition->data.tag_pair.oldtag))
+					continue;
 
-				zbx_chrcpy_alloc(&filter, &filter_alloc, &filter_offset, ')');
+				for (j = 0; j < event->tags.values_num; j++)
+				{
+					tag = (const zbx_tag_t *)event->tags.values[j];
 
-				zbx_free(tag_esc);
-				zbx_vector_str_clear_ext(&values, zbx_str_free);
+					if (0 == strcmp(tag->tag, condition->data.tag_pair.newtag) &&
+							0 == strcmp(tag->value, problem_tag->value))
+					{
+						return "1";
+					}
+				}
 			}
-
-			zbx_vector_str_destroy(&values);
-			return filter;
-
-		case ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE:
-			correlation_condition_add_tag_match(&filter, &filter_alloc, &filter_offset,
-					condition->data.tag_value.tag, condition->data.tag_value.value,
-					condition->data.tag_value.op);
-			return filter;
+			break;
 	}
 
-	return NULL;
+	return "0";
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: add sql statement to filter out correlation conditions and        *
- *          matching events                                                   *
+ * Purpose: gets tag names required for open problems to match the            *
+ *          correlation rule                                                  *
  *                                                                            *
- * Parameters: sql         - [IN/OUT]                                         *
- *             sql_alloc   - [IN/OUT]                                         *
- *             sql_offset  - [IN/OUT]                                         *
- *             correlation - [IN] the correlation rule to match               *
- *             event       - [IN] the new event to match                      *
+ * Parameters: correlation - [IN] the correlation rule                        *
+ *             tags        - [OUT] the tag names, the open problem must have  *
+ *                                 at least one of them to match the rule     *
  *                                                                            *
- * Return value: SUCCEED - the filter was added successfully                  *
- *               FAIL    - otherwise                                          *
+ * Return value: SUCCEED - the rule can match only problems having at least   *
+ *                         one of the returned tags                           *
+ *               FAIL    - the rule can match any problem                     *
+ *                                                                            *
+ * Comments: The rule requires problem tags if it cannot match when all old   *
+ *           event conditions fail, regardless of the new event conditions.   *
  *                                                                            *
  ******************************************************************************/
-static int	correlation_add_event_filter(char **sql, size_t *sql_alloc, size_t *sql_offset,
-		zbx_correlation_t *correlation, const DB_EVENT *event)
+static int	correlation_get_problem_tags(const zbx_correlation_t *correlation, zbx_vector_str_t *tags)
 {
-	char			*expression, *filter;
-	zbx_token_t		token;
-	int			pos = 0, ret = FAIL;
-	zbx_uint64_t		conditionid;
-	zbx_strloc_t		*loc;
-	zbx_corr_condition_t	*condition;
+	const char			**values;
+	const zbx_corr_condition_t	*condition;
+	int				i, ret = SUCCEED;
+	double				result;
 
-	zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "c.correlationid=" ZBX_FS_UI64, correlation->correlationid);
+	if ('\0' == *correlation->formula)
+		return FAIL;
 
-	expression = zbx_strdup(NULL, correlation->formula);
+	values = (const char **)zbx_malloc(NULL, sizeof(char *) * (size_t)correlation->conditions.values_num);
 
-	for (; SUCCEED == zbx_token_find(expression, pos, &token, ZBX_TOKEN_SEARCH_BASIC); pos++)
+	for (i = 0; i < correlation->conditions.values_num; i++)
 	{
-		if (ZBX_TOKEN_OBJECTID != token.type)
-			continue;
-
-		loc = &token.data.objectid.name;
-
-		if (SUCCEED != is_uint64_n(expression + loc->l, loc->r - loc->l + 1, &conditionid))
-			continue;
+		condition = (const zbx_corr_condition_t *)correlation->conditions.values[i];
+		values[i] = "0";
 
-		if (NULL == (condition = (zbx_corr_condition_t *)zbx_hashset_search(&correlation_rules.conditions, &conditionid)))
-			goto out;
-
-		if (NULL == (filter = correlation_condition_get_event_filter(condition, event)))
+		switch (condition->type)
 		{
-			THIS_SHOULD_NEVER_HAPPEN;
-			goto out;
-		}
+			case ZBX_CORR_CONDITION_OLD_EVENT_TAG:
+				zbx_vector_str_append(tags, condition->data.tag.tag);
+				break;
+			case ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE:
+				switch (condition->data.tag_value.op)
+				{
+					case CONDITION_OPERATOR_NOT_EQUAL:
+					case CONDITION_OPERATOR_NOT_LIKE:
+						/* matches also problems without the tag */
+						ret = FAIL;
+						goto out;
+				}
 
-		zbx_replace_string(&expression, token.loc.l, &token.loc.r, filter);
-		pos = token.loc.r;
-		zbx_free(filter);
+				zbx_vector_str_append(tags, condition->data.tag_value.tag);
+				break;
+			case ZBX_CORR_CONDITION_EVENT_TAG_PAIR:
+				zbx_vector_str_append(tags, condition->data.tag_pair.oldtag);
+				break;
+			default:
+				values[i] = ZBX_UNKNOWN_STR "0";
+		}
 	}
 
-	if ('\0' != *expression)
-		zbx_snprintf_alloc(sql, sql_alloc, sql_offset, " and (%s)", expression);
-
-	ret = SUCCEED;
+	/* the rule with invalid formula does not match any problems */
+	if (SUCCEED == correlation_evaluate(correlation, values, &result) &&
+			(ZBX_UNKNOWN == result || SUCCEED == zbx_double_compare(result, 1)))
+	{
+		ret = FAIL;
+	}
 out:
-	zbx_free(expression);
+	zbx_free(values);
 
 	return ret;
 }
@@ -1144,6 +1294,143 @@ typedef enum
 }
 zbx_problem_state_t;
 
+/* correlation rule evaluation result for a set of old event condition values */
+#define ZBX_CORRELATION_RESULT_CONDITIONS_MAX	64
+
+typedef struct
+{
+	zbx_uint64_t	mask;
+	int		result;
+}
+zbx_correlation_result_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets open problems that might match global correlation rules      *
+ *                                                                            *
+ * Parameters: problems - [OUT] the open problems (zbx_event_problem_t)       *
+ *                                                                            *
+ * Return value: The total number of open trigger problems.                   *
+ *                                                                            *
+ ******************************************************************************/
+static int	correlation_get_open_problems(zbx_vector_ptr_t *problems)
+{
+	int			i, problems_num;
+	zbx_vector_str_t	tags;
+
+	zbx_vector_str_create(&tags);
+
+	for (i = 0; i < correlation_rules.correlations.values_num; i++)
+	{
+		if (SUCCEED != correlation_get_problem_tags(
+				(const zbx_correlation_t *)correlation_rules.correlations.values[i], &tags))
+		{
+			break;
+		}
+	}
+
+	if (i == correlation_rules.correlations.values_num)
+	{
+		zbx_vector_str_sort(&tags, ZBX_DEFAULT_STR_COMPARE_FUNC);
+		zbx_vector_str_uniq(&tags, ZBX_DEFAULT_STR_COMPARE_FUNC);
+		problems_num = zbx_dc_get_open_problems(&tags, problems);
+	}
+	else
+		problems_num = zbx_dc_get_open_problems(NULL, problems);
+
+	zbx_vector_str_destroy(&tags);
+
+	return problems_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: executes correlation rule operations for the open problems        *
+ *          matching the rule and new event                                   *
+ *                                                                            *
+ * Parameters: correlation - [IN] the correlation rule                        *
+ *             event       - [IN] the new event                               *
+ *             problems    - [IN] the open problems (zbx_event_problem_t)     *
+ *                                                                            *
+ * Comments: The rule result depends only on the old event condition values   *
+ *           when the new event is fixed, so the results are cached by the    *
+ *           bitmask of old event condition values.                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	correlation_match_problems(zbx_correlation_t *correlation, DB_EVENT *event,
+		const zbx_vector_ptr_t *problems)
+{
+	const char			**values;
+	const zbx_corr_condition_t	*condition;
+	const zbx_event_problem_t	*problem;
+	zbx_correlation_result_t	*cached, result_local;
+	zbx_hashset_t			results;
+	double				result;
+	int				i, j;
+
+	values = (const char **)zbx_malloc(NULL, sizeof(char *) * (size_t)correlation->conditions.values_num);
+
+	for (i = 0; i < correlation->conditions.values_num; i++)
+	{
+		condition = (const zbx_corr_condition_t *)correlation->conditions.values[i];
+
+		if (SUCCEED != correlation_condition_is_old_event(condition))
+		{
+			values[i] = correlation_condition_match_new_event((zbx_corr_condition_t *)condition, event,
+					SUCCEED);
+		}
+	}
+
+	zbx_hashset_create(&results, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0; i < problems->values_num; i++)
+	{
+		problem = (const zbx_event_problem_t *)problems->values[i];
+
+		/* check if this event is not already recovered by another correlation rule */
+		if (NULL != zbx_hashset_search(&correlation_cache, &problem->eventid))
+			continue;
+
+		result_local.mask = 0;
+
+		for (j = 0; j < correlation->conditions.values_num; j++)
+		{
+			condition = (const zbx_corr_condition_t *)correlation->conditions.values[j];
+
+			if (SUCCEED != correlation_condition_is_old_event(condition))
+				continue;
+
+			values[j] = correlation_condition_match_old_event(condition, event, problem);
+
+			if ('1' == *values[j] && ZBX_CORRELATION_RESULT_CONDITIONS_MAX > j)
+				result_local.mask |= __UINT64_C(1) << j;
+		}
+
+		if (ZBX_CORRELATION_RESULT_CONDITIONS_MAX < correlation->conditions.values_num || NULL ==
+				(cached = (zbx_correlation_result_t *)zbx_hashset_search(&results, &result_local)))
+		{
+			result_local.result = FAIL;
+
+			if (SUCCEED == correlation_evaluate(correlation, values, &result) &&
+					SUCCEED == zbx_double_compare(result, 1))
+			{
+				result_local.result = SUCCEED;
+			}
+
+			if (ZBX_CORRELATION_RESULT_CONDITIONS_MAX >= correlation->conditions.values_num)
+				zbx_hashset_insert(&results, &result_local, sizeof(result_local));
+
+			cached = &result_local;
+		}
+
+		if (SUCCEED == cached->result)
+			correlation_execute_operations(correlation, event, problem->eventid, problem->triggerid);
+	}
+
+	zbx_hashset_destroy(&results);
+	zbx_free(values);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: find problem events that must be recovered by global correlation  *
@@ -1151,6 +1438,9 @@ zbx_problem_state_t;
  *                                                                            *
  * Parameters: event         - [IN] the new event                             *
  *             problem_state - [IN/OUT] problem state cache variable          *
+ *             problems      - [IN/OUT] the open problems that might match    *
+ *                                      correlation rules, loaded together    *
+ *                                      with problem state                    *
  *                                                                            *
  * Comments: The correlation data (zbx_event_recovery_t) of events that       *
  *           must be closed are added to event_correlation hashset            *
@@ -1158,19 +1448,16 @@ zbx_problem_state_t;
  *           The global event correlation matching is done in two parts:      *
  *             1) exclude correlations that can't possibly match the event    *
  *                based on new event tag/value/group conditions               *
- *             2) assemble sql statement to select problems/correlations      *
- *                based on the rest correlation conditions                    *
+ *             2) match the rest correlation conditions against open problems *
+ *                cached in configuration cache                               *
  *                                                                            *
  ******************************************************************************/
-static void	correlate_event_by_global_rules(DB_EVENT *event, zbx_problem_state_t *problem_state)
+static void	correlate_event_by_global_rules(DB_EVENT *event, zbx_problem_state_t *problem_state,
+		zbx_vector_ptr_t *problems)
 {
 	int			i;
 	zbx_correlation_t	*correlation;
 	zbx_vector_ptr_t	corr_old, corr_new;
-	char			*sql = NULL;
-	const char		*delim = "";
-	size_t			sql_alloc = 0, sql_offset = 0;
-	zbx_uint64_t		eventid, correlationid, objectid;
 
 	zbx_vector_ptr_create(&corr_old);
 	zbx_vector_ptr_create(&corr_new);
@@ -1194,23 +1481,19 @@ static void	correlate_event_by_global_rules(DB_EVENT *event, zbx_problem_state_t
 			case CORRELATION_MAY_MATCH:	/* might match depending on old events */
 				scope = ZBX_CHECK_OLD_EVENTS;
 				break;
+			default:
+				THIS_SHOULD_NEVER_HAPPEN;
+				continue;
 		}
 
 		if (ZBX_CHECK_OLD_EVENTS == scope)
 		{
 			if (ZBX_PROBLEM_STATE_UNKNOWN == *problem_state)
 			{
-				DB_RESULT	result;
-
-				result = DBselectN("select eventid from problem"
-						" where r_eventid is null and source="
-						ZBX_STR(EVENT_SOURCE_TRIGGERS), 1);
-
-				if (NULL == DBfetch(result))
+				if (0 == correlation_get_open_problems(problems))
 					*problem_state = ZBX_PROBLEM_STATE_RESOLVED;
 				else
 					*problem_state = ZBX_PROBLEM_STATE_OPEN;
-				DBfree_result(result);
 			}
 
 			if (ZBX_PROBLEM_STATE_RESOLVED == *problem_state)
@@ -1231,61 +1514,15 @@ static void	correlate_event_by_global_rules(DB_EVENT *event, zbx_problem_state_t
 	if (0 != corr_new.values_num)
 	{
 		/* Process correlations that matches new event and does not use or affect old events. */
-		/* Those correlations can be executed directly, without checking database.            */
+		/* Those correlations can be executed directly, without checking open problems.       */
 		for (i = 0; i < corr_new.values_num; i++)
 			correlation_execute_operations((zbx_correlation_t *)corr_new.values[i], event, 0, 0);
 	}
 
-	if (0 != corr_old.values_num)
-	{
-		DB_RESULT	result;
-		DB_ROW		row;
-
-		/* Process correlations that matches new event and either uses old events in conditions */
-		/* or has operations involving old events.                                              */
-
-		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, "select p.eventid,p.objectid,c.correlationid"
-								" from correlation c,problem p"
-								" where p.r_eventid is null"
-								" and p.source=" ZBX_STR(EVENT_SOURCE_TRIGGERS)
-								" and (");
-
-		for (i = 0; i < corr_old.values_num; i++)
-		{
-			correlation = (zbx_correlation_t *)corr_old.values[i];
-
-			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, delim);
-			correlation_add_event_filter(&sql, &sql_alloc, &sql_offset, correlation, event);
-			delim = " or ";
-		}
-
-		zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ')');
-		result = DBselect("%s", sql);
-
-		while (NULL != (row = DBfetch(result)))
-		{
-			ZBX_STR2UINT64(eventid, row[0]);
-
-			/* check if this event is not already recovered by another correlation rule */
-			if (NULL != zbx_hashset_search(&correlation_cache, &eventid))
-				continue;
-
-			ZBX_STR2UINT64(correlationid, row[2]);
-
-			if (FAIL == (i = zbx_vector_ptr_bsearch(&corr_old, &correlationid,
-					ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
-			{
-				THIS_SHOULD_NEVER_HAPPEN;
-				continue;
-			}
-
-			ZBX_STR2UINT64(objectid, row[1]);
-			correlation_execute_operations((zbx_correlation_t *)corr_old.values[i], event, eventid, objectid);
-		}
-
-		DBfree_result(result);
-		zbx_free(sql);
-	}
+	/* Process correlations that matches new event and either uses old events in conditions */
+	/* or has operations involving old events.                                              */
+	for (i = 0; i < corr_old.values_num; i++)
+		correlation_match_problems((zbx_correlation_t *)corr_old.values[i], event, problems);
 
 	zbx_vector_ptr_destroy(&corr_new);
 	zbx_vector_ptr_destroy(&corr_old);
@@ -1302,6 +1539,7 @@ static void	correlate_events_by_global_rules(zbx_vector_ptr_t *trigger_events, z
 	int			i, index;
 	zbx_trigger_diff_t	*diff;
 	zbx_problem_state_t	problem_state = ZBX_PROBLEM_STATE_UNKNOWN;
+	zbx_vector_ptr_t	problems;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() events:%d", __func__, correlation_cache.num_data);
 
@@ -1310,6 +1548,8 @@ static void	correlate_events_by_global_rules(zbx_vector_ptr_t *trigger_events, z
 	if (0 == correlation_rules.correlations.values_num)
 		goto out;
 
+	zbx_vector_ptr_create(&problems);
+
 	/* process global correlation and queue the events that must be closed */
 	for (i = 0; i < trigger_events->values_num; i++)
 	{
@@ -1318,7 +1558,7 @@ static void	correlate_events_by_global_rules(zbx_vector_ptr_t *trigger_events, z
 		if (0 == (ZBX_FLAGS_DB_EVENT_CREATE & event->flags))
 			continue;
 
-		correlate_event_by_global_rules(event, &problem_state);
+		correlate_event_by_global_rules(event, &problem_state, &problems);
 
 		/* force value recalculation based on open problems for triggers with */
 		/* events closed by 'close new' correlation operation                */
@@ -1333,6 +1573,8 @@ static void	correlate_events_by_global_rules(zbx_vector_ptr_t *trigger_events, z
 		}
 	}
 
+	zbx_vector_ptr_clear_ext(&problems, (zbx_clean_func_t)event_problem_free);
+	zbx_vector_ptr_destroy(&problems);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -1345,7 +1587,7 @@ out:
  ******************************************************************************/
 static void	flush_correlation_queue(zbx_vector_ptr_t *trigger_diff, zbx_vector_uint64_t *triggerids_lock)
 {
-	zbx_vector_uint64_t	triggerids, lockids, eventids;
+	zbx_vector_uint64_t	triggerids, lockids, eventids, stale_eventids;
 	zbx_hashset_iter_t	iter;
 	zbx_event_recovery_t	*recovery;
 	int			i, closed_num = 0;
@@ -1358,6 +1600,7 @@ static void	flush_correlation_queue(zbx_vector_ptr_t *trigger_diff, zbx_vector_u
 	zbx_vector_uint64_create(&triggerids);
 	zbx_vector_uint64_create(&lockids);
 	zbx_vector_uint64_create(&eventids);
+	zbx_vector_uint64_create(&stale_eventids);
 
 	/* lock source triggers of events to be closed by global correlation rules */
 
@@ -1484,15 +1727,21 @@ static void	flush_correlation_queue(zbx_vector_ptr_t *trigger_diff, zbx_vector_u
 
 				closed_num++;
 			}
+			else if (SUCCEED == errcodes[index])
+				zbx_vector_uint64_append(&stale_eventids, recovery->eventid);
 
 			zbx_hashset_iter_remove(&iter);
 		}
 
+		/* the problems already closed by other processes must be dropped from open problem cache */
+		zbx_dc_update_open_problems(NULL, &stale_eventids);
+
 		DCconfig_clean_triggers(triggers, errcodes, triggerids.values_num);
 		zbx_free(errcodes);
 		zbx_free(triggers);
 	}
 
+	zbx_vector_uint64_destroy(&stale_eventids);
 	zbx_vector_uint64_destroy(&eventids);
 	zbx_vector_uint64_destroy(&lockids);
 	zbx_vector_uint64_destroy(&triggerids);
@@ -1906,6 +2155,51 @@ void	zbx_events_update_itservices(void)
 	zbx_free(data);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates open problem cache used by global event correlation      *
+ *                                                                            *
+ * Comments: This function must be called after the events have been          *
+ *           committed to database.                                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_events_update_open_problems(void)
+{
+	int			i;
+	zbx_vector_ptr_t	problem_events;
+	zbx_vector_uint64_t	closed_eventids;
+	zbx_hashset_iter_t	iter;
+	zbx_event_recovery_t	*recovery;
+
+	zbx_vector_ptr_create(&problem_events);
+	zbx_vector_uint64_create(&closed_eventids);
+
+	for (i = 0; i < events.values_num; i++)
+	{
+		DB_EVENT	*event = (DB_EVENT *)events.values[i];
+
+		if (EVENT_SOURCE_TRIGGERS != event->source || 0 == (event->flags & ZBX_FLAGS_DB_EVENT_CREATE))
+			continue;
+
+		if (EVENT_OBJECT_TRIGGER != event->object || TRIGGER_VALUE_PROBLEM != event->value)
+			continue;
+
+		zbx_vector_ptr_append(&problem_events, event);
+	}
+
+	zbx_hashset_iter_reset(&event_recovery, &iter);
+	while (NULL != (recovery = (zbx_event_recovery_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (EVENT_SOURCE_TRIGGERS == recovery->r_event->source)
+			zbx_vector_uint64_append(&closed_eventids, recovery->eventid);
+	}
+
+	zbx_dc_update_open_problems(&problem_events, &closed_eventids);
+
+	zbx_vector_uint64_destroy(&closed_eventids);
+	zbx_vector_ptr_destroy(&problem_events);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: adds event suppress data for problem events matching active       *
@@ -2325,18 +2619,6 @@ static void	get_open_problems(const zbx_vector_uint64_t *triggerids, zbx_vector_
 	zbx_vector_uint64_destroy(&eventids);
 }
 
-/******************************************************************************
- *                                                                            *
- * Purpose: frees cached problem event                                        *
- *                                                                            *
- ******************************************************************************/
-static void	event_problem_free(zbx_event_problem_t *problem)
-{
-	zbx_vector_ptr_clear_ext(&problem->tags, (zbx_clean_func_t)zbx_free_tag);
-	zbx_vector_ptr_destroy(&problem->tags);
-	zbx_free(problem);
-}
-
 /******************************************************************************
  *                                                                            *
  * Purpose: frees trigger dependency                                          *
@@ -2828,6 +3110,7 @@ int	zbx_close_problem(zbx_uint64_t triggerid, zbx_uint64_t eventid, zbx_uint64_t
 			if (SUCCEED == zbx_is_export_enabled(ZBX_FLAG_EXPTYPE_EVENTS))
 				zbx_export_events();
 
+			zbx_events_update_open_problems();
 			zbx_events_update_itservices();
 		}
 
@@ -2840,3 +3123,7 @@ int	zbx_close_problem(zbx_uint64_t triggerid, zbx_uint64_t eventid, zbx_uint64_t
 
 	return (0 == processed_num ? FAIL : SUCCEED);
 }
+
+#ifdef HAVE_TESTS
+#	include "../../tests/zabbix_server/events/correlation_match_old_event_test.c"
+#endif
@@ -38,5 +38,6 @@ void	zbx_clean_events(void);
 void	zbx_reset_event_recovery(void);
 void	zbx_export_events(void);
 void	zbx_events_update_itservices(void);
+void	zbx_events_update_open_problems(void);
 
 #endif
@@ -0,0 +1,94 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "log.h"
+#include "zbxself.h"
+#include "daemon.h"
+#include "sighandler.h"
+#include "export.h"
+
+#include "exporter.h"
+
+extern ZBX_THREAD_LOCAL unsigned char	process_type;
+extern unsigned char			program_type;
+extern ZBX_THREAD_LOCAL int		server_num, process_num;
+
+#define ZBX_EXPORTER_IDLE_NSEC	100000000	/* sleep 100ms when export cache is empty */
+
+ZBX_THREAD_ENTRY(exporter_thread, args)
+{
+	int		records_num, processed_num = 0;
+	double		time_stat, time_idle = 0, time_now;
+	struct timespec	ts_sleep = {0, ZBX_EXPORTER_IDLE_NSEC};
+
+#define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+				server_num, get_process_type_string(process_type), process_num);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	time_stat = zbx_time();
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+
+	while (ZBX_IS_RUNNING())
+	{
+		time_now = zbx_time();
+		zbx_update_env(time_now);
+
+		if (STAT_INTERVAL < time_now - time_stat)
+		{
+			zbx_setproctitle("%s #%d [exported %d records, idle " ZBX_FS_DBL " sec during " ZBX_FS_DBL
+					" sec]", get_process_type_string(process_type), process_num, processed_num,
+					time_idle, time_now - time_stat);
+
+			time_stat = time_now;
+			time_idle = 0;
+			processed_num = 0;
+		}
+
+		if (0 != (records_num = zbx_export_cache_write()))
+		{
+			processed_num += records_num;
+			continue;
+		}
+
+		update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+		nanosleep(&ts_sleep, NULL);
+		update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+		time_idle += zbx_time() - time_now;
+	}
+
+	/* write out the records queued before shutdown */
+	while (0 != zbx_export_cache_write())
+		;
+
+	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
+
+	while (1)
+		zbx_sleep(SEC_PER_MIN);
+#undef STAT_INTERVAL
+}
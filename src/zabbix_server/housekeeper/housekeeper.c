@@ -24,6 +24,7 @@
 #include "daemon.h"
 #include "zbxself.h"
 #include "zbxalgo.h"
+#include "zbxhistory.h"
 #include "zbxserver.h"
 #include "history_compress.h"
 #include "../../libs/zbxdbcache/valuecache.h"
@@ -155,6 +156,9 @@ typedef struct
 
 	/* the item delete queue */
 	zbx_vector_ptr_t	delete_queue;
+
+	/* the table is in partition mode, but is not range partitioned and is housekept per item */
+	unsigned char		not_partitioned;
 }
 zbx_hk_history_rule_t;
 
@@ -367,6 +371,24 @@ static void	hk_history_item_update(zbx_hk_history_rule_t *rules, zbx_hk_history_
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns housekeeping mode of history rule                         *
+ *                                                                            *
+ * Parameters: rule - [IN] the history housekeeping rule                      *
+ *                                                                            *
+ * Return value: the configured housekeeping mode or ZBX_HK_MODE_REGULAR if   *
+ *               the table in partition mode is not range partitioned         *
+ *                                                                            *
+ ******************************************************************************/
+static unsigned char	hk_history_rule_mode(const zbx_hk_history_rule_t *rule)
+{
+	if (ZBX_HK_MODE_PARTITION == *rule->poption_mode && 0 != rule->not_partitioned)
+		return ZBX_HK_MODE_REGULAR;
+
+	return *rule->poption_mode;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: updates history housekeeping rule with the latest item history    *
@@ -402,7 +424,7 @@ static void	hk_history_update(zbx_hk_history_rule_t *rules, int now)
 		ZBX_STR2UINT64(hostid, row[4]);
 
 		if (value_type < ITEM_VALUE_TYPE_MAX &&
-				ZBX_HK_MODE_REGULAR == *(rule = rules + value_type)->poption_mode)
+				ZBX_HK_MODE_REGULAR == hk_history_rule_mode(rule = rules + value_type))
 		{
 			tmp = zbx_strdup(tmp, row[2]);
 			substitute_simple_macros(NULL, NULL, NULL, NULL, &hostid, NULL, NULL, NULL, NULL, NULL, NULL,
@@ -432,7 +454,7 @@ static void	hk_history_update(zbx_hk_history_rule_t *rules, int now)
 			rule = rules + (value_type == ITEM_VALUE_TYPE_FLOAT ?
 					HK_UPDATE_CACHE_OFFSET_TREND_FLOAT : HK_UPDATE_CACHE_OFFSET_TREND_UINT);
 
-			if (ZBX_HK_MODE_REGULAR != *rule->poption_mode)
+			if (ZBX_HK_MODE_REGULAR != hk_history_rule_mode(rule))
 				continue;
 
 			tmp = zbx_strdup(tmp, row[3]);
@@ -485,7 +507,7 @@ static void	hk_history_delete_queue_prepare_all(zbx_hk_history_rule_t *rules, in
 	/* prepare history item cache (hashset containing itemid:min_clock values) */
 	for (rule = rules; NULL != rule->table; rule++)
 	{
-		if (ZBX_HK_MODE_REGULAR == *rule->poption_mode)
+		if (ZBX_HK_MODE_REGULAR == hk_history_rule_mode(rule))
 		{
 			if (0 == rule->item_cache.num_slots)
 				hk_history_prepare(rule);
@@ -518,6 +540,62 @@ static void	hk_history_delete_queue_clear(zbx_hk_history_rule_t *rule)
 	zbx_vector_ptr_clear_ext(&rule->delete_queue, zbx_ptr_free);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: delete limited count of rows from table                           *
+ *                                                                            *
+ * Return value: number of deleted rows or less than 0 if an error occurred   *
+ *                                                                            *
+ ******************************************************************************/
+static int	DBdelete_from_table(const char *tablename, const char *filter, int limit)
+{
+	if (0 == limit)
+	{
+		return DBexecute(
+				"delete from %s"
+				" where %s",
+				tablename,
+				filter);
+	}
+	else
+	{
+#if defined(HAVE_ORACLE)
+		return DBexecute(
+				"delete from %s"
+				" where %s"
+					" and rownum<=%d",
+				tablename,
+				filter,
+				limit);
+#elif defined(HAVE_MYSQL)
+		return DBexecute(
+				"delete from %s"
+				" where %s limit %d",
+				tablename,
+				filter,
+				limit);
+#elif defined(HAVE_POSTGRESQL)
+		return DBexecute(
+				"delete from %s"
+				" where %s and ctid = any(array(select ctid from %s"
+					" where %s limit %d))",
+				tablename,
+				filter,
+				tablename,
+				filter,
+				limit);
+#elif defined(HAVE_SQLITE3)
+		return DBexecute(
+				"delete from %s"
+				" where %s",
+				tablename,
+				filter);
+#endif
+	}
+
+	return 0;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: drop appropriate partitions from the history and trends tables    *
@@ -579,6 +657,426 @@ out:
 #endif
 }
 
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
+/* native range partition of history or trends table */
+typedef struct
+{
+	char	*name;
+
+	/* the partition lower bound (inclusive) and upper bound (exclusive), */
+	/* INT_MIN/INT_MAX for PostgreSQL MINVALUE/MAXVALUE bounds            */
+	int	clock_from;
+	int	clock_to;
+}
+zbx_hk_partition_t;
+
+static void	hk_partition_free(zbx_hk_partition_t *partition)
+{
+	zbx_free(partition->name);
+	zbx_free(partition);
+}
+
+static int	hk_partition_compare(const void *d1, const void *d2)
+{
+	const zbx_hk_partition_t	*p1 = *(const zbx_hk_partition_t * const *)d1;
+	const zbx_hk_partition_t	*p2 = *(const zbx_hk_partition_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(p1->clock_to, p2->clock_to);
+
+	return 0;
+}
+
+#if defined(HAVE_POSTGRESQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parse PostgreSQL range partition bound value                      *
+ *                                                                            *
+ * Parameters: bound - [IN] the partition bound expression                    *
+ *             key   - [IN] the bound keyword - " FROM (" or " TO ("          *
+ *             clock - [OUT] the bound value, INT_MIN for MINVALUE and        *
+ *                           INT_MAX for MAXVALUE                             *
+ *                                                                            *
+ * Return value: SUCCEED - the bound was parsed successfully                  *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_partition_parse_bound(const char *bound, const char *key, int *clock)
+{
+	if (NULL == (bound = strstr(bound, key)))
+		return FAIL;
+
+	bound += strlen(key);
+
+	if (0 == strncmp(bound, "MINVALUE", ZBX_CONST_STRLEN("MINVALUE")))
+	{
+		*clock = INT_MIN;
+		return SUCCEED;
+	}
+
+	if (0 == strncmp(bound, "MAXVALUE", ZBX_CONST_STRLEN("MAXVALUE")))
+	{
+		*clock = INT_MAX;
+		return SUCCEED;
+	}
+
+	if ('-' != *bound && 0 == isdigit((unsigned char)*bound))
+		return FAIL;
+
+	*clock = atoi(bound);
+
+	return SUCCEED;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get range partitions of history or trends table                   *
+ *                                                                            *
+ * Parameters: table        - [IN] the table name                             *
+ *             partitions   - [OUT] the range partitions sorted by upper      *
+ *                                  bound                                     *
+ *             default_name - [OUT] the name of partition accepting values    *
+ *                                  out of partition ranges (PostgreSQL       *
+ *                                  DEFAULT or MySQL MAXVALUE partition),     *
+ *                                  NULL if there is no such partition        *
+ *                                                                            *
+ * Return value: SUCCEED - the table is range partitioned                     *
+ *               FAIL    - the table is not partitioned                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_partitions_get(const char *table, zbx_vector_ptr_t *partitions, char **default_name)
+{
+	DB_RESULT		result;
+	DB_ROW			row;
+	int			ret = FAIL, clock_from, clock_to;
+	zbx_hk_partition_t	*partition;
+
+#if defined(HAVE_POSTGRESQL)
+	result = DBselect(
+			"select c.relname,pg_get_expr(c.relpartbound,c.oid),t.partdefid=c.oid"
+			" from pg_class p"
+				" join pg_namespace n"
+					" on n.oid=p.relnamespace"
+				" join pg_partitioned_table t"
+					" on t.partrelid=p.oid"
+				" left join pg_inherits i"
+					" on i.inhparent=p.oid"
+				" left join pg_class c"
+					" on c.oid=i.inhrelid"
+			" where p.relname='%s'"
+				" and p.relkind='p'"
+				" and t.partstrat='r'"
+				" and n.nspname='%s'",
+			table, zbx_db_get_schema_esc());
+#else
+	result = DBselect(
+			"select partition_name,partition_description"
+			" from information_schema.partitions"
+			" where table_schema=database()"
+				" and table_name='%s'"
+				" and partition_method in ('RANGE','RANGE COLUMNS')"
+			" order by partition_ordinal_position",
+			table);
+#endif
+	if (NULL == result)
+		return FAIL;
+
+	clock_to = INT_MIN;
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ret = SUCCEED;
+
+		/* partitioned table without partitions */
+		if (SUCCEED == DBis_null(row[0]))
+			continue;
+
+#if defined(HAVE_POSTGRESQL)
+		if ('t' == *row[2])
+		{
+			*default_name = zbx_strdup(*default_name, row[0]);
+			continue;
+		}
+
+		/* range partition bound is formatted as "FOR VALUES FROM (<from>) TO (<to>)", */
+		/* where the values can be MINVALUE and MAXVALUE                               */
+		if (SUCCEED != hk_partition_parse_bound(row[1], " FROM (", &clock_from) ||
+				SUCCEED != hk_partition_parse_bound(row[1], " TO (", &clock_to))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot parse bound \"%s\" of partition \"%s\"", row[1],
+					row[0]);
+			continue;
+		}
+#else
+		/* MAXVALUE partition accepts the values above partition ranges */
+		if (0 == isdigit((unsigned char)*row[1]))
+		{
+			*default_name = zbx_strdup(*default_name, row[0]);
+			continue;
+		}
+
+		/* range partition starts at the upper bound of the previous partition */
+		clock_from = clock_to;
+		clock_to = atoi(row[1]);
+#endif
+		partition = (zbx_hk_partition_t *)zbx_malloc(NULL, sizeof(zbx_hk_partition_t));
+		partition->name = zbx_strdup(NULL, row[0]);
+		partition->clock_from = clock_from;
+		partition->clock_to = clock_to;
+		zbx_vector_ptr_append(partitions, partition);
+	}
+	DBfree_result(result);
+
+	zbx_vector_ptr_sort(partitions, hk_partition_compare);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: create range partition of history or trends table                 *
+ *                                                                            *
+ * Parameters: table        - [IN] the table name                             *
+ *             default_name - [IN] the name of DEFAULT/MAXVALUE partition     *
+ *                                 (optional)                                 *
+ *             clock_from   - [IN] the partition lower bound                  *
+ *             clock_to     - [IN] the partition upper bound                  *
+ *                                                                            *
+ * Return value: SUCCEED - the partition was created successfully             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_partition_create(const char *table, const char *default_name, int clock_from, int clock_to)
+{
+	int	rc;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() table:%s from:%d to:%d", __func__, table, clock_from, clock_to);
+#if defined(HAVE_POSTGRESQL)
+	ZBX_UNUSED(default_name);
+
+	rc = DBexecute("create table %s_p%d partition of %s for values from (%d) to (%d)", table, clock_from, table,
+			clock_from, clock_to);
+#else
+	if (NULL != default_name)
+	{
+		rc = DBexecute("alter table %s reorganize partition %s into"
+				" (partition p%d values less than (%d),partition %s values less than maxvalue)",
+				table, default_name, clock_from, clock_to, default_name);
+	}
+	else
+	{
+		rc = DBexecute("alter table %s add partition (partition p%d values less than (%d))", table,
+				clock_from, clock_to);
+	}
+#endif
+	if (ZBX_DB_OK > rc)
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot create partition of table \"%s\" for period from %d to %d",
+				table, clock_from, clock_to);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: create partitions for history or trends records within storage    *
+ *          period and for future records                                     *
+ *                                                                            *
+ * Parameters: table        - [IN] the table name                             *
+ *             partitions   - [IN] the existing range partitions              *
+ *             default_name - [IN] the name of DEFAULT/MAXVALUE partition     *
+ *                                 (optional)                                 *
+ *             keep_from    - [IN] the start of storage period                *
+ *             now          - [IN] the current timestamp                      *
+ *                                                                            *
+ * Comments: Partitions are aligned to HousekeepingPartitionPeriod and        *
+ *           created to cover the storage period and at least two days or two *
+ *           partition periods ahead, so housekeeping can be delayed without  *
+ *           rejecting writes.                                                *
+ *           MySQL range partitions can be added only above the existing      *
+ *           ones, but the lowest partition accepts all older values, so the  *
+ *           storage period is covered when the first partition is created.   *
+ *                                                                            *
+ ******************************************************************************/
+static void	hk_partitions_create(const char *table, const zbx_vector_ptr_t *partitions,
+		const char *default_name, int keep_from, int now)
+{
+	int	period, clock_from, clock_to, horizon;
+
+	period = CONFIG_HOUSEKEEPING_PARTITION_PERIOD * SEC_PER_HOUR;
+	horizon = now + MAX(2 * SEC_PER_DAY, 2 * period);
+	clock_from = keep_from - keep_from % period;
+
+	if (0 != partitions->values_num)
+	{
+#if defined(HAVE_POSTGRESQL)
+		int	clock_first;
+
+		/* fill the storage period below the lowest partition */
+		clock_first = ((const zbx_hk_partition_t *)partitions->values[0])->clock_from;
+
+		for (; clock_from < clock_first; clock_from = clock_to)
+		{
+			clock_to = MIN(clock_from - clock_from % period + period, clock_first);
+
+			if (SUCCEED != hk_partition_create(table, default_name, clock_from, clock_to))
+				break;
+		}
+#endif
+		clock_from = ((const zbx_hk_partition_t *)partitions->values[partitions->values_num - 1])->clock_to;
+	}
+
+	for (; clock_from < horizon; clock_from = clock_to)
+	{
+		clock_to = clock_from - clock_from % period + period;
+
+		if (SUCCEED != hk_partition_create(table, default_name, clock_from, clock_to))
+			break;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: maintain native range partitions of history and trends tables     *
+ *                                                                            *
+ * Parameters: rule - [IN] the history housekeeping rule                      *
+ *             now  - [IN] the current timestamp                              *
+ *                                                                            *
+ * Return value: SUCCEED - the table is range partitioned                     *
+ *               FAIL    - the table is not partitioned, history must be      *
+ *                         removed per item                                   *
+ *                                                                            *
+ * Comments: Partitions are created ahead of time and partitions with all     *
+ *           records older than the global storage period are dropped.        *
+ *           A table that is not partitioned is reported once and housekept   *
+ *           per item until it is partitioned.                                *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_native_partition_for_rule(zbx_hk_history_rule_t *rule, int now)
+{
+	zbx_vector_ptr_t	partitions;
+	char			*default_name = NULL;
+	int			i, keep_from, rc, ret = SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:%s now:%d", __func__, rule->table, now);
+
+	if (0 == *rule->poption)
+	{
+		keep_from = now;
+	}
+	else if (ZBX_HK_HISTORY_MIN > *rule->poption || ZBX_HK_PERIOD_MAX < *rule->poption)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "invalid history storage period for table '%s'", rule->table);
+		goto out;
+	}
+	else
+		keep_from = now - *rule->poption;
+
+	zbx_vector_ptr_create(&partitions);
+
+	if (SUCCEED != hk_partitions_get(rule->table, &partitions, &default_name))
+	{
+		if (0 == rule->not_partitioned)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "table \"%s\" is not range partitioned, removing outdated records"
+					" per item instead of dropping partitions", rule->table);
+			rule->not_partitioned = 1;
+		}
+
+		ret = FAIL;
+		goto clean;
+	}
+
+	if (0 != rule->not_partitioned)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "table \"%s\" is range partitioned, dropping partitions instead of"
+				" removing outdated records per item", rule->table);
+		rule->not_partitioned = 0;
+	}
+
+	hk_partitions_create(rule->table, &partitions, default_name, keep_from, now);
+
+	for (i = 0; i < partitions.values_num; i++)
+	{
+		zbx_hk_partition_t	*partition = (zbx_hk_partition_t *)partitions.values[i];
+
+		if (partition->clock_to > keep_from)
+			break;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() dropping partition %s of table %s", __func__, partition->name,
+				rule->table);
+#if defined(HAVE_POSTGRESQL)
+		rc = DBexecute("drop table %s", partition->name);
+#else
+		rc = DBexecute("alter table %s drop partition %s", rule->table, partition->name);
+#endif
+		if (ZBX_DB_OK > rc)
+		{
+			zabbix_log(LOG_LEVEL_ERR, "cannot drop partition \"%s\" of table \"%s\"", partition->name,
+					rule->table);
+			break;
+		}
+	}
+clean:
+	zbx_free(default_name);
+	zbx_vector_ptr_clear_ext(&partitions, (zbx_clean_func_t)hk_partition_free);
+	zbx_vector_ptr_destroy(&partitions);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes expired history kept outside database by history storage  *
+ *                                                                            *
+ * Parameters: rule - [IN] the history housekeeping rule                      *
+ *             now  - [IN] the current timestamp                              *
+ *                                                                            *
+ * Return value: SUCCEED - the rule history is kept by history storage        *
+ *               FAIL    - the rule history is kept in database               *
+ *                                                                            *
+ * Comments: History storage drops whole time blocks, so only the global      *
+ *           history storage period can be applied.                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	hk_history_storage_for_rule(zbx_hk_history_rule_t *rule, int now)
+{
+	/* the value types with the not housekept warning logged, until the period is overridden */
+	static unsigned char	warned[ITEM_VALUE_TYPE_MAX];
+	int			keep_from, removed = 0;
+
+	if (ZBX_HK_OPTION_ENABLED == *rule->poption_global)
+		keep_from = now - *rule->poption;
+	else
+		keep_from = 0;
+
+	if (SUCCEED != zbx_history_housekeep(rule->type, keep_from, &removed))
+		return FAIL;
+
+	if (0 == keep_from)
+	{
+		if (0 == warned[rule->type])
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "history of table \"%s\" in history storage is not housekept:"
+					" item history period must be overridden", rule->table);
+			warned[rule->type] = 1;
+		}
+	}
+	else
+	{
+		warned[rule->type] = 0;
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() table:%s removed %d time blocks from history storage", __func__,
+				rule->table, removed);
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: performs housekeeping for history and trends tables               *
@@ -603,14 +1101,38 @@ static int	housekeeping_history_and_trends(int now)
 		if (ZBX_HK_MODE_DISABLED == *rule->poption_mode)
 			continue;
 
+		if (0 == strcmp(rule->history, "history") && SUCCEED == hk_history_storage_for_rule(rule, now))
+			continue;
+
 		/* If partitioning enabled for history and/or trends then drop partitions with expired history.  */
 		/* ZBX_HK_MODE_PARTITION is set during configuration sync based on the following: */
-		/* 1. "Override item history (or trend) period" must be on 2. DB must be PostgreSQL */
-		/* 3. config.db.extension must be set to "timescaledb" */
+		/* 1. "Override item history (or trend) period" must be on 2. DB must be PostgreSQL or MySQL */
+		/* 3. config.db.extension must be set to "timescaledb" (PostgreSQL only) or */
+		/*    HousekeepingPartitionPeriod must be set for native partitioning */
 		if (ZBX_HK_MODE_PARTITION == *rule->poption_mode)
 		{
-			hk_drop_partition_for_rule(rule, now);
-			continue;
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
+			if (0 != strcmp(cfg.db.extension, ZBX_CONFIG_DB_EXTENSION_TIMESCALE))
+			{
+				if (SUCCEED == hk_native_partition_for_rule(rule, now))
+				{
+					/* discard the queue prepared while the table was not partitioned */
+					if (0 != rule->item_cache.num_slots)
+						hk_history_delete_queue_clear(rule);
+
+					continue;
+				}
+
+				/* the table is not range partitioned, process the per item delete queue */
+				if (0 == rule->item_cache.num_slots)
+					continue;
+			}
+			else
+#endif
+			{
+				hk_drop_partition_for_rule(rule, now);
+				continue;
+			}
 		}
 
 		/* process delete queue for the housekeeping rule */
@@ -734,62 +1256,6 @@ static int	housekeeping_process_rule(int now, zbx_hk_rule_t *rule)
 	return deleted;
 }
 
-/******************************************************************************
- *                                                                            *
- * Purpose: delete limited count of rows from table                           *
- *                                                                            *
- * Return value: number of deleted rows or less than 0 if an error occurred   *
- *                                                                            *
- ******************************************************************************/
-static int	DBdelete_from_table(const char *tablename, const char *filter, int limit)
-{
-	if (0 == limit)
-	{
-		return DBexecute(
-				"delete from %s"
-				" where %s",
-				tablename,
-				filter);
-	}
-	else
-	{
-#if defined(HAVE_ORACLE)
-		return DBexecute(
-				"delete from %s"
-				" where %s"
-					" and rownum<=%d",
-				tablename,
-				filter,
-				limit);
-#elif defined(HAVE_MYSQL)
-		return DBexecute(
-				"delete from %s"
-				" where %s limit %d",
-				tablename,
-				filter,
-				limit);
-#elif defined(HAVE_POSTGRESQL)
-		return DBexecute(
-				"delete from %s"
-				" where %s and ctid = any(array(select ctid from %s"
-					" where %s limit %d))",
-				tablename,
-				filter,
-				tablename,
-				filter,
-				limit);
-#elif defined(HAVE_SQLITE3)
-		return DBexecute(
-				"delete from %s"
-				" where %s",
-				tablename,
-				filter);
-#endif
-	}
-
-	return 0;
-}
-
 /******************************************************************************
  *                                                                            *
  * Purpose: perform problem table cleanup                                     *
@@ -22,6 +22,7 @@
 #include "zbxlld.h"
 #include "dbcache.h"
 #include "zbxha.h"
+#include "export.h"
 
 #include "checks_internal.h"
 
@@ -188,6 +189,62 @@ int	zbx_get_value_internal_ext(const char *param1, const AGENT_REQUEST *request,
 			goto out;
 		}
 	}
+	else if (0 == strcmp(param1, "export"))
+	{
+		zbx_export_cache_stats_t	stats;
+
+		if (FAIL == zbx_export_cache_get_stats(&stats))
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Export cache is disabled."));
+			goto out;
+		}
+
+		if (3 != nparams)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid number of parameters."));
+			goto out;
+		}
+
+		param2 = get_rparam(request, 1);
+		param3 = get_rparam(request, 2);
+
+		if (0 == strcmp(param2, "buffer"))
+		{
+			if (0 == strcmp(param3, "free"))
+				SET_UI64_RESULT(result, stats.free_size);
+			else if (0 == strcmp(param3, "pfree"))
+				SET_DBL_RESULT(result, (double)stats.free_size / stats.total_size * 100);
+			else if (0 == strcmp(param3, "total"))
+				SET_UI64_RESULT(result, stats.total_size);
+			else if (0 == strcmp(param3, "used"))
+				SET_UI64_RESULT(result, stats.total_size - stats.free_size);
+			else if (0 == strcmp(param3, "pused"))
+				SET_DBL_RESULT(result, (double)(stats.total_size - stats.free_size) /
+						stats.total_size * 100);
+			else
+			{
+				SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+				goto out;
+			}
+		}
+		else if (0 == strcmp(param2, "records"))
+		{
+			if (0 == strcmp(param3, "written"))
+				SET_UI64_RESULT(result, stats.written_num);
+			else if (0 == strcmp(param3, "dropped"))
+				SET_UI64_RESULT(result, stats.dropped_num);
+			else
+			{
+				SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid third parameter."));
+				goto out;
+			}
+		}
+		else
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Invalid second parameter."));
+			goto out;
+		}
+	}
 	else if (0 == strcmp(param1, "lld_queue"))
 	{
 		zbx_uint64_t	value;
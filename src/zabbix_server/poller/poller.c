@@ -433,7 +433,8 @@ void	zbx_prepare_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *res
 		init_result(&results[i]);
 		errcodes[i] = SUCCEED;
 
-		if (MACRO_EXPAND_YES == expand_macros)
+		/* key can be already resolved by configuration cache */
+		if (MACRO_EXPAND_YES == expand_macros && 0 == items[i].macros_resolved)
 		{
 			ZBX_STRDUP(items[i].key, items[i].key_orig);
 			if (SUCCEED != substitute_key_macros_unmasked(&items[i].key, NULL, &items[i], NULL, NULL,
@@ -500,11 +501,16 @@ void	zbx_prepare_items(DC_ITEM *items, int *errcodes, int num, AGENT_RESULT *res
 				}
 
 				ZBX_STRDUP(items[i].snmp_community, items[i].snmp_community_orig);
-				ZBX_STRDUP(items[i].snmp_oid, items[i].snmp_oid_orig);
 
 				substitute_simple_macros_unmasked(NULL, NULL, NULL, NULL, &items[i].host.hostid, NULL,
 						NULL, NULL, NULL, NULL, NULL, NULL, &items[i].snmp_community,
 						MACRO_TYPE_COMMON, NULL, 0);
+
+				if (0 != items[i].macros_resolved)
+					break;
+
+				ZBX_STRDUP(items[i].snmp_oid, items[i].snmp_oid_orig);
+
 				if (SUCCEED != substitute_key_macros(&items[i].snmp_oid, &items[i].host.hostid,
 						NULL, NULL, NULL, MACRO_TYPE_SNMP_OID, error, sizeof(error)))
 				{
@@ -810,6 +816,7 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 	zbx_vector_ptr_create(&add_results);
 
 	zbx_prepare_items(items, errcodes, num, results, MACRO_EXPAND_YES);
+	DCconfig_set_resolved_items(items, errcodes, num);
 	zbx_check_items(items, errcodes, num, results, &add_results, poller_type);
 
 	zbx_timespec(&timespec);
@@ -68,6 +68,7 @@
 #include "lld/lld_worker.h"
 #include "reporter/report_manager.h"
 #include "reporter/report_writer.h"
+#include "exporter/exporter.h"
 #include "events.h"
 #include "../libs/zbxdbcache/valuecache.h"
 #include "setproctitle.h"
@@ -138,7 +139,8 @@ const char	*help_message[] = {
 	"                                  self-monitoring, snmp trapper, task manager,",
 	"                                  timer, trapper, unreachable poller,",
 	"                                  vmware collector, history poller,",
-	"                                  availability manager, service manager, odbc poller)",
+	"                                  availability manager, service manager, odbc poller,",
+	"                                  exporter)",
 	"        process-type,N            Process type and number (e.g., poller,3)",
 	"        pid                       Process identifier",
 	"",
@@ -221,6 +223,7 @@ int	CONFIG_REPORTWRITER_FORKS	= 0;
 int	CONFIG_SERVICEMAN_FORKS		= 1;
 int	CONFIG_PROBLEMHOUSEKEEPER_FORKS = 1;
 int	CONFIG_ODBCPOLLER_FORKS		= 1;
+int	CONFIG_EXPORTER_FORKS		= 0;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -230,10 +233,12 @@ char	*CONFIG_SERVER			= NULL;		/* not used in zabbix_server, required for linkin
 
 int	CONFIG_HOUSEKEEPING_FREQUENCY	= 1;
 int	CONFIG_MAX_HOUSEKEEPER_DELETE	= 5000;		/* applies for every separate field value */
+int	CONFIG_HOUSEKEEPING_PARTITION_PERIOD	= 0;
 int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
 int	CONFIG_CONFSYNCER_FREQUENCY	= 60;
+int	CONFIG_CONF_CACHE_LOAD_CONNECTIONS	= 4;
 
 int	CONFIG_PROBLEMHOUSEKEEPING_FREQUENCY = 60;
 
@@ -250,6 +255,10 @@ zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE		= ZBX_GIBIBYTE;
+zbx_uint64_t	CONFIG_EXPORT_CACHE_SIZE	= 0;
+
+int	CONFIG_HUGE_PAGES		= 0;
+int	CONFIG_VALUE_CACHE_COMPRESSION	= 0;
 
 int	CONFIG_UNREACHABLE_PERIOD	= 45;
 int	CONFIG_UNREACHABLE_DELAY	= 15;
@@ -345,6 +354,9 @@ static char	*CONFIG_SOCKET_PATH	= NULL;
 char	*CONFIG_HISTORY_STORAGE_URL		= NULL;
 char	*CONFIG_HISTORY_STORAGE_OPTS		= NULL;
 int	CONFIG_HISTORY_STORAGE_PIPELINES	= 0;
+int	CONFIG_HISTORY_STORAGE_COMPRESSION	= 0;
+zbx_uint64_t	CONFIG_HISTORY_STORAGE_BULK_SIZE	= 0;
+char	*CONFIG_HISTORY_STORAGE_DIR		= NULL;
 
 char	*CONFIG_STATS_ALLOWED_IP	= NULL;
 int	CONFIG_TCP_MAX_BACKLOG_SIZE	= SOMAXCONN;
@@ -535,6 +547,11 @@ int	get_process_info_by_thread(int local_server_num, unsigned char *local_proces
 		*local_process_type = ZBX_PROCESS_TYPE_ODBCPOLLER;
 		*local_process_num = local_server_num - server_count + CONFIG_ODBCPOLLER_FORKS;
 	}
+	else if (local_server_num <= (server_count += CONFIG_EXPORTER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_EXPORTER;
+		*local_process_num = local_server_num - server_count + CONFIG_EXPORTER_FORKS;
+	}
 	else
 		return FAIL;
 
@@ -648,6 +665,22 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 		err = 1;
 	}
 
+#if !defined(HAVE_POSTGRESQL) && !defined(HAVE_MYSQL)
+	if (0 != CONFIG_HOUSEKEEPING_PARTITION_PERIOD)
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "\"HousekeepingPartitionPeriod\" configuration parameter is supported only"
+				" with PostgreSQL and MySQL databases");
+		err = 1;
+	}
+#endif
+
+	if (0 != CONFIG_EXPORT_CACHE_SIZE && 128 * ZBX_KIBIBYTE > CONFIG_EXPORT_CACHE_SIZE)
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "\"ExportCacheSize\" configuration parameter must be either 0"
+				" or greater than 128KB");
+		err = 1;
+	}
+
 	if (NULL != CONFIG_SOURCE_IP && SUCCEED != is_supported_ip(CONFIG_SOURCE_IP))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "invalid \"SourceIP\" configuration parameter: '%s'", CONFIG_SOURCE_IP);
@@ -684,14 +717,24 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 	err |= (FAIL == check_cfg_feature_str("SSLCertLocation", CONFIG_SSL_CERT_LOCATION, "cURL library"));
 	err |= (FAIL == check_cfg_feature_str("SSLKeyLocation", CONFIG_SSL_KEY_LOCATION, "cURL library"));
 	err |= (FAIL == check_cfg_feature_str("HistoryStorageURL", CONFIG_HISTORY_STORAGE_URL, "cURL library"));
-	err |= (FAIL == check_cfg_feature_str("HistoryStorageTypes", CONFIG_HISTORY_STORAGE_OPTS, "cURL library"));
+	if (NULL == CONFIG_HISTORY_STORAGE_DIR)
+	{
+		err |= (FAIL == check_cfg_feature_str("HistoryStorageTypes", CONFIG_HISTORY_STORAGE_OPTS,
+				"cURL library"));
+	}
 	err |= (FAIL == check_cfg_feature_int("HistoryStorageDateIndex", CONFIG_HISTORY_STORAGE_PIPELINES,
 			"cURL library"));
+	err |= (FAIL == check_cfg_feature_int("HistoryStorageCompression", CONFIG_HISTORY_STORAGE_COMPRESSION,
+			"cURL library"));
 	err |= (FAIL == check_cfg_feature_str("VaultToken", CONFIG_VAULTTOKEN, "cURL library"));
 	err |= (FAIL == check_cfg_feature_str("VaultDBPath", CONFIG_VAULTDBPATH, "cURL library"));
 
 	err |= (FAIL == check_cfg_feature_int("StartReportWriters", CONFIG_REPORTWRITER_FORKS, "cURL library"));
 #endif
+#if !defined(HAVE_ZLIB)
+	err |= (FAIL == check_cfg_feature_int("HistoryStorageCompression", CONFIG_HISTORY_STORAGE_COMPRESSION,
+			"zlib library"));
+#endif
 
 #if !defined(HAVE_LIBXML2) || !defined(HAVE_LIBCURL)
 	err |= (FAIL == check_cfg_feature_int("StartVMwareCollectors", CONFIG_VMWARE_FORKS, "VMware support"));
@@ -791,12 +834,20 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"ValueCacheSize",		&CONFIG_VALUE_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	0,			__UINT64_C(64) * ZBX_GIBIBYTE},
+		{"ValueCacheCompression",	&CONFIG_VALUE_CACHE_COMPRESSION,	TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"HugePages",			&CONFIG_HUGE_PAGES,			TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"CacheUpdateFrequency",	&CONFIG_CONFSYNCER_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	1,			SEC_PER_HOUR},
+		{"CacheLoadConnections",	&CONFIG_CONF_CACHE_LOAD_CONNECTIONS,	TYPE_INT,
+			PARM_OPT,	0,			16},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"MaxHousekeeperDelete",	&CONFIG_MAX_HOUSEKEEPER_DELETE,		TYPE_INT,
 			PARM_OPT,	0,			1000000},
+		{"HousekeepingPartitionPeriod",	&CONFIG_HOUSEKEEPING_PARTITION_PERIOD,	TYPE_INT,
+			PARM_OPT,	0,			720},
 		{"TmpDir",			&CONFIG_TMPDIR,				TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"FpingLocation",		&CONFIG_FPING_LOCATION,			TYPE_STRING,
@@ -933,12 +984,20 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"HistoryStorageDateIndex",	&CONFIG_HISTORY_STORAGE_PIPELINES,	TYPE_INT,
 			PARM_OPT,	0,			1},
+		{"HistoryStorageCompression",	&CONFIG_HISTORY_STORAGE_COMPRESSION,	TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"HistoryStorageBulkSize",	&CONFIG_HISTORY_STORAGE_BULK_SIZE,	TYPE_UINT64,
+			PARM_OPT,	0,			ZBX_GIBIBYTE},
+		{"HistoryStorageDir",		&CONFIG_HISTORY_STORAGE_DIR,		TYPE_STRING,
+			PARM_OPT,	0,			0},
 		{"ExportDir",			&CONFIG_EXPORT_DIR,			TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"ExportType",			&CONFIG_EXPORT_TYPE,			TYPE_STRING_LIST,
 			PARM_OPT,	0,			0},
 		{"ExportFileSize",		&CONFIG_EXPORT_FILE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	ZBX_MEBIBYTE,	ZBX_GIBIBYTE},
+		{"ExportCacheSize",		&CONFIG_EXPORT_CACHE_SIZE,		TYPE_UINT64,
+			PARM_OPT,	0,			__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"StartLLDProcessors",		&CONFIG_LLDWORKER_FORKS,		TYPE_INT,
 			PARM_OPT,	1,			100},
 		{"StatsAllowedIP",		&CONFIG_STATS_ALLOWED_IP,		TYPE_STRING_LIST,
@@ -1252,7 +1311,7 @@ static int	server_startup(zbx_socket_t *listen_sock, zbx_rtc_t *rtc)
 			+ CONFIG_LLDMANAGER_FORKS + CONFIG_LLDWORKER_FORKS + CONFIG_ALERTDB_FORKS
 			+ CONFIG_HISTORYPOLLER_FORKS + CONFIG_AVAILMAN_FORKS + CONFIG_REPORTMANAGER_FORKS
 			+ CONFIG_REPORTWRITER_FORKS + CONFIG_SERVICEMAN_FORKS + CONFIG_PROBLEMHOUSEKEEPER_FORKS
-			+ CONFIG_ODBCPOLLER_FORKS;
+			+ CONFIG_ODBCPOLLER_FORKS + CONFIG_EXPORTER_FORKS;
 	threads = (pid_t *)zbx_calloc(threads, (size_t)threads_num, sizeof(pid_t));
 	threads_flags = (int *)zbx_calloc(threads_flags, (size_t)threads_num, sizeof(int));
 
@@ -1422,6 +1481,9 @@ static int	server_startup(zbx_socket_t *listen_sock, zbx_rtc_t *rtc)
 				thread_args.args = &poller_type;
 				zbx_thread_start(poller_thread, &thread_args, &threads[i]);
 				break;
+			case ZBX_PROCESS_TYPE_EXPORTER:
+				zbx_thread_start(exporter_thread, &thread_args, &threads[i]);
+				break;
 		}
 	}
 
@@ -1678,6 +1740,8 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 
+	zbx_mem_set_huge_pages(CONFIG_HUGE_PAGES);
+
 	if (SUCCEED != init_database_cache(&error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize database cache: %s", error);
@@ -1706,6 +1770,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 		exit(EXIT_FAILURE);
 	}
 
+	if (SUCCEED == zbx_is_export_cache_enabled())
+		CONFIG_EXPORTER_FORKS = 1;
+
 	if (SUCCEED != zbx_history_init(&error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize history storage: %s", error);
@@ -1901,8 +1968,15 @@ void	zbx_on_exit(int ret)
 
 		DBconnect(ZBX_DB_CONNECT_EXIT);
 
+		/* exporter has been stopped, write the queued records and the records of the final sync here */
+		if (SUCCEED == zbx_is_export_cache_enabled())
+			zbx_export_cache_flush();
+
 		free_database_cache(ZBX_SYNC_ALL);
 
+		if (SUCCEED == zbx_is_export_cache_enabled())
+			zbx_export_cache_flush();
+
 		DBclose();
 
 		free_configuration_cache();
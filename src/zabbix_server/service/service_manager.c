@@ -39,6 +39,8 @@ extern int				CONFIG_SERVICEMAN_SYNC_FREQUENCY;
 #define ZBX_PROBLEM_CLEANUP_AGE		(SEC_PER_HOUR * 2)
 #define ZBX_PROBLEM_CLEANUP_FREQUENCY	SEC_PER_HOUR
 
+#define ZBX_SERVICE_LEVEL_UNKNOWN	-1
+
 static volatile sig_atomic_t	service_cache_reload_requested;
 
 typedef struct
@@ -89,10 +91,30 @@ typedef struct
 	zbx_vector_ptr_t	service_problems_recovered;
 #define ZBX_FLAG_SERVICE_UPDATE		__UINT64_C(0x00)
 #define ZBX_FLAG_SERVICE_RECALCULATE	__UINT64_C(0x01)
+/* recalculate parent services even if service status has not changed */
+#define ZBX_FLAG_SERVICE_PROPAGATE	__UINT64_C(0x02)
 	int			flags;
 }
 zbx_services_diff_t;
 
+/* parent service status recalculation request */
+typedef struct
+{
+	zbx_service_t	*service;
+	zbx_timespec_t	ts;
+	int		flags;
+	int		processed;
+}
+zbx_service_recalc_t;
+
+/* parent services recalculation queue, ordered by service level */
+typedef struct
+{
+	zbx_hashset_t		services;
+	zbx_binary_heap_t	queue;
+}
+zbx_service_recalc_queue_t;
+
 /* preprocessing manager data */
 typedef struct
 {
@@ -577,6 +599,7 @@ static void	sync_services(zbx_service_manager_t *service_manager, int *updated,
 			zbx_vector_ptr_create(&service_local.service_problems);
 			zbx_vector_ptr_create(&service_local.status_rules);
 			service_local.name = zbx_strdup(NULL, row[3]);
+			service_local.level = 0;
 
 			service = zbx_hashset_insert(&service_manager->services, &service_local, sizeof(service_local));
 
@@ -862,6 +885,49 @@ static void	sync_services_links(zbx_service_manager_t *service_manager, int *upd
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculates service level - the longest path to leaf service       *
+ *                                                                            *
+ ******************************************************************************/
+static int	service_update_level(zbx_service_t *service)
+{
+	int	i, level = 0, child_level;
+
+	if (ZBX_SERVICE_LEVEL_UNKNOWN != service->level)
+		return service->level;
+
+	/* protect against infinite recursion in the case of cyclic links */
+	service->level = 0;
+
+	for (i = 0; i < service->children.values_num; i++)
+	{
+		if (level < (child_level = service_update_level((zbx_service_t *)service->children.values[i]) + 1))
+			level = child_level;
+	}
+
+	return service->level = level;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates levels of all services after service tree was changed     *
+ *                                                                            *
+ ******************************************************************************/
+static void	services_update_levels(zbx_hashset_t *services)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_service_t		*service;
+
+	zbx_hashset_iter_reset(services, &iter);
+	while (NULL != (service = (zbx_service_t *)zbx_hashset_iter_next(&iter)))
+		service->level = ZBX_SERVICE_LEVEL_UNKNOWN;
+
+	zbx_hashset_iter_reset(services, &iter);
+	while (NULL != (service = (zbx_service_t *)zbx_hashset_iter_next(&iter)))
+		service_update_level(service);
+}
+
 static void	sync_service_problems(zbx_hashset_t *services, zbx_hashset_t *service_problems_index)
 {
 	DB_RESULT	result;
@@ -1510,49 +1576,85 @@ out:
 	return ret;
 }
 
+/* the number and weight of not ignored children services per status, */
+/* the status index is calculated by ZBX_SERVICE_STATUS_INDEX() macro */
+typedef struct
+{
+#define ZBX_SERVICE_STATUS_INDEX(status)	((status) - ZBX_SERVICE_STATUS_OK)
+#define ZBX_SERVICE_STATUS_NUM			(TRIGGER_SEVERITY_COUNT + 1)
+	int	num[ZBX_SERVICE_STATUS_NUM];
+	int	weight[ZBX_SERVICE_STATUS_NUM];
+	int	total_num;
+	int	total_weight;
+}
+zbx_service_children_status_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: count not ignored children services by their status              *
+ *                                                                            *
+ * Parameters: service  - [IN] the service                                    *
+ *             children - [OUT] the children status statistics                *
+ *                                                                            *
+ * Comments: The statistics are gathered once per service recalculation and   *
+ *           shared by main status algorithm and all status rules.            *
+ *                                                                            *
+ ******************************************************************************/
+static void	service_get_children_status(const zbx_service_t *service, zbx_service_children_status_t *children)
+{
+	int	i, child_status;
+
+	memset(children, 0, sizeof(zbx_service_children_status_t));
+
+	for (i = 0; i < service->children.values_num; i++)
+	{
+		zbx_service_t	*child = (zbx_service_t *)service->children.values[i];
+
+		if (SUCCEED != service_get_status(child, &child_status))
+			continue;
+
+		if (ZBX_SERVICE_STATUS_OK > child_status)
+			child_status = ZBX_SERVICE_STATUS_OK;
+		else if (TRIGGER_SEVERITY_COUNT <= child_status)
+			child_status = TRIGGER_SEVERITY_COUNT - 1;
+
+		children->num[ZBX_SERVICE_STATUS_INDEX(child_status)]++;
+		children->weight[ZBX_SERVICE_STATUS_INDEX(child_status)] += child->weight;
+		children->total_num++;
+		children->total_weight += child->weight;
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get service status by applying the main service status algorithm  *
+ *          to the children status statistics                                 *
  *                                                                            *
- * Parameters: service - [IN] the service                                     *
+ * Parameters: service  - [IN] the service                                    *
+ *             children - [IN] the children status statistics                 *
  *                                                                            *
  *  Return value: The service status.                                         *
  *                                                                            *
  ******************************************************************************/
-int	service_get_main_status(const zbx_service_t *service)
+static int	service_calculate_main_status(const zbx_service_t *service,
+		const zbx_service_children_status_t *children)
 {
-	int	status = ZBX_SERVICE_STATUS_OK, child_status, i;
+	int	status = ZBX_SERVICE_STATUS_OK, i;
 
 	switch (service->algorithm)
 	{
 		case ZBX_SERVICE_STATUS_CALC_MOST_CRITICAL_ALL:
-			for (i = 0; i < service->children.values_num; i++)
+			if (0 != children->num[ZBX_SERVICE_STATUS_INDEX(ZBX_SERVICE_STATUS_OK)])
+				break;
+			ZBX_FALLTHROUGH;
+		case ZBX_SERVICE_STATUS_CALC_MOST_CRITICAL_ONE:
+			for (i = TRIGGER_SEVERITY_COUNT - 1; ZBX_SERVICE_STATUS_OK < i; i--)
 			{
-				zbx_service_t	*child = (zbx_service_t *)service->children.values[i];
-
-				if (SUCCEED != service_get_status(child, &child_status))
-					continue;
-
-				if (ZBX_SERVICE_STATUS_OK == child_status)
+				if (0 != children->num[ZBX_SERVICE_STATUS_INDEX(i)])
 				{
-					status = child_status;
+					status = i;
 					break;
 				}
-
-				if (status < child_status)
-					status = child_status;
-			}
-			break;
-		case ZBX_SERVICE_STATUS_CALC_MOST_CRITICAL_ONE:
-			for (i = 0; i < service->children.values_num; i++)
-			{
-				zbx_service_t	*child = (zbx_service_t *)service->children.values[i];
-
-				if (SUCCEED != service_get_status(child, &child_status))
-					continue;
-
-				if (status < child_status)
-					status = child_status;
 			}
 			break;
 		case ZBX_SERVICE_STATUS_CALC_SET_OK:
@@ -1568,77 +1670,42 @@ int	service_get_main_status(const zbx_service_t *service)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get children with status greater or equal to the specified        *
- *                                                                            *
- * Parameters: service      - [IN] the service                                *
- *             status       - [IN] the target status                          *
- *             children     - [OUT] the children having the required status   *
- *             total_weight - [OUT] the weight of all not ignored children    *
- *             total_num    - [OUT] the number of all not ignored children    *
+ * Purpose: get service status by applying the main service status algorithm  *
  *                                                                            *
- ******************************************************************************/
-static void	service_get_children_by_status(const zbx_service_t *service, int status, zbx_vector_ptr_t *children,
-		int *total_weight, int *total_num)
-{
-	int	i, child_status;
-
-	*total_num = 0;
-	*total_weight = 0;
-
-	for (i = 0; i < service->children.values_num; i++)
-	{
-		zbx_service_t	*child = (zbx_service_t *)service->children.values[i];
-
-		if (SUCCEED != service_get_status(child, &child_status))
-			continue;
-
-		(*total_weight) += child->weight;
-		(*total_num)++;
-
-		if (child_status >= status)
-			zbx_vector_ptr_append(children, child);
-	}
-}
-
-/******************************************************************************
+ * Parameters: service - [IN] the service                                     *
  *                                                                            *
- * Purpose: get total weight of all specified services                        *
+ *  Return value: The service status.                                         *
  *                                                                            *
  ******************************************************************************/
-static int	services_get_weight(const zbx_vector_ptr_t *services)
+int	service_get_main_status(const zbx_service_t *service)
 {
-	int	i, weight = 0;
+	zbx_service_children_status_t	children;
 
-	for (i = 0; i < services->values_num; i++)
-	{
-		zbx_service_t	*service = (zbx_service_t *)services->values[i];
-
-		weight += service->weight;
-	}
+	service_get_children_status(service, &children);
 
-	return weight;
+	return service_calculate_main_status(service, &children);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: get service status according to the specified rule                *
+ * Purpose: get service status according to the specified rule and children  *
+ *          status statistics                                                 *
  *                                                                            *
- * Parameters: service - [IN] the service                                     *
- *             rule    - [IN] the service status rule                         *
+ * Parameters: service  - [IN] the service                                    *
+ *             rule     - [IN] the service status rule                        *
+ *             children - [IN] the children status statistics                 *
  *                                                                            *
  *  Return value: The service status.                                         *
  *                                                                            *
  ******************************************************************************/
-int	service_get_rule_status(const zbx_service_t *service, const zbx_service_rule_t *rule)
+static int	service_calculate_rule_status(const zbx_service_t *service, const zbx_service_rule_t *rule,
+		const zbx_service_children_status_t *children)
 {
-	zbx_vector_ptr_t	children;
-	int			status = ZBX_SERVICE_STATUS_OK, status_limit, total_num, total_weight, weight;
+	int	status = ZBX_SERVICE_STATUS_OK, status_limit, num = 0, weight = 0, i;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() service:" ZBX_FS_UI64 ", rule:" ZBX_FS_UI64, __func__, service->serviceid,
 			rule->service_ruleid);
 
-	zbx_vector_ptr_create(&children);
-
 	switch (rule->type)
 	{
 		case ZBX_SERVICE_STATUS_RULE_TYPE_N_GE:
@@ -1658,45 +1725,53 @@ int	service_get_rule_status(const zbx_service_t *service, const zbx_service_rule
 			goto out;
 	}
 
-	service_get_children_by_status(service, status_limit, &children, &total_weight, &total_num);
+	/* count children with status greater or equal to the limit */
+	for (i = MAX(status_limit, ZBX_SERVICE_STATUS_OK); i < TRIGGER_SEVERITY_COUNT; i++)
+	{
+		num += children->num[ZBX_SERVICE_STATUS_INDEX(i)];
+		weight += children->weight[ZBX_SERVICE_STATUS_INDEX(i)];
+	}
 
 	switch (rule->type)
 	{
 		case ZBX_SERVICE_STATUS_RULE_TYPE_N_GE:
-			if (children.values_num < rule->limit_value)
+			if (num < rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_NP_GE:
-			if (0 == total_num || children.values_num * 100 / total_num < rule->limit_value)
+			if (0 == children->total_num || num * 100 / children->total_num < rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_N_L:
-			if (total_num - children.values_num >= rule->limit_value)
+			if (children->total_num - num >= rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_NP_L:
-			if (0 == total_num || (total_num - children.values_num) * 100 / total_num >= rule->limit_value)
+			if (0 == children->total_num ||
+					(children->total_num - num) * 100 / children->total_num >= rule->limit_value)
+			{
 				goto out;
+			}
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_W_GE:
-			weight = services_get_weight(&children);
 			if (weight < rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_WP_GE:
-			weight = services_get_weight(&children);
-			if (0 == total_weight || weight * 100 / total_weight < rule->limit_value)
+			if (0 == children->total_weight || weight * 100 / children->total_weight < rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_W_L:
-			weight = services_get_weight(&children);
-			if (total_weight - weight >= rule->limit_value)
+			if (children->total_weight - weight >= rule->limit_value)
 				goto out;
 			break;
 		case ZBX_SERVICE_STATUS_RULE_TYPE_WP_L:
-			weight = services_get_weight(&children);
-			if (0 == total_weight || (total_weight - weight) * 100 / total_weight >= rule->limit_value)
+			if (0 == children->total_weight ||
+					(children->total_weight - weight) * 100 / children->total_weight >=
+					rule->limit_value)
+			{
 				goto out;
+			}
 			break;
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
@@ -1705,13 +1780,64 @@ int	service_get_rule_status(const zbx_service_t *service, const zbx_service_rule
 
 	status = rule->new_status;
 out:
-	zbx_vector_ptr_destroy(&children);
-
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() status:%d", __func__, status);
 
 	return status;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get service status according to the specified rule                *
+ *                                                                            *
+ * Parameters: service - [IN] the service                                     *
+ *             rule    - [IN] the service status rule                         *
+ *                                                                            *
+ *  Return value: The service status.                                         *
+ *                                                                            *
+ ******************************************************************************/
+int	service_get_rule_status(const zbx_service_t *service, const zbx_service_rule_t *rule)
+{
+	zbx_service_children_status_t	children;
+
+	service_get_children_status(service, &children);
+
+	return service_calculate_rule_status(service, rule, &children);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get children with status greater or equal to the specified        *
+ *                                                                            *
+ * Parameters: service      - [IN] the service                                *
+ *             status       - [IN] the target status                          *
+ *             children     - [OUT] the children having the required status   *
+ *             total_weight - [OUT] the weight of all not ignored children    *
+ *             total_num    - [OUT] the number of all not ignored children    *
+ *                                                                            *
+ ******************************************************************************/
+static void	service_get_children_by_status(const zbx_service_t *service, int status, zbx_vector_ptr_t *children,
+		int *total_weight, int *total_num)
+{
+	int	i, child_status;
+
+	*total_num = 0;
+	*total_weight = 0;
+
+	for (i = 0; i < service->children.values_num; i++)
+	{
+		zbx_service_t	*child = (zbx_service_t *)service->children.values[i];
+
+		if (SUCCEED != service_get_status(child, &child_status))
+			continue;
+
+		(*total_weight) += child->weight;
+		(*total_num)++;
+
+		if (child_status >= status)
+			zbx_vector_ptr_append(children, child);
+	}
+}
+
 typedef struct
 {
 	zbx_service_t	*service;
@@ -1923,30 +2049,90 @@ void	service_get_rootcause_eventids(const zbx_service_t *parent, zbx_vector_uint
 
 /******************************************************************************
  *                                                                            *
- * Purpose: updates service and its parents statuses                          *
+ * Purpose: queues parent services for status recalculation                   *
+ *                                                                            *
+ * Parameters: queue   - [IN/OUT] the recalculation queue                     *
+ *             service - [IN] the service with updated status                 *
+ *             ts      - [IN] the update timestamp                            *
+ *             flags   - [IN] the update flags                                *
+ *                                                                            *
+ * Comments: Parent service is queued once per update batch, the timestamp    *
+ *           and flags of multiple updated children are merged.               *
+ *                                                                            *
+ ******************************************************************************/
+static void	service_queue_parents(zbx_service_recalc_queue_t *queue, const zbx_service_t *service,
+		const zbx_timespec_t *ts, int flags)
+{
+	int	i;
+
+	for (i = 0; i < service->parents.values_num; i++)
+	{
+		zbx_service_recalc_t	recalc_local, *recalc;
+		zbx_binary_heap_elem_t	elem;
+
+		recalc_local.service = (zbx_service_t *)service->parents.values[i];
+
+		if (NULL != (recalc = (zbx_service_recalc_t *)zbx_hashset_search(&queue->services, &recalc_local)))
+		{
+			if (SUCCEED == recalc->processed)
+			{
+				/* parent has lower level than child only with cyclic links */
+				THIS_SHOULD_NEVER_HAPPEN;
+				continue;
+			}
+
+			if (0 > zbx_timespec_compare(&recalc->ts, ts))
+				recalc->ts = *ts;
+
+			recalc->flags |= flags;
+			continue;
+		}
+
+		recalc_local.ts = *ts;
+		recalc_local.flags = flags;
+		recalc_local.processed = FAIL;
+
+		recalc = (zbx_service_recalc_t *)zbx_hashset_insert(&queue->services, &recalc_local,
+				sizeof(recalc_local));
+
+		elem.key = recalc->service->serviceid;
+		elem.data = (const void *)recalc;
+		zbx_binary_heap_insert(&queue->queue, &elem);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates service status and queues its parents for recalculation   *
  *                                                                            *
- * Parameters: service    - [IN] the service to update                        *
- *             ts         - [IN] the update timestamp                         *
- *             alarms     - [OUT] the alarms update queue                     *
+ * Parameters: itservice       - [IN] the service to update                   *
+ *             ts              - [IN] the update timestamp                    *
+ *             alarms          - [OUT] the alarms update queue                *
+ *             service_updates - [OUT] the service status updates             *
+ *             flags           - [IN] the update flags                        *
+ *             queue           - [IN/OUT] the recalculation queue             *
  *                                                                            *
  * Comments: This function recalculates service status according to the       *
  *           algorithm and status of the children services. If the status     *
  *           has been changed, an alarm is generated and parent services      *
- *           (up until the root service) are updated too.                     *
+ *           are queued for recalculation too.                                *
  *                                                                            *
  ******************************************************************************/
 static void	its_itservice_update_status(zbx_service_t *itservice, const zbx_timespec_t *ts,
-		zbx_vector_ptr_t *alarms, zbx_hashset_t *service_updates, int flags)
+		zbx_vector_ptr_t *alarms, zbx_hashset_t *service_updates, int flags, zbx_service_recalc_queue_t *queue)
 {
-	int	status, rule_status, i;
+	int				status, rule_status, i;
+	zbx_service_children_status_t	children;
 
-	status = service_get_main_status(itservice);
+	service_get_children_status(itservice, &children);
+
+	status = service_calculate_main_status(itservice, &children);
 
 	for (i = 0; i < itservice->status_rules.values_num; i++)
 	{
 		zbx_service_rule_t	*rule = (zbx_service_rule_t *)itservice->status_rules.values[i];
 
-		if (status < (rule_status = service_get_rule_status(itservice, rule)))
+		if (status < (rule_status = service_calculate_rule_status(itservice, rule, &children)))
 			status = rule_status;
 	}
 
@@ -1957,21 +2143,40 @@ static void	its_itservice_update_status(zbx_service_t *itservice, const zbx_time
 		update = update_service(service_updates, itservice, status, ts);
 		update->alarm = its_updates_append(alarms, itservice->serviceid, status, ts->sec);
 
-		/* update parent services */
-		for (i = 0; i < itservice->parents.values_num; i++)
-		{
-			its_itservice_update_status((zbx_service_t *)itservice->parents.values[i], ts, alarms,
-					service_updates, flags);
-		}
+		service_queue_parents(queue, itservice, ts, flags);
 	}
-	else if (0 != (ZBX_FLAG_SERVICE_RECALCULATE & flags))
+	else if (0 != ((ZBX_FLAG_SERVICE_RECALCULATE | ZBX_FLAG_SERVICE_PROPAGATE) & flags))
+		service_queue_parents(queue, itservice, ts, flags);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: recalculates queued services starting with the lowest level       *
+ *                                                                            *
+ * Parameters: queue           - [IN/OUT] the recalculation queue             *
+ *             alarms          - [OUT] the alarms update queue                *
+ *             service_updates - [OUT] the service status updates             *
+ *                                                                            *
+ * Comments: Services are recalculated after all their updated children, so   *
+ *           each service is recalculated once even if many of its children   *
+ *           or descendants were updated.                                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	services_recalculate_queued(zbx_service_recalc_queue_t *queue, zbx_vector_ptr_t *alarms,
+		zbx_hashset_t *service_updates)
+{
+	zbx_binary_heap_elem_t	*elem;
+	zbx_service_recalc_t	*recalc;
+
+	while (FAIL == zbx_binary_heap_empty(&queue->queue))
 	{
-		/* update parent services */
-		for (i = 0; i < itservice->parents.values_num; i++)
-		{
-			its_itservice_update_status((zbx_service_t *)itservice->parents.values[i], ts, alarms,
-					service_updates, flags);
-		}
+		elem = zbx_binary_heap_find_min(&queue->queue);
+		recalc = (zbx_service_recalc_t *)elem->data;
+		zbx_binary_heap_remove_min(&queue->queue);
+
+		recalc->processed = SUCCEED;
+		its_itservice_update_status(recalc->service, &recalc->ts, alarms, service_updates, recalc->flags,
+				queue);
 	}
 }
 
@@ -2476,13 +2681,27 @@ static int	service_update_compare_func(const void *d1, const void *d2)
 	return 0;
 }
 
+static int	service_recalc_compare_func(const void *d1, const void *d2)
+{
+	const zbx_binary_heap_elem_t	*e1 = (const zbx_binary_heap_elem_t *)d1;
+	const zbx_binary_heap_elem_t	*e2 = (const zbx_binary_heap_elem_t *)d2;
+	const zbx_service_recalc_t	*r1 = (const zbx_service_recalc_t *)e1->data;
+	const zbx_service_recalc_t	*r2 = (const zbx_service_recalc_t *)e2->data;
+
+	ZBX_RETURN_IF_NOT_EQUAL(r1->service->level, r2->service->level);
+	ZBX_RETURN_IF_NOT_EQUAL(e1->key, e2->key);
+
+	return 0;
+}
+
 static void	db_update_services(zbx_service_manager_t *manager)
 {
 	zbx_hashset_iter_t	iter;
 	zbx_services_diff_t	*service_diff;
 	zbx_vector_ptr_t	alarms, service_problems_new;
-	zbx_vector_uint64_t	service_problemids;
-	zbx_hashset_t		service_updates;
+	zbx_vector_uint64_t		service_problemids;
+	zbx_hashset_t			service_updates;
+	zbx_service_recalc_queue_t	queue;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -2490,6 +2709,8 @@ static void	db_update_services(zbx_service_manager_t *manager)
 	zbx_vector_ptr_create(&service_problems_new);
 	zbx_vector_uint64_create(&service_problemids);
 	zbx_hashset_create(&service_updates, 100, service_update_hash_func, service_update_compare_func);
+	zbx_hashset_create(&queue.services, 100, ZBX_DEFAULT_PTR_HASH_FUNC, ZBX_DEFAULT_PTR_COMPARE_FUNC);
+	zbx_binary_heap_create(&queue.queue, service_recalc_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY);
 
 	zbx_hashset_iter_reset(&manager->service_diffs, &iter);
 	while (NULL != (service_diff = (zbx_services_diff_t *)zbx_hashset_iter_next(&iter)))
@@ -2587,24 +2808,14 @@ static void	db_update_services(zbx_service_manager_t *manager)
 			update = update_service(&service_updates, service, status, &ts);
 			update->alarm = its_updates_append(&alarms, service->serviceid, service->status, ts.sec);
 
-			/* update parent services */
-			for (i = 0; i < service->parents.values_num; i++)
-			{
-				its_itservice_update_status((zbx_service_t *)service->parents.values[i], &ts, &alarms,
-						&service_updates, service_diff->flags);
-			}
-		}
-		else if (0 != (ZBX_FLAG_SERVICE_RECALCULATE & service_diff->flags))
-		{
-			/* update parent services */
-			for (i = 0; i < service->parents.values_num; i++)
-			{
-				its_itservice_update_status((zbx_service_t *)service->parents.values[i], &ts, &alarms,
-						&service_updates, service_diff->flags);
-			}
+			service_queue_parents(&queue, service, &ts, service_diff->flags);
 		}
+		else if (0 != ((ZBX_FLAG_SERVICE_RECALCULATE | ZBX_FLAG_SERVICE_PROPAGATE) & service_diff->flags))
+			service_queue_parents(&queue, service, &ts, service_diff->flags);
 	}
 
+	services_recalculate_queued(&queue, &alarms, &service_updates);
+
 	do
 	{
 		DBbegin();
@@ -2615,6 +2826,8 @@ static void	db_update_services(zbx_service_manager_t *manager)
 	}
 	while (ZBX_DB_DOWN == DBcommit());
 
+	zbx_binary_heap_destroy(&queue.queue);
+	zbx_hashset_destroy(&queue.services);
 	zbx_vector_uint64_destroy(&service_problemids);
 	zbx_vector_ptr_destroy(&service_problems_new);
 	zbx_hashset_destroy(&service_updates);
@@ -3194,7 +3407,20 @@ static void	service_manager_trace(zbx_service_manager_t *service_manager)
 	dump_actions(&service_manager->actions);
 }
 
-static void	recalculate_services(zbx_service_manager_t *service_manager)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: recalculates service statuses after configuration changes         *
+ *                                                                            *
+ * Parameters: service_manager      - [IN] the service manager                *
+ *             problem_tags_updated - [IN] the number of updated service      *
+ *                                         problem tags                       *
+ *                                                                            *
+ * Comments: Open problems are matched to services again only if service      *
+ *           problem tags were changed, otherwise service problems are kept   *
+ *           and only the statuses are propagated up the service tree.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	recalculate_services(zbx_service_manager_t *service_manager, int problem_tags_updated)
 {
 	zbx_hashset_iter_t	iter;
 	zbx_event_t		**event;
@@ -3202,16 +3428,21 @@ static void	recalculate_services(zbx_service_manager_t *service_manager)
 	zbx_services_diff_t	services_diff_local, *services_diff;
 	int			flags;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	flags = ZBX_FLAG_SERVICE_RECALCULATE;
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() problem_tags_updated:%d", __func__, problem_tags_updated);
 
-	zbx_hashset_iter_reset(&service_manager->problem_events, &iter);
-	while (NULL != (event = (zbx_event_t **)zbx_hashset_iter_next(&iter)))
+	if (0 != problem_tags_updated)
 	{
-		match_event_to_service_problem_tags(*event, &service_manager->service_problem_tags_index,
-				&service_manager->service_diffs, flags);
+		flags = ZBX_FLAG_SERVICE_RECALCULATE;
+
+		zbx_hashset_iter_reset(&service_manager->problem_events, &iter);
+		while (NULL != (event = (zbx_event_t **)zbx_hashset_iter_next(&iter)))
+		{
+			match_event_to_service_problem_tags(*event, &service_manager->service_problem_tags_index,
+					&service_manager->service_diffs, flags);
+		}
 	}
+	else
+		flags = ZBX_FLAG_SERVICE_PROPAGATE;
 
 	zbx_hashset_iter_reset(&service_manager->services, &iter);
 	while (NULL != (service = (zbx_service_t *)zbx_hashset_iter_next(&iter)))
@@ -3342,7 +3573,7 @@ ZBX_THREAD_ENTRY(service_manager_thread, args)
 
 		if (CONFIG_SERVICEMAN_SYNC_FREQUENCY < time_now - time_flush || 1 == service_cache_reload_requested)
 		{
-			int	updated = 0, revision;
+			int	updated = 0, problem_tags_updated = 0, revision;
 
 			service_cache_reload_requested = 0;
 
@@ -3353,7 +3584,7 @@ ZBX_THREAD_ENTRY(service_manager_thread, args)
 				sync_services(&service_manager, &updated, revision);
 				sync_service_rules(&service_manager, &updated, revision);
 				sync_service_tags(&service_manager, revision);
-				sync_service_problem_tags(&service_manager, &updated, revision);
+				sync_service_problem_tags(&service_manager, &problem_tags_updated, revision);
 				sync_services_links(&service_manager, &updated, revision);
 				sync_actions(&service_manager, revision);
 				sync_action_conditions(&service_manager, revision);
@@ -3369,9 +3600,12 @@ ZBX_THREAD_ENTRY(service_manager_thread, args)
 			while (ZBX_DB_DOWN == DBcommit());
 
 			if (0 != updated)
-				recalculate_services(&service_manager);
+				services_update_levels(&service_manager.services);
+
+			if (0 != updated || 0 != problem_tags_updated)
+				recalculate_services(&service_manager, problem_tags_updated);
 
-			service_update_num += updated;
+			service_update_num += updated + problem_tags_updated;
 			time_flush = time_now;
 			time_now = zbx_time();
 		}
@@ -87,6 +87,9 @@ typedef struct
 	int			weight;
 	int			propagation_rule;
 	int			propagation_value;
+
+	/* the longest path to leaf service, children are recalculated before parents by level */
+	int			level;
 }
 zbx_service_t;
 
@@ -24,6 +24,7 @@
 #	include <libxml/parser.h>
 #	include <libxml/tree.h>
 #	include <libxml/xpath.h>
+#	include <libxml/xmlreader.h>
 #endif
 
 #include "memalloc.h"
@@ -104,6 +105,9 @@ static zbx_vmware_t	*vmware = NULL;
 
 #define ZBX_VMWARE_COUNTERS_INIT_SIZE	500
 
+#define ZBX_VMWARE_PARALLEL_REQUESTS	8
+#define ZBX_VMWARE_MULTI_WAIT_TIMEOUT	1000	/* milliseconds */
+
 #define ZBX_VPXD_STATS_MAXQUERYMETRICS				64
 #define ZBX_MAXQUERYMETRICS_UNLIMITED				1000
 #define ZBX_VCENTER_LESS_THAN_6_5_0_STATS_MAXQUERYMETRICS	64
@@ -573,6 +577,7 @@ static int	zbx_xml_try_read_value(const char *data, size_t len, const char *xpat
 static int	zbx_xml_doc_read_num(xmlDoc *xdoc, const char *xpath, int *num);
 static char	*zbx_xml_node_read_value(xmlDoc *doc, xmlNode *node, const char *xpath);
 static char	*zbx_xml_doc_read_value(xmlDoc *xdoc, const char *xpath);
+static void	libxml_handle_error(void *user_data, xmlErrorPtr err);
 
 static size_t	curl_write_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
@@ -663,29 +668,25 @@ static int	zbx_http_post(CURL *easyhandle, const char *request, ZBX_HTTPPAGE **r
 
 	return SUCCEED;
 }
+
 /******************************************************************************
  *                                                                            *
- * Purpose: unification of vmware web service call with SOAP error validation *
+ * Purpose: parses vmware web service response with SOAP error validation     *
  *                                                                            *
  * Parameters: fn_parent  - [IN] the parent function name for Log records     *
- *             easyhandle - [IN] the CURL handle                              *
- *             request    - [IN] the http request                             *
+ *             resp       - [IN] the http response                            *
  *             xdoc       - [OUT] the xml document response (optional)        *
  *             error      - [OUT] the error message in the case of failure    *
  *                                (optional)                                  *
  *                                                                            *
- * Return value: SUCCEED - the SOAP request was completed successfully        *
- *               FAIL    - the SOAP request has failed                        *
+ * Return value: SUCCEED - the SOAP response does not contain errors          *
+ *               FAIL    - the SOAP response contains fault or is invalid     *
  ******************************************************************************/
-static int	zbx_soap_post(const char *fn_parent, CURL *easyhandle, const char *request, xmlDoc **xdoc, char **error)
+static int	zbx_soap_parse(const char *fn_parent, const ZBX_HTTPPAGE *resp, xmlDoc **xdoc, char **error)
 {
-	xmlDoc		*doc;
-	ZBX_HTTPPAGE	*resp;
-	int		ret = SUCCEED;
-	char		*val = NULL;
-
-	if (SUCCEED != zbx_http_post(easyhandle, request, &resp, error))
-		return FAIL;
+	xmlDoc	*doc;
+	int	ret = SUCCEED;
+	char	*val = NULL;
 
 	if (NULL != fn_parent)
 		zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP response: %s", fn_parent, resp->data);
@@ -714,6 +715,30 @@ static int	zbx_soap_post(const char *fn_parent, CURL *easyhandle, const char *re
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: unification of vmware web service call with SOAP error validation *
+ *                                                                            *
+ * Parameters: fn_parent  - [IN] the parent function name for Log records     *
+ *             easyhandle - [IN] the CURL handle                              *
+ *             request    - [IN] the http request                             *
+ *             xdoc       - [OUT] the xml document response (optional)        *
+ *             error      - [OUT] the error message in the case of failure    *
+ *                                (optional)                                  *
+ *                                                                            *
+ * Return value: SUCCEED - the SOAP request was completed successfully        *
+ *               FAIL    - the SOAP request has failed                        *
+ ******************************************************************************/
+static int	zbx_soap_post(const char *fn_parent, CURL *easyhandle, const char *request, xmlDoc **xdoc, char **error)
+{
+	ZBX_HTTPPAGE	*resp;
+
+	if (SUCCEED != zbx_http_post(easyhandle, request, &resp, error))
+		return FAIL;
+
+	return zbx_soap_parse(fn_parent, resp, xdoc, error);
+}
+
 /******************************************************************************
  *                                                                            *
  * performance counter hashset support functions                              *
@@ -2643,22 +2668,18 @@ clean:
 
 /******************************************************************************
  *                                                                            *
- * Purpose: gets the virtual machine data                                     *
+ * Purpose: composes the virtual machine data request                         *
  *                                                                            *
  * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
  *             vmid         - [IN] the virtual machine id                     *
  *             propmap      - [IN] the xpaths of the properties to read       *
  *             props_num    - [IN] the number of properties to read           *
- *             xdoc         - [OUT] a reference to output xml document        *
- *             error        - [OUT] the error message in the case of failure  *
  *                                                                            *
- * Return value: SUCCEED - the operation has completed successfully           *
- *               FAIL    - the operation has failed                           *
+ * Return value: The allocated SOAP request.                                  *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyhandle, const char *vmid,
-		const zbx_vmware_propmap_t *propmap, int props_num, xmlDoc **xdoc, char **error)
+static char	*vmware_service_get_vm_data_request(const zbx_vmware_service_t *service, const char *vmid,
+		const zbx_vmware_propmap_t *propmap, int props_num)
 {
 #	define ZBX_POST_VMWARE_VM_STATUS_EX 						\
 		ZBX_POST_VSPHERE_HEADER							\
@@ -2704,10 +2725,9 @@ static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyh
 		"</ns0:RetrievePropertiesEx>"						\
 		ZBX_POST_VSPHERE_FOOTER
 
-	char	tmp[MAX_STRING_LEN + ZBX_VMWARE_VMPROPS_NUM * 100], props[MAX_STRING_LEN], *vmid_esc;
-	int	i, ret = FAIL;
+	char	props[MAX_STRING_LEN], *vmid_esc, *request;
+	int	i;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() vmid:'%s'", __func__, vmid);
 	props[0] = '\0';
 
 	for (i = 0; i < props_num; i++)
@@ -2719,21 +2739,344 @@ static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyh
 
 	vmid_esc = xml_escape_dyn(vmid);
 
-	zbx_snprintf(tmp, sizeof(tmp), ZBX_POST_VMWARE_VM_STATUS_EX,
+	request = zbx_dsprintf(NULL, ZBX_POST_VMWARE_VM_STATUS_EX,
 			vmware_service_objects[service->type].property_collector, props, vmid_esc);
 
 	zbx_free(vmid_esc);
 
-	if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, xdoc, error))
-		goto out;
+	return request;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the virtual machine data                                     *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             easyhandle   - [IN] the CURL handle                            *
+ *             vmid         - [IN] the virtual machine id                     *
+ *             propmap      - [IN] the xpaths of the properties to read       *
+ *             props_num    - [IN] the number of properties to read           *
+ *             xdoc         - [OUT] a reference to output xml document        *
+ *             error        - [OUT] the error message in the case of failure  *
+ *                                                                            *
+ * Return value: SUCCEED - the operation has completed successfully           *
+ *               FAIL    - the operation has failed                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_get_vm_data(zbx_vmware_service_t *service, CURL *easyhandle, const char *vmid,
+		const zbx_vmware_propmap_t *propmap, int props_num, xmlDoc **xdoc, char **error)
+{
+	char	*request;
+	int	ret;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() vmid:'%s'", __func__, vmid);
+
+	request = vmware_service_get_vm_data_request(service, vmid, propmap, props_num);
+	ret = zbx_soap_post(__func__, easyhandle, request, xdoc, error);
+	zbx_free(request);
 
-	ret = SUCCEED;
-out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
 }
 
+#if LIBCURL_VERSION_NUM >= 0x071c00
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates a copy of authenticated CURL handle for parallel requests *
+ *                                                                            *
+ * Parameters: easyhandle   - [IN] the authenticated CURL handle              *
+ *             page         - [IN] the output buffer of the new handle        *
+ *             error        - [OUT] the error message in the case of failure  *
+ *                                                                            *
+ * Return value: The new CURL handle or NULL if an error was detected.        *
+ *                                                                            *
+ * Comments: Duplicated handles do not inherit cookies, so the session cookie *
+ *           is copied explicitly to reuse the same vmware session.           *
+ *                                                                            *
+ ******************************************************************************/
+static CURL	*vmware_curl_duphandle(CURL *easyhandle, ZBX_HTTPPAGE *page, char **error)
+{
+	CURL			*handle;
+	CURLoption		opt;
+	CURLcode		err;
+	struct curl_slist	*cookies = NULL, *cookie;
+
+	if (NULL == (handle = curl_easy_duphandle(easyhandle)))
+	{
+		*error = zbx_strdup(*error, "Cannot duplicate cURL handle.");
+		return NULL;
+	}
+
+	if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_COOKIELIST, &cookies)))
+	{
+		*error = zbx_dsprintf(*error, "Cannot get cURL cookies: %s.", curl_easy_strerror(err));
+		goto fail;
+	}
+
+	for (cookie = cookies; NULL != cookie; cookie = cookie->next)
+	{
+		if (CURLE_OK != (err = curl_easy_setopt(handle, opt = CURLOPT_COOKIELIST, cookie->data)))
+			break;
+	}
+
+	curl_slist_free_all(cookies);
+
+	if (CURLE_OK != err ||
+			CURLE_OK != (err = curl_easy_setopt(handle, opt = CURLOPT_WRITEDATA, page)) ||
+			CURLE_OK != (err = curl_easy_setopt(handle, opt = CURLOPT_PRIVATE, page)))
+	{
+		*error = zbx_dsprintf(*error, "Cannot set cURL option %d: %s.", (int)opt, curl_easy_strerror(err));
+		goto fail;
+	}
+
+	return handle;
+fail:
+	curl_easy_cleanup(handle);
+
+	return NULL;
+}
+
+typedef struct
+{
+	CURL		*easyhandle;
+	ZBX_HTTPPAGE	page;
+	char		*request;
+	int		index;
+}
+zbx_vmware_request_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: starts the next pending virtual machine data request              *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             multihandle  - [IN] the CURL multi handle                      *
+ *             request      - [IN] the request slot                           *
+ *             vmids        - [IN] the virtual machine ids                    *
+ *             index        - [IN] the index of virtual machine to request    *
+ *                                                                            *
+ * Return value: SUCCEED - the request was started                            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_vm_request_start(const zbx_vmware_service_t *service, CURLM *multihandle,
+		zbx_vmware_request_t *request, const zbx_vector_str_t *vmids, int index)
+{
+	CURLcode	err;
+	CURLMcode	merr;
+
+	zbx_free(request->request);
+	request->request = vmware_service_get_vm_data_request(service, vmids->values[index], vm_propmap,
+			ZBX_VMWARE_VMPROPS_NUM);
+	request->index = index;
+	request->page.offset = 0;
+
+	if (CURLE_OK != (err = curl_easy_setopt(request->easyhandle, CURLOPT_POSTFIELDS, request->request)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: cannot set cURL option %d: %s.",
+				vmids->values[index], (int)CURLOPT_POSTFIELDS, curl_easy_strerror(err));
+		return FAIL;
+	}
+
+	if (CURLM_OK != (merr = curl_multi_add_handle(multihandle, request->easyhandle)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: %s.", vmids->values[index],
+				curl_multi_strerror(merr));
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets data of multiple virtual machines                            *
+ *                                                                            *
+ * Parameters: service      - [IN] the vmware service                         *
+ *             easyhandle   - [IN] the authenticated CURL handle              *
+ *             vmids        - [IN] the virtual machine ids                    *
+ *             docs         - [OUT] the xml documents with virtual machine    *
+ *                                  data, NULL for virtual machines which     *
+ *                                  data could not be retrieved               *
+ *                                                                            *
+ * Comments: Up to ZBX_VMWARE_PARALLEL_REQUESTS requests are performed        *
+ *           concurrently over the same vmware session, so refreshing a       *
+ *           hypervisor is not bound by the round-trip time of every virtual  *
+ *           machine request. Requests that could not be started or were     *
+ *           still in progress when cURL multi interface failed are retried   *
+ *           one by one.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_service_get_vms_data(zbx_vmware_service_t *service, CURL *easyhandle,
+		const zbx_vector_str_t *vmids, xmlDoc **docs)
+{
+	char			*error = NULL;
+	int			i, next = 0;
+	zbx_vector_uint64_t	retry;
+#if LIBCURL_VERSION_NUM >= 0x071c00
+	CURLM			*multihandle = NULL;
+	zbx_vmware_request_t	requests[ZBX_VMWARE_PARALLEL_REQUESTS];
+	int			requests_num = 0, running;
+#endif
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() vms:%d", __func__, vmids->values_num);
+
+	memset(docs, 0, sizeof(xmlDoc *) * (size_t)vmids->values_num);
+	zbx_vector_uint64_create(&retry);
+#if LIBCURL_VERSION_NUM >= 0x071c00
+	if (1 >= vmids->values_num)
+		goto sequential;
+
+	if (NULL == (multihandle = curl_multi_init()))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s(): cannot initialize cURL multi session", __func__);
+		goto sequential;
+	}
+
+	for (i = 0; i < ZBX_VMWARE_PARALLEL_REQUESTS && i < vmids->values_num; i++)
+	{
+		zbx_vmware_request_t	*request = &requests[requests_num];
+
+		memset(request, 0, sizeof(zbx_vmware_request_t));
+
+		if (NULL == (request->easyhandle = vmware_curl_duphandle(easyhandle, &request->page, &error)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "%s(): %s", __func__, error);
+			zbx_free(error);
+			break;
+		}
+
+		requests_num++;
+
+		if (SUCCEED != vmware_vm_request_start(service, multihandle, request, vmids, next++))
+		{
+			zbx_vector_uint64_append(&retry, (zbx_uint64_t)request->index);
+			request->index = -1;
+		}
+	}
+
+	if (0 == requests_num)
+		goto clean;
+
+	do
+	{
+		CURLMsg		*msg;
+		CURLMcode	code;
+		int		fds, msgnum;
+
+		if (CURLM_OK != (code = curl_multi_perform(multihandle, &running)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "%s(): cannot perform on cURL multi handle: %s", __func__,
+					curl_multi_strerror(code));
+			break;
+		}
+
+		while (NULL != (msg = curl_multi_info_read(multihandle, &msgnum)))
+		{
+			zbx_vmware_request_t	*request = NULL;
+
+			if (CURLMSG_DONE != msg->msg)
+				continue;
+
+			for (i = 0; i < requests_num; i++)
+			{
+				if (requests[i].easyhandle == msg->easy_handle)
+				{
+					request = &requests[i];
+					break;
+				}
+			}
+
+			if (NULL == request)
+				continue;
+
+			curl_multi_remove_handle(multihandle, request->easyhandle);
+
+			if (CURLE_OK != msg->data.result)
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: %s.",
+						vmids->values[request->index], curl_easy_strerror(msg->data.result));
+			}
+			else if (SUCCEED != zbx_soap_parse(__func__, &request->page, &docs[request->index], &error))
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: %s.",
+						vmids->values[request->index], ZBX_NULL2EMPTY_STR(error));
+				zbx_free(error);
+
+				zbx_xml_free_doc(docs[request->index]);
+				docs[request->index] = NULL;
+			}
+
+			request->index = -1;
+
+			while (next < vmids->values_num)
+			{
+				if (SUCCEED == vmware_vm_request_start(service, multihandle, request, vmids, next++))
+				{
+					running++;
+					break;
+				}
+
+				zbx_vector_uint64_append(&retry, (zbx_uint64_t)request->index);
+				request->index = -1;
+			}
+		}
+
+		if (0 == running)
+			break;
+
+		if (CURLM_OK != (code = curl_multi_wait(multihandle, NULL, 0, ZBX_VMWARE_MULTI_WAIT_TIMEOUT, &fds)))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "%s(): cannot wait on cURL multi handle: %s", __func__,
+					curl_multi_strerror(code));
+			break;
+		}
+	}
+	while (1);
+clean:
+	for (i = 0; i < requests_num; i++)
+	{
+		/* requests still in progress are left after cURL multi interface failure */
+		if (-1 != requests[i].index)
+		{
+			curl_multi_remove_handle(multihandle, requests[i].easyhandle);
+			zbx_vector_uint64_append(&retry, (zbx_uint64_t)requests[i].index);
+		}
+
+		curl_easy_cleanup(requests[i].easyhandle);
+		zbx_free(requests[i].request);
+		zbx_free(requests[i].page.data);
+	}
+
+	curl_multi_cleanup(multihandle);
+sequential:
+#endif
+	/* virtual machines that were not requested in parallel are requested one by one */
+	for (i = next; i < vmids->values_num; i++)
+		zbx_vector_uint64_append(&retry, (zbx_uint64_t)i);
+
+	for (i = 0; i < retry.values_num; i++)
+	{
+		int	index = (int)retry.values[i];
+
+		if (SUCCEED != vmware_service_get_vm_data(service, easyhandle, vmids->values[index], vm_propmap,
+				ZBX_VMWARE_VMPROPS_NUM, &docs[index], &error))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: %s.", vmids->values[index],
+					ZBX_NULL2EMPTY_STR(error));
+			zbx_free(error);
+
+			zbx_xml_free_doc(docs[index]);
+			docs[index] = NULL;
+		}
+	}
+
+	zbx_vector_uint64_destroy(&retry);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: convert vm folder id to chain of folder names divided by '/'      *
@@ -2795,20 +3138,18 @@ static int	vmware_service_get_vm_folder(xmlDoc *xdoc, char **vm_folder)
  * Purpose: create virtual machine object                                     *
  *                                                                            *
  * Parameters: service      - [IN] the vmware service                         *
- *             easyhandle   - [IN] the CURL handle                            *
  *             id           - [IN] the virtual machine id                     *
- *             error        - [OUT] the error message in the case of failure  *
+ *             details      - [IN] the xml document with virtual machine data *
  *                                                                            *
  * Return value: The created virtual machine object or NULL if an error was   *
  *               detected.                                                    *
  *                                                                            *
  ******************************************************************************/
-static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,  CURL *easyhandle,
-		const char *id, char **error)
+static zbx_vmware_vm_t	*vmware_service_create_vm(const zbx_vmware_service_t *service, const char *id,
+		xmlDoc *details)
 {
 	zbx_vmware_vm_t	*vm;
 	char		*value;
-	xmlDoc		*details = NULL;
 	const char	*uuid_xpath[3] = {NULL, ZBX_XPATH_VM_UUID(), ZBX_XPATH_VM_INSTANCE_UUID()};
 	int		ret = FAIL;
 
@@ -2820,12 +3161,6 @@ static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,
 	zbx_vector_ptr_create(&vm->devs);
 	zbx_vector_ptr_create(&vm->file_systems);
 
-	if (SUCCEED != vmware_service_get_vm_data(service, easyhandle, id, vm_propmap,
-			ZBX_VMWARE_VMPROPS_NUM, &details, error))
-	{
-		goto out;
-	}
-
 	if (NULL == (value = zbx_xml_doc_read_value(details, uuid_xpath[service->type])))
 		goto out;
 
@@ -2848,8 +3183,6 @@ static zbx_vmware_vm_t	*vmware_service_create_vm(zbx_vmware_service_t *service,
 
 	ret = SUCCEED;
 out:
-	zbx_xml_free_doc(details);
-
 	if (SUCCEED != ret)
 	{
 		vmware_vm_free(vm);
@@ -3753,7 +4086,7 @@ static int	vmware_service_init_hv(zbx_vmware_service_t *service, CURL *easyhandl
 		zbx_vector_vmware_datastore_t *dss, zbx_vmware_hv_t *hv, char **error)
 {
 	char			*value;
-	xmlDoc			*details = NULL, *multipath_data = NULL;
+	xmlDoc			*details = NULL, *multipath_data = NULL, **vms_details = NULL;
 	zbx_vector_str_t	datastores, vms;
 	int			i, j, ret = FAIL;
 
@@ -3867,24 +4200,28 @@ static int	vmware_service_init_hv(zbx_vmware_service_t *service, CURL *easyhandl
 	zbx_xml_read_values(details, ZBX_XPATH_HV_VMS(), &vms);
 	zbx_vector_ptr_reserve(&hv->vms, vms.values_num + hv->vms.values_alloc);
 
+	if (0 != vms.values_num)
+	{
+		vms_details = (xmlDoc **)zbx_malloc(NULL, sizeof(xmlDoc *) * (size_t)vms.values_num);
+		vmware_service_get_vms_data(service, easyhandle, &vms, vms_details);
+	}
+
 	for (i = 0; i < vms.values_num; i++)
 	{
 		zbx_vmware_vm_t	*vm;
 
-		if (NULL != (vm = vmware_service_create_vm(service, easyhandle, vms.values[i], error)))
-		{
+		if (NULL == vms_details[i])
+			continue;
+
+		if (NULL != (vm = vmware_service_create_vm(service, vms.values[i], vms_details[i])))
 			zbx_vector_ptr_append(&hv->vms, vm);
-		}
-		else if (NULL != *error)
-		{
-			zabbix_log(LOG_LEVEL_DEBUG, "Unable initialize vm %s: %s.", vms.values[i], *error);
-			zbx_free(*error);
-		}
 
+		zbx_xml_free_doc(vms_details[i]);
 	}
 
 	ret = SUCCEED;
 out:
+	zbx_free(vms_details);
 	zbx_xml_free_doc(multipath_data);
 	zbx_xml_free_doc(details);
 
@@ -5808,147 +6145,280 @@ out:
 			zbx_result_string(ret), (zbx_fs_size_t)page.alloc, msg);
 }
 
+/* QueryPerf response element depths: Envelope/Body/QueryPerfResponse/returnval/value/id/counterId */
+#define ZBX_VMWARE_PERF_DEPTH_FAULT		2
+#define ZBX_VMWARE_PERF_DEPTH_ENTITY		3
+#define ZBX_VMWARE_PERF_DEPTH_SERIES		4
+#define ZBX_VMWARE_PERF_DEPTH_SAMPLE		5
+#define ZBX_VMWARE_PERF_DEPTH_ID		6
+
+/* performance counter series being parsed */
+typedef struct
+{
+	char	*counter;
+	char	*instance;
+	char	*value;
+
+	/* the last value which is not -1 (unavailable) */
+	char	*value_valid;
+}
+zbx_vmware_perf_series_t;
+
+static void	vmware_perf_series_clean(zbx_vmware_perf_series_t *series)
+{
+	zbx_free(series->counter);
+	zbx_free(series->instance);
+	zbx_free(series->value);
+	zbx_free(series->value_valid);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads text content of the current xml reader node                 *
+ *                                                                            *
+ * Parameters: reader - [IN] the xml reader                                   *
+ *             value  - [OUT] the node content                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	vmware_xml_reader_read_string(xmlTextReaderPtr reader, char **value)
+{
+	xmlChar	*content;
+
+	zbx_free(*value);
+
+	if (NULL != (content = xmlTextReaderReadString(reader)))
+	{
+		*value = zbx_strdup(NULL, (const char *)content);
+		xmlFree(content);
+	}
+}
+
 /******************************************************************************
  *                                                                            *
- * Purpose: updates vmware performance statistics data                        *
+ * Purpose: adds parsed performance counter series value to entity data       *
  *                                                                            *
- * Parameters: perfdata  - [OUT] the performance counter values               *
- *             xdoc      - [IN] the XML document containing performance       *
- *                              counter values for all entities               *
- *             node      - [IN] the XML node containing performance counter   *
- *                              values for the specified entity               *
+ * Parameters: data   - [IN/OUT] the performance entity data                  *
+ *             series - [IN] the parsed performance counter series            *
  *                                                                            *
- * Return value: SUCCEED - the performance entity data was parsed             *
- *               FAIL    - the perofmance entity data did not contain valid   *
- *                         values                                             *
+ * Return value: SUCCEED - the series contained valid value                   *
+ *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
-static int	vmware_service_process_perf_entity_data(zbx_vmware_perf_data_t *perfdata, xmlDoc *xdoc, xmlNode *node)
+static int	vmware_perf_data_add_series(zbx_vmware_perf_data_t *data, zbx_vmware_perf_series_t *series)
 {
-	xmlXPathContext		*xpathCtx;
-	xmlXPathObject		*xpathObj;
-	xmlNodeSetPtr		nodeset;
-	char			*instance, *counter, *value;
-	int			i, values = 0, ret = FAIL;
-	zbx_vector_ptr_t	*pervalues = &perfdata->values;
 	zbx_vmware_perf_value_t	*perfvalue;
+	const char		*value;
+	int			ret = FAIL;
+
+	if (NULL == (value = series->value_valid))
+		value = series->value;
+
+	if (NULL == value || NULL == series->counter)
+		return FAIL;
+
+	perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
+
+	ZBX_STR2UINT64(perfvalue->counterid, series->counter);
+	perfvalue->instance = (NULL != series->instance ? series->instance : zbx_strdup(NULL, ""));
+	series->instance = NULL;
+
+	if (0 == strcmp(value, "-1") || SUCCEED != is_uint64(value, &perfvalue->value))
+	{
+		perfvalue->value = ZBX_MAX_UINT64;
+		zabbix_log(LOG_LEVEL_DEBUG, "PerfCounter inaccessible. type:%s object id:%s "
+				"counter id:" ZBX_FS_UI64 " instance:%s value:%s", data->type,
+				data->id, perfvalue->counterid, perfvalue->instance, value);
+	}
+	else
+		ret = SUCCEED;
+
+	zbx_vector_ptr_append(&data->values, perfvalue);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses vmware performance statistics data                         *
+ *                                                                            *
+ * Parameters: perfdata - [OUT] performance entity data                       *
+ *             resp     - [IN] the QueryPerf response                         *
+ *             error    - [OUT] the error message in the case of failure      *
+ *                                                                            *
+ * Return value: SUCCEED - the response was parsed successfully               *
+ *               FAIL    - the response contains SOAP fault or is invalid     *
+ *                                                                            *
+ * Comments: The response is parsed with a streaming xml reader instead of    *
+ *           building the document tree and evaluating xpath for every        *
+ *           counter value, as QueryPerf responses can be very large.         *
+ *           Only entities having at least one accessible counter value are   *
+ *           added to performance data.                                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	vmware_service_parse_perf_data(zbx_vector_ptr_t *perfdata, const ZBX_HTTPPAGE *resp, char **error)
+{
+	xmlTextReaderPtr		reader;
+	zbx_vmware_perf_data_t		*data = NULL;
+	zbx_vmware_perf_series_t	series;
+	zbx_vector_ptr_t		entities;
+	int				rc, depth, entity_ret = FAIL, fault = 0, ret = FAIL, values = 0;
+	const char			*name;
+	char				**value;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
-	xpathCtx = xmlXPathNewContext(xdoc);
-	xpathCtx->node = node;
+	memset(&series, 0, sizeof(series));
+	zbx_vector_ptr_create(&entities);
 
-	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"*[local-name()='value']", xpathCtx)))
+	if (NULL == resp->data)
+	{
+		*error = zbx_strdup(*error, "Received response has no valid XML data.");
 		goto out;
+	}
 
-	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
-		goto out;
+	xmlSetStructuredErrorFunc(NULL, &libxml_handle_error);
 
-	nodeset = xpathObj->nodesetval;
-	zbx_vector_ptr_reserve(pervalues, nodeset->nodeNr + pervalues->values_alloc);
+	if (NULL == (reader = xmlReaderForMemory(resp->data, (int)resp->offset, ZBX_VM_NONAME_XML, NULL,
+			ZBX_XML_PARSE_OPTS)))
+	{
+		*error = zbx_strdup(*error, "Received response has no valid XML data.");
+		xmlSetStructuredErrorFunc(NULL, NULL);
+		goto out;
+	}
 
-	for (i = 0; i < nodeset->nodeNr; i++)
+	while (1 == (rc = xmlTextReaderRead(reader)))
 	{
-		if (NULL == (value = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i],
-				"*[local-name()='value'][text() != '-1'][last()]")))
-		{
-			value = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='value'][last()]");
-		}
+		depth = xmlTextReaderDepth(reader);
 
-		instance = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
-				"/*[local-name()='instance']");
-		counter = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
-				"/*[local-name()='counterId']");
+		if (NULL == (name = (const char *)xmlTextReaderConstLocalName(reader)))
+			continue;
 
-		if (NULL != value && NULL != counter)
+		if (XML_READER_TYPE_END_ELEMENT == xmlTextReaderNodeType(reader))
 		{
-			perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
-
-			ZBX_STR2UINT64(perfvalue->counterid, counter);
-			perfvalue->instance = (NULL != instance ? instance : zbx_strdup(NULL, ""));
+			if (NULL == data)
+				continue;
 
-			if (0 == strcmp(value, "-1") || SUCCEED != is_uint64(value, &perfvalue->value))
+			if (ZBX_VMWARE_PERF_DEPTH_SERIES == depth && 0 == strcmp(name, "value"))
 			{
-				perfvalue->value = ZBX_MAX_UINT64;
-				zabbix_log(LOG_LEVEL_DEBUG, "PerfCounter inaccessible. type:%s object id:%s "
-						"counter id:" ZBX_FS_UI64 " instance:%s value:%s", perfdata->type,
-						perfdata->id, perfvalue->counterid, perfvalue->instance, value);
+				if (SUCCEED == vmware_perf_data_add_series(data, &series))
+				{
+					entity_ret = SUCCEED;
+					values++;
+				}
+
+				vmware_perf_series_clean(&series);
 			}
-			else if (FAIL == ret)
-				ret = SUCCEED;
+			else if (ZBX_VMWARE_PERF_DEPTH_ENTITY == depth)
+			{
+				if (SUCCEED == entity_ret && NULL != data->type && NULL != data->id)
+					zbx_vector_ptr_append(&entities, data);
+				else
+					vmware_free_perfdata(data);
 
-			zbx_vector_ptr_append(pervalues, perfvalue);
+				data = NULL;
+			}
 
-			instance = NULL;
-			values++;
+			continue;
 		}
 
-		zbx_free(counter);
-		zbx_free(instance);
-		zbx_free(value);
-	}
+		if (XML_READER_TYPE_ELEMENT != xmlTextReaderNodeType(reader) || 0 != xmlTextReaderIsEmptyElement(reader))
+			continue;
 
-out:
-	xmlXPathFreeObject(xpathObj);
-	xmlXPathFreeContext(xpathCtx);
+		if (0 != fault)
+		{
+			if (0 == strcmp(name, "faultstring"))
+				vmware_xml_reader_read_string(reader, error);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() values:%d", __func__, values);
+			continue;
+		}
 
-	return ret;
-}
+		switch (depth)
+		{
+			case ZBX_VMWARE_PERF_DEPTH_FAULT:
+				if (0 == strcmp(name, "Fault"))
+					fault = 1;
+				continue;
+			case ZBX_VMWARE_PERF_DEPTH_ENTITY:
+				if (NULL != data)
+					vmware_free_perfdata(data);
+
+				data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+				data->id = NULL;
+				data->type = NULL;
+				data->error = NULL;
+				zbx_vector_ptr_create(&data->values);
+				entity_ret = FAIL;
+				continue;
+			case ZBX_VMWARE_PERF_DEPTH_SERIES:
+				if (NULL != data && 0 == strcmp(name, "entity"))
+				{
+					xmlChar	*type;
 
-/******************************************************************************
- *                                                                            *
- * Purpose: updates vmware performance statistics data                        *
- *                                                                            *
- * Parameters: perfdata - [OUT] performance entity data                       *
- *             xdoc     - [IN] the performance data xml document              *
- *                                                                            *
- ******************************************************************************/
-static void	vmware_service_parse_perf_data(zbx_vector_ptr_t *perfdata, xmlDoc *xdoc)
-{
-	xmlXPathContext	*xpathCtx;
-	xmlXPathObject	*xpathObj;
-	xmlNodeSetPtr	nodeset;
-	int		i;
+					if (NULL != (type = xmlTextReaderGetAttribute(reader, (const xmlChar *)"type")))
+					{
+						data->type = zbx_strdup(data->type, (const char *)type);
+						xmlFree(type);
+					}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+					vmware_xml_reader_read_string(reader, &data->id);
+				}
+				continue;
+			case ZBX_VMWARE_PERF_DEPTH_SAMPLE:
+				if (NULL == data || 0 != strcmp(name, "value"))
+					continue;
 
-	xpathCtx = xmlXPathNewContext(xdoc);
+				vmware_xml_reader_read_string(reader, &series.value);
 
-	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"/*/*/*/*", xpathCtx)))
-		goto clean;
+				if (NULL != series.value && 0 != strcmp(series.value, "-1"))
+					series.value_valid = zbx_strdup(series.value_valid, series.value);
+				continue;
+			case ZBX_VMWARE_PERF_DEPTH_ID:
+				if (NULL == data)
+					continue;
+
+				if (0 == strcmp(name, "counterId"))
+					value = &series.counter;
+				else if (0 == strcmp(name, "instance"))
+					value = &series.instance;
+				else
+					continue;
+
+				vmware_xml_reader_read_string(reader, value);
+				continue;
+		}
+	}
 
-	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
-		goto clean;
+	xmlFreeTextReader(reader);
+	xmlSetStructuredErrorFunc(NULL, NULL);
 
-	nodeset = xpathObj->nodesetval;
-	zbx_vector_ptr_reserve(perfdata, nodeset->nodeNr + perfdata->values_alloc);
+	if (0 != rc)
+	{
+		*error = zbx_strdup(*error, "Received response has no valid XML data.");
+		goto out;
+	}
 
-	for (i = 0; i < nodeset->nodeNr; i++)
+	if (0 != fault)
 	{
-		zbx_vmware_perf_data_t 	*data;
-		int			ret = FAIL;
+		if (NULL == *error)
+			*error = zbx_strdup(*error, "Received SOAP fault without fault string.");
+		goto out;
+	}
 
-		data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+	zbx_vector_ptr_append_array(perfdata, entities.values, entities.values_num);
+	zbx_vector_ptr_clear(&entities);
 
-		data->id = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']");
-		data->type = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']/@type");
-		data->error = NULL;
-		zbx_vector_ptr_create(&data->values);
+	ret = SUCCEED;
+out:
+	if (NULL != data)
+		vmware_free_perfdata(data);
 
-		if (NULL != data->type && NULL != data->id)
-			ret = vmware_service_process_perf_entity_data(data, xdoc, nodeset->nodeTab[i]);
+	vmware_perf_series_clean(&series);
+	zbx_vector_ptr_clear_ext(&entities, (zbx_mem_free_func_t)vmware_free_perfdata);
+	zbx_vector_ptr_destroy(&entities);
 
-		if (SUCCEED == ret)
-			zbx_vector_ptr_append(perfdata, data);
-		else
-			vmware_free_perfdata(data);
-	}
-clean:
-	xmlXPathFreeObject(xpathObj);
-	xmlXPathFreeContext(xpathCtx);
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s values:%d", __func__, zbx_result_string(ret), values);
+
+	return ret;
 }
 
 /******************************************************************************
@@ -6051,9 +6521,9 @@ static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service,
 {
 	char				*tmp = NULL, *error = NULL;
 	size_t				tmp_alloc = 0, tmp_offset;
-	int				i, j, start_counter = 0;
+	int				i, j, start_counter = 0, ret;
 	zbx_vmware_perf_entity_t	*entity;
-	xmlDoc				*doc = NULL;
+	ZBX_HTTPPAGE			*resp;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() counters_max:%d", __func__, counters_max);
 
@@ -6133,15 +6603,21 @@ static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service,
 		}
 
 		zbx_vmware_unlock();
-		zbx_xml_free_doc(doc);
-		doc = NULL;
 
 		zbx_strcpy_alloc(&tmp, &tmp_alloc, &tmp_offset, "</ns0:QueryPerf>");
 		zbx_strcpy_alloc(&tmp, &tmp_alloc, &tmp_offset, ZBX_POST_VSPHERE_FOOTER);
 
 		zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP request: %s", __func__, tmp);
 
-		if (SUCCEED != zbx_soap_post(__func__, easyhandle, tmp, &doc, &error))
+		if (SUCCEED == (ret = zbx_http_post(easyhandle, tmp, &resp, &error)))
+		{
+			zabbix_log(LOG_LEVEL_TRACE, "%s() SOAP response: %s", __func__, resp->data);
+
+			/* parse performance data into local memory */
+			ret = vmware_service_parse_perf_data(perfdata, resp, &error);
+		}
+
+		if (SUCCEED != ret)
 		{
 			for (j = i + 1; j < entities->values_num; j++)
 			{
@@ -6153,15 +6629,11 @@ static void	vmware_service_retrieve_perf_counters(zbx_vmware_service_t *service,
 			break;
 		}
 
-		/* parse performance data into local memory */
-		vmware_service_parse_perf_data(perfdata, doc);
-
 		while (entities->values_num > i + 1)
 			zbx_vector_ptr_remove_noorder(entities, entities->values_num - 1);
 	}
 
 	zbx_free(tmp);
-	zbx_xml_free_doc(doc);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -7111,3 +7583,7 @@ out:
 }
 
 #endif
+
+#ifdef HAVE_TESTS
+#	include "../../../tests/zabbix_server/vmware/vmware_perf_bench_test.c"
+#endif
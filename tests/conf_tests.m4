@@ -28,6 +28,7 @@ AC_DEFUN([CONF_TESTS],[
 		tests/libs/zbxcommshigh/Makefile
 		tests/libs/zbxconf/Makefile
 		tests/libs/zbxdbcache/Makefile
+		tests/libs/zbxdb/Makefile
 		tests/libs/zbxdbhigh/Makefile
 		tests/libs/zbxeval/Makefile
 		tests/libs/zbxhistory/Makefile
@@ -40,9 +41,12 @@ AC_DEFUN([CONF_TESTS],[
 		tests/libs/zbxsysinfo/linux/Makefile
 		tests/libs/zbxtrends/Makefile
 		tests/zabbix_server/Makefile
+		tests/zabbix_server/escalator/Makefile
+		tests/zabbix_server/events/Makefile
 		tests/zabbix_server/preprocessor/Makefile
 		tests/zabbix_server/service/Makefile
 		tests/zabbix_server/trapper/Makefile
+		tests/zabbix_server/vmware/Makefile
 		tests/mocks/Makefile
 		tests/mocks/configcache/Makefile
 		tests/mocks/valuecache/Makefile
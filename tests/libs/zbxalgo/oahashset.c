@@ -0,0 +1,242 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "zbxalgo.h"
+
+#define	INSERT_REMOVE	1
+#define	CHURN		2
+
+typedef struct
+{
+	zbx_uint64_t	id;
+	zbx_uint64_t	value;
+}
+zbx_oahashset_test_rec_t;
+
+static void	mock_read_values(const char *path, zbx_vector_uint64_t *values)
+{
+	zbx_mock_error_t	err;
+	zbx_mock_handle_t	hdata, hvalue;
+
+	hdata = zbx_mock_get_parameter_handle(path);
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hdata, &hvalue))))
+	{
+		zbx_uint64_t	value;
+
+		if (ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hvalue, &value)))
+			fail_msg("Cannot read vector member: %s", zbx_mock_error_string(err));
+
+		zbx_vector_uint64_append(values, value);
+	}
+}
+
+static int	oahashset_count(zbx_oahashset_t *hs)
+{
+	zbx_oahashset_iter_t	iter;
+	int			num = 0;
+
+	zbx_oahashset_iter_reset(hs, &iter);
+
+	while (NULL != zbx_oahashset_iter_next(&iter))
+		num++;
+
+	return num;
+}
+
+static void	test_oahashset_insert_remove(void)
+{
+	zbx_vector_uint64_t		values, removed;
+	zbx_vector_ptr_t		recs;
+	zbx_oahashset_t			hs;
+	zbx_oahashset_test_rec_t	rec, *prec;
+	int				i;
+
+	zbx_vector_uint64_create(&values);
+	zbx_vector_uint64_create(&removed);
+	zbx_vector_ptr_create(&recs);
+
+	mock_read_values("in.values", &values);
+	mock_read_values("in.remove", &removed);
+
+	zbx_oahashset_create(&hs, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0; i < values.values_num; i++)
+	{
+		rec.id = values.values[i];
+		rec.value = i;
+		prec = (zbx_oahashset_test_rec_t *)zbx_oahashset_insert(&hs, &rec, sizeof(rec));
+		zbx_vector_ptr_append(&recs, prec);
+	}
+
+	zbx_vector_uint64_sort(&values, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_uniq(&values, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	zbx_mock_assert_int_eq("number of entries", values.values_num, hs.num_data);
+	zbx_mock_assert_int_eq("number of iterated entries", values.values_num, oahashset_count(&hs));
+
+	/* entries must stay in place when slots are resized */
+	for (i = 0; i < recs.values_num; i++)
+	{
+		prec = (zbx_oahashset_test_rec_t *)recs.values[i];
+		zbx_mock_assert_ptr_eq("entry", prec, zbx_oahashset_search(&hs, prec));
+	}
+
+	for (i = 0; i < removed.values_num; i++)
+	{
+		rec.id = removed.values[i];
+
+		if (0 == i % 2)
+		{
+			zbx_oahashset_remove(&hs, &rec);
+		}
+		else if (NULL != (prec = (zbx_oahashset_test_rec_t *)zbx_oahashset_search(&hs, &rec)))
+		{
+			zbx_oahashset_remove_direct(&hs, prec);
+		}
+	}
+
+	zbx_vector_uint64_sort(&removed, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_uniq(&removed, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0; i < values.values_num; i++)
+	{
+		rec.id = values.values[i];
+		prec = (zbx_oahashset_test_rec_t *)zbx_oahashset_search(&hs, &rec);
+
+		if (FAIL == zbx_vector_uint64_bsearch(&removed, values.values[i], ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+		{
+			if (NULL == prec)
+				fail_msg("cannot find entry " ZBX_FS_UI64, values.values[i]);
+		}
+		else if (NULL != prec)
+			fail_msg("found removed entry " ZBX_FS_UI64, values.values[i]);
+	}
+
+	zbx_mock_assert_int_eq("number of entries after removal", hs.num_data, oahashset_count(&hs));
+
+	zbx_oahashset_clear(&hs);
+	zbx_mock_assert_int_eq("number of entries after clear", 0, oahashset_count(&hs));
+
+	zbx_oahashset_destroy(&hs);
+
+	zbx_vector_ptr_destroy(&recs);
+	zbx_vector_uint64_destroy(&removed);
+	zbx_vector_uint64_destroy(&values);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: run random inserts/removals on both open addressing and chained   *
+ *          hashsets and compare the results                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	test_oahashset_churn(void)
+{
+	zbx_oahashset_t			hs;
+	zbx_hashset_t			ref;
+	zbx_oahashset_iter_t		iter;
+	zbx_oahashset_test_rec_t	rec = {0}, *prec;
+	zbx_uint64_t			range, iterations, i, seed = 1;
+
+	range = zbx_mock_get_parameter_uint64("in.range");
+	iterations = zbx_mock_get_parameter_uint64("in.iterations");
+
+	zbx_oahashset_create(&hs, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ref, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0; i < iterations; i++)
+	{
+		/* deterministic linear congruential generator to keep the test reproducible */
+		seed = seed * __UINT64_C(6364136223846793005) + __UINT64_C(1442695040888963407);
+		rec.id = (seed >> 33) % range;
+
+		switch ((seed >> 16) % 3)
+		{
+			case 0:
+				zbx_oahashset_insert(&hs, &rec, sizeof(rec));
+				zbx_hashset_insert(&ref, &rec, sizeof(rec));
+				break;
+			case 1:
+				zbx_oahashset_remove(&hs, &rec);
+				zbx_hashset_remove(&ref, &rec);
+				break;
+			default:
+				prec = (zbx_oahashset_test_rec_t *)zbx_oahashset_search(&hs, &rec);
+
+				if ((NULL == prec) != (NULL == zbx_hashset_search(&ref, &rec)))
+					fail_msg("search result mismatch for " ZBX_FS_UI64, rec.id);
+		}
+
+		zbx_mock_assert_int_eq("number of entries", ref.num_data, hs.num_data);
+	}
+
+	/* remove half of entries through iterator */
+	zbx_oahashset_iter_reset(&hs, &iter);
+
+	while (NULL != (prec = (zbx_oahashset_test_rec_t *)zbx_oahashset_iter_next(&iter)))
+	{
+		if (0 == prec->id % 2)
+		{
+			zbx_hashset_remove(&ref, prec);
+			zbx_oahashset_iter_remove(&iter);
+		}
+		else if (NULL == zbx_hashset_search(&ref, prec))
+			fail_msg("unexpected entry " ZBX_FS_UI64, prec->id);
+	}
+
+	zbx_mock_assert_int_eq("number of entries after iteration", ref.num_data, hs.num_data);
+	zbx_mock_assert_int_eq("number of iterated entries", ref.num_data, oahashset_count(&hs));
+
+	zbx_hashset_destroy(&ref);
+	zbx_oahashset_destroy(&hs);
+}
+
+static int	get_type(const char *str)
+{
+	if (0 == strcmp(str, "INSERT_REMOVE"))
+		return INSERT_REMOVE;
+	if (0 == strcmp(str, "CHURN"))
+		return CHURN;
+
+	fail_msg("unknown cmocka step type: %s", str);
+	return FAIL;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_UNUSED(state);
+
+	switch (get_type(zbx_mock_get_parameter_string("in.type")))
+	{
+		case INSERT_REMOVE:
+			test_oahashset_insert_remove();
+			break;
+		case CHURN:
+			test_oahashset_churn();
+			break;
+		default:
+			fail_msg("unknown cmocka step type: %s", zbx_mock_get_parameter_string("in.type"));
+	}
+}
@@ -0,0 +1,366 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+/******************************************************************************
+ *                                                                            *
+ * Microbenchmark comparing zbx_hashset_t (chained) with zbx_oahashset_t      *
+ * (open addressing) on the configuration cache item index by host and key    *
+ * (items_hk) workload: 24 byte entries with host identifier, pooled key and  *
+ * item pointer, hashed and compared the same way.                            *
+ *                                                                            *
+ * Build with 'make oahashset_bench' and run:                                 *
+ *                                                                            *
+ *     ./oahashset_bench [entries] [runs]                                     *
+ *                                                                            *
+ * The entries are spread over hosts having BENCH_HOST_ITEMS items each,      *
+ * with the same keys on every host. Searches use separately allocated key    *
+ * copies, so keys are compared by contents as in DCfind_item().              *
+ *                                                                            *
+ * For each implementation the best of runs is printed in nanoseconds per     *
+ * operation:                                                                 *
+ *     insert - inserting all entries into an empty hashset                   *
+ *     hit    - searching existing keys in random order                       *
+ *     dep    - searching existing keys where each key depends on the result  *
+ *              of the previous search (latency bound lookups)                *
+ *     miss   - searching keys that are not in the hashset                    *
+ *     iter   - iterating over all entries                                    *
+ * and the index size (slots and entry headers) in bytes per entry.           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "common.h"
+#include "zbxalgo.h"
+
+const char	title_message[] = "oahashset_bench";
+const char	*usage_message[] = {"[entries] [runs]", NULL};
+const char	*help_message[] = {NULL};
+const char	*progname = "oahashset_bench";
+const char	syslog_app_name[] = "oahashset_bench";
+
+unsigned char	program_type = 0;
+
+#define BENCH_SEARCH_ROUNDS	3
+#define BENCH_HOST_ITEMS	200
+
+/* same layout as ZBX_DC_ITEM_HK */
+typedef struct
+{
+	zbx_uint64_t	hostid;
+	const char	*key;
+	void		*item_ptr;
+}
+zbx_bench_rec_t;
+
+typedef struct
+{
+	double	insert;
+	double	hit;
+	double	dep;
+	double	miss;
+	double	iter;
+	double	index;
+}
+zbx_bench_result_t;
+
+typedef struct
+{
+	zbx_uint64_t	*hostids;
+	char		**keys;		/* pooled keys, shared by hosts */
+	char		**keys_search;	/* key copies used for searching */
+	zbx_uint64_t	*order;
+	int		num;
+}
+zbx_bench_data_t;
+
+static zbx_hash_t	bench_item_hk_hash(const void *data)
+{
+	const zbx_bench_rec_t	*rec = (const zbx_bench_rec_t *)data;
+	zbx_hash_t		hash;
+
+	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&rec->hostid);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(rec->key, strlen(rec->key), hash);
+
+	return hash;
+}
+
+static int	bench_item_hk_compare(const void *d1, const void *d2)
+{
+	const zbx_bench_rec_t	*rec1 = (const zbx_bench_rec_t *)d1;
+	const zbx_bench_rec_t	*rec2 = (const zbx_bench_rec_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(rec1->hostid, rec2->hostid);
+
+	return rec1->key == rec2->key ? 0 : strcmp(rec1->key, rec2->key);
+}
+
+static void	bench_result_min(zbx_bench_result_t *best, const zbx_bench_result_t *res, int first)
+{
+	if (0 != first || res->insert < best->insert)
+		best->insert = res->insert;
+	if (0 != first || res->hit < best->hit)
+		best->hit = res->hit;
+	if (0 != first || res->dep < best->dep)
+		best->dep = res->dep;
+	if (0 != first || res->miss < best->miss)
+		best->miss = res->miss;
+	if (0 != first || res->iter < best->iter)
+		best->iter = res->iter;
+
+	best->index = res->index;
+}
+
+static void	bench_set_rec(zbx_bench_rec_t *rec, const zbx_bench_data_t *data, char * const *keys, zbx_uint64_t i)
+{
+	rec->hostid = data->hostids[i];
+	rec->key = keys[i % BENCH_HOST_ITEMS];
+}
+
+static void	bench_chained(const zbx_bench_data_t *data, zbx_bench_result_t *res)
+{
+	zbx_hashset_t		hs;
+	zbx_hashset_iter_t	iter;
+	zbx_bench_rec_t		rec = {0}, *prec;
+	zbx_uint64_t		sum = 0;
+	double			start;
+	int			i, k, num = data->num;
+
+	zbx_hashset_create(&hs, 0, bench_item_hk_hash, bench_item_hk_compare);
+
+	start = zbx_time();
+	for (i = 0; i < num; i++)
+	{
+		bench_set_rec(&rec, data, data->keys, (zbx_uint64_t)i);
+		rec.item_ptr = &rec;
+		zbx_hashset_insert(&hs, &rec, sizeof(rec));
+	}
+	res->insert = (zbx_time() - start) / num;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, data->order[i]);
+			prec = (zbx_bench_rec_t *)zbx_hashset_search(&hs, &rec);
+			sum += prec->hostid;
+		}
+	}
+	res->hit = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, (data->order[i] + (sum & 1)) % (zbx_uint64_t)num);
+			prec = (zbx_bench_rec_t *)zbx_hashset_search(&hs, &rec);
+			sum += prec->hostid;
+		}
+	}
+	res->dep = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, data->order[i]);
+			rec.hostid++;
+			if (NULL != zbx_hashset_search(&hs, &rec))
+				sum++;
+		}
+	}
+	res->miss = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		zbx_hashset_iter_reset(&hs, &iter);
+		while (NULL != (prec = (zbx_bench_rec_t *)zbx_hashset_iter_next(&iter)))
+			sum += prec->hostid;
+	}
+	res->iter = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	res->index = (double)((size_t)hs.num_slots * sizeof(void *) + (size_t)num * ZBX_HASHSET_ENTRY_OFFSET) / num;
+
+	zbx_hashset_destroy(&hs);
+
+	/* keep the search results alive */
+	if (42 == sum)
+		printf("\n");
+}
+
+static void	bench_oa(const zbx_bench_data_t *data, zbx_bench_result_t *res)
+{
+	zbx_oahashset_t		hs;
+	zbx_oahashset_iter_t	iter;
+	zbx_bench_rec_t		rec = {0}, *prec;
+	zbx_uint64_t		sum = 0;
+	double			start;
+	int			i, k, num = data->num;
+
+	zbx_oahashset_create(&hs, 0, bench_item_hk_hash, bench_item_hk_compare);
+
+	start = zbx_time();
+	for (i = 0; i < num; i++)
+	{
+		bench_set_rec(&rec, data, data->keys, (zbx_uint64_t)i);
+		rec.item_ptr = &rec;
+		zbx_oahashset_insert(&hs, &rec, sizeof(rec));
+	}
+	res->insert = (zbx_time() - start) / num;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, data->order[i]);
+			prec = (zbx_bench_rec_t *)zbx_oahashset_search(&hs, &rec);
+			sum += prec->hostid;
+		}
+	}
+	res->hit = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, (data->order[i] + (sum & 1)) % (zbx_uint64_t)num);
+			prec = (zbx_bench_rec_t *)zbx_oahashset_search(&hs, &rec);
+			sum += prec->hostid;
+		}
+	}
+	res->dep = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			bench_set_rec(&rec, data, data->keys_search, data->order[i]);
+			rec.hostid++;
+			if (NULL != zbx_oahashset_search(&hs, &rec))
+				sum++;
+		}
+	}
+	res->miss = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	start = zbx_time();
+	for (k = 0; k < BENCH_SEARCH_ROUNDS; k++)
+	{
+		zbx_oahashset_iter_reset(&hs, &iter);
+		while (NULL != (prec = (zbx_bench_rec_t *)zbx_oahashset_iter_next(&iter)))
+			sum += prec->hostid;
+	}
+	res->iter = (zbx_time() - start) / num / BENCH_SEARCH_ROUNDS;
+
+	res->index = (double)((size_t)hs.num_slots * sizeof(zbx_oahashset_group_t) / ZBX_OAHASHSET_GROUP_WIDTH) / num;
+
+	zbx_oahashset_destroy(&hs);
+
+	if (42 == sum)
+		printf("\n");
+}
+
+static void	bench_print(const char *name, int num, const zbx_bench_result_t *res)
+{
+	printf("%-8d %-6s insert %6.1f  hit %6.1f  dep %6.1f  miss %6.1f  iter %6.1f ns/op  index %5.1f B/entry\n",
+			num, name, res->insert * 1e9, res->hit * 1e9, res->dep * 1e9, res->miss * 1e9,
+			res->iter * 1e9, res->index);
+}
+
+int	main(int argc, char **argv)
+{
+	int			runs = 6, i, k;
+	zbx_uint64_t		tmp;
+	char			buffer[MAX_STRING_LEN];
+	zbx_bench_data_t	data;
+	zbx_bench_result_t	res, best_chained, best_oa;
+
+	data.num = 100000;
+
+	if (1 < argc && 0 >= (data.num = atoi(argv[1])))
+	{
+		fprintf(stderr, "usage: %s %s\n", progname, usage_message[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (2 < argc && 0 >= (runs = atoi(argv[2])))
+	{
+		fprintf(stderr, "usage: %s %s\n", progname, usage_message[0]);
+		return EXIT_FAILURE;
+	}
+
+	data.hostids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)data.num);
+	data.order = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)data.num);
+	data.keys = (char **)zbx_malloc(NULL, sizeof(char *) * BENCH_HOST_ITEMS);
+	data.keys_search = (char **)zbx_malloc(NULL, sizeof(char *) * BENCH_HOST_ITEMS);
+
+	/* keys of the same template items, as on monitored hosts */
+	for (i = 0; i < BENCH_HOST_ITEMS; i++)
+	{
+		zbx_snprintf(buffer, sizeof(buffer), "net.if.in[\"interface%d\",bytes]", i);
+		data.keys[i] = zbx_strdup(NULL, buffer);
+		data.keys_search[i] = zbx_strdup(NULL, buffer);
+	}
+
+	/* host identifiers are sparse and increasing, search the entries in random order */
+	for (i = 0; i < data.num; i++)
+	{
+		data.hostids[i] = (zbx_uint64_t)(i / BENCH_HOST_ITEMS) * 7919 + 10000;
+		data.order[i] = (zbx_uint64_t)i;
+	}
+
+	srand(3);
+
+	for (i = data.num - 1; 0 < i; i--)
+	{
+		k = rand() % (i + 1);
+		tmp = data.order[i];
+		data.order[i] = data.order[k];
+		data.order[k] = tmp;
+	}
+
+	for (i = 0; i < runs; i++)
+	{
+		bench_chained(&data, &res);
+		bench_result_min(&best_chained, &res, 0 == i);
+
+		bench_oa(&data, &res);
+		bench_result_min(&best_oa, &res, 0 == i);
+	}
+
+	bench_print("chain", data.num, &best_chained);
+	bench_print("oa", data.num, &best_oa);
+
+	for (i = 0; i < BENCH_HOST_ITEMS; i++)
+	{
+		zbx_free(data.keys[i]);
+		zbx_free(data.keys_search[i]);
+	}
+
+	zbx_free(data.keys_search);
+	zbx_free(data.keys);
+	zbx_free(data.order);
+	zbx_free(data.hostids);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,307 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxdb.h"
+
+#if defined(HAVE_POSTGRESQL)
+
+#include "zbx_db_parallel_test.h"
+
+#define MOCK_CONNS_MAX		4
+#define MOCK_QUERIES_MAX	16
+
+/* libpq handles are opaque, the mock defines its own content for them */
+struct pg_result
+{
+	ExecStatusType	status;
+	int		rows;
+};
+
+struct pg_conn
+{
+	ConnStatusType	status;
+	PGresult	*pending;
+};
+
+static PGconn	mock_conns[MOCK_CONNS_MAX];
+static PGresult	mock_results[MOCK_QUERIES_MAX];
+static PGresult	mock_command_ok = {PGRES_COMMAND_OK, 0};
+
+static zbx_mock_handle_t	mock_queries[MOCK_QUERIES_MAX];
+static int			mock_queries_num;
+
+/* the mock database wraps result functions for all tests, results of parallel selects need the real ones */
+DB_ROW	__real_zbx_db_fetch(DB_RESULT result);
+void	__real_DBfree_result(DB_RESULT result);
+
+int	__wrap_PQsendQuery(PGconn *conn, const char *query)
+{
+	const char	*status;
+	int		i;
+
+	for (i = 0; i < mock_queries_num; i++)
+	{
+		if (0 == strcmp(zbx_mock_get_object_member_string(mock_queries[i], "sql"), query))
+			break;
+	}
+
+	if (i == mock_queries_num)
+		fail_msg("unexpected query \"%s\"", query);
+
+	if (CONNECTION_OK != conn->status)
+		return 0;
+
+	if (NULL != conn->pending)
+		fail_msg("query \"%s\" sent over busy connection", query);
+
+	status = zbx_mock_get_object_member_string(mock_queries[i], "status");
+
+	if (0 == strcmp(status, "PGRES_TUPLES_OK"))
+		mock_results[i].status = PGRES_TUPLES_OK;
+	else if (0 == strcmp(status, "PGRES_FATAL_ERROR"))
+		mock_results[i].status = PGRES_FATAL_ERROR;
+	else
+		fail_msg("unknown query status \"%s\"", status);
+
+	mock_results[i].rows = zbx_mock_get_object_member_int(mock_queries[i], "rows");
+
+	/* the connection is lost while the query is executed */
+	if (0 == strcmp(zbx_mock_get_object_member_string(mock_queries[i], "connection"), "CONNECTION_BAD"))
+		conn->status = CONNECTION_BAD;
+
+	conn->pending = &mock_results[i];
+
+	return 1;
+}
+
+PGresult	*__wrap_PQgetResult(PGconn *conn)
+{
+	PGresult	*result = conn->pending;
+
+	conn->pending = NULL;
+
+	return result;
+}
+
+PGresult	*__wrap_PQexec(PGconn *conn, const char *query)
+{
+	ZBX_UNUSED(conn);
+
+	/* parallel selects must never be repeated over the main connection */
+	if (0 != strcmp(query, "commit"))
+		fail_msg("unexpected statement \"%s\"", query);
+
+	return &mock_command_ok;
+}
+
+ExecStatusType	__wrap_PQresultStatus(const PGresult *res)
+{
+	return NULL == res ? PGRES_FATAL_ERROR : res->status;
+}
+
+int	__wrap_PQntuples(const PGresult *res)
+{
+	return res->rows;
+}
+
+int	__wrap_PQnfields(const PGresult *res)
+{
+	ZBX_UNUSED(res);
+
+	return 1;
+}
+
+int	__wrap_PQgetisnull(const PGresult *res, int tup_num, int field_num)
+{
+	ZBX_UNUSED(res);
+	ZBX_UNUSED(tup_num);
+	ZBX_UNUSED(field_num);
+
+	return 0;
+}
+
+char	*__wrap_PQgetvalue(const PGresult *res, int tup_num, int field_num)
+{
+	ZBX_UNUSED(res);
+	ZBX_UNUSED(tup_num);
+	ZBX_UNUSED(field_num);
+
+	return "1";
+}
+
+Oid	__wrap_PQftype(const PGresult *res, int field_num)
+{
+	ZBX_UNUSED(res);
+	ZBX_UNUSED(field_num);
+
+	return 25;	/* text */
+}
+
+ConnStatusType	__wrap_PQstatus(const PGconn *conn)
+{
+	return conn->status;
+}
+
+void	__wrap_PQclear(PGresult *res)
+{
+	ZBX_UNUSED(res);
+}
+
+void	__wrap_PQfinish(PGconn *conn)
+{
+	ZBX_UNUSED(conn);
+}
+
+char	*__wrap_PQerrorMessage(const PGconn *conn)
+{
+	ZBX_UNUSED(conn);
+
+	return "connection lost";
+}
+
+char	*__wrap_PQresStatus(ExecStatusType status)
+{
+	return PGRES_TUPLES_OK == status ? "PGRES_TUPLES_OK" : "PGRES_FATAL_ERROR";
+}
+
+char	*__wrap_PQresultErrorMessage(const PGresult *res)
+{
+	ZBX_UNUSED(res);
+
+	return "";
+}
+
+char	*__wrap_PQresultErrorField(const PGresult *res, int fieldcode)
+{
+	ZBX_UNUSED(res);
+	ZBX_UNUSED(fieldcode);
+
+	return NULL;
+}
+
+static int	mock_str_to_db_code(const char *str)
+{
+	if (0 == strcmp(str, "ZBX_DB_OK"))
+		return ZBX_DB_OK;
+
+	if (0 == strcmp(str, "ZBX_DB_FAIL"))
+		return ZBX_DB_FAIL;
+
+	if (0 == strcmp(str, "ZBX_DB_DOWN"))
+		return ZBX_DB_DOWN;
+
+	fail_msg("unknown database return code \"%s\"", str);
+
+	return ZBX_DB_FAIL;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	PGconn			*conns[MOCK_CONNS_MAX];
+	DB_RESULT		results[MOCK_QUERIES_MAX];
+	zbx_mock_handle_t	hqueries, hquery;
+	int			conns_num, i, rows, ret = ZBX_DB_OK;
+
+	ZBX_UNUSED(state);
+
+	memset(mock_results, 0, sizeof(mock_results));
+
+	if (MOCK_CONNS_MAX < (conns_num = (int)zbx_mock_get_parameter_uint64("in.connections")))
+		fail_msg("too many connections %d", conns_num);
+
+	for (i = 0; i < conns_num; i++)
+	{
+		mock_conns[i].status = CONNECTION_OK;
+		mock_conns[i].pending = NULL;
+		conns[i] = &mock_conns[i];
+	}
+
+	zbx_db_parallel_set_test(conns, conns_num);
+
+	hqueries = zbx_mock_get_parameter_handle("in.queries");
+
+	for (mock_queries_num = 0; ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hqueries, &hquery); mock_queries_num++)
+	{
+		if (MOCK_QUERIES_MAX == mock_queries_num)
+			fail_msg("too many queries");
+
+		mock_queries[mock_queries_num] = hquery;
+	}
+
+	/* send all queries before waiting, more queries than connections reuse busy connections */
+	for (i = 0; i < mock_queries_num; i++)
+	{
+		results[i] = zbx_db_parallel_select(zbx_mock_get_object_member_string(mock_queries[i], "sql"));
+
+		if ((DB_RESULT)ZBX_DB_DOWN == results[i])
+			ret = ZBX_DB_DOWN;
+		else if (NULL == results[i] && ZBX_DB_OK == ret)
+			ret = ZBX_DB_FAIL;
+	}
+
+	if (ZBX_DB_OK == ret)
+	{
+		ret = zbx_db_parallel_wait();
+
+		/* the error is returned only once */
+		zbx_mock_assert_int_eq("repeated wait", ZBX_DB_OK, zbx_db_parallel_wait());
+	}
+
+	for (i = 0; i < mock_queries_num; i++)
+	{
+		if (NULL == results[i] || (DB_RESULT)ZBX_DB_DOWN == results[i])
+			continue;
+
+		for (rows = 0; NULL != __real_zbx_db_fetch(results[i]); rows++)
+			;
+
+		/* failed queries must not be returned as empty result sets */
+		if (ZBX_DB_OK == ret)
+		{
+			zbx_mock_assert_int_eq("fetched rows", zbx_mock_get_object_member_int(mock_queries[i], "rows"),
+					rows);
+		}
+		else if (PGRES_TUPLES_OK != mock_results[i].status)
+			zbx_mock_assert_int_eq("fetched rows", 0, rows);
+
+		__real_DBfree_result(results[i]);
+	}
+
+	zbx_mock_assert_int_eq("return value", mock_str_to_db_code(zbx_mock_get_parameter_string("out.return")), ret);
+
+	zbx_db_parallel_close();
+	zbx_mock_assert_int_eq("parallel connections", 0, zbx_db_parallel_num());
+}
+
+#else
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_UNUSED(state);
+
+	skip();
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbx_db_parallel_test.h"
+
+void	zbx_db_parallel_set_test(PGconn **conns, int num)
+{
+	int	i;
+
+	parallel_conns = (zbx_db_parallel_conn_t *)zbx_malloc(NULL, sizeof(zbx_db_parallel_conn_t) * num);
+
+	for (i = 0; i < num; i++)
+	{
+		parallel_conns[i].conn = conns[i];
+		parallel_conns[i].result = NULL;
+	}
+
+	parallel_conns_num = num;
+	parallel_conns_next = 0;
+	parallel_error = ZBX_DB_OK;
+}
@@ -27,9 +27,10 @@ void	zbx_vc_set_mode(int mode)
 
 int	zbx_vc_get_cached_values(zbx_uint64_t itemid, unsigned char value_type, zbx_vector_history_record_t *values)
 {
-	zbx_vc_item_t	*item;
-	int		i;
-	zbx_vc_chunk_t	*chunk;
+	zbx_vc_item_t		*item;
+	int			i;
+	zbx_vc_chunk_t		*chunk;
+	const zbx_vc_chunk_t	*chunk_values;
 
 	if (NULL == (item = zbx_hashset_search(&vc_cache->items, &itemid)))
 		return FAIL;
@@ -39,8 +40,10 @@ int	zbx_vc_get_cached_values(zbx_uint64_t itemid, unsigned char value_type, zbx_
 
 	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
 	{
+		chunk_values = vch_chunk_get_values(item, chunk);
+
 		for (i = chunk->first_value; i <= chunk->last_value; i++)
-			vc_history_record_vector_append(values, value_type, &chunk->slots[i]);
+			vc_history_record_vector_append(values, value_type, &chunk_values->slots[i]);
 	}
 
 	return SUCCEED;
@@ -55,7 +58,7 @@ int	zbx_vc_precache_values(zbx_uint64_t itemid, int value_type, int seconds, int
 	/* add item to cache if necessary */
 	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
 	{
-		zbx_vc_item_t   new_item = {.itemid = itemid, .value_type = value_type};
+		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
 		item = zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(zbx_vc_item_t));
 	}
 
@@ -104,3 +107,68 @@ int	zbx_vc_get_cache_state(int *mode, zbx_uint64_t *hits, zbx_uint64_t *misses)
 
 	return SUCCEED;
 }
+
+int	zbx_vc_compress_values(int value_type, const zbx_history_record_t *values, int values_num,
+		zbx_history_record_t *decoded)
+{
+	unsigned char	*data;
+	size_t		size;
+
+	data = (unsigned char *)zbx_calloc(NULL, (size_t)values_num, ZBX_VC_MAX_COMPRESSED_VALUE_SIZE);
+	size = vc_compress_values(value_type, values, values_num, data);
+	vc_decompress_values(value_type, data, decoded, values_num);
+	zbx_free(data);
+
+	return (int)size;
+}
+
+int	zbx_vc_add_value_at_head(zbx_uint64_t itemid, int value_type, const zbx_history_record_t *value)
+{
+	zbx_vc_item_t	*item;
+	int		ret;
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+	{
+		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
+		item = zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(zbx_vc_item_t));
+	}
+
+	WRLOCK_CACHE;
+	ret = vch_item_add_value_at_head(item, value);
+	UNLOCK_CACHE;
+
+	return ret;
+}
+
+int	zbx_vc_get_compressed_chunks(zbx_uint64_t itemid)
+{
+	zbx_vc_item_t	*item;
+	zbx_vc_chunk_t	*chunk;
+	int		num = 0;
+
+	if (NULL == (item = zbx_hashset_search(&vc_cache->items, &itemid)))
+		return 0;
+
+	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
+	{
+		if (0 != chunk->compressed_size)
+			num++;
+	}
+
+	return num;
+}
+
+int	zbx_vc_get_prefetched_values(zbx_uint64_t *itemid, zbx_vector_history_record_t *values)
+{
+	int	i;
+
+	if (0 == vc_prefetch.itemid)
+		return FAIL;
+
+	*itemid = vc_prefetch.itemid;
+
+	for (i = 0; i < vc_prefetch.values.values_num; i++)
+		vc_history_record_vector_append(values, vc_prefetch.value_type, &vc_prefetch.values.values[i]);
+
+	return SUCCEED;
+}
@@ -26,5 +26,10 @@ int	zbx_vc_precache_values(zbx_uint64_t itemid, int value_type, int seconds, int
 int	zbx_vc_get_item_state(zbx_uint64_t itemid, int *status, int *active_range, int *values_total,
 		int *db_cached_from);
 int	zbx_vc_get_cache_state(int *mode, zbx_uint64_t *hits, zbx_uint64_t *misses);
+int	zbx_vc_compress_values(int value_type, const zbx_history_record_t *values, int values_num,
+		zbx_history_record_t *decoded);
+int	zbx_vc_add_value_at_head(zbx_uint64_t itemid, int value_type, const zbx_history_record_t *value);
+int	zbx_vc_get_compressed_chunks(zbx_uint64_t itemid);
+int	zbx_vc_get_prefetched_values(zbx_uint64_t *itemid, zbx_vector_history_record_t *values);
 
 #endif
@@ -0,0 +1,160 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "valuecache.h"
+#include "valuecache_test.h"
+#include "mocks/valuecache/valuecache_mock.h"
+
+extern zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE;
+extern int		CONFIG_VALUE_CACHE_COMPRESSION;
+
+#define VC_TEST_ITEMID	1
+
+static int	history_compare(const void *d1, const void *d2)
+{
+	return zbx_history_record_compare_asc_func((const zbx_history_record_t *)d1,
+			(const zbx_history_record_t *)d2);
+}
+
+static void	vc_test_codec(unsigned char value_type)
+{
+	zbx_vector_history_record_t	values;
+	zbx_history_record_t		*decoded;
+	int				i, size;
+
+	zbx_history_record_vector_create(&values);
+	zbx_vcmock_read_values(zbx_mock_get_parameter_handle("in.values"), value_type, &values);
+
+	decoded = (zbx_history_record_t *)zbx_malloc(NULL, sizeof(zbx_history_record_t) * (size_t)values.values_num);
+	size = zbx_vc_compress_values(value_type, values.values, values.values_num, decoded);
+
+	if (size > values.values_num * (int)sizeof(zbx_history_record_t))
+		fail_msg("compressed size %d exceeds uncompressed size", size);
+
+	for (i = 0; i < values.values_num; i++)
+	{
+		zbx_mock_assert_int_eq("timestamp seconds", values.values[i].timestamp.sec, decoded[i].timestamp.sec);
+		zbx_mock_assert_int_eq("timestamp nanoseconds", values.values[i].timestamp.ns, decoded[i].timestamp.ns);
+
+		/* floating point values must be restored bit by bit */
+		zbx_mock_assert_uint64_eq("value", values.values[i].value.ui64, decoded[i].value.ui64);
+	}
+
+	zbx_free(decoded);
+	zbx_history_record_vector_destroy(&values, value_type);
+}
+
+static void	vc_test_insert(unsigned char value_type)
+{
+	zbx_vector_history_record_t	expected, returned, inserted;
+	zbx_history_record_t		record;
+	zbx_timespec_t			start;
+	int				i, count, step;
+
+	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_parameter_string("in.start"), &start))
+		fail_msg("Cannot read start timestamp");
+
+	count = (int)zbx_mock_get_parameter_uint64("in.count");
+	step = (int)zbx_mock_get_parameter_uint64("in.step");
+
+	zbx_history_record_vector_create(&expected);
+	zbx_history_record_vector_create(&returned);
+	zbx_history_record_vector_create(&inserted);
+
+	/* fill the cache in order, full chunks are compressed when the next chunk is started */
+	for (i = 0; i < count; i++)
+	{
+		record.timestamp.sec = start.sec + i * step;
+		record.timestamp.ns = 0;
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			record.value.dbl = i * 0.5;
+		else
+			record.value.ui64 = (zbx_uint64_t)i * 3;
+
+		zbx_mock_assert_result_eq("adding value", SUCCEED,
+				zbx_vc_add_value_at_head(VC_TEST_ITEMID, value_type, &record));
+		zbx_vector_history_record_append_ptr(&expected, &record);
+	}
+
+	if (0 == zbx_vc_get_compressed_chunks(VC_TEST_ITEMID))
+		fail_msg("no chunks were compressed");
+
+	/* insert values older than the head value */
+	zbx_vcmock_read_values(zbx_mock_get_parameter_handle("in.insert"), value_type, &inserted);
+
+	for (i = 0; i < inserted.values_num; i++)
+	{
+		zbx_mock_assert_result_eq("inserting value", SUCCEED,
+				zbx_vc_add_value_at_head(VC_TEST_ITEMID, value_type, &inserted.values[i]));
+		zbx_vector_history_record_append_ptr(&expected, &inserted.values[i]);
+	}
+
+	zbx_vector_history_record_sort(&expected, history_compare);
+
+	zbx_vc_get_cached_values(VC_TEST_ITEMID, value_type, &returned);
+	zbx_vcmock_check_records("Cached values", value_type, &expected, &returned);
+
+	if (0 == zbx_vc_get_compressed_chunks(VC_TEST_ITEMID))
+		fail_msg("chunks were not compressed back after insertion");
+
+	zbx_vector_history_record_destroy(&inserted);
+	zbx_vector_history_record_destroy(&returned);
+	zbx_vector_history_record_destroy(&expected);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	int			err;
+	char			*error = NULL;
+	unsigned char		value_type;
+	zbx_mock_handle_t	handle;
+
+	ZBX_UNUSED(state);
+
+	CONFIG_VALUE_CACHE_SIZE = ZBX_MEBIBYTE;
+	CONFIG_VALUE_CACHE_COMPRESSION = 1;
+
+	err = zbx_locks_create(&error);
+	zbx_mock_assert_result_eq("Lock initialization failed", SUCCEED, err);
+
+	err = zbx_vc_init(&error);
+	zbx_mock_assert_result_eq("Value cache initialization failed", SUCCEED, err);
+
+	zbx_vc_enable();
+	zbx_vcmock_ds_init();
+
+	value_type = zbx_mock_str_to_value_type(zbx_mock_get_parameter_string("in.value_type"));
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("in.values", &handle))
+		vc_test_codec(value_type);
+	else
+		vc_test_insert(value_type);
+
+	zbx_vcmock_ds_destroy();
+
+	zbx_vc_reset();
+	zbx_vc_destroy();
+}
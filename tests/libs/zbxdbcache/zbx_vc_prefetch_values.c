@@ -0,0 +1,108 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "valuecache.h"
+#include "valuecache_test.h"
+#include "mocks/valuecache/valuecache_mock.h"
+
+extern zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE;
+
+void	zbx_mock_test_entry(void **state)
+{
+	char				*error = NULL;
+	int				err, seconds, count;
+	zbx_vector_history_record_t	expected, returned;
+	zbx_timespec_t			ts;
+	zbx_uint64_t			itemid, prefetched_itemid;
+	unsigned char			value_type;
+	zbx_mock_handle_t		handle, hitem;
+	zbx_mock_error_t		mock_err;
+
+	ZBX_UNUSED(state);
+
+	/* set small cache size to force smaller cache free request size (5% of cache size) */
+	CONFIG_VALUE_CACHE_SIZE = ZBX_KIBIBYTE;
+
+	err = zbx_locks_create(&error);
+	zbx_mock_assert_result_eq("Lock initialization failed", SUCCEED, err);
+
+	err = zbx_vc_init(&error);
+	zbx_mock_assert_result_eq("Value cache initialization failed", SUCCEED, err);
+
+	zbx_vc_enable();
+
+	zbx_vcmock_ds_init();
+	zbx_history_record_vector_create(&expected);
+	zbx_history_record_vector_create(&returned);
+
+	/* precache values */
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("in.precache", &handle))
+	{
+		while (ZBX_MOCK_END_OF_VECTOR != (mock_err = (zbx_mock_vector_element(handle, &hitem))))
+		{
+			zbx_vcmock_set_time(hitem, "time");
+			zbx_vcmock_get_request_params(hitem, &itemid, &value_type, &seconds, &count, &ts);
+			zbx_vc_precache_values(itemid, value_type, seconds, count, &ts);
+		}
+	}
+
+	/* perform request */
+
+	handle = zbx_mock_get_parameter_handle("in.test");
+	zbx_vcmock_set_time(handle, "time");
+
+	zbx_vcmock_get_request_params(handle, &itemid, &value_type, &seconds, &count, &ts);
+	err = zbx_vc_prefetch_values(itemid, value_type, seconds, count, &ts);
+	zbx_mock_assert_result_eq("zbx_vc_prefetch_values() return value",
+			zbx_mock_str_to_return_code(zbx_mock_get_parameter_string("out.return")), err);
+
+	/* validate prefetched values */
+
+	if (SUCCEED == zbx_vc_get_prefetched_values(&prefetched_itemid, &returned))
+	{
+		zbx_mock_assert_result_eq("zbx_vc_prefetch_values() return value", SUCCEED, err);
+		zbx_mock_assert_uint64_eq("prefetched itemid", itemid, prefetched_itemid);
+
+		zbx_vcmock_read_values(zbx_mock_get_parameter_handle("out.values"), value_type, &expected);
+		zbx_vcmock_check_records("Prefetched values", value_type, &expected, &returned);
+	}
+	else
+		zbx_mock_assert_result_eq("zbx_vc_prefetch_values() return value", FAIL, err);
+
+	zbx_history_record_vector_clean(&returned, value_type);
+	zbx_history_record_vector_clean(&expected, value_type);
+
+	/* cleanup */
+
+	zbx_vc_prefetch_clear();
+
+	zbx_vector_history_record_destroy(&returned);
+	zbx_vector_history_record_destroy(&expected);
+
+	zbx_vcmock_ds_destroy();
+
+	zbx_vc_reset();
+	zbx_vc_destroy();
+}
@@ -0,0 +1,229 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "zbxhistory.h"
+#include "dbcache.h"
+#include "history.h"
+
+/* open(), opendir() and readdir() are mapped to __real_*() in CFLAGS to bypass file system mocks */
+
+extern char	*CONFIG_HISTORY_STORAGE_DIR;
+
+static void	local_read_value(zbx_mock_handle_t hvalue, unsigned char value_type, zbx_timespec_t *ts,
+		history_value_t *value)
+{
+	const char	*str;
+
+	str = zbx_mock_get_object_member_string(hvalue, "ts");
+
+	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(str, ts))
+		fail_msg("Invalid timestamp \"%s\"", str);
+
+	str = zbx_mock_get_object_member_string(hvalue, "value");
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		value->dbl = atof(str);
+	else if (SUCCEED != is_uint64(str, &value->ui64))
+		fail_msg("Invalid unsigned value \"%s\"", str);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: appends incomplete chunk to all segment files, as left by a       *
+ *          process terminated while writing                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	local_tear_segments(const char *path)
+{
+	DIR		*dir, *block_dir;
+	struct dirent	*entry, *block_entry;
+	char		*block_path = NULL, *file_path = NULL;
+	zbx_uint32_t	head[8] = {0x4b43485a, 1000, 1, 0, 1, 0, 0, 0};
+	int		fd;
+
+	if (NULL == (dir = opendir(path)))
+		fail_msg("cannot open directory \"%s\": %s", path, zbx_strerror(errno));
+
+	while (NULL != (entry = readdir(dir)))
+	{
+		if ('.' == entry->d_name[0])
+			continue;
+
+		block_path = zbx_dsprintf(block_path, "%s/%s", path, entry->d_name);
+
+		if (NULL == (block_dir = opendir(block_path)))
+			fail_msg("cannot open directory \"%s\": %s", block_path, zbx_strerror(errno));
+
+		while (NULL != (block_entry = readdir(block_dir)))
+		{
+			if ('.' == block_entry->d_name[0])
+				continue;
+
+			file_path = zbx_dsprintf(file_path, "%s/%s", block_path, block_entry->d_name);
+
+			if (-1 == (fd = open(file_path, O_WRONLY | O_APPEND)))
+				fail_msg("cannot open file \"%s\": %s", file_path, zbx_strerror(errno));
+
+			if (sizeof(head) != write(fd, head, sizeof(head)))
+				fail_msg("cannot write file \"%s\": %s", file_path, zbx_strerror(errno));
+
+			close(fd);
+		}
+
+		closedir(block_dir);
+	}
+
+	closedir(dir);
+
+	zbx_free(file_path);
+	zbx_free(block_path);
+}
+
+static void	local_write_values(zbx_mock_handle_t hflush, unsigned char value_type)
+{
+	zbx_history_iface_t	hist;
+	zbx_mock_handle_t	hvalues, hvalue;
+	zbx_vector_ptr_t	history;
+	ZBX_DC_HISTORY		*h;
+	char			*error = NULL;
+
+	if (SUCCEED != zbx_history_local_init(&hist, value_type, &error))
+		fail_msg("cannot initialize local history storage: %s", error);
+
+	zbx_vector_ptr_create(&history);
+
+	hvalues = zbx_mock_get_object_member_handle(hflush, "values");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hvalues, &hvalue))
+	{
+		h = (ZBX_DC_HISTORY *)zbx_malloc(NULL, sizeof(ZBX_DC_HISTORY));
+		memset(h, 0, sizeof(ZBX_DC_HISTORY));
+
+		h->itemid = zbx_mock_get_object_member_uint64(hvalue, "itemid");
+		h->value_type = value_type;
+		local_read_value(hvalue, value_type, &h->ts, &h->value);
+
+		zbx_vector_ptr_append(&history, h);
+	}
+
+	zbx_mock_assert_int_eq("added values", history.values_num, hist.add_values(&hist, &history));
+	zbx_mock_assert_int_eq("flush result", FLUSH_SUCCEED, hist.flush(&hist));
+
+	hist.destroy(&hist);
+
+	zbx_vector_ptr_clear_ext(&history, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&history);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_history_iface_t		hist;
+	zbx_mock_handle_t		hflushes, hflush, hvalues, hvalue;
+	zbx_vector_history_record_t	values;
+	zbx_timespec_t			ts;
+	history_value_t			value;
+	unsigned char			value_type;
+	char				root[] = "/tmp/zbx_history_local_XXXXXX", *path, *error = NULL;
+	int				i, start, end;
+
+	ZBX_UNUSED(state);
+
+	if (NULL == mkdtemp(root))
+		fail_msg("cannot create temporary directory: %s", zbx_strerror(errno));
+
+	CONFIG_HISTORY_STORAGE_DIR = root;
+
+	value_type = zbx_mock_str_to_value_type(zbx_mock_get_parameter_string("in.value_type"));
+	path = zbx_dsprintf(NULL, "%s/%s", root, ITEM_VALUE_TYPE_FLOAT == value_type ? "dbl" : "uint");
+
+	/* each flush is written by a new storage interface, like after process restart */
+	hflushes = zbx_mock_get_parameter_handle("in.flushes");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hflushes, &hflush))
+	{
+		local_write_values(hflush, value_type);
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hflush, "torn", &hvalue))
+			local_tear_segments(path);
+	}
+
+	if (SUCCEED != zbx_history_local_init(&hist, value_type, &error))
+		fail_msg("cannot initialize local history storage: %s", error);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter_exists("in.keep_from"))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_parameter_string("in.keep_from"), &ts))
+			fail_msg("Invalid keep_from timestamp");
+
+		zbx_mock_assert_int_eq("removed time blocks", (int)zbx_mock_get_parameter_uint64("out.removed"),
+				hist.housekeep(&hist, ts.sec));
+	}
+
+	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_parameter_string("in.start"), &ts))
+		fail_msg("Invalid start timestamp");
+	start = ts.sec;
+
+	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_parameter_string("in.end"), &ts))
+		fail_msg("Invalid end timestamp");
+	end = ts.sec;
+
+	zbx_history_record_vector_create(&values);
+
+	zbx_mock_assert_result_eq("get values result", SUCCEED, hist.get_values(&hist,
+			zbx_mock_get_parameter_uint64("in.itemid"), start,
+			(int)zbx_mock_get_parameter_uint64("in.count"), end, &values));
+
+	hvalues = zbx_mock_get_parameter_handle("out.values");
+
+	for (i = 0; ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hvalues, &hvalue); i++)
+	{
+		if (i >= values.values_num)
+			fail_msg("expected more than %d values", values.values_num);
+
+		local_read_value(hvalue, value_type, &ts, &value);
+
+		zbx_mock_assert_timespec_eq("value timestamp", &ts, &values.values[i].timestamp);
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			zbx_mock_assert_double_eq("value", value.dbl, values.values[i].value.dbl);
+		else
+			zbx_mock_assert_uint64_eq("value", value.ui64, values.values[i].value.ui64);
+	}
+
+	zbx_mock_assert_int_eq("number of values", i, values.values_num);
+
+	zbx_history_record_vector_destroy(&values, value_type);
+
+	/* remove all time blocks */
+	hist.housekeep(&hist, INT_MAX);
+	hist.destroy(&hist);
+
+	if (0 != rmdir(path) || 0 != rmdir(root))
+		fail_msg("cannot remove history storage directory: %s", zbx_strerror(errno));
+
+	zbx_free(path);
+}
@@ -0,0 +1,84 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "expression_funcs_test.h"
+
+#define FUNCTIONS_MAX	16
+
+void	zbx_mock_test_entry(void **state)
+{
+	DC_FUNCTION		functions[FUNCTIONS_MAX];
+	char			*errors[FUNCTIONS_MAX];
+	zbx_mock_handle_t	hfunctions, hfunction, herrors, herror;
+	zbx_mock_error_t	err;
+	const char		*expected_error;
+	int			functions_num = 0, funcs_num, i;
+
+	ZBX_UNUSED(state);
+
+	hfunctions = zbx_mock_get_parameter_handle("in.functions");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hfunctions, &hfunction))))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read 'functions' element #%d: %s", functions_num, zbx_mock_error_string(err));
+
+		if (FUNCTIONS_MAX == functions_num)
+			fail_msg("Too many functions");
+
+		functions[functions_num].functionid = (zbx_uint64_t)functions_num + 1;
+		functions[functions_num].triggerid = (zbx_uint64_t)functions_num + 1;
+		functions[functions_num].itemid = zbx_mock_get_object_member_uint64(hfunction, "itemid");
+		functions[functions_num].function = (char *)zbx_mock_get_object_member_string(hfunction, "function");
+		functions[functions_num].parameter = (char *)zbx_mock_get_object_member_string(hfunction, "parameter");
+		functions[functions_num].type = (unsigned char)zbx_mock_get_object_member_uint64(hfunction, "type");
+		functions_num++;
+	}
+
+	zbx_funcs_error_test(functions, functions_num, zbx_mock_get_parameter_string("in.error"), &funcs_num,
+			errors);
+
+	zbx_mock_assert_int_eq("evaluated functions", (int)zbx_mock_get_parameter_uint64("out.evaluations"),
+			funcs_num);
+
+	herrors = zbx_mock_get_parameter_handle("out.errors");
+
+	for (i = 0; ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(herrors, &herror))); i++)
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != zbx_mock_string(herror, &expected_error))
+			fail_msg("Cannot read 'errors' element #%d", i);
+
+		if (i == functions_num)
+			fail_msg("Too many expected errors");
+
+		zbx_mock_assert_str_eq("error", expected_error, errors[i]);
+	}
+
+	zbx_mock_assert_int_eq("errors", functions_num, i);
+
+	for (i = 0; i < functions_num; i++)
+		zbx_free(errors[i]);
+}
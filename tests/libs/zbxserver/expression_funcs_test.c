@@ -0,0 +1,60 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "expression_funcs_test.h"
+
+void	zbx_funcs_error_test(const DC_FUNCTION *functions, int functions_num, const char *error, int *funcs_num,
+		char **errors)
+{
+	zbx_hashset_t		funcs, ifuncs;
+	zbx_hashset_iter_t	iter;
+	zbx_func_t		*func;
+	zbx_ifunc_t		*ifunc;
+	zbx_timespec_t		ts = {0, 0};
+	char			*norm = NULL;
+	size_t			norm_alloc = 0;
+	int			i;
+
+	zbx_hashset_create_ext(&ifuncs, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC,
+			ifunc_clean, ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC,
+			ZBX_DEFAULT_MEM_FREE_FUNC);
+	zbx_hashset_create_ext(&funcs, 0, func_hash_func, func_compare_func, func_clean,
+			ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+
+	for (i = 0; i < functions_num; i++)
+		func_add(&funcs, &ifuncs, &functions[i], &ts, &norm, &norm_alloc);
+
+	zbx_free(norm);
+
+	/* fail evaluation of each distinct function as zbx_evaluate_item_functions() would */
+	zbx_hashset_iter_reset(&funcs, &iter);
+	while (NULL != (func = (zbx_func_t *)zbx_hashset_iter_next(&iter)))
+		func->error = zbx_strdup(NULL, error);
+
+	*funcs_num = funcs.num_data;
+
+	for (i = 0; i < functions_num; i++)
+	{
+		ifunc = (zbx_ifunc_t *)zbx_hashset_search(&ifuncs, &functions[i].functionid);
+		errors[i] = ifunc_format_error(ifunc, ifunc->func->error);
+	}
+
+	zbx_hashset_destroy(&ifuncs);
+	zbx_hashset_destroy(&funcs);
+}
@@ -0,0 +1,28 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef EXPRESSION_FUNCS_TEST_H
+#define EXPRESSION_FUNCS_TEST_H
+
+#include "dbcache.h"
+
+void	zbx_funcs_error_test(const DC_FUNCTION *functions, int functions_num, const char *error, int *funcs_num,
+		char **errors);
+
+#endif /* EXPRESSION_FUNCS_TEST_H */
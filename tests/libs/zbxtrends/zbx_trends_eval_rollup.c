@@ -0,0 +1,238 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "zbxtrends.h"
+#include "dbcache.h"
+#include "mutexs.h"
+#include "log.h"
+
+extern zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE;
+
+#define TRENDS_TEST_ITEMID	1
+
+int	__wrap_DBis_null(const char *field);
+DB_ROW	__wrap_DBfetch(DB_RESULT result);
+DB_RESULT	__wrap_DBselect(const char *fmt, ...);
+void	__wrap_DBfree_result(DB_RESULT result);
+
+static zbx_mock_handle_t	htrends;
+static int			selects_num, select_from, select_to;
+static char			row_buf[5][ZBX_MAX_UINT64_LEN * 2];
+static char			*row[5];
+
+int	__wrap_DBis_null(const char *field)
+{
+	return NULL == field ? SUCCEED : FAIL;
+}
+
+DB_RESULT	__wrap_DBselect(const char *fmt, ...)
+{
+	va_list		args;
+	char		*sql;
+	const char	*ptr;
+
+	va_start(args, fmt);
+	sql = zbx_dvsprintf(NULL, fmt, args);
+	va_end(args);
+
+	/* the trend hours are selected by the clock range */
+	if (NULL == (ptr = strstr(sql, "clock>=")) || 1 != sscanf(ptr, "clock>=%d", &select_from))
+		fail_msg("unexpected query: %s", sql);
+
+	if (NULL == (ptr = strstr(sql, "clock<=")) || 1 != sscanf(ptr, "clock<=%d", &select_to))
+		select_to = INT_MAX;
+
+	zbx_free(sql);
+	selects_num++;
+	htrends = zbx_mock_get_parameter_handle("in.trends");
+
+	return (DB_RESULT)&htrends;
+}
+
+DB_ROW	__wrap_DBfetch(DB_RESULT result)
+{
+	zbx_mock_handle_t	htrend;
+	zbx_timespec_t		ts;
+	const char		*fields[] = {"num", "min", "avg", "max"};
+	int			i;
+
+	ZBX_UNUSED(result);
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(htrends, &htrend))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(htrend, "clock"),
+				&ts))
+		{
+			fail_msg("invalid trend clock format");
+		}
+
+		if (ts.sec < select_from || ts.sec > select_to)
+			continue;
+
+		zbx_snprintf(row_buf[0], sizeof(row_buf[0]), "%d", ts.sec);
+
+		for (i = 0; i < (int)ARRSIZE(fields); i++)
+		{
+			zbx_strlcpy(row_buf[i + 1], zbx_mock_get_object_member_string(htrend, fields[i]),
+					sizeof(row_buf[i + 1]));
+		}
+
+		for (i = 0; i < (int)ARRSIZE(row); i++)
+			row[i] = row_buf[i];
+
+		return row;
+	}
+
+	return NULL;
+}
+
+void	__wrap_DBfree_result(DB_RESULT result)
+{
+	ZBX_UNUSED(result);
+}
+
+static int	trends_get_clock(zbx_mock_handle_t handle, const char *name)
+{
+	zbx_timespec_t	ts;
+
+	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(handle, name), &ts))
+		fail_msg("invalid %s time format", name);
+
+	return ts.sec;
+}
+
+/* flush trends like history syncer does after writing them to database */
+static void	trends_flush(zbx_mock_handle_t hflush, unsigned char value_type)
+{
+	zbx_mock_handle_t	htrend;
+	ZBX_DC_TREND		*trends = NULL;
+	int			trends_num = 0;
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hflush, &htrend))
+	{
+		ZBX_DC_TREND	*trend;
+
+		trends = (ZBX_DC_TREND *)zbx_realloc(trends, sizeof(ZBX_DC_TREND) * (size_t)(trends_num + 1));
+		trend = &trends[trends_num++];
+		memset(trend, 0, sizeof(ZBX_DC_TREND));
+
+		trend->itemid = TRENDS_TEST_ITEMID;
+		trend->value_type = value_type;
+		trend->clock = trends_get_clock(htrend, "clock");
+		trend->num = zbx_mock_get_object_member_int(htrend, "num");
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			trend->value_min.dbl = zbx_mock_get_object_member_float(htrend, "min");
+			trend->value_avg.dbl = zbx_mock_get_object_member_float(htrend, "avg");
+			trend->value_max.dbl = zbx_mock_get_object_member_float(htrend, "max");
+		}
+		else
+		{
+			/* unsigned trends keep the sum of values until written to database */
+			trend->value_min.ui64 = zbx_mock_get_object_member_uint64(htrend, "min");
+			trend->value_avg.ui64.hi = zbx_mock_get_object_member_uint64(htrend, "sum_hi");
+			trend->value_avg.ui64.lo = zbx_mock_get_object_member_uint64(htrend, "sum_lo");
+			trend->value_max.ui64 = zbx_mock_get_object_member_uint64(htrend, "max");
+		}
+	}
+
+	zbx_tfc_invalidate_trends(trends, trends_num);
+	zbx_tfc_update_trends(trends, trends_num, SUCCEED);
+
+	zbx_free(trends);
+}
+
+static void	trends_eval(zbx_mock_handle_t heval, const char *table)
+{
+	const char	*function;
+	char		*error = NULL;
+	double		value;
+	int		start, end, ret;
+
+	function = zbx_mock_get_object_member_string(heval, "function");
+	start = trends_get_clock(heval, "start");
+	end = trends_get_clock(heval, "end");
+
+	selects_num = 0;
+
+	if (0 == strcmp(function, "avg"))
+		ret = zbx_trends_eval_avg(table, TRENDS_TEST_ITEMID, start, end, &value, &error);
+	else if (0 == strcmp(function, "count"))
+		ret = zbx_trends_eval_count(table, TRENDS_TEST_ITEMID, start, end, &value, &error);
+	else if (0 == strcmp(function, "min"))
+		ret = zbx_trends_eval_min(table, TRENDS_TEST_ITEMID, start, end, &value, &error);
+	else if (0 == strcmp(function, "max"))
+		ret = zbx_trends_eval_max(table, TRENDS_TEST_ITEMID, start, end, &value, &error);
+	else if (0 == strcmp(function, "sum"))
+		ret = zbx_trends_eval_sum(table, TRENDS_TEST_ITEMID, start, end, &value, &error);
+	else
+		fail_msg("unknown trend function \"%s\"", function);
+
+	if (SUCCEED != ret)
+		fail_msg("cannot evaluate %s(): %s", function, ZBX_NULL2EMPTY_STR(error));
+
+	zbx_mock_assert_double_eq("trend function value", zbx_mock_get_object_member_float(heval, "value"), value);
+	zbx_mock_assert_int_eq("trend queries", zbx_mock_get_object_member_int(heval, "selects"), selects_num);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hsteps, hstep, hdata;
+	const char		*table;
+	unsigned char		value_type;
+	char			*error = NULL;
+
+	ZBX_UNUSED(state);
+
+	if (0 != setenv("TZ", zbx_mock_get_parameter_string("in.timezone"), 1))
+		fail_msg("Cannot set 'TZ' environment variable: %s", zbx_strerror(errno));
+
+	tzset();
+
+	table = zbx_mock_get_parameter_string("in.table");
+	value_type = (0 == strcmp(table, "trends") ? ITEM_VALUE_TYPE_FLOAT : ITEM_VALUE_TYPE_UINT64);
+
+	CONFIG_TREND_FUNC_CACHE_SIZE = ZBX_MEBIBYTE;
+
+	if (SUCCEED != zbx_locks_create(&error))
+		fail_msg("cannot initialize locks: %s", error);
+
+	if (SUCCEED != zbx_tfc_init(&error))
+		fail_msg("cannot initialize trend function cache: %s", error);
+
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hsteps, &hstep))
+	{
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hstep, "flush", &hdata))
+			trends_flush(hdata, value_type);
+		else
+			trends_eval(zbx_mock_get_object_member_handle(hstep, "eval"), table);
+	}
+
+	zbx_tfc_destroy();
+	zbx_locks_destroy();
+}
@@ -0,0 +1,85 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+#include "zbxmockdb.h"
+
+#include "common.h"
+#include "zbxalgo.h"
+
+#include "escalator_get_permission_test.h"
+
+static void	mock_read_uint64_vector(zbx_mock_handle_t hvector, zbx_vector_uint64_t *values)
+{
+	zbx_mock_handle_t	hvalue;
+	zbx_uint64_t		value;
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hvector, &hvalue))
+	{
+		if (ZBX_MOCK_SUCCESS != zbx_mock_uint64(hvalue, &value))
+			fail_msg("invalid identifier");
+
+		zbx_vector_uint64_append(values, value);
+	}
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_vector_uint64_t	userids, hostgroupids;
+	zbx_mock_handle_t	hchecks, hcheck;
+
+	ZBX_UNUSED(state);
+
+	zbx_mockdb_init();
+	escalator_cache_init_test();
+
+	zbx_vector_uint64_create(&userids);
+	zbx_vector_uint64_create(&hostgroupids);
+
+	/* all recipients are loaded at once, following checks must not query database */
+	mock_read_uint64_vector(zbx_mock_get_parameter_handle("in.userids"), &userids);
+	escalator_load_users_test(&userids);
+
+	hchecks = zbx_mock_get_parameter_handle("out.permissions");
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(hchecks, &hcheck))
+	{
+		zbx_uint64_t	userid;
+		int		perm;
+
+		userid = zbx_mock_get_object_member_uint64(hcheck, "userid");
+
+		zbx_vector_uint64_clear(&hostgroupids);
+		mock_read_uint64_vector(zbx_mock_get_object_member_handle(hcheck, "hostgroupids"), &hostgroupids);
+		zbx_vector_uint64_sort(&hostgroupids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+		perm = get_hostgroups_permission_test(userid, &hostgroupids);
+
+		zbx_mock_assert_str_eq("host group permission",
+				zbx_mock_get_object_member_string(hcheck, "permission"), zbx_permission_string(perm));
+	}
+
+	zbx_vector_uint64_destroy(&hostgroupids);
+	zbx_vector_uint64_destroy(&userids);
+
+	zbx_mockdb_destroy();
+}
@@ -0,0 +1,27 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ESCALATOR_GET_PERMISSION_TEST_H
+#define ESCALATOR_GET_PERMISSION_TEST_H
+
+void	escalator_cache_init_test(void);
+void	escalator_load_users_test(const zbx_vector_uint64_t *userids);
+int	get_hostgroups_permission_test(zbx_uint64_t userid, const zbx_vector_uint64_t *hostgroupids);
+
+#endif /* ESCALATOR_GET_PERMISSION_TEST_H */
@@ -0,0 +1,128 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "db.h"
+#include "dbcache.h"
+
+#include "correlation_match_old_event_test.h"
+
+static void	mock_read_tags(const char *path, zbx_vector_ptr_t *tags)
+{
+	zbx_mock_handle_t	htags, htag;
+
+	htags = zbx_mock_get_parameter_handle(path);
+
+	while (ZBX_MOCK_SUCCESS == zbx_mock_vector_element(htags, &htag))
+	{
+		zbx_tag_t	*tag;
+
+		tag = (zbx_tag_t *)zbx_malloc(NULL, sizeof(zbx_tag_t));
+		tag->tag = zbx_strdup(NULL, zbx_mock_get_object_member_string(htag, "tag"));
+		tag->value = zbx_strdup(NULL, zbx_mock_get_object_member_string(htag, "value"));
+		zbx_vector_ptr_append(tags, tag);
+	}
+}
+
+static unsigned char	mock_str_to_operator(const char *str)
+{
+	if (0 == strcmp(str, "equal"))
+		return CONDITION_OPERATOR_EQUAL;
+
+	if (0 == strcmp(str, "not equal"))
+		return CONDITION_OPERATOR_NOT_EQUAL;
+
+	if (0 == strcmp(str, "like"))
+		return CONDITION_OPERATOR_LIKE;
+
+	if (0 == strcmp(str, "not like"))
+		return CONDITION_OPERATOR_NOT_LIKE;
+
+	fail_msg("unknown condition operator \"%s\"", str);
+
+	return CONDITION_OPERATOR_EQUAL;
+}
+
+static void	mock_read_condition(zbx_corr_condition_t *condition)
+{
+	zbx_mock_handle_t	hcondition;
+	const char		*type;
+
+	hcondition = zbx_mock_get_parameter_handle("in.condition");
+	type = zbx_mock_get_object_member_string(hcondition, "type");
+
+	if (0 == strcmp(type, "old event tag"))
+	{
+		condition->type = ZBX_CORR_CONDITION_OLD_EVENT_TAG;
+		condition->data.tag.tag = (char *)zbx_mock_get_object_member_string(hcondition, "tag");
+	}
+	else if (0 == strcmp(type, "old event tag value"))
+	{
+		condition->type = ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE;
+		condition->data.tag_value.tag = (char *)zbx_mock_get_object_member_string(hcondition, "tag");
+		condition->data.tag_value.value = (char *)zbx_mock_get_object_member_string(hcondition, "value");
+		condition->data.tag_value.op = mock_str_to_operator(
+				zbx_mock_get_object_member_string(hcondition, "operator"));
+	}
+	else if (0 == strcmp(type, "event tag pair"))
+	{
+		condition->type = ZBX_CORR_CONDITION_EVENT_TAG_PAIR;
+		condition->data.tag_pair.oldtag = (char *)zbx_mock_get_object_member_string(hcondition, "oldtag");
+		condition->data.tag_pair.newtag = (char *)zbx_mock_get_object_member_string(hcondition, "newtag");
+	}
+	else
+		fail_msg("unknown correlation condition type \"%s\"", type);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_corr_condition_t	condition;
+	DB_EVENT		event;
+	zbx_event_problem_t	problem;
+	zbx_mock_handle_t	handle;
+
+	ZBX_UNUSED(state);
+
+	memset(&condition, 0, sizeof(condition));
+	memset(&event, 0, sizeof(event));
+	memset(&problem, 0, sizeof(problem));
+
+	zbx_vector_ptr_create(&event.tags);
+	zbx_vector_ptr_create(&problem.tags);
+
+	mock_read_condition(&condition);
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("in.event", &handle))
+		mock_read_tags("in.event", &event.tags);
+
+	mock_read_tags("in.problem", &problem.tags);
+
+	zbx_mock_assert_str_eq("condition match", zbx_mock_get_parameter_string("out.result"),
+			correlation_condition_match_old_event_test(&condition, &event, &problem));
+
+	zbx_vector_ptr_clear_ext(&problem.tags, (zbx_clean_func_t)zbx_free_tag);
+	zbx_vector_ptr_destroy(&problem.tags);
+	zbx_vector_ptr_clear_ext(&event.tags, (zbx_clean_func_t)zbx_free_tag);
+	zbx_vector_ptr_destroy(&event.tags);
+}
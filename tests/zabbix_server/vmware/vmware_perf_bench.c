@@ -0,0 +1,255 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+/******************************************************************************
+ *                                                                            *
+ * Benchmark comparing vmware QueryPerf response parsing with the document    *
+ * tree and xpath (xpath) and with the streaming xml reader (reader).         *
+ *                                                                            *
+ * Build with 'make vmware_perf_bench' and run:                               *
+ *                                                                            *
+ *     ./vmware_perf_bench <response file> [runs]                             *
+ *     ./vmware_perf_bench [entities] [counters] [runs]                       *
+ *                                                                            *
+ * The first form parses a recorded QueryPerf response body. The second form  *
+ * generates a response in the same format with the specified number of       *
+ * entities and counter series per entity, two samples per series as          *
+ * requested by vmware collector.                                             *
+ *                                                                            *
+ * Each parser runs in a child process. The best time of runs and the peak    *
+ * resident set size of the child process are printed, together with the      *
+ * peak resident set size of a child process only reading the response.       *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "common.h"
+#include "log.h"
+#include "zbxself.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "vmware_perf_bench_test.h"
+
+const char	title_message[] = "vmware_perf_bench";
+const char	*usage_message[] = {"<response file> [runs] | [entities] [counters] [runs]", NULL};
+const char	*help_message[] = {NULL};
+const char	*progname = "vmware_perf_bench";
+const char	syslog_app_name[] = "vmware_perf_bench";
+
+unsigned char			program_type = ZBX_PROGRAM_TYPE_SERVER;
+ZBX_THREAD_LOCAL unsigned char	process_type = 0;
+ZBX_THREAD_LOCAL int		server_num = 0, process_num = 0;
+
+int		CONFIG_VMWARE_FREQUENCY = 60;
+int		CONFIG_VMWARE_PERF_FREQUENCY = 60;
+zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE = 8 * ZBX_MEBIBYTE;
+int		CONFIG_VMWARE_TIMEOUT = 10;
+char		*CONFIG_SOURCE_IP = NULL;
+
+/* vmware collector process is not started, self monitoring is not used */
+void	update_selfmon_counter(unsigned char state)
+{
+	ZBX_UNUSED(state);
+}
+
+void	zbx_sleep_loop(int sleeptime)
+{
+	ZBX_UNUSED(sleeptime);
+}
+
+void	zbx_on_exit(int ret)
+{
+	exit(EXIT_SUCCESS == ret ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+typedef int	(*zbx_bench_parse_func_t)(char *data, size_t len, int *values_num, char **error);
+
+static char	*bench_generate(int entities, int counters, size_t *len)
+{
+	char	*data = NULL;
+	size_t	data_alloc = 0, data_offset = 0;
+	int	i, j;
+
+	zbx_strcpy_alloc(&data, &data_alloc, &data_offset,
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+			"<soapenv:Envelope xmlns:soapenc=\"http://schemas.xmlsoap.org/soap/encoding/\""
+			" xmlns:soapenv=\"http://schemas.xmlsoap.org/soap/envelope/\""
+			" xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\""
+			" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">"
+			"<soapenv:Body><QueryPerfResponse xmlns=\"urn:vim25\">");
+
+	for (i = 0; i < entities; i++)
+	{
+		zbx_snprintf_alloc(&data, &data_alloc, &data_offset,
+				"<returnval xsi:type=\"PerfEntityMetric\">"
+				"<entity type=\"VirtualMachine\">vm-%d</entity>"
+				"<sampleInfo><timestamp>2022-03-01T10:00:00Z</timestamp><interval>20</interval>"
+				"</sampleInfo>"
+				"<sampleInfo><timestamp>2022-03-01T10:00:20Z</timestamp><interval>20</interval>"
+				"</sampleInfo>", 1000 + i);
+
+		for (j = 0; j < counters; j++)
+		{
+			/* every tenth series has no value for the last sample */
+			zbx_snprintf_alloc(&data, &data_alloc, &data_offset,
+					"<value xsi:type=\"PerfMetricIntSeries\">"
+					"<id><counterId>%d</counterId><instance>%s</instance></id>"
+					"<value>%d</value><value>%d</value>"
+					"</value>", 2 + j, 0 == j % 3 ? "" : "scsi0:0", i * j,
+					0 == j % 10 ? -1 : i + j);
+		}
+
+		zbx_strcpy_alloc(&data, &data_alloc, &data_offset, "</returnval>");
+	}
+
+	zbx_strcpy_alloc(&data, &data_alloc, &data_offset, "</QueryPerfResponse></soapenv:Body></soapenv:Envelope>");
+	*len = data_offset;
+
+	return data;
+}
+
+static char	*bench_read(const char *path, size_t *len)
+{
+	char	*data = NULL, buf[ZBX_KIBIBYTE * 64];
+	size_t	data_alloc = 0, data_offset = 0, n;
+	FILE	*f;
+
+	if (NULL == (f = fopen(path, "r")))
+		return NULL;
+
+	while (0 != (n = fread(buf, 1, sizeof(buf), f)))
+		zbx_strncpy_alloc(&data, &data_alloc, &data_offset, buf, n);
+
+	fclose(f);
+	*len = data_offset;
+
+	return data;
+}
+
+/* runs parser in child process, returns peak resident set size of the child process in kilobytes */
+static long	bench_run(const char *name, zbx_bench_parse_func_t parse, char *data, size_t len, int runs)
+{
+	pid_t		pid;
+	int		status;
+	struct rusage	usage;
+
+	fflush(stdout);
+
+	if (0 == (pid = fork()))
+	{
+		double	start, best = 0;
+		int	i, values_num = 0;
+		char	*error = NULL;
+
+		for (i = 0; i < runs; i++)
+		{
+			start = zbx_time();
+
+			if (NULL == parse)
+			{
+				/* only read the response to get resident set size baseline */
+				values_num = (int)(strlen(data) == len);
+			}
+			else if (SUCCEED != parse(data, len, &values_num, &error))
+			{
+				printf("%s: cannot parse response: %s\n", name, ZBX_NULL2EMPTY_STR(error));
+				exit(EXIT_FAILURE);
+			}
+
+			if (0 == i || zbx_time() - start < best)
+				best = zbx_time() - start;
+		}
+
+		if (NULL != parse)
+			printf("%-8s values %-8d time %9.3f ms", name, values_num, best * 1e3);
+		else
+			printf("%-8s %-15s %17s", name, "", "");
+
+		exit(EXIT_SUCCESS);
+	}
+
+	if (-1 == pid || -1 == wait4(pid, &status, 0, &usage) || !WIFEXITED(status) ||
+			EXIT_SUCCESS != WEXITSTATUS(status))
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	return usage.ru_maxrss;
+}
+
+int	main(int argc, char **argv)
+{
+	char	*data;
+	size_t	len;
+	int	runs = 5, entities = 1000, counters = 50;
+	long	base, rss;
+
+	if (1 < argc && 0 == isdigit((unsigned char)*argv[1]))
+	{
+		if (NULL == (data = bench_read(argv[1], &len)))
+		{
+			fprintf(stderr, "cannot read \"%s\": %s\n", argv[1], zbx_strerror(errno));
+			return EXIT_FAILURE;
+		}
+
+		if (2 < argc)
+			runs = atoi(argv[2]);
+	}
+	else
+	{
+		if (1 < argc)
+			entities = atoi(argv[1]);
+
+		if (2 < argc)
+			counters = atoi(argv[2]);
+
+		if (3 < argc)
+			runs = atoi(argv[3]);
+
+		if (0 >= entities || 0 >= counters)
+		{
+			fprintf(stderr, "usage: %s %s\n", progname, usage_message[0]);
+			return EXIT_FAILURE;
+		}
+
+		data = bench_generate(entities, counters, &len);
+	}
+
+	if (0 >= runs)
+	{
+		fprintf(stderr, "usage: %s %s\n", progname, usage_message[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("response %.1f KB, best of %d runs\n", (double)len / ZBX_KIBIBYTE, runs);
+
+	base = bench_run("baseline", NULL, data, len, 1);
+	printf("  peak rss %7ld KB\n", base);
+
+	rss = bench_run("xpath", vmware_parse_perf_data_xpath_test, data, len, runs);
+	printf("  peak rss %7ld KB (+%ld KB)\n", rss, rss - base);
+
+	rss = bench_run("reader", vmware_parse_perf_data_reader_test, data, len, runs);
+	printf("  peak rss %7ld KB (+%ld KB)\n", rss, rss - base);
+
+	zbx_free(data);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
+
+#include "vmware_perf_bench_test.h"
+
+/* The document tree and xpath based QueryPerf response parser, which was replaced by the */
+/* streaming parser. It is kept only as a reference for benchmark comparison.             */
+
+static int	vmware_bench_xpath_parse_entity(zbx_vmware_perf_data_t *perfdata, xmlDoc *xdoc, xmlNode *node)
+{
+	xmlXPathContext		*xpathCtx;
+	xmlXPathObject		*xpathObj;
+	xmlNodeSetPtr		nodeset;
+	char			*instance, *counter, *value;
+	int			i, ret = FAIL;
+	zbx_vector_ptr_t	*pervalues = &perfdata->values;
+	zbx_vmware_perf_value_t	*perfvalue;
+
+	xpathCtx = xmlXPathNewContext(xdoc);
+	xpathCtx->node = node;
+
+	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"*[local-name()='value']", xpathCtx)))
+		goto out;
+
+	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
+		goto out;
+
+	nodeset = xpathObj->nodesetval;
+	zbx_vector_ptr_reserve(pervalues, nodeset->nodeNr + pervalues->values_alloc);
+
+	for (i = 0; i < nodeset->nodeNr; i++)
+	{
+		if (NULL == (value = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i],
+				"*[local-name()='value'][text() != '-1'][last()]")))
+		{
+			value = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='value'][last()]");
+		}
+
+		instance = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
+				"/*[local-name()='instance']");
+		counter = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='id']"
+				"/*[local-name()='counterId']");
+
+		if (NULL != value && NULL != counter)
+		{
+			perfvalue = (zbx_vmware_perf_value_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_value_t));
+
+			ZBX_STR2UINT64(perfvalue->counterid, counter);
+			perfvalue->instance = (NULL != instance ? instance : zbx_strdup(NULL, ""));
+
+			if (0 == strcmp(value, "-1") || SUCCEED != is_uint64(value, &perfvalue->value))
+				perfvalue->value = ZBX_MAX_UINT64;
+			else if (FAIL == ret)
+				ret = SUCCEED;
+
+			zbx_vector_ptr_append(pervalues, perfvalue);
+
+			instance = NULL;
+		}
+
+		zbx_free(counter);
+		zbx_free(instance);
+		zbx_free(value);
+	}
+out:
+	xmlXPathFreeObject(xpathObj);
+	xmlXPathFreeContext(xpathCtx);
+
+	return ret;
+}
+
+static void	vmware_bench_xpath_parse(zbx_vector_ptr_t *perfdata, xmlDoc *xdoc)
+{
+	xmlXPathContext	*xpathCtx;
+	xmlXPathObject	*xpathObj;
+	xmlNodeSetPtr	nodeset;
+	int		i;
+
+	xpathCtx = xmlXPathNewContext(xdoc);
+
+	if (NULL == (xpathObj = xmlXPathEvalExpression((xmlChar *)"/*/*/*/*", xpathCtx)))
+		goto clean;
+
+	if (0 != xmlXPathNodeSetIsEmpty(xpathObj->nodesetval))
+		goto clean;
+
+	nodeset = xpathObj->nodesetval;
+	zbx_vector_ptr_reserve(perfdata, nodeset->nodeNr + perfdata->values_alloc);
+
+	for (i = 0; i < nodeset->nodeNr; i++)
+	{
+		zbx_vmware_perf_data_t	*data;
+		int			ret = FAIL;
+
+		data = (zbx_vmware_perf_data_t *)zbx_malloc(NULL, sizeof(zbx_vmware_perf_data_t));
+
+		data->id = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']");
+		data->type = zbx_xml_node_read_value(xdoc, nodeset->nodeTab[i], "*[local-name()='entity']/@type");
+		data->error = NULL;
+		zbx_vector_ptr_create(&data->values);
+
+		if (NULL != data->type && NULL != data->id)
+			ret = vmware_bench_xpath_parse_entity(data, xdoc, nodeset->nodeTab[i]);
+
+		if (SUCCEED == ret)
+			zbx_vector_ptr_append(perfdata, data);
+		else
+			vmware_free_perfdata(data);
+	}
+clean:
+	xmlXPathFreeObject(xpathObj);
+	xmlXPathFreeContext(xpathCtx);
+}
+
+static int	vmware_bench_perf_data_free(zbx_vector_ptr_t *perfdata)
+{
+	int	i, values_num = 0;
+
+	for (i = 0; i < perfdata->values_num; i++)
+		values_num += ((zbx_vmware_perf_data_t *)perfdata->values[i])->values.values_num;
+
+	zbx_vector_ptr_clear_ext(perfdata, (zbx_mem_free_func_t)vmware_free_perfdata);
+	zbx_vector_ptr_destroy(perfdata);
+
+	return values_num;
+}
+
+int	vmware_parse_perf_data_reader_test(char *data, size_t len, int *values_num, char **error)
+{
+	ZBX_HTTPPAGE		resp = {data, len + 1, len};
+	zbx_vector_ptr_t	perfdata;
+	int			ret;
+
+	zbx_vector_ptr_create(&perfdata);
+	ret = vmware_service_parse_perf_data(&perfdata, &resp, error);
+	*values_num = vmware_bench_perf_data_free(&perfdata);
+
+	return ret;
+}
+
+int	vmware_parse_perf_data_xpath_test(char *data, size_t len, int *values_num, char **error)
+{
+	ZBX_HTTPPAGE		resp = {data, len + 1, len};
+	zbx_vector_ptr_t	perfdata;
+	xmlDoc			*doc = NULL;
+
+	if (SUCCEED != zbx_soap_parse(NULL, &resp, &doc, error))
+	{
+		zbx_xml_free_doc(doc);
+		return FAIL;
+	}
+
+	zbx_vector_ptr_create(&perfdata);
+	vmware_bench_xpath_parse(&perfdata, doc);
+	*values_num = vmware_bench_perf_data_free(&perfdata);
+	zbx_xml_free_doc(doc);
+
+	return SUCCEED;
+}
+
+#endif
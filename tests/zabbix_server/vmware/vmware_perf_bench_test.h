@@ -0,0 +1,26 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef VMWARE_PERF_BENCH_TEST_H
+#define VMWARE_PERF_BENCH_TEST_H
+
+int	vmware_parse_perf_data_reader_test(char *data, size_t len, int *values_num, char **error);
+int	vmware_parse_perf_data_xpath_test(char *data, size_t len, int *values_num, char **error);
+
+#endif /* VMWARE_PERF_BENCH_TEST_H */
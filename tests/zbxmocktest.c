@@ -59,6 +59,7 @@ int	CONFIG_AVAILMAN_FORKS		= 1;
 int	CONFIG_SERVICEMAN_FORKS		= 0;
 int	CONFIG_PROBLEMHOUSEKEEPER_FORKS = 0;
 int	CONFIG_ODBCPOLLER_FORKS		= 5;
+int	CONFIG_EXPORTER_FORKS		= 0;
 
 int	CONFIG_LISTEN_PORT		= 0;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -67,10 +68,12 @@ int	CONFIG_TRAPPER_TIMEOUT		= 300;
 
 int	CONFIG_HOUSEKEEPING_FREQUENCY	= 1;
 int	CONFIG_MAX_HOUSEKEEPER_DELETE	= 5000;		/* applies for every separate field value */
+int	CONFIG_HOUSEKEEPING_PARTITION_PERIOD	= 0;
 int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
 int	CONFIG_CONFSYNCER_FREQUENCY	= 60;
+int	CONFIG_CONF_CACHE_LOAD_CONNECTIONS	= 0;
 int	CONFIG_PROBLEMHOUSEKEEPING_FREQUENCY = 60;
 
 int	CONFIG_VMWARE_FORKS		= 0;
@@ -85,8 +88,11 @@ zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 4 * 0;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 8 * 0;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * 0;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE;
+zbx_uint64_t	CONFIG_EXPORT_CACHE_SIZE;
 zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE	= 0;
 
+int	CONFIG_VALUE_CACHE_COMPRESSION	= 0;
+
 int	CONFIG_UNREACHABLE_PERIOD	= 45;
 int	CONFIG_UNREACHABLE_DELAY	= 15;
 int	CONFIG_UNAVAILABLE_DELAY	= 60;
@@ -177,6 +183,9 @@ char	*CONFIG_SOCKET_PATH			= NULL;
 char	*CONFIG_HISTORY_STORAGE_URL		= NULL;
 char	*CONFIG_HISTORY_STORAGE_OPTS		= NULL;
 int	CONFIG_HISTORY_STORAGE_PIPELINES	= 0;
+int	CONFIG_HISTORY_STORAGE_COMPRESSION	= 0;
+zbx_uint64_t	CONFIG_HISTORY_STORAGE_BULK_SIZE	= 0;
+char	*CONFIG_HISTORY_STORAGE_DIR		= NULL;
 
 /* not used in tests, defined for linking with comms.c */
 int	CONFIG_TCP_MAX_BACKLOG_SIZE	= SOMAXCONN;